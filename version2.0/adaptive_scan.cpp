@@ -0,0 +1,304 @@
+#include <stdio.h>              // printf(), fprintf()
+#include <math.h>               // logf()
+#include <vector>
+
+#include "adaptive_scan.h"
+#include "main_drivers.h"
+#include "helper_functions.h"   // convertRSSI(), xorshift32()
+#include "cc1101_config.h"
+#include "rssi_stream.h"        // enterRssiMode(), rssiUpdateRateHz()
+#include "pacer.h"              // monotonicNs()
+
+constexpr float SCAN_ACTIVITY_FLOOR = 0.01f;            // quiet channels still share spare looks evenly
+constexpr uint64_t SCAN_SETTLE_TIMEOUT_NS = 1'000'000;
+
+void scanInit(AdaptiveScan &scan, const ScanConfig &config) {
+    scan = AdaptiveScan{};
+    scan.config = config;
+    ScanConfig &c = scan.config;
+    if (c.numChannels > SCAN_MAX_CHANNELS) c.numChannels = SCAN_MAX_CHANNELS;
+    if (c.numChannels < 1) c.numChannels = 1;
+    if (c.maxRevisitSweeps < 1) c.maxRevisitSweeps = 1;
+    if (c.looksPerSweep <= 0) c.looksPerSweep = 2 * c.numChannels;
+    if (c.looksPerSweep > SCAN_MAX_LOOKS - c.numChannels) c.looksPerSweep = SCAN_MAX_LOOKS - c.numChannels;
+    if (c.maxLooksPerChannel <= 0) c.maxLooksPerChannel = c.looksPerSweep / 4;
+    if (c.maxLooksPerChannel < 1) c.maxLooksPerChannel = 1;
+
+    // stagger the mandatory looks so each sweep gets ~numChannels / maxRevisitSweeps of them
+    for (int ch = 0; ch < c.numChannels; ch++) scan.channels[ch].sinceLook = c.maxRevisitSweeps - 1 - ch % c.maxRevisitSweeps;
+}
+
+int scanPlan(AdaptiveScan &scan) {
+    const ScanConfig &config = scan.config;
+    int numChannels = config.numChannels;
+
+    if (scan.sweeps > 0) {
+        for (int c = 0; c < numChannels; c++) {
+            ScanChannel &ch = scan.channels[c];
+            if (ch.looks) {
+                ch.activity += config.activityAlpha * (ch.onsets - ch.activity);
+                ch.sinceLook = 0;
+            } else {
+                ch.sinceLook++;
+            }
+            ch.onsets = 0;
+        }
+    }
+
+    // minimum revisit rate first
+    int planned = 0;
+    for (int c = 0; c < numChannels; c++) {
+        ScanChannel &ch = scan.channels[c];
+        ch.looks = ch.sinceLook + 1 >= config.maxRevisitSweeps;
+        planned += ch.looks;
+    }
+
+    // rest of the budget by activity: D'Hondt, next look to the highest activity / (looks + 1)
+    while (planned < config.looksPerSweep) {
+        int best = -1;
+        float bestQuotient = -1.0f;
+        for (int c = 0; c < numChannels; c++) {
+            const ScanChannel &ch = scan.channels[c];
+            if (ch.looks >= config.maxLooksPerChannel) continue;
+            float quotient = (ch.activity + SCAN_ACTIVITY_FLOOR) / (ch.looks + 1);
+            if (quotient > bestQuotient) {
+                bestQuotient = quotient;
+                best = c;
+            }
+        }
+        if (best < 0) break;    // every channel at its cap
+        scan.channels[best].looks++;
+        planned++;
+    }
+
+    // smooth weighted round robin: a channel with k looks comes up about every planned / k looks
+    int current[SCAN_MAX_CHANNELS] = {};
+    for (int i = 0; i < planned; i++) {
+        int best = 0;
+        for (int c = 0; c < numChannels; c++) {
+            current[c] += scan.channels[c].looks;
+            if (current[c] > current[best]) best = c;
+        }
+        current[best] -= planned;
+        scan.order[i] = best;
+    }
+
+    scan.numLooks = planned;
+    scan.sweeps++;
+    return planned;
+}
+
+bool scanUpdate(AdaptiveScan &scan, int channel, float dbm) {
+    const ScanConfig &config = scan.config;
+    ScanChannel &ch = scan.channels[channel];
+
+    if (!ch.floorValid) {
+        ch.floor_dbm = dbm;
+        ch.floorValid = true;
+    }
+    bool active = dbm > ch.floor_dbm + config.onDb;
+    if (!active) ch.floor_dbm += (dbm < ch.floor_dbm ? config.floorFallAlpha : config.floorRiseAlpha) * (dbm - ch.floor_dbm);
+
+    if (active && !ch.lastActive) {
+        ch.onsets++;
+        ch.totalOnsets++;
+    }
+    ch.lastActive = active;
+    ch.totalLooks++;
+    return active;
+}
+
+bool scanRun(int fd, const HopTable &table, AdaptiveScan &scan, int numSweeps, uint64_t rssiWaitNs,
+             LookCallback onLook, void *ctx) {
+    if (table.plan.numChannels < scan.config.numChannels) {
+        fprintf(stderr, "ERROR: hop table has %d channels, scan needs %d\n", table.plan.numChannels,
+                scan.config.numChannels);
+        return false;
+    }
+
+    RssiModeBackup rssiBackup;
+    if (!enterRssiMode(fd, &rssiBackup)) return false;
+    HopBackup hopBackup;
+    hopBegin(fd, &hopBackup);
+    if (rssiWaitNs == 0) rssiWaitNs = (uint64_t)(2e9 / rssiUpdateRateHz(fd));
+
+    bool ok = true;
+    uint64_t unsettled = 0;
+    for (int sweep = 0; sweep < numSweeps && ok; sweep++) {
+        scanPlan(scan);
+        for (int i = 0; i < scan.numLooks; i++) {
+            int channel = scan.order[i];
+            uint64_t start = monotonicNs();
+            if (!hopToChannel(fd, table, channel, false)) {
+                ok = false;
+                break;
+            }
+            uint64_t settle = hopWaitSettled(fd, false, start, start + SCAN_SETTLE_TIMEOUT_NS);
+            if (!settle) {
+                unsettled++;
+                continue;
+            }
+            // RSSI needs a few filter periods on the new channel
+            while (monotonicNs() - start < settle + rssiWaitNs) {}
+
+            uint8_t status;
+            float dbm = convertRSSI(readRegisterWithStatus(fd, RSSI, READ_BURST, &status));
+            bool active = scanUpdate(scan, channel, dbm);
+            if (onLook) onLook(channel, dbm, active, ctx);
+        }
+    }
+    if (unsettled) fprintf(stderr, "WARNING: %llu scan looks skipped, radio didn't reach RX\n", (unsigned long long)unsettled);
+
+    hopEnd(fd, hopBackup);
+    exitRssiMode(fd, rssiBackup);
+    return ok;
+}
+
+// simulated scene: -100 dBm +-3 dB noise, 1-3 ms bursts at -70 dBm, a few busy channels
+// with frequent bursts and the rest with rare ones, busy channels move halfway through
+struct SimBurst {
+    uint64_t start_ns;
+    uint64_t end_ns;
+    bool busy;
+    bool seen;
+};
+
+struct SimScene {
+    std::vector<std::vector<SimBurst>> bursts;      // per channel, in time order
+    std::vector<size_t> next;                       // first burst not over yet
+    uint64_t duration_ns;
+    uint32_t rng;
+};
+
+constexpr uint64_t SIM_LOOK_NS = 350'000;           // hop + settle + RSSI valid (~250 us at 58 kHz BW)
+constexpr double SIM_BUSY_RATE = 20.0;              // bursts/s
+constexpr double SIM_QUIET_RATE = 0.5;
+
+static inline float uniform(uint32_t &state) {
+    return (xorshift32(state) >> 8) * (1.0f / 16777216.0f);
+}
+
+static bool simBusy(int channel, int numChannels, bool secondHalf) {
+    int period = numChannels / 4 > 0 ? numChannels / 4 : 1;
+    return channel % period == (secondHalf ? 3 : 1) % period;
+}
+
+static void buildScene(SimScene &scene, int numChannels, double seconds) {
+    scene.bursts.assign(numChannels, {});
+    scene.duration_ns = (uint64_t)(seconds * 1e9);
+    scene.rng = 12345;
+
+    for (int c = 0; c < numChannels; c++) {
+        for (int half = 0; half < 2; half++) {
+            bool busy = simBusy(c, numChannels, half);
+            double rate = busy ? SIM_BUSY_RATE : SIM_QUIET_RATE;
+            double t = half * seconds / 2;
+            double end = (half + 1) * seconds / 2;
+            while (true) {
+                t += -logf(1.0f - uniform(scene.rng)) / rate;
+                if (t >= end) break;
+                uint64_t start = (uint64_t)(t * 1e9);
+                uint64_t length = 1'000'000 + (uint64_t)(uniform(scene.rng) * 2e6);
+                if (!scene.bursts[c].empty() && start < scene.bursts[c].back().end_ns) continue;  // no overlap
+                scene.bursts[c].push_back({start, start + length, busy, false});
+            }
+        }
+    }
+}
+
+struct SimResult {
+    uint64_t busyBursts, busySeen;
+    uint64_t quietBursts, quietSeen;
+    uint64_t looks, busyLooks;
+    uint64_t worstRevisitNs;
+    uint64_t planNs, sweeps;
+};
+
+// fixed = every channel once per sweep in order, otherwise scanPlan()
+static SimResult simulateScan(SimScene &scene, const ScanConfig &config, bool fixed) {
+    static AdaptiveScan scan;
+    scanInit(scan, config);
+    int numChannels = scan.config.numChannels;
+    scene.next.assign(numChannels, 0);
+    for (auto &channel : scene.bursts)
+        for (auto &burst : channel) burst.seen = false;
+
+    SimResult result = {};
+    std::vector<uint64_t> lastLook(numChannels, 0);
+    uint64_t t = 0;
+    while (t < scene.duration_ns) {
+        int numLooks = numChannels;
+        if (!fixed) {
+            uint64_t start = monotonicNs();
+            numLooks = scanPlan(scan);
+            result.planNs += monotonicNs() - start;
+        }
+        result.sweeps++;
+
+        for (int i = 0; i < numLooks && t < scene.duration_ns; i++) {
+            int c = fixed ? i : scan.order[i];
+            t += SIM_LOOK_NS;
+
+            std::vector<SimBurst> &bursts = scene.bursts[c];
+            size_t &next = scene.next[c];
+            while (next < bursts.size() && bursts[next].end_ns <= t) next++;
+            SimBurst *burst = next < bursts.size() && bursts[next].start_ns <= t ? &bursts[next] : NULL;
+
+            float dbm = (burst ? -70.0f : -100.0f) + uniform(scene.rng) * 6.0f - 3.0f;
+            if (scanUpdate(scan, c, dbm) && burst) burst->seen = true;
+
+            if (t - lastLook[c] > result.worstRevisitNs) result.worstRevisitNs = t - lastLook[c];
+            lastLook[c] = t;
+            result.looks++;
+            result.busyLooks += simBusy(c, numChannels, t >= scene.duration_ns / 2);
+        }
+    }
+
+    for (auto &channel : scene.bursts) {
+        for (auto &burst : channel) {
+            (burst.busy ? result.busyBursts : result.quietBursts)++;
+            (burst.busy ? result.busySeen : result.quietSeen) += burst.seen;
+        }
+    }
+    return result;
+}
+
+void benchmarkAdaptiveScan(int numChannels, double seconds) {
+    SimScene scene;
+    buildScene(scene, numChannels, seconds);
+
+    printf("simulated scene: %d channels, %.0f s, %.0f us per look, 4 busy channels (%.0f bursts/s), "
+           "rest %.1f bursts/s, 1-3 ms bursts, busy channels move at %.0f s\n",
+           numChannels, seconds, SIM_LOOK_NS / 1e3, SIM_BUSY_RATE, SIM_QUIET_RATE, seconds / 2);
+
+    ScanConfig fixed;
+    fixed.numChannels = numChannels;
+    fixed.looksPerSweep = numChannels;
+
+    ScanConfig everySweep;
+    everySweep.numChannels = numChannels;
+    everySweep.looksPerSweep = 2 * numChannels;
+    everySweep.maxRevisitSweeps = 1;
+
+    ScanConfig everyFourth;
+    everyFourth.numChannels = numChannels;
+    everyFourth.looksPerSweep = numChannels;
+    everyFourth.maxRevisitSweeps = 4;
+
+    const struct { const char *name; const ScanConfig &config; bool fixed; } runs[] = {
+        {"fixed sweep", fixed, true},
+        {"adaptive, 2N looks, revisit 1", everySweep, false},
+        {"adaptive, N looks, revisit 4", everyFourth, false},
+    };
+
+    for (const auto &run : runs) {
+        SimResult r = simulateScan(scene, run.config, run.fixed);
+        uint64_t bursts = r.busyBursts + r.quietBursts;
+        printf("%-30s P(detect) busy %5.1f%%  quiet %5.1f%%  all %5.1f%%  worst revisit %6.1f ms  "
+               "looks on busy %4.1f%%  plan %5.1f us/sweep\n", run.name,
+               100.0 * r.busySeen / (r.busyBursts ? r.busyBursts : 1),
+               100.0 * r.quietSeen / (r.quietBursts ? r.quietBursts : 1),
+               100.0 * (r.busySeen + r.quietSeen) / (bursts ? bursts : 1), r.worstRevisitNs / 1e6,
+               100.0 * r.busyLooks / (r.looks ? r.looks : 1), run.fixed ? 0.0 : r.planNs / 1e3 / r.sweeps);
+    }
+}
@@ -0,0 +1,75 @@
+#ifndef ADAPTIVE_SCAN_H
+#define ADAPTIVE_SCAN_H
+
+#include <stdint.h>
+
+#include "freq_hopper.h"
+
+// Channel scan that moves dwell to where the activity is.
+//
+// A fixed sweep looks at every channel once per sweep, so a channel is revisited every
+// numChannels looks no matter how busy it is and bursts shorter than that are mostly missed.
+// Here every sweep has a budget of looks (one look = hop + RSSI read on one channel):
+//   - every channel gets a look at least every maxRevisitSweeps sweeps (quiet channels
+//     are never starved, new activity anywhere is found within that many sweeps)
+//   - the rest of the budget goes to channels by activity (EMA of burst onsets per sweep)
+//     with the D'Hondt method, capped at maxLooksPerChannel
+//   - looks of a channel are spread over the sweep (smooth weighted round robin) instead
+//     of back to back, so they cover the sweep time instead of one short window
+// A look is active when it is onDb above that channel's noise floor, an onset is an active
+// look after an inactive one on the same channel.
+
+constexpr int SCAN_MAX_CHANNELS = HOP_MAX_CHANNELS;
+constexpr int SCAN_MAX_LOOKS = 4096;                // per sweep
+
+struct ScanConfig {
+    int numChannels = 0;
+    int looksPerSweep = 0;              // dwell budget per sweep, 0 = 2 * numChannels
+    int maxRevisitSweeps = 1;           // every channel looked at at least this often
+    int maxLooksPerChannel = 0;         // per sweep, 0 = looksPerSweep / 4
+    float onDb = 10.0f;                 // active threshold above the channel noise floor
+    float activityAlpha = 0.1f;         // per sweep EMA of onsets
+    float floorRiseAlpha = 0.01f;       // noise floor EMA on inactive looks above it
+    float floorFallAlpha = 0.2f;        // ... and below it
+};
+
+struct ScanChannel {
+    float floor_dbm;
+    bool floorValid;
+    bool lastActive;                    // last look was active
+    int onsets;                         // this sweep
+    int looks;                          // planned this sweep
+    int sinceLook;                      // sweeps without a look
+    float activity;                     // EMA of onsets per sweep
+    uint64_t totalLooks;
+    uint64_t totalOnsets;
+};
+
+struct AdaptiveScan {
+    ScanConfig config;
+    ScanChannel channels[SCAN_MAX_CHANNELS];
+    uint16_t order[SCAN_MAX_LOOKS];     // channel of every look of the current sweep
+    int numLooks;
+    uint64_t sweeps;
+};
+
+void scanInit(AdaptiveScan &scan, const ScanConfig &config);
+
+// fold the last sweep into the activity and plan the next one into scan.order, returns numLooks
+// (more than looksPerSweep only when more channels hit maxRevisitSweeps than fit the budget)
+int scanPlan(AdaptiveScan &scan);
+
+// result of one look, returns true if it was active
+bool scanUpdate(AdaptiveScan &scan, int channel, float dbm);
+
+// numSweeps sweeps on a radio over the channels of a calibrated hop table (one single
+// message hop per look, freq_hopper.h), RSSI read after settle + rssiWaitNs (0 = two
+// RSSI update periods of the current config). onLook (optional) gets every look.
+typedef void (*LookCallback)(int channel, float dbm, bool active, void *ctx);
+bool scanRun(int fd, const HopTable &table, AdaptiveScan &scan, int numSweeps, uint64_t rssiWaitNs,
+             LookCallback onLook, void *ctx);
+
+// burst detection probability of fixed vs adaptive sweeps on a simulated RF scene
+void benchmarkAdaptiveScan(int numChannels, double seconds);
+
+#endif
@@ -0,0 +1,170 @@
+#include <stdio.h>              // printf()
+#include <vector>
+
+#include "burst_detector.h"
+
+// same as convertRSSI()
+static inline float rawToDbm(uint8_t raw) {
+    return (int8_t)raw * 0.5f - 74.0f;
+}
+
+void burstInit(BurstDetector &det, const BurstConfig &config, uint8_t radio, uint32_t freqHz,
+               BurstCallback callback, void *callbackCtx) {
+    det = BurstDetector{};
+    det.config = config;
+    if (det.config.preTrigger > BURST_PRE_MAX) det.config.preTrigger = BURST_PRE_MAX;
+    if (det.config.preTrigger < 0) det.config.preTrigger = 0;
+    if (det.config.minSamples < 1) det.config.minSamples = 1;
+    det.callback = callback;
+    det.callbackCtx = callbackCtx;
+    det.event.radio = radio;
+    det.event.freq_hz = freqHz;
+}
+
+static inline void addContext(BurstDetector &det, const RssiSample &sample) {
+    if (det.event.numContext < BURST_CONTEXT_MAX) det.context[det.event.numContext++] = sample;
+}
+
+static void emit(BurstDetector &det) {
+    det.postRemaining = 0;
+    det.event.context = det.context;
+    det.events++;
+    if (det.callback) det.callback(det.event, det.callbackCtx);
+}
+
+static void startBurst(BurstDetector &det, const RssiSample &sample, float dbm) {
+    // a new burst while still collecting the previous one's post trigger: ship that one now
+    if (det.postRemaining > 0) emit(det);
+
+    det.active = true;
+    det.below = 0;
+    det.event.start_ns = det.event.end_ns = sample.t_ns;
+    det.event.peak_dbm = dbm;
+    det.event.floor_dbm = det.floor_dbm;
+    det.event.numSamples = 1;
+    det.event.numContext = 0;
+    det.sum_dbm = dbm;
+    det.tail_dbm = 0;
+
+    if (det.config.preTrigger) {
+        int oldest = (det.prePos - det.preCount + BURST_PRE_MAX) % BURST_PRE_MAX;
+        for (int i = 0; i < det.preCount; i++) addContext(det, det.pre[(oldest + i) % BURST_PRE_MAX]);
+        det.preCount = 0;
+    }
+    if (det.config.preTrigger || det.config.postTrigger) addContext(det, sample);
+}
+
+// holdoff samples (below offDb) were counted while waiting, take them back out
+static void endBurst(BurstDetector &det) {
+    det.active = false;
+    det.event.numSamples -= det.below;
+    det.event.mean_dbm = (float)((det.sum_dbm - det.tail_dbm) / det.event.numSamples);
+
+    if ((int)det.event.numSamples < det.config.minSamples) {
+        det.discarded++;
+        return;
+    }
+    if (det.config.postTrigger > 0) det.postRemaining = det.config.postTrigger;
+    else emit(det);
+}
+
+void burstProcess(BurstDetector &det, const RssiSample *samples, int numSamples) {
+    const BurstConfig &cfg = det.config;
+
+    for (int i = 0; i < numSamples; i++) {
+        const RssiSample &sample = samples[i];
+        float dbm = rawToDbm(sample.raw);
+        det.samples++;
+
+        if (!det.floorValid) {
+            det.floor_dbm = dbm;
+            det.floorValid = true;
+        }
+
+        if (!det.active) {
+            if (dbm > det.floor_dbm + cfg.onDb) {
+                startBurst(det, sample, dbm);
+                continue;
+            }
+
+            if (det.postRemaining > 0) {
+                addContext(det, sample);
+                if (--det.postRemaining == 0) emit(det);
+            }
+
+            float alpha = (dbm > det.floor_dbm) ? cfg.floorRiseAlpha : cfg.floorFallAlpha;
+            det.floor_dbm += alpha * (dbm - det.floor_dbm);
+
+            if (cfg.preTrigger) {
+                det.pre[det.prePos] = sample;
+                det.prePos = (det.prePos + 1) % BURST_PRE_MAX;
+                if (det.preCount < cfg.preTrigger) det.preCount++;
+            }
+            continue;
+        }
+
+        // inside a burst
+        det.event.numSamples++;
+        det.sum_dbm += dbm;
+        if (dbm > det.event.peak_dbm) det.event.peak_dbm = dbm;
+        if (cfg.preTrigger || cfg.postTrigger) addContext(det, sample);
+
+        if (dbm < det.floor_dbm + cfg.offDb) {
+            det.below++;
+            det.tail_dbm += dbm;
+            if (det.below >= cfg.holdoffSamples) endBurst(det);
+        } else {
+            det.below = 0;
+            det.tail_dbm = 0;
+            det.event.end_ns = sample.t_ns;
+        }
+    }
+}
+
+// same end as in burstProcess() (trailing holdoff samples dropped), the post trigger gets
+// what it has so far
+void burstFlush(BurstDetector &det) {
+    if (det.active) endBurst(det);
+    if (det.postRemaining > 0) emit(det);
+}
+
+static void countEvent(const BurstEvent &, void *ctx) {
+    (*(uint64_t *)ctx)++;
+}
+
+void benchmarkBurstDetector(int numSamples) {
+    // -100 dBm +-3 dB noise with a 20 sample, -60 dBm burst every 2000 samples
+    std::vector<RssiSample> samples(numSamples);
+    uint32_t seed = 1;
+    for (int i = 0; i < numSamples; i++) {
+        seed = seed * 1103515245 + 12345;
+        float dbm = -100.0f + (int)((seed >> 16) % 13) * 0.5f - 3.0f;
+        if ((i + 1000) % 2000 < 20) dbm = -60.0f;
+        samples[i].t_ns = (uint64_t)i * 50'000;     // 20 kHz
+        samples[i].raw = (uint8_t)(int8_t)((dbm + 74.0f) * 2.0f);
+    }
+
+    static const struct { int pre; int post; const char *name; } modes[] = {
+        {0, 0, "events only"},
+        {64, 64, "+64 pre/post context"},
+    };
+
+    for (const auto &mode : modes) {
+        BurstConfig config;
+        config.preTrigger = mode.pre;
+        config.postTrigger = mode.post;
+
+        static BurstDetector det;   // ~20 KB, keep it off the stack
+        uint64_t callbacks = 0;
+        burstInit(det, config, 0, 433'920'000, countEvent, &callbacks);
+
+        uint64_t start = monotonicRawNs();
+        burstProcess(det, samples.data(), numSamples);
+        burstFlush(det);
+        uint64_t elapsed = monotonicRawNs() - start;
+
+        printf("burst detector (%s): %.1f M samples/s, %llu events (expected %d), %llu discarded\n", mode.name,
+               numSamples * 1e3 / elapsed, (unsigned long long)callbacks, (numSamples + 1000) / 2000,
+               (unsigned long long)det.discarded);
+    }
+}
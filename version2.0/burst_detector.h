@@ -0,0 +1,77 @@
+#ifndef BURST_DETECTOR_H
+#define BURST_DETECTOR_H
+
+#include <stdint.h>
+
+#include "capture_timing.h"
+
+// Streaming burst detector on one radio's RSSI samples.
+// Noise floor = EMA of samples outside bursts (falls fast, rises slowly so bursts don't
+// drag it up). A burst starts above floor + onDb, ends after holdoffSamples below
+// floor + offDb, and is dropped if shorter than minSamples. Optionally the raw samples
+// around it (pre trigger, burst body, post trigger) are kept in the event.
+
+constexpr int BURST_CONTEXT_MAX = 1024;     // raw samples kept per event (pre + body + post)
+constexpr int BURST_PRE_MAX = 256;
+
+struct BurstConfig {
+    float onDb = 10.0f;             // start threshold above noise floor
+    float offDb = 6.0f;             // end threshold above noise floor (hysteresis)
+    int minSamples = 3;             // shorter bursts are discarded
+    int holdoffSamples = 2;         // samples below offDb before a burst ends
+    float floorRiseAlpha = 0.001f;  // noise floor EMA when the sample is above the floor
+    float floorFallAlpha = 0.05f;   // ... and below it
+    int preTrigger = 0;             // raw samples kept before the start (<= BURST_PRE_MAX)
+    int postTrigger = 0;            // raw samples kept after the end
+};
+
+struct BurstEvent {
+    uint64_t start_ns;
+    uint64_t end_ns;
+    float peak_dbm;
+    float mean_dbm;
+    float floor_dbm;                // noise floor when the burst started
+    uint32_t numSamples;
+    uint32_t freq_hz;
+    uint8_t radio;
+    int numContext;                 // raw context samples (0 unless pre/postTrigger set)
+    const RssiSample *context;      // only valid inside the callback
+};
+
+typedef void (*BurstCallback)(const BurstEvent &event, void *ctx);
+
+struct BurstDetector {
+    BurstConfig config;
+    BurstCallback callback;
+    void *callbackCtx;
+
+    float floor_dbm;
+    bool floorValid;
+    bool active;                    // inside a burst
+    int below;                      // consecutive samples under offDb
+    int postRemaining;              // post trigger samples still to collect
+    BurstEvent event;               // burst being built
+    double sum_dbm;
+    double tail_dbm;                // dBm sum of the current holdoff run
+
+    RssiSample pre[BURST_PRE_MAX];  // ring of the last preTrigger samples
+    int prePos;
+    int preCount;
+    RssiSample context[BURST_CONTEXT_MAX];
+
+    uint64_t samples;               // totals
+    uint64_t events;
+    uint64_t discarded;             // bursts shorter than minSamples
+};
+
+void burstInit(BurstDetector &det, const BurstConfig &config, uint8_t radio, uint32_t freqHz,
+               BurstCallback callback, void *callbackCtx);
+void burstProcess(BurstDetector &det, const RssiSample *samples, int numSamples);
+
+// end an open burst (end of capture)
+void burstFlush(BurstDetector &det);
+
+// samples/s of burstProcess() on simulated noise with bursts
+void benchmarkBurstDetector(int numSamples);
+
+#endif
@@ -0,0 +1,116 @@
+#include <stdio.h>              // printf()
+#include <string.h>             // memset()
+#include <math.h>               // sqrt()
+
+#include "capture_timing.h"
+
+void histogramInit(Histogram &hist, int64_t low_ns, int64_t bin_ns) {
+    memset(&hist, 0, sizeof(hist));
+    hist.low_ns = low_ns;
+    hist.bin_ns = (bin_ns > 0) ? bin_ns : 1;
+    hist.min_ns = INT64_MAX;
+    hist.max_ns = INT64_MIN;
+}
+
+void histogramAdd(Histogram &hist, int64_t value_ns) {
+    int64_t bin = (value_ns - hist.low_ns) / hist.bin_ns;
+    if (value_ns < hist.low_ns)         hist.underflow++;
+    else if (bin >= HISTOGRAM_BINS)     hist.overflow++;
+    else                                hist.bins[bin]++;
+
+    hist.count++;
+    if (value_ns < hist.min_ns) hist.min_ns = value_ns;
+    if (value_ns > hist.max_ns) hist.max_ns = value_ns;
+    hist.sum_ns += value_ns;
+    hist.sumSq_ns += (double)value_ns * value_ns;
+}
+
+int64_t histogramPercentile(const Histogram &hist, double percentile) {
+    if (hist.count == 0) return 0;
+
+    uint64_t target = (uint64_t)(percentile / 100.0 * hist.count);
+    uint64_t seen = hist.underflow;
+    if (seen > target) return hist.min_ns;
+
+    for (int i = 0; i < HISTOGRAM_BINS; i++) {
+        seen += hist.bins[i];
+        if (seen > target) return hist.low_ns + (i + 1) * hist.bin_ns;
+    }
+    return hist.max_ns;
+}
+
+double histogramMean(const Histogram &hist) {
+    return hist.count ? hist.sum_ns / hist.count : 0.0;
+}
+
+double histogramStdDev(const Histogram &hist) {
+    if (hist.count < 2) return 0.0;
+    double mean = histogramMean(hist);
+    double var = hist.sumSq_ns / hist.count - mean * mean;
+    return (var > 0) ? sqrt(var) : 0.0;
+}
+
+void printHistogram(const char *title, const Histogram &hist) {
+    printf("%s: n=%llu mean=%.1f us std=%.1f us min=%.1f us max=%.1f us\n", title,
+           (unsigned long long)hist.count, histogramMean(hist) / 1e3, histogramStdDev(hist) / 1e3,
+           hist.count ? hist.min_ns / 1e3 : 0.0, hist.count ? hist.max_ns / 1e3 : 0.0);
+    printf("    p50=%.1f us p90=%.1f us p99=%.1f us p99.9=%.1f us (under=%llu over=%llu)\n",
+           histogramPercentile(hist, 50) / 1e3, histogramPercentile(hist, 90) / 1e3,
+           histogramPercentile(hist, 99) / 1e3, histogramPercentile(hist, 99.9) / 1e3,
+           (unsigned long long)hist.underflow, (unsigned long long)hist.overflow);
+
+    uint32_t peak = 1;
+    for (int i = 0; i < HISTOGRAM_BINS; i++) if (hist.bins[i] > peak) peak = hist.bins[i];
+
+    for (int i = 0; i < HISTOGRAM_BINS; i++) {
+        if (hist.bins[i] == 0) continue;
+        int bar = (int)(40.0 * hist.bins[i] / peak) + 1;
+        printf("    %8.1f us | %-41.*s %u\n", (hist.low_ns + i * hist.bin_ns) / 1e3, bar,
+               "#########################################", hist.bins[i]);
+    }
+}
+
+double measureJitter(const RssiSample *samples, int numSamples, Histogram &jitter) {
+    if (numSamples < 2) return 0.0;
+
+    double period = (double)(samples[numSamples - 1].t_ns - samples[0].t_ns) / (numSamples - 1);
+    for (int i = 1; i < numSamples; i++) {
+        int64_t interval = (int64_t)(samples[i].t_ns - samples[i - 1].t_ns);
+        histogramAdd(jitter, interval - (int64_t)period);
+    }
+    return period;
+}
+
+uint64_t countDeadlineMisses(const RssiSample *samples, int numSamples, uint64_t deadlineNs) {
+    uint64_t misses = 0;
+    for (int i = 1; i < numSamples; i++) {
+        if (samples[i].t_ns - samples[i - 1].t_ns > deadlineNs) misses++;
+    }
+    return misses;
+}
+
+// two pointer walk, both streams are in time order
+int alignSamples(const RssiSample *a, int numA, const RssiSample *b, int numB, uint64_t toleranceNs,
+                 SamplePair *pairs, int maxPairs, Histogram *skew) {
+    int numPairs = 0;
+    int i = 0, j = 0;
+
+    while (i < numA && j < numB && numPairs < maxPairs) {
+        int64_t diff = (int64_t)(b[j].t_ns - a[i].t_ns);
+
+        if (diff < -(int64_t)toleranceNs) { j++; continue; }   // b too early, no partner for it
+        if (diff > (int64_t)toleranceNs)  { i++; continue; }   // a too early
+
+        // b[j] is within tolerance of a[i], but b[j + 1] may be closer
+        if (j + 1 < numB) {
+            int64_t next = (int64_t)(b[j + 1].t_ns - a[i].t_ns);
+            if ((next < 0 ? -next : next) < (diff < 0 ? -diff : diff)) { j++; continue; }
+        }
+
+        pairs[numPairs++] = {i, j, diff};
+        if (skew) histogramAdd(*skew, diff);
+        i++;
+        j++;
+    }
+    return numPairs;
+}
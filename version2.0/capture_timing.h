@@ -0,0 +1,62 @@
+#ifndef CAPTURE_TIMING_H
+#define CAPTURE_TIMING_H
+
+#include <stdint.h>
+#include <time.h>
+
+// one RSSI read, stamped when the SPI transfer returned
+struct RssiSample {
+    uint64_t t_ns;      // CLOCK_MONOTONIC_RAW
+    uint8_t raw;        // raw RSSI register, convertRSSI() for dBm
+};
+
+// indices of two samples (radio a / radio b) that were taken close enough together
+struct SamplePair {
+    int a;
+    int b;
+    int64_t skew_ns;    // t_b - t_a
+};
+
+constexpr int HISTOGRAM_BINS = 64;
+
+// fixed width linear histogram over [low_ns, low_ns + HISTOGRAM_BINS * bin_ns)
+struct Histogram {
+    int64_t low_ns;
+    int64_t bin_ns;
+    uint32_t bins[HISTOGRAM_BINS];
+    uint64_t underflow;
+    uint64_t overflow;
+    uint64_t count;
+    int64_t min_ns;
+    int64_t max_ns;
+    double sum_ns;
+    double sumSq_ns;
+};
+
+inline uint64_t monotonicRawNs() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC_RAW, &ts);
+    return (uint64_t)ts.tv_sec * 1'000'000'000ull + ts.tv_nsec;
+}
+
+void histogramInit(Histogram &hist, int64_t low_ns, int64_t bin_ns);
+void histogramAdd(Histogram &hist, int64_t value_ns);
+int64_t histogramPercentile(const Histogram &hist, double percentile);   // upper edge of the bin holding it
+double histogramMean(const Histogram &hist);
+double histogramStdDev(const Histogram &hist);
+void printHistogram(const char *title, const Histogram &hist);
+
+// sample spacing of one radio, histogram of (t[i] - t[i-1]) - mean period
+// returns mean period in ns
+double measureJitter(const RssiSample *samples, int numSamples, Histogram &jitter);
+
+// number of sample intervals (t[i] - t[i-1]) longer than deadlineNs
+uint64_t countDeadlineMisses(const RssiSample *samples, int numSamples, uint64_t deadlineNs);
+
+// pair up samples of two radios whose timestamps are within toleranceNs (both sorted by time)
+// each sample is used at most once, skew of every pair goes into skew (if not NULL)
+// returns number of pairs written (at most maxPairs)
+int alignSamples(const RssiSample *a, int numA, const RssiSample *b, int numB, uint64_t toleranceNs,
+                 SamplePair *pairs, int maxPairs, Histogram *skew);
+
+#endif
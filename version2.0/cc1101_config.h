@@ -106,6 +106,16 @@ constexpr uint8_t SWORRST  = 0x3C;         // Reset real time clock.
 constexpr uint8_t SNOP     = 0x3D;         // No operation.
 constexpr uint8_t TXRXFIFO = 0x3F;         // Tx and Rx FIFOs
 
+// chip status byte (clocked out on MISO with every header byte, pg. 31)
+constexpr uint8_t STATUS_STATE_MASK      = 0x70;    // STATE[2:0]
+constexpr uint8_t STATUS_FIFO_BYTES_MASK = 0x0F;    // RX FIFO bytes (reads) / TX FIFO free (writes), 15 = 15+
+constexpr uint8_t STATE_IDLE             = 0x00;
+constexpr uint8_t STATE_RX               = 0x10;
+constexpr uint8_t STATE_TX               = 0x20;
+constexpr uint8_t STATE_FSTXON           = 0x30;
+constexpr uint8_t STATE_RXFIFO_OVERFLOW  = 0x60;
+constexpr uint8_t STATE_TXFIFO_UNDERFLOW = 0x70;
+
 // status regs (READ BURST OFFSET 0xC0 ALREADY INCLUDED/OR'd IN)
 constexpr uint8_t PARTNUM        = 0x30;    // (0xF0)  Part number
 constexpr uint8_t VERSION        = 0x31;    // (0xF1)  Current version number
@@ -122,6 +132,15 @@ constexpr uint8_t RXBYTES        = 0x3B;    // (0xFB)  Overflow and # of bytes i
 constexpr uint8_t RCCTRL1_STATUS = 0x3C;    // (0xFC)  Last RC Oscillator Calibration Result
 constexpr uint8_t RCCTRL0_STATUS = 0x3D;    // (0xFD)  Last RC Oscillator Calibration Result
 
+// MARCSTATE values (MARC_STATE[4:0], pg. 93)
+constexpr uint8_t MARCSTATE_MASK = 0x1F;
+constexpr uint8_t MARCSTATE_IDLE = 0x01;
+constexpr uint8_t MARCSTATE_RX   = 0x0D;
+constexpr uint8_t MARCSTATE_TX   = 0x13;
+constexpr uint8_t MARCSTATE_RXFIFO_OVERFLOW = 0x11;
+constexpr uint8_t MARCSTATE_FSTXON = 0x12;
+constexpr uint8_t MARCSTATE_TXFIFO_UNDERFLOW = 0x16;
+
 extern const uint8_t cc1100_GFSK_1_2_kb[CFG_REGISTER];
 extern const uint8_t cc1100_GFSK_38_4_kb[CFG_REGISTER];
 extern const uint8_t cc1100_GFSK_100_kb[CFG_REGISTER];
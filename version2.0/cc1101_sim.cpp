@@ -0,0 +1,440 @@
+#include <string.h>             // memset()
+#include <stdio.h>              // fprintf(), perror()
+#include <errno.h>              // errno, ENODEV
+#include <math.h>               // exp(), pow(), log10()
+#include <unistd.h>             // pipe(), write(), close(), sysconf()
+#include <linux/gpio.h>         // gpio_v2_line_event
+#include <algorithm>            // std::min()
+#include <chrono>
+
+#include "cc1101_sim.h"
+#include "relay.h"              // relayAirtimeNs()
+#include "helper_functions.h"   // calculateDataRate(), xorshift32()
+#include "spi_util.h"           // simBusWait()
+#include "capture_timing.h"     // monotonicRawNs()
+#include "pacer.h"              // monotonicNs()
+#include "cc1101_config.h"
+
+static Sim *running;            // the one simTransfer() serves
+
+void simInit(Sim &sim, int numRadios, uint32_t seed) {
+    sim.quit = false;
+    sim.spinNs = sysconf(_SC_NPROCESSORS_ONLN) > 1 ? 100'000 : 0;
+    sim.rng = seed ? seed : 1;
+    sim.numRadios = numRadios < SIM_MAX_RADIOS ? numRadios : SIM_MAX_RADIOS;
+    sim.numOnAir = 0;
+    for (SimRadio &radio : sim.radios) {
+        radio = SimRadio{};
+        radio.state = MARCSTATE_IDLE;
+        radio.peer = -1;
+        radio.edgeFd = -1;
+    }
+}
+
+int simWireGdo(Sim &sim, int radio) {
+    int fds[2];
+    if (pipe(fds) < 0) {
+        perror("pipe failed");
+        return -1;
+    }
+    sim.radios[radio].edgeFd = fds[1];
+    return fds[0];
+}
+
+static bool fifoPush(SimFifo &fifo, uint8_t byte) {
+    if (fifo.count >= 64) return false;
+    fifo.bytes[(fifo.head + fifo.count++) % 64] = byte;
+    return true;
+}
+
+static bool fifoPop(SimFifo &fifo, uint8_t *byte) {
+    if (fifo.count == 0) return false;
+    *byte = fifo.bytes[fifo.head];
+    fifo.head = (fifo.head + 1) % 64;
+    fifo.count--;
+    return true;
+}
+
+static void simEdge(SimRadio &radio, bool level, uint64_t t_ns) {
+    if (radio.edgeFd < 0) return;
+    struct gpio_v2_line_event event;
+    memset(&event, 0, sizeof(event));
+    event.timestamp_ns = t_ns;
+    event.id = level ? GPIO_V2_LINE_EVENT_RISING_EDGE : GPIO_V2_LINE_EVENT_FALLING_EDGE;
+    if (write(radio.edgeFd, &event, sizeof(event)) != sizeof(event)) perror("sim edge write failed");
+}
+
+// MCSM1 RXOFF_MODE / TXOFF_MODE
+static uint8_t offState(uint8_t mode) {
+    static const uint8_t states[4] = {MARCSTATE_IDLE, MARCSTATE_FSTXON, MARCSTATE_TX, MARCSTATE_RX};
+    return states[mode & 0x03];
+}
+
+static bool streaming(const SimRadio &radio) {
+    return (radio.regs[PKTCTRL0] & 0x03) != 0x01;
+}
+
+static bool streamTx(const SimRadio &radio) {
+    return radio.state == MARCSTATE_TX || radio.state == MARCSTATE_TXFIFO_UNDERFLOW ||
+           (radio.state == MARCSTATE_IDLE && radio.written);
+}
+
+// fixed length from byte count c on: ends at the next count with count % 256 == PKTLEN
+static void streamEndAt(SimRadio &radio, uint64_t c) {
+    uint64_t end = (c & ~255ull) + radio.regs[PKTLEN];
+    if (end < c || end == 0) end += 256;
+    radio.endAt = end;
+}
+
+// time moves the radio on: end of a packet, the byte clock of a stream (overflow, underflow, end
+// of packet). Returns the stream's byte count.
+static uint64_t advance(SimRadio &radio, uint64_t now) {
+    if (!streaming(radio)) {
+        if (radio.state == MARCSTATE_TX && now >= radio.txEnd_ns) radio.state = offState(radio.regs[MCSM1]);
+        return 0;
+    }
+    bool rx = radio.state == MARCSTATE_RX;
+    if (!rx && radio.state != MARCSTATE_TX) return radio.frozen;
+    uint64_t c = (uint64_t)((now - radio.start_ns) / radio.nsPerByte);
+    if (rx && radio.airBytes) c = std::min(c, radio.airBytes);
+    bool ended = c >= radio.endAt;
+    c = std::min(c, radio.endAt);
+    if (rx && c - radio.consumed > 64) {
+        radio.state = MARCSTATE_RXFIFO_OVERFLOW;
+        radio.frozen = radio.consumed + 64;
+        return radio.frozen;
+    }
+    if (!rx && c > radio.written) {
+        radio.state = MARCSTATE_TXFIFO_UNDERFLOW;
+        radio.frozen = radio.endedAt = radio.written;
+        return radio.frozen;
+    }
+    if (ended) {
+        radio.state = MARCSTATE_IDLE;
+        radio.frozen = radio.endedAt = c;
+    }
+    return c;
+}
+
+static int rxCount(const SimRadio &radio, uint64_t c) {
+    if (!streaming(radio)) return radio.rx.count;
+    return streamTx(radio) || c < radio.consumed ? 0 : (int)std::min<uint64_t>(c - radio.consumed, 64);
+}
+
+static int txCount(const SimRadio &radio, uint64_t c) {
+    if (!streaming(radio)) return radio.tx.count;
+    return streamTx(radio) && radio.written > c ? (int)std::min<uint64_t>(radio.written - c, 64) : 0;
+}
+
+static int fifoThreshold(const SimRadio &radio) {
+    return 4 * ((radio.regs[FIFOTHR] & 0x0F) + 1);
+}
+
+// GDO2 on a FIFO threshold (0x00 RX, 0x02 TX), else unchanged
+static bool lineLevel(const SimRadio &radio, uint64_t c) {
+    uint8_t gdo = radio.regs[IOCFG2] & 0x3F;
+    if (gdo == 0x00) return rxCount(radio, c) >= fifoThreshold(radio);
+    if (gdo == 0x02) return txCount(radio, c) >= 65 - fifoThreshold(radio);
+    return radio.level;
+}
+
+static void setLevel(SimRadio &radio, bool level, uint64_t t_ns) {
+    if (level == radio.level) return;
+    radio.level = level;
+    simEdge(radio, level, t_ns);
+}
+
+// the threshold crossing the byte clock causes next (RX filling up, TX draining): an edge that
+// already happened is stamped when it did, returns when the next one is due (0 = none coming)
+static uint64_t streamClock(SimRadio &radio, uint64_t now) {
+    uint64_t c = advance(radio, now);
+    uint8_t gdo = radio.regs[IOCFG2] & 0x3F;
+    bool level = lineLevel(radio, c);
+    if (!streaming(radio) || (gdo != 0x00 && gdo != 0x02)) {
+        setLevel(radio, level, now);
+        return 0;
+    }
+    bool rising = gdo == 0x00;                              // the way the clock moves the line
+    uint64_t txAbove = 65 - fifoThreshold(radio);
+    uint64_t cross = rising ? radio.consumed + fifoThreshold(radio)
+                            : radio.written + 1 >= txAbove ? radio.written + 1 - txAbove : 0;
+    uint64_t cross_ns = radio.start_ns + (uint64_t)(cross * radio.nsPerByte);
+    setLevel(radio, level, level != radio.level && level == rising && c >= cross ? cross_ns : now);
+    bool counting = radio.state == MARCSTATE_RX || radio.state == MARCSTATE_TX;
+    return counting && level != rising && c < cross ? cross_ns + 1 : 0;
+}
+
+static void deliver(SimRadio &radio, const uint8_t *payload, uint8_t len, bool crcOk, uint64_t now) {
+    if (radio.state != MARCSTATE_RX || streaming(radio)) return;   // not listening for packets
+    uint8_t gdo = radio.regs[IOCFG2] & 0x3F;
+    if (crcOk || !(radio.regs[PKTCTRL1] & 0x08)) {         // CRC_AUTOFLUSH
+        bool fits = fifoPush(radio.rx, len);
+        for (int i = 0; i < len; i++) fits &= fifoPush(radio.rx, payload[i]);
+        if (radio.regs[PKTCTRL1] & 0x04) {                  // APPEND_STATUS
+            fits &= fifoPush(radio.rx, 0x40);               // RSSI
+            fits &= fifoPush(radio.rx, (crcOk ? 0x80 : 0) | 12);    // CRC_OK, LQI
+        }
+        if (!fits) radio.state = MARCSTATE_RXFIFO_OVERFLOW;
+        else radio.state = offState(radio.regs[MCSM1] >> 2);
+    }
+    if (gdo == 0x06 || gdo == 0x07) simEdge(radio, false, now);
+    setLevel(radio, lineLevel(radio, 0), now);
+}
+
+static void transmit(Sim &sim, SimRadio &radio, uint64_t now) {
+    uint8_t len = radio.tx.bytes[radio.tx.head];
+    if (radio.tx.count < len + 1) {                         // runs dry during the packet
+        radio.tx.count = 0;
+        radio.state = MARCSTATE_TXFIFO_UNDERFLOW;
+        return;
+    }
+    SimPacket &packet = sim.onAir[sim.numOnAir];
+    fifoPop(radio.tx, &packet.len);
+    for (int i = 0; i < len; i++) fifoPop(radio.tx, &packet.payload[i]);
+    radio.state = MARCSTATE_TX;
+    radio.txEnd_ns = now + relayAirtimeNs(radio.regs, len);
+    if (radio.txHook) radio.txHook(packet.payload, len, radio.txHookCtx);
+    if (radio.peer < 0) return;
+    packet.eop_ns = radio.txEnd_ns;
+    packet.to = radio.peer;
+    sim.numOnAir++;                                         // simTransfer() wakes the air thread
+}
+
+static void startStream(SimRadio &radio, uint8_t state, uint64_t now) {
+    radio.state = state;
+    radio.nsPerByte = 8e9 / calculateDataRate(radio.regs[MDMCFG4] & 0x0F, radio.regs[MDMCFG3]);
+    radio.start_ns = now;
+    radio.consumed = 0;
+    radio.frozen = 0;
+    if (state == MARCSTATE_RX) radio.written = 0;
+    radio.endAt = UINT64_MAX;
+    if ((radio.regs[PKTCTRL0] & 0x03) == 0) streamEndAt(radio, 0);
+}
+
+static void strobe(Sim &sim, SimRadio &radio, uint8_t s, uint64_t c, uint64_t now) {
+    uint8_t &state = radio.state;
+    bool idle = state == MARCSTATE_IDLE || state == MARCSTATE_FSTXON;
+    switch (s) {
+    case SRES:
+        radio.rx.count = radio.tx.count = 0;
+        radio.consumed = radio.written = radio.frozen = 0;
+        state = MARCSTATE_IDLE;
+        break;
+    case SFSTXON:
+        if (state == MARCSTATE_IDLE || state == MARCSTATE_RX) state = MARCSTATE_FSTXON;
+        break;
+    case SRX:
+        if (idle && streaming(radio)) startStream(radio, MARCSTATE_RX, now);
+        else if (idle) state = MARCSTATE_RX;
+        break;
+    case STX:
+        if (!idle && state != MARCSTATE_RX) break;
+        if (streaming(radio)) startStream(radio, MARCSTATE_TX, now);
+        else if (radio.tx.count) transmit(sim, radio, now);
+        break;
+    case SIDLE:
+        radio.frozen = c;
+        state = MARCSTATE_IDLE;
+        break;
+    case SFRX:
+        if (state == MARCSTATE_IDLE || state == MARCSTATE_RXFIFO_OVERFLOW) {
+            radio.rx.count = 0;
+            radio.consumed = c;
+            state = MARCSTATE_IDLE;
+        }
+        break;
+    case SFTX:
+        if (state == MARCSTATE_IDLE || state == MARCSTATE_TXFIFO_UNDERFLOW) {
+            radio.tx.count = 0;
+            radio.written = radio.frozen = 0;
+            state = MARCSTATE_IDLE;
+        }
+        break;
+    default:                                                // SCAL, SNOP, ...: nothing to simulate
+        break;
+    }
+}
+
+static uint8_t statusByte(const SimRadio &radio, uint64_t c, bool read) {
+    uint8_t state = STATE_IDLE;
+    if (radio.state == MARCSTATE_RX) state = STATE_RX;
+    else if (radio.state == MARCSTATE_TX) state = STATE_TX;
+    else if (radio.state == MARCSTATE_FSTXON) state = STATE_FSTXON;
+    else if (radio.state == MARCSTATE_RXFIFO_OVERFLOW) state = STATE_RXFIFO_OVERFLOW;
+    else if (radio.state == MARCSTATE_TXFIFO_UNDERFLOW) state = STATE_TXFIFO_UNDERFLOW;
+    int bytes = read ? rxCount(radio, c) : 64 - txCount(radio, c);
+    return state | (bytes < 15 ? bytes : 15);
+}
+
+static uint8_t statusRegister(const SimRadio &radio, uint64_t c, uint8_t reg) {
+    switch (reg) {
+    case VERSION: return 0x14;
+    case RSSI: return 0x80;
+    case MARCSTATE: return radio.state;
+    case RXBYTES: return (radio.state == MARCSTATE_RXFIFO_OVERFLOW ? 0x80 : 0) | rxCount(radio, c);
+    case TXBYTES: return (radio.state == MARCSTATE_TXFIFO_UNDERFLOW ? 0x80 : 0) | txCount(radio, c);
+    default: return 0;
+    }
+}
+
+static uint8_t fifoRead(SimRadio &radio, uint64_t c) {
+    uint8_t byte = 0;
+    if (!streaming(radio)) {
+        if (!fifoPop(radio.rx, &byte)) radio.emptyReads++;
+    } else if (!streamTx(radio) && radio.consumed < c) {
+        byte = simStreamByte(radio.consumed++);
+    } else {
+        radio.emptyReads++;
+    }
+    return byte;
+}
+
+static void fifoWrite(SimRadio &radio, uint64_t c, uint8_t byte) {
+    if (!streaming(radio)) {
+        if (!fifoPush(radio.tx, byte)) radio.fullWrites++;
+    } else if (radio.written >= c + 64) {
+        radio.fullWrites++;
+    } else {
+        if (byte != simStreamByte(radio.written)) radio.dataErrors++;
+        radio.written++;
+    }
+}
+
+static void access(Sim &sim, SimRadio &radio, const uint8_t *tx, uint8_t *rx, uint32_t len, uint64_t now) {
+    uint64_t c = advance(radio, now);
+    uint8_t header = tx[0];
+    uint8_t addr = header & 0x3F;
+    bool read = header & 0x80;
+    bool burst = header & 0x40;
+    if (rx) rx[0] = statusByte(radio, c, read);
+
+    if (addr == TXRXFIFO) {
+        for (uint32_t i = 1; i < len; i++) {
+            if (!read) fifoWrite(radio, c, tx[i]);
+            else if (rx) rx[i] = fifoRead(radio, c);
+            else fifoRead(radio, c);
+        }
+    } else if (len == 1 && addr >= SRES) {
+        strobe(sim, radio, addr, c, now);
+    } else if (addr >= SRES && burst && read) {             // status registers, PATABLE not simulated
+        if (rx) rx[1] = statusRegister(radio, c, addr);
+    } else if (addr < CFG_REGISTER) {
+        bool counting = radio.state == MARCSTATE_RX || radio.state == MARCSTATE_TX;
+        bool infinite = radio.endAt == UINT64_MAX;
+        for (uint32_t i = 1; i < len; i++) {
+            uint8_t reg = burst ? addr + i - 1 : addr;
+            if (reg >= CFG_REGISTER) break;
+            if (read && rx) rx[i] = radio.regs[reg];
+            else if (!read) radio.regs[reg] = tx[i];
+        }
+        // switched to fixed length in the middle of a stream
+        if (streaming(radio) && counting && infinite && (radio.regs[PKTCTRL0] & 0x03) == 0) streamEndAt(radio, c);
+    }
+    setLevel(radio, lineLevel(radio, advance(radio, now)), now);
+}
+
+int simTransfer(int fd, struct spi_ioc_transfer *xfers, int numXfers) {
+    Sim *sim = running;
+    int r = SIM_FD - fd;
+    if (!sim || r < 0 || r >= sim->numRadios) {
+        errno = ENODEV;
+        return -1;
+    }
+    uint64_t start = monotonicRawNs();
+    {
+        std::lock_guard<std::mutex> guard(sim->lock);
+        for (int x = 0; x < numXfers; x++)
+            access(*sim, sim->radios[r], (const uint8_t *)xfers[x].tx_buf, (uint8_t *)xfers[x].rx_buf,
+                   xfers[x].len, monotonicNs());
+    }
+    sim->wake.notify_one();                                 // a packet on air, the next byte clock edge moved
+    return simBusWait(start, xfers, numXfers);
+}
+
+void simReceive(Sim &sim, int radio, const uint8_t *payload, uint8_t len) {
+    std::lock_guard<std::mutex> guard(sim.lock);
+    uint64_t now = monotonicNs();
+    advance(sim.radios[radio], now);
+    deliver(sim.radios[radio], payload, len, true, now);
+}
+
+// packets that end: into the peer's FIFO (unless a bit was hit). Byte clocks: threshold edges.
+static void simAir(Sim &sim) {
+    std::unique_lock<std::mutex> guard(sim.lock);
+    while (!sim.quit) {
+        uint64_t now = monotonicNs();
+        uint64_t next = 0;
+        for (int i = 0; i < sim.numOnAir;) {
+            SimPacket &packet = sim.onAir[i];
+            if (packet.eop_ns > now) {
+                if (!next || packet.eop_ns < next) next = packet.eop_ns;
+                i++;
+                continue;
+            }
+            SimRadio &radio = sim.radios[packet.to];
+            double pOk = pow(1.0 - radio.bitErrorRate, (packet.len + 3) * 8);     // length, payload, CRC
+            bool crcOk = radio.bitErrorRate <= 0 || xorshift32(sim.rng) / 4294967296.0 < pOk;
+            advance(radio, now);
+            deliver(radio, packet.payload, packet.len, crcOk, now);
+            packet = sim.onAir[--sim.numOnAir];
+        }
+        for (int r = 0; r < sim.numRadios; r++) {
+            uint64_t due = streamClock(sim.radios[r], now);
+            if (due && (!next || due < next)) next = due;
+        }
+
+        uint64_t wakeAt = next > sim.spinNs ? next - sim.spinNs : next;
+        if (!next) {
+            sim.wake.wait(guard);
+        } else if (now < wakeAt) {
+            sim.wake.wait_until(guard, std::chrono::steady_clock::time_point(std::chrono::nanoseconds(wakeAt)));
+        } else {                                            // spin the rest: on time like the chip's
+            guard.unlock();
+            while (monotonicNs() < next) {}
+            guard.lock();
+        }
+    }
+}
+
+bool simStart(Sim &sim) {
+    if (running) {
+        fprintf(stderr, "ERROR: a simulation is already running\n");
+        return false;
+    }
+    running = &sim;
+    sim.air = std::thread(simAir, std::ref(sim));
+    return true;
+}
+
+void simStop(Sim &sim) {
+    {
+        std::lock_guard<std::mutex> guard(sim.lock);
+        sim.quit = true;
+    }
+    sim.wake.notify_one();
+    sim.air.join();
+    running = NULL;
+    for (SimRadio &radio : sim.radios) {
+        if (radio.edgeFd >= 0) close(radio.edgeFd);
+        radio.edgeFd = -1;
+    }
+}
+
+uint8_t simPacketByte(uint8_t address, uint32_t seq, int i) {
+    if (i == 0) return address;
+    if (i <= 4) return (seq >> (8 * (i - 1))) & 0xFF;
+    return (uint8_t)(seq * 7 + i);
+}
+
+uint8_t simStreamByte(uint64_t i) {
+    return (uint8_t)((i * 2654435761ull) >> 13);
+}
+
+double simBitErrorRate(const uint8_t *regs, float rxPowerDbm, float noiseFigureDb) {
+    double rate = calculateDataRate(regs[MDMCFG4] & 0x0F, regs[MDMCFG3]);
+    double ebn0Db = rxPowerDbm - (-174.0 + 10 * log10(rate) + noiseFigureDb);
+    if (regs[MDMCFG1] & 0x80) ebn0Db += 3.0;               // FEC
+    double ebn0 = pow(10.0, ebn0Db / 10);
+    bool ook = ((regs[MDMCFG2] >> 4) & 0x07) == 3;
+    return 0.5 * exp(-ebn0 / (ook ? 4 : 2));
+}
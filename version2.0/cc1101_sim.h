@@ -0,0 +1,121 @@
+#ifndef CC1101_SIM_H
+#define CC1101_SIM_H
+
+#include <stdint.h>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+#include <linux/spi/spidev.h>   // spi_ioc_transfer
+
+// Simulated CC1101s for the benchmarks behind simTransfer() (a SpiTransferFn), so the code under
+// test runs unchanged: config registers, strobes and MARCSTATE, the 64 byte RX / TX FIFOs with
+// overflow / underflow, the chip status byte, RXBYTES / TXBYTES. Every message takes the bus time
+// of a Pi (simBusWait(), spi_util.h). GDO2 edges go into a pipe in the GPIO event format, so
+// gpioReadEdges() reads them like a line's, stamped when the level changed.
+//
+// Packets (PKTCTRL0.LENGTH_CONFIG = 1): STX takes the packet out of the TX FIFO and puts it on air
+// for relayAirtimeNs(), then the radio goes to TXOFF_MODE. At its end it lands in the peer's RX
+// FIFO if the peer is in RX: length, payload and with APPEND_STATUS RSSI, LQI | CRC_OK. A packet
+// with a bit error (bitErrorRate of the receiver, per bit) is dropped with CRC_AUTOFLUSH, else
+// kept with CRC_OK clear. GDO2 = 0x06 / 0x07 falls at the end of every packet; the sync word's
+// rising edge, address and length filters and CCA aren't simulated.
+//
+// Streams (LENGTH_CONFIG = 0 / 2): a byte clock at the data rate runs from SRX / STX. RX bytes
+// (simStreamByte()) arrive with it, up to airBytes; TX bytes leave with it and are checked against
+// the same pattern. Infinite length runs until SIDLE; fixed length, also when switched to in the
+// middle, ends at the next byte count with count % 256 = PKTLEN, like the chip's counter, and the
+// radio goes to IDLE (the RXOFF / TXOFF modes aren't simulated here).
+//
+// GDO2 = 0x00 / 0x02 follows the RX / TX FIFO threshold (FIFOTHR) in both. Crossings the byte clock
+// causes are found by the air thread and stamped when they happened; with more than one cpu it
+// spins the last 100 us before one so the edge is delivered on time, on one cpu that would only
+// starve the code under test.
+//
+// One simulation per process at a time, all its radios behind one lock.
+
+constexpr int SIM_MAX_RADIOS = 4;
+constexpr int SIM_FD = -100;                // radio i is fd SIM_FD - i
+
+// every packet a radio puts on air (payload = address + data), called under the lock
+typedef void (*SimTxHook)(const uint8_t *payload, uint8_t len, void *ctx);
+
+struct SimFifo {
+    uint8_t bytes[64];
+    int head;
+    int count;
+};
+
+struct SimRadio {
+    uint8_t regs[0x30];                     // config registers
+    uint8_t state;                          // MARCSTATE
+    int peer;                               // radio that hears this one, -1 = nobody
+    double bitErrorRate;                    // of the packets this one receives
+    SimTxHook txHook;
+    void *txHookCtx;
+    int edgeFd;                             // GDO2 events (write end of a pipe), -1 = not wired
+    bool level;                             // GDO2 as last reported (FIFO thresholds)
+
+    // packets
+    SimFifo rx;
+    SimFifo tx;
+    uint64_t txEnd_ns;                      // packet on air until
+
+    // streams: byte counts since SRX / STX
+    uint64_t airBytes;                      // RX: what the other side sends, 0 = endless
+    double nsPerByte;
+    uint64_t start_ns;                      // SRX / STX
+    uint64_t frozen;                        // byte count once it stopped counting
+    uint64_t endAt;                         // where the packet ends, UINT64_MAX = infinite length
+    uint64_t consumed;                      // RX: read out of the FIFO
+    uint64_t written;                       // TX: written into the FIFO
+    uint64_t endedAt;                       // where the packet ended (or ran dry)
+    uint64_t dataErrors;                    // TX bytes not simStreamByte() of their count
+
+    uint64_t emptyReads;                    // RX FIFO bytes read that weren't there
+    uint64_t fullWrites;                    // TX FIFO bytes written into a full FIFO
+};
+
+struct SimPacket {
+    uint64_t eop_ns;
+    int to;
+    uint8_t len;
+    uint8_t payload[64];
+};
+
+struct Sim {
+    std::mutex lock;
+    std::condition_variable wake;
+    std::thread air;
+    bool quit;
+    uint64_t spinNs;                        // before a byte clock edge, 0 on one cpu
+    uint32_t rng;                           // bit errors
+    SimRadio radios[SIM_MAX_RADIOS];
+    int numRadios;
+    SimPacket onAir[SIM_MAX_RADIOS];        // one per transmitting radio at most
+    int numOnAir;
+};
+
+// numRadios radios in IDLE, registers zero, not wired, endless RX streams. seed: bit errors
+void simInit(Sim &sim, int numRadios, uint32_t seed);
+// read end of a pipe that gets radio's GDO2 events (the caller closes it), -1 on failure
+int simWireGdo(Sim &sim, int radio);
+// air thread, simTransfer() serves sim from here on
+bool simStart(Sim &sim);
+// closes the GDO write ends
+void simStop(Sim &sim);
+
+inline int simFd(int radio) { return SIM_FD - radio; }
+int simTransfer(int fd, struct spi_ioc_transfer *xfers, int numXfers);
+
+// a packet from a radio outside the simulation ends on radio now
+void simReceive(Sim &sim, int radio, const uint8_t *payload, uint8_t len);
+
+// byte i of benchmark packet seq: address, seq (4 bytes little endian), then a pattern
+uint8_t simPacketByte(uint8_t address, uint32_t seq, int i);
+// byte i of a stream
+uint8_t simStreamByte(uint64_t i);
+// noncoherent FSK / OOK bit error rate of the profile at rxPowerDbm over kTB (B = data rate) + NF
+double simBitErrorRate(const uint8_t *regs, float rxPowerDbm, float noiseFigureDb);
+
+#endif
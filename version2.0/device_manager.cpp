@@ -0,0 +1,118 @@
+#include <stdio.h>              // snprintf(), printf()
+#include <string.h>             // memset(), strncpy()
+#include <unistd.h>             // close(), sysconf()
+#include <pthread.h>            // pthread_setaffinity_np()
+#include <sched.h>              // cpu_set_t
+#include <thread>
+
+#include "device_manager.h"
+#include "main_drivers.h"
+#include "cc1101_config.h"
+#include "spi_trace.h"       // spiExists(), spiClose()
+
+// a floating MISO reads all 0s or all 1s, a real cc1101 has PARTNUM 0x00 and a nonzero VERSION
+static bool looksLikeCC1101(uint8_t partnum, uint8_t version) {
+    return partnum == 0x00 && version != 0x00 && version != 0xFF;
+}
+
+// open + probe one device, fills radio on success
+static bool probeRadio(const char *path, Radio &radio) {
+    int fd = openSPI(path);
+    if (fd < 0) return false;
+
+    uint8_t partnum = readRegister(fd, PARTNUM, READ_BURST, 1, NULL);
+    uint8_t version = readRegister(fd, VERSION, READ_BURST, 1, NULL);
+    if (!looksLikeCC1101(partnum, version)) {
+        printf("%s: no cc1101 (PARTNUM: 0x%02X, VERSION: 0x%02X)\n", path, partnum, version);
+        spiClose(fd);
+        return false;
+    }
+
+    memset(&radio, 0, sizeof(radio));
+    strncpy(radio.path, path, sizeof(radio.path) - 1);
+    radio.fd = fd;
+    radio.partnum = partnum;
+    radio.version = version;
+
+    unsigned bus = 0, cs = 0;
+    sscanf(path, "/dev/spidev%u.%u", &bus, &cs);
+    radio.bus = bus;
+    radio.cs = cs;
+    return true;
+}
+
+// index, gdo line and cpu depend on the order the radios were found
+static void assignRadio(Radio &radio, int index, const int *gdoLines, int numGdoLines) {
+    long numCpus = sysconf(_SC_NPROCESSORS_ONLN);
+    radio.index = index;
+    radio.gdoLine = (gdoLines && index < numGdoLines) ? gdoLines[index] : -1;
+    radio.cpu = (numCpus > 0) ? index % numCpus : -1;
+}
+
+int enumerateRadios(Radio *radios, int maxRadios, const int *gdoLines, int numGdoLines) {
+    int numRadios = 0;
+    for (int bus = 0; bus < MAX_SPI_BUS && numRadios < maxRadios; bus++) {
+        for (int cs = 0; cs < MAX_SPI_CS && numRadios < maxRadios; cs++) {
+            char path[32];
+            snprintf(path, sizeof(path), "/dev/spidev%d.%d", bus, cs);
+            if (!spiExists(path)) continue;
+
+            if (probeRadio(path, radios[numRadios])) {
+                assignRadio(radios[numRadios], numRadios, gdoLines, numGdoLines);
+                numRadios++;
+            }
+        }
+    }
+    return numRadios;
+}
+
+int openRadios(Radio *radios, const char *const *paths, int numPaths, const int *gdoLines, int numGdoLines) {
+    int numRadios = 0;
+    for (int i = 0; i < numPaths && numRadios < MAX_RADIOS; i++) {
+        if (probeRadio(paths[i], radios[numRadios])) {
+            assignRadio(radios[numRadios], numRadios, gdoLines, numGdoLines);
+            numRadios++;
+        }
+    }
+    return numRadios;
+}
+
+void closeRadios(Radio *radios, int numRadios) {
+    for (int i = 0; i < numRadios; i++) {
+        if (radios[i].fd >= 0) spiClose(radios[i].fd);
+        radios[i].fd = -1;
+    }
+}
+
+static void pinToCpu(int cpu) {
+    if (cpu < 0) return;
+
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    int err = pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+    if (err) fprintf(stderr, "WARNING: could not pin thread to cpu %d (%s)\n", cpu, strerror(err));
+}
+
+void runOnRadios(Radio *radios, int numRadios, int numThreads, RadioWork work, void *ctx) {
+    if (numRadios <= 0) return;
+    if (numRadios > MAX_RADIOS) numRadios = MAX_RADIOS;
+    if (numThreads < 1) numThreads = 1;
+    if (numThreads > numRadios) numThreads = numRadios;
+
+    Radio *shards[MAX_RADIOS][MAX_RADIOS];
+    int shardSizes[MAX_RADIOS] = {0};
+    for (int i = 0; i < numRadios; i++) {
+        int t = i % numThreads;
+        shards[t][shardSizes[t]++] = &radios[i];
+    }
+
+    std::thread threads[MAX_RADIOS];
+    for (int t = 0; t < numThreads; t++) {
+        threads[t] = std::thread([&, t]() {
+            pinToCpu(shards[t][0]->cpu);
+            work(shards[t], shardSizes[t], ctx);
+        });
+    }
+    for (int t = 0; t < numThreads; t++) threads[t].join();
+}
@@ -0,0 +1,37 @@
+#ifndef DEVICE_MANAGER_H
+#define DEVICE_MANAGER_H
+
+#include <stdint.h>
+
+constexpr int MAX_RADIOS   = 8;
+constexpr int MAX_SPI_BUS  = 7;     // scans /dev/spidev0.0 - /dev/spidev6.x
+constexpr int MAX_SPI_CS   = 4;
+
+struct Radio {
+    char path[32];      // /dev/spidevB.C
+    int fd;
+    int index;          // position in the radio array (0..numRadios-1)
+    uint8_t bus;        // B
+    uint8_t cs;         // C
+    uint8_t partnum;    // datasheet says 0x00
+    uint8_t version;    // datasheet says 0x14 (0x04 on older parts)
+    int gdoLine;        // gpio line (BCM) wired to this radio's GDO, -1 = none
+    int cpu;            // cpu its worker thread is pinned to, -1 = don't pin
+};
+
+// open + probe every /dev/spidevB.C, keep the ones that answer like a cc1101
+// gdoLines[i] is assigned to the i'th radio found (-1 past numGdoLines)
+// returns number of radios found
+int enumerateRadios(Radio *radios, int maxRadios, const int *gdoLines, int numGdoLines);
+
+// open + probe an explicit list of device paths, returns number of radios that answered
+int openRadios(Radio *radios, const char *const *paths, int numPaths, const int *gdoLines, int numGdoLines);
+
+void closeRadios(Radio *radios, int numRadios);
+
+// run work over all radios split into numThreads shards (radio i -> shard i % numThreads)
+// each shard thread is pinned to the cpu of its first radio, blocks until all shards return
+typedef void (*RadioWork)(Radio **shard, int shardSize, void *ctx);
+void runOnRadios(Radio *radios, int numRadios, int numThreads, RadioWork work, void *ctx);
+
+#endif
@@ -0,0 +1,336 @@
+#include <string.h>             // memset(), memcpy(), memcmp()
+#include <stdio.h>              // printf(), fprintf()
+#include <math.h>               // logf(), log10f(), expf()
+#include <algorithm>            // std::sort()
+#include <vector>
+
+#include "diversity.h"
+#include "main_drivers.h"
+#include "helper_functions.h"   // calculateFreqWord()
+#include "radio_coro.h"
+#include "shm_ring.h"
+#include "pacer.h"              // monotonicNs()
+#include "cc1101_config.h"
+
+void divInit(DiversityCombiner &comb, const DiversityConfig &config, DiversityCallback callback, void *ctx) {
+    comb = DiversityCombiner{};
+    comb.config = config;
+    if (comb.config.numBranches < 1) comb.config.numBranches = 1;
+    if (comb.config.numBranches > DIV_MAX_BRANCHES) comb.config.numBranches = DIV_MAX_BRANCHES;
+    comb.callback = callback;
+    comb.callbackCtx = ctx;
+    histogramInit(comb.addedLatency, 0, comb.config.windowNs / 32 + 1);    // window in 32 bins, rest overflow
+}
+
+// FNV-1a, length folded in
+static uint64_t packetHash(const uint8_t *data, uint8_t len) {
+    uint64_t h = 0xCBF29CE484222325ull ^ len;
+    for (int i = 0; i < len; i++) h = (h ^ data[i]) * 0x100000001B3ull;
+    return h;
+}
+
+// lower LQI = better link on the cc1101, RSSI breaks ties
+static bool betterCopy(const DiversityCopy &a, const DiversityCopy &b) {
+    if (a.lqi != b.lqi) return a.lqi < b.lqi;
+    return a.rssiDbm > b.rssiDbm;
+}
+
+static void deliver(DiversityCombiner &comb, DivPending &p, uint64_t now_ns) {
+    p.delivered = true;
+    comb.delivered++;
+    comb.branches[p.best.branch].selected++;
+    histogramAdd(comb.addedLatency, now_ns - p.first_ns);
+    if (comb.callback) comb.callback({&p.best, p.first_ns, now_ns, p.branchMask}, comb.callbackCtx);
+}
+
+static void retire(DiversityCombiner &comb, DivPending &p, uint64_t now_ns) {
+    if (!p.delivered) deliver(comb, p, now_ns);
+    if (__builtin_popcount(p.branchMask) == 1) comb.branches[p.best.branch].unique++;
+    p.used = false;
+}
+
+void divAdd(DiversityCombiner &comb, const DiversityCopy &copy) {
+    if (copy.branch >= comb.config.numBranches) return;
+    DiversityBranchStats &b = comb.branches[copy.branch];
+    b.received++;
+    if (!copy.crcOk) {
+        b.crcFail++;
+        return;
+    }
+    b.crcOk++;
+    b.rssiSum += copy.rssiDbm;
+    b.lqiSum += copy.lqi;
+
+    uint64_t hash = packetHash(copy.data, copy.len);
+    uint8_t bit = 1 << copy.branch;
+    DivPending *slot = NULL, *oldest = NULL;
+    for (DivPending &p : comb.pending) {
+        if (!p.used) {
+            if (!slot) slot = &p;
+            continue;
+        }
+        if (p.hash == hash && copy.t_ns - p.first_ns <= comb.config.windowNs && !(p.branchMask & bit) &&
+            p.best.len == copy.len && !memcmp(p.best.data, copy.data, copy.len)) {
+            p.branchMask |= bit;
+            if (p.delivered) {
+                comb.duplicates++;
+                return;
+            }
+            if (betterCopy(copy, p.best)) p.best = copy;
+            if (__builtin_popcount(p.branchMask) == comb.config.numBranches) deliver(comb, p, copy.t_ns);
+            return;
+        }
+        if (!oldest || p.first_ns < oldest->first_ns) oldest = &p;
+    }
+
+    if (!slot) {                // more than DIV_MAX_PENDING inside the window, close the oldest early
+        retire(comb, *oldest, copy.t_ns);
+        slot = oldest;
+    }
+    slot->used = true;
+    slot->delivered = false;
+    slot->hash = hash;
+    slot->first_ns = copy.t_ns;
+    slot->branchMask = bit;
+    slot->best = copy;
+    if (comb.config.mode == DIV_FIRST_OK || comb.config.numBranches == 1) deliver(comb, *slot, copy.t_ns);
+}
+
+void divFlush(DiversityCombiner &comb, uint64_t now_ns) {
+    for (DivPending &p : comb.pending)
+        if (p.used && now_ns - p.first_ns > comb.config.windowNs)
+            retire(comb, p, now_ns < UINT64_MAX ? now_ns : p.first_ns + comb.config.windowNs);
+}
+
+void printDiversityStats(const DiversityCombiner &comb) {
+    for (int i = 0; i < comb.config.numBranches; i++) {
+        const DiversityBranchStats &b = comb.branches[i];
+        printf("    branch %d: %7llu received  %7llu CRC OK  %6llu CRC fail  %7llu selected  %6llu only here"
+               "  mean %6.1f dBm  LQI %5.1f\n",
+               i, (unsigned long long)b.received, (unsigned long long)b.crcOk, (unsigned long long)b.crcFail,
+               (unsigned long long)b.selected, (unsigned long long)b.unique, b.crcOk ? b.rssiSum / b.crcOk : 0.0,
+               b.crcOk ? b.lqiSum / b.crcOk : 0.0);
+    }
+}
+
+uint64_t divPublishStats(ShmRingWriter &ring, const DiversityCombiner &comb, uint64_t t_ns) {
+    float values[DIV_MAX_BRANCHES * DIV_STAT_FIELDS];
+    int n = 0;
+    for (int i = 0; i < comb.config.numBranches; i++) {
+        const DiversityBranchStats &b = comb.branches[i];
+        values[n++] = b.received;
+        values[n++] = b.crcOk;
+        values[n++] = b.crcFail;
+        values[n++] = b.selected;
+        values[n++] = b.unique;
+        values[n++] = b.crcOk ? b.rssiSum / b.crcOk : 0.0f;
+        values[n++] = b.crcOk ? b.lqiSum / b.crcOk : 0.0f;
+    }
+    ShmSlotHeader frame = {};
+    frame.type = SHM_FRAME_DIVERSITY;
+    frame.t_ns = t_ns;
+    return shmRingPublish(ring, frame, values, n * sizeof(float));
+}
+
+bool diversityTune(Radio *radios, int numRadios, const uint8_t *profile, uint32_t freqHz) {
+    uint8_t regs[CFG_REGISTER];
+    memcpy(regs, profile, CFG_REGISTER);
+    uint32_t word = calculateFreqWord(freqHz);
+    regs[FREQ2] = (word >> 16) & 0xFF;
+    regs[FREQ1] = (word >> 8) & 0xFF;
+    regs[FREQ0] = word & 0xFF;
+    regs[PKTCTRL1] &= ~0x08;        // CRC_AUTOFLUSH off: CRC failed copies reach the host and count in crcFail
+
+    bool ok = true;
+    for (int i = 0; i < numRadios; i++) {
+        int fd = radios[i].fd;
+        sendStrobe(fd, SIDLE);
+        writeRegister(fd, IOCFG2, regs, WRITE_BURST, CFG_REGISTER);
+        uint8_t fscal[3];
+        if (!calibrateSynthesizer(fd, fscal, 5'000'000)) {        // every VCO needs its own
+            fprintf(stderr, "ERROR: %s did not calibrate\n", radios[i].path);
+            ok = false;
+            continue;
+        }
+        sendStrobe(fd, SFRX);
+        sendStrobe(fd, SRX);
+    }
+    for (int i = 0; i < numRadios; i++) {
+        uint8_t marcstate = readRegister(radios[i].fd, MARCSTATE, READ_BURST, 1, NULL) & MARCSTATE_MASK;
+        if (marcstate != MARCSTATE_RX) {
+            fprintf(stderr, "ERROR: %s not in RX after tuning (MARCSTATE = 0x%02X)\n", radios[i].path, marcstate);
+            ok = false;
+        }
+    }
+    return ok;
+}
+
+struct DivRun {
+    DiversityCombiner *comb;
+    ShmRingWriter *ring;
+    uint64_t end;
+};
+
+static Task<> divBranch(CoRadio &radio, int branch, DivRun &run) {
+    for (uint64_t now = monotonicNs(); now < run.end; now = monotonicNs()) {
+        CoPacket p = co_await radio.recvPacket(run.end - now);
+        if (!p.ok) continue;
+        DiversityCopy copy;
+        copy.branch = branch;
+        copy.crcOk = p.crcOk;
+        copy.lqi = p.lqi;
+        copy.rssiDbm = p.rssiDbm;
+        copy.t_ns = monotonicNs();
+        copy.len = p.len;
+        memcpy(copy.data, p.data, p.len);
+        divFlush(*run.comb, copy.t_ns);
+        divAdd(*run.comb, copy);
+    }
+}
+
+static Task<> divHousekeeping(CoLoop &loop, DivRun &run) {
+    uint64_t nextPublish = monotonicNs() + 1'000'000'000;
+    for (uint64_t now = monotonicNs(); now < run.end; now = monotonicNs()) {
+        co_await coSleep(loop, run.comb->config.windowNs / 2);
+        divFlush(*run.comb, monotonicNs());
+        if (run.ring && monotonicNs() >= nextPublish) {
+            divPublishStats(*run.ring, *run.comb, monotonicNs());
+            nextPublish += 1'000'000'000;
+        }
+    }
+    divFlush(*run.comb, UINT64_MAX);
+    if (run.ring) divPublishStats(*run.ring, *run.comb, monotonicNs());
+}
+
+bool diversityReceive(Radio *radios, int numRadios, const char *gpioChip, double seconds, DiversityCombiner &comb,
+                      ShmRingWriter *ring) {
+    if (numRadios > comb.config.numBranches) numRadios = comb.config.numBranches;
+    CoLoop loop;
+    if (!coLoopInit(loop)) return false;
+    CoRadio coRadios[DIV_MAX_BRANCHES];
+    DivRun run = {&comb, ring, monotonicNs() + (uint64_t)(seconds * 1e9)};
+
+    bool ok = true;
+    for (int i = 0; i < numRadios && ok; i++) ok = coRadioInit(coRadios[i], loop, radios[i], gpioChip);
+    if (ok) {
+        for (int i = 0; i < numRadios; i++) coSpawn(loop, divBranch(coRadios[i], i, run));
+        coSpawn(loop, divHousekeeping(loop, run));
+        coRun(loop);
+    }
+    for (int i = 0; i < numRadios; i++) coRadioClose(coRadios[i]);
+    coLoopClose(loop);
+    return ok;
+}
+
+// ===================== simulated scene =====================
+
+struct SimScene {
+    std::vector<std::vector<uint8_t>> sent;
+    std::vector<bool> seen;
+    uint64_t delivered;
+    uint64_t wrong;             // content didn't match what was sent, or delivered twice
+    double rssiSum;
+    double lqiSum;
+};
+
+static void sceneDelivered(const DiversityPacket &packet, void *ctx) {
+    SimScene &scene = *(SimScene *)ctx;
+    const DiversityCopy &c = *packet.copy;
+    uint32_t seq = c.data[0] | c.data[1] << 8 | c.data[2] << 16;
+    if (seq >= scene.sent.size() || scene.seen[seq] || c.len != scene.sent[seq].size() ||
+        memcmp(c.data, scene.sent[seq].data(), c.len)) {
+        scene.wrong++;
+        return;
+    }
+    scene.seen[seq] = true;
+    scene.delivered++;
+    scene.rssiSum += c.rssiDbm;
+    scene.lqiSum += c.lqi;
+}
+
+static inline float uniform(uint32_t &state) {
+    state ^= state << 13;
+    state ^= state >> 17;
+    state ^= state << 5;
+    return (state >> 8) * (1.0f / 16777216.0f);
+}
+
+void benchmarkDiversity(int numPackets, float meanSnrDb) {
+    constexpr uint64_t PERIOD_NS = 20'000'000;
+    constexpr uint64_t AIRTIME_NS = 2'000'000;
+    constexpr int LEN = 20;
+
+    SimScene scene;
+    std::vector<DiversityCopy> copies;
+    uint32_t seed = 2024;
+    for (int k = 0; k < numPackets; k++) {
+        std::vector<uint8_t> payload(LEN);
+        payload[0] = k;
+        payload[1] = k >> 8;
+        payload[2] = k >> 16;
+        for (int i = 3; i < LEN; i++) payload[i] = uniform(seed) * 256;
+        scene.sent.push_back(payload);
+
+        bool interference = uniform(seed) < 0.03f;      // hits every branch
+        uint64_t t = (uint64_t)k * PERIOD_NS + AIRTIME_NS;
+        for (int b = 0; b < 2; b++) {
+            float fading = -logf(uniform(seed) + 1e-9f);  // Rayleigh: exponential power
+            float snr = meanSnrDb + 10.0f * log10f(fading + 1e-9f);
+            float pOk = interference ? 0.0f : 1.0f / (1.0f + expf(-(snr - 8.0f) * 1.5f));
+            if (snr < 0.0f) continue;                     // no sync word, nothing received
+            DiversityCopy c;
+            c.branch = b;
+            c.crcOk = uniform(seed) < pOk;
+            c.rssiDbm = -100.0f + snr;
+            int lqi = (int)(40.0f - 2.0f * snr + uniform(seed) * 6.0f);
+            c.lqi = lqi < 0 ? 0 : lqi > 127 ? 127 : lqi;
+            c.t_ns = t + 100'000 + (uint64_t)(uniform(seed) * 700'000);   // GDO -> FIFO read of that branch
+            c.len = LEN;
+            memcpy(c.data, payload.data(), LEN);
+            if (!c.crcOk) c.data[3 + (int)(uniform(seed) * (LEN - 3))] ^= 0x10;
+            copies.push_back(c);
+        }
+    }
+    std::sort(copies.begin(), copies.end(),
+              [](const DiversityCopy &a, const DiversityCopy &b) { return a.t_ns < b.t_ns; });
+
+    printf("diversity: %d packets every 20 ms, mean SNR %.1f dB, Rayleigh per branch + 3%% shared interference\n",
+           numPackets, meanSnrDb);
+    static DiversityCombiner comb;      // pending copies + histogram, keep it off the stack
+    const struct { const char *name; DiversityMode mode; int branches; } runs[] = {
+        {"single radio", DIV_FIRST_OK, 1},
+        {"2 radios, first OK", DIV_FIRST_OK, 2},
+        {"2 radios, best", DIV_BEST, 2},
+    };
+    for (const auto &r : runs) {
+        scene.seen.assign(numPackets, false);
+        scene.delivered = scene.wrong = 0;
+        scene.rssiSum = scene.lqiSum = 0;
+        DiversityConfig config;
+        config.mode = r.mode;
+        config.numBranches = r.branches;
+        divInit(comb, config, sceneDelivered, &scene);
+
+        // flushed every window / 2 like diversityReceive() does
+        uint64_t tick = config.windowNs / 2, nextFlush = tick;
+        uint64_t start = monotonicNs();
+        for (const DiversityCopy &c : copies) {
+            if (c.branch >= r.branches) continue;
+            for (; nextFlush <= c.t_ns; nextFlush += tick) divFlush(comb, nextFlush);
+            divAdd(comb, c);
+        }
+        divFlush(comb, UINT64_MAX);
+        uint64_t elapsed = monotonicNs() - start;
+
+        const Histogram &h = comb.addedLatency;
+        int64_t p99 = histogramPercentile(h, 99);       // upper bin edge, can't be above the max
+        if (p99 > h.max_ns) p99 = h.max_ns;
+        printf("  %-20s delivered %6.2f%%  added latency mean %7.1f us  p99 %7.1f us  max %7.1f us"
+               "  delivered RSSI %6.1f dBm  LQI %5.1f%s\n",
+               r.name, 100.0 * scene.delivered / numPackets, histogramMean(h) / 1e3, p99 / 1e3,
+               h.max_ns / 1e3, scene.delivered ? scene.rssiSum / scene.delivered : 0.0,
+               scene.delivered ? scene.lqiSum / scene.delivered : 0.0, scene.wrong ? "  WRONG PACKETS" : "");
+        printDiversityStats(comb);
+        printf("    combiner %.0f ns per copy\n", (double)elapsed / copies.size());
+    }
+}
@@ -0,0 +1,109 @@
+#ifndef DIVERSITY_H
+#define DIVERSITY_H
+
+#include <stdint.h>
+
+#include "capture_timing.h"     // Histogram
+
+struct Radio;
+struct ShmRingWriter;
+
+// Selection combining: radios tuned identically (same profile, frequency, own calibration)
+// all receive, every copy goes into the combiner.
+//
+// A copy with CRC OK is matched to the others by a hash of its bytes within windowNs of the
+// first copy (bad copies can't be matched, they only count in their branch's stats):
+//   DIV_BEST:     hold the packet until every branch delivered it or the window ends, then
+//                 deliver the best copy (lowest LQI = best link, then highest RSSI)
+//   DIV_FIRST_OK: deliver the first good copy at once, later copies are only counted
+// Content of good copies is the same, BEST only picks better metadata and costs latency
+// whenever a branch lost the packet (up to the window).
+
+constexpr int DIV_MAX_BRANCHES = 4;
+constexpr int DIV_MAX_PENDING = 32;         // packets inside the window at once
+constexpr int DIV_STAT_FIELDS = 7;          // floats per branch in a SHM_FRAME_DIVERSITY frame
+
+enum DiversityMode : uint8_t {
+    DIV_BEST = 0,
+    DIV_FIRST_OK = 1
+};
+
+struct DiversityConfig {
+    DiversityMode mode = DIV_BEST;
+    int numBranches = 2;
+    uint64_t windowNs = 5'000'000;          // > skew between the branches' reads of one packet
+};
+
+struct DiversityCopy {
+    uint8_t branch;
+    bool crcOk;
+    uint8_t lqi;
+    float rssiDbm;
+    uint64_t t_ns;                          // read from the radio, CLOCK_MONOTONIC
+    uint8_t len;
+    uint8_t data[64];
+};
+
+struct DiversityPacket {
+    const DiversityCopy *copy;              // the selected one
+    uint64_t first_ns;                      // first good copy of any branch
+    uint64_t deliver_ns;
+    uint8_t branchMask;                     // branches that had it with CRC OK so far
+};
+
+typedef void (*DiversityCallback)(const DiversityPacket &packet, void *ctx);
+
+// DIV_STAT_FIELDS, in this order, as floats in the shm frame
+struct DiversityBranchStats {
+    uint64_t received;
+    uint64_t crcOk;
+    uint64_t crcFail;
+    uint64_t selected;                      // its copy was delivered
+    uint64_t unique;                        // no other branch had it
+    double rssiSum;                         // over good copies, for the means
+    double lqiSum;
+};
+
+struct DivPending {
+    bool used;
+    bool delivered;
+    uint64_t hash;
+    uint64_t first_ns;
+    uint8_t branchMask;
+    DiversityCopy best;
+};
+
+struct DiversityCombiner {
+    DiversityConfig config;
+    DiversityCallback callback;
+    void *callbackCtx;
+
+    DivPending pending[DIV_MAX_PENDING];
+    DiversityBranchStats branches[DIV_MAX_BRANCHES];
+    uint64_t delivered;
+    uint64_t duplicates;                    // good copies of already delivered packets
+    Histogram addedLatency;                 // deliver_ns - first_ns
+};
+
+void divInit(DiversityCombiner &comb, const DiversityConfig &config, DiversityCallback callback, void *ctx);
+// copy.t_ns is the time it arrived, copies have to come in time order
+void divAdd(DiversityCombiner &comb, const DiversityCopy &copy);
+// delivers / retires packets whose window ended before now_ns, call at least every window / 2
+void divFlush(DiversityCombiner &comb, uint64_t now_ns);
+
+void printDiversityStats(const DiversityCombiner &comb);
+// one SHM_FRAME_DIVERSITY frame with the branch stats, returns the frame number
+uint64_t divPublishStats(ShmRingWriter &ring, const DiversityCombiner &comb, uint64_t t_ns);
+
+// every radio: SIDLE, profile (CRC_AUTOFLUSH cleared), FREQ from freqHz, own SCAL, SFRX, SRX
+bool diversityTune(Radio *radios, int numRadios, const uint8_t *profile, uint32_t freqHz);
+// receive on every radio for seconds (one coroutine loop, radio_coro.h) into comb,
+// branch stats published to ring once a second if not NULL
+bool diversityReceive(Radio *radios, int numRadios, const char *gpioChip, double seconds, DiversityCombiner &comb,
+                      ShmRingWriter *ring);
+
+// simulated scene: a packet every 20 ms, independent Rayleigh fading per branch plus shared
+// interference bursts. Delivered packet rate and added latency of one radio vs both (BEST, FIRST_OK)
+void benchmarkDiversity(int numPackets, float meanSnrDb);
+
+#endif
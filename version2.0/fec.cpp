@@ -0,0 +1,234 @@
+#include <string.h>             // memcpy(), memset(), memcmp()
+#include <stdio.h>              // printf()
+#include <math.h>               // sqrtf(), logf(), cosf()
+#include <vector>
+
+#include "fec.h"
+#include "packet_codec.h"       // packetEncode(), packetDecodeBatch()
+#include "capture_timing.h"     // monotonicRawNs()
+#include "helper_functions.h"   // xorshift32()
+
+typedef int16_t v8i16 __attribute__((vector_size(16)));
+typedef uint8_t v16u8 __attribute__((vector_size(16)));
+
+static inline v16u8 load16(const uint8_t *p) { v16u8 v; memcpy(&v, p, 16); return v; }
+static inline void store16(uint8_t *p, v16u8 v) { memcpy(p, &v, 16); }
+
+// 2 coded bits for (3 previous input bits, oldest first) << 1 | input bit, DN504
+// = generators 1 + D^2 + D^3 (first bit) and 1 + D + D^2 + D^3 (second bit)
+static const uint8_t fecEncodeTable[16] = {0, 3, 1, 2, 3, 0, 2, 1, 3, 0, 2, 1, 0, 3, 1, 2};
+
+// state = last 3 input bits, next state = (state << 1 | bit) & 7, so state s is reached from
+// (s >> 1) and (s >> 1) | 4 with input bit s & 1
+#define PRED0(s) ((s) >> 1)
+#define PRED1(s) (((s) >> 1) | 4)
+#define SYM0(s) fecEncodeTable[(PRED0(s) << 1) | ((s) & 1)]
+#define SYM1(s) fecEncodeTable[(PRED1(s) << 1) | ((s) & 1)]
+static const v8i16 pred0 = {PRED0(0), PRED0(1), PRED0(2), PRED0(3), PRED0(4), PRED0(5), PRED0(6), PRED0(7)};
+static const v8i16 pred1 = {PRED1(0), PRED1(1), PRED1(2), PRED1(3), PRED1(4), PRED1(5), PRED1(6), PRED1(7)};
+static const v8i16 sym0 = {SYM0(0), SYM0(1), SYM0(2), SYM0(3), SYM0(4), SYM0(5), SYM0(6), SYM0(7)};
+static const v8i16 sym1 = {SYM1(0), SYM1(1), SYM1(2), SYM1(3), SYM1(4), SYM1(5), SYM1(6), SYM1(7)};
+
+// 4 x 4 interleaver on soft bits: output symbol j = input symbol (3 - j % 4) * 4 + 3 - j / 4
+#define ILV(j) (((3 - ((j) & 3)) * 4 + 3 - ((j) >> 2)) * 2)
+static const v16u8 ilvLow = {ILV(0), ILV(0) + 1, ILV(1), ILV(1) + 1, ILV(2), ILV(2) + 1, ILV(3), ILV(3) + 1,
+                             ILV(4), ILV(4) + 1, ILV(5), ILV(5) + 1, ILV(6), ILV(6) + 1, ILV(7), ILV(7) + 1};
+static const v16u8 ilvHigh = {ILV(8), ILV(8) + 1, ILV(9), ILV(9) + 1, ILV(10), ILV(10) + 1, ILV(11), ILV(11) + 1,
+                              ILV(12), ILV(12) + 1, ILV(13), ILV(13) + 1, ILV(14), ILV(14) + 1, ILV(15), ILV(15) + 1};
+
+uint32_t fecEncodedLen(uint32_t dataLen) {
+    return 4 * (dataLen / 2 + 1);
+}
+
+uint32_t fecEncode(const uint8_t *data, uint32_t dataLen, uint8_t *out, uint32_t outSize) {
+    uint32_t numIn = 2 * (dataLen / 2 + 1);     // data + trellis terminator, even
+    uint32_t outLen = 2 * numIn;
+    if (outLen > outSize) return 0;
+
+    uint16_t reg = 0;
+    for (uint32_t i = 0; i < numIn; i++) {
+        reg = (reg & 0x700) | (i < dataLen ? data[i] : 0x0B);
+        uint16_t coded = 0;
+        for (int j = 0; j < 8; j++) {
+            coded = (coded << 2) | fecEncodeTable[reg >> 7];
+            reg = (reg << 1) & 0x7FF;
+        }
+        out[2 * i] = coded >> 8;
+        out[2 * i + 1] = coded & 0xFF;
+    }
+
+    for (uint32_t i = 0; i < outLen; i += 4) {
+        uint8_t block[4];
+        memcpy(block, out + i, 4);
+        uint32_t v = 0;
+        for (int j = 0; j < 16; j++) v = (v << 2) | ((block[~j & 0x03] >> (2 * ((j & 0x0C) >> 2))) & 0x03);
+        out[i] = v >> 24;
+        out[i + 1] = v >> 16;
+        out[i + 2] = v >> 8;
+        out[i + 3] = v;
+    }
+    return outLen;
+}
+
+void fecHardToSoft(const uint8_t *in, uint32_t numBytes, uint8_t *soft) {
+    for (uint32_t i = 0; i < numBytes; i++)
+        for (int b = 0; b < 8; b++) soft[i * 8 + b] = (in[i] >> (7 - b)) & 1 ? 255 : 0;
+}
+
+void fecDeinterleaveSoft(uint8_t *soft, uint32_t numBits) {
+    for (uint32_t i = 0; i + 32 <= numBits; i += 32) {
+        v16u8 a = load16(soft + i), b = load16(soft + i + 16);
+        store16(soft + i, __builtin_shuffle(a, b, ilvLow));
+        store16(soft + i + 16, __builtin_shuffle(a, b, ilvHigh));
+    }
+}
+
+uint32_t fecViterbiDecode(const uint8_t *soft, uint32_t numBits, uint8_t *out, uint32_t *metric) {
+    uint32_t steps = numBits / 2;
+    static thread_local std::vector<uint8_t> decisions;
+    if (decisions.size() < steps) decisions.resize(steps);
+
+    const v8i16 lane0 = {0, 0, 0, 0, 0, 0, 0, 0};
+    const v8i16 bitOf = {1, 2, 4, 8, 16, 32, 64, 128};
+    v8i16 pm = {0, 4096, 4096, 4096, 4096, 4096, 4096, 4096};     // encoder starts in state 0
+    uint32_t normalized = 0;
+
+    for (uint32_t t = 0; t < steps; t++) {
+        int16_t r1 = soft[2 * t], r0 = soft[2 * t + 1];
+        int16_t d1 = 255 - r1, d0 = 255 - r0;       // distance to a 1, r = distance to a 0
+        v8i16 bm = {(int16_t)(r1 + r0), (int16_t)(r1 + d0), (int16_t)(d1 + r0), (int16_t)(d1 + d0), 0, 0, 0, 0};
+
+        // add compare select, all 8 states at once
+        v8i16 m0 = __builtin_shuffle(pm, pred0) + __builtin_shuffle(bm, sym0);
+        v8i16 m1 = __builtin_shuffle(pm, pred1) + __builtin_shuffle(bm, sym1);
+        v8i16 take1 = m1 < m0;
+        pm = (m0 & ~take1) | (m1 & take1);
+
+        // survivor bits of the 8 states into one byte
+        v8i16 bits = take1 & bitOf;
+        bits += __builtin_shuffle(bits, (v8i16){4, 5, 6, 7, 0, 1, 2, 3});
+        bits += __builtin_shuffle(bits, (v8i16){2, 3, 0, 1, 2, 3, 0, 1});
+        bits += __builtin_shuffle(bits, (v8i16){1, 0, 1, 0, 1, 0, 1, 0});
+        decisions[t] = bits[0];
+
+        // keep metrics small: relative to state 0
+        normalized += pm[0];
+        pm -= __builtin_shuffle(pm, lane0);
+    }
+
+    int best = 0;
+    for (int s = 1; s < 8; s++)
+        if (pm[s] < pm[best]) best = s;
+    if (metric) *metric = normalized + pm[best];
+
+    uint32_t numBytes = steps / 8;
+    memset(out, 0, numBytes);
+    int state = best;
+    for (uint32_t t = steps; t-- > 0;) {
+        if (t / 8 < numBytes) out[t / 8] |= (state & 1) << (7 - t % 8);
+        state = (state >> 1) | (((decisions[t] >> state) & 1) << 2);
+    }
+    return numBytes;
+}
+
+uint32_t fecDecodeSoft(uint8_t *soft, uint32_t numBits, uint8_t *out, uint32_t *metric) {
+    numBits &= ~31u;
+    fecDeinterleaveSoft(soft, numBits);
+    return fecViterbiDecode(soft, numBits, out, metric);
+}
+
+uint32_t fecDecode(const uint8_t *frame, uint32_t frameLen, uint8_t *out, uint32_t *metric) {
+    static thread_local std::vector<uint8_t> soft;
+    if (soft.size() < frameLen * 8) soft.resize(frameLen * 8);
+    fecHardToSoft(frame, frameLen, soft.data());
+    return fecDecodeSoft(soft.data(), frameLen * 8, out, metric);
+}
+
+static inline float uniform(uint32_t &state) {
+    return ((xorshift32(state) >> 8) + 0.5f) * (1.0f / 16777216.0f);
+}
+
+// packets with CRC ok after the decoder: hard = sign of the noisy sample only, soft = all of it
+static void errorTest(const std::vector<uint8_t> &coded, uint32_t codedLen, int numPackets, float sigma,
+                      int &hardOk, int &softOk, int &uncodedBitErrors) {
+    PacketConfig config;
+    uint32_t seed = 777;
+    std::vector<uint8_t> soft(codedLen * 8), hard(codedLen * 8), decoded(codedLen);
+    hardOk = softOk = uncodedBitErrors = 0;
+
+    for (int p = 0; p < numPackets; p++) {
+        const uint8_t *frame = &coded[(size_t)p * codedLen];
+        for (uint32_t i = 0; i < codedLen * 8; i++) {
+            // BPSK-like +-1 at 127.5 +- 100, gaussian noise (Box-Muller)
+            float bit = (frame[i / 8] >> (7 - i % 8)) & 1 ? 1.0f : -1.0f;
+            float noise = sqrtf(-2.0f * logf(uniform(seed))) * cosf(6.2831853f * uniform(seed)) * sigma;
+            float v = 127.5f + 100.0f * (bit + noise);
+            soft[i] = v < 0 ? 0 : v > 255 ? 255 : (uint8_t)v;
+            hard[i] = soft[i] >= 128 ? 255 : 0;
+            uncodedBitErrors += (hard[i] != 0) != (bit > 0);
+        }
+
+        for (int mode = 0; mode < 2; mode++) {
+            uint8_t *bits = mode ? soft.data() : hard.data();
+            uint32_t n = fecDecodeSoft(bits, codedLen * 8, decoded.data(), NULL);
+            uint8_t *frames[1] = {decoded.data()};
+            DecodedPacket packet;
+            if (packetDecodeBatch(config, frames, &n, 1, &packet)) (mode ? softOk : hardOk)++;
+        }
+    }
+}
+
+void benchmarkFec(int numPackets, int payloadLen) {
+    if (payloadLen > 250) payloadLen = 250;
+
+    // test vector: length 3, payload 01 02 03, CRC, no whitening, through the DN504 encoder
+    static const uint8_t vectorIn[] = {0x03, 0x01, 0x02, 0x03, 0x30, 0x3A};
+    static const uint8_t vectorCoded[] = {0xC8, 0x3C, 0x00, 0x20, 0x84, 0xCF, 0x33, 0x31,
+                                          0xA2, 0xFC, 0x40, 0x4A, 0x44, 0x30, 0x47, 0xEF};
+    uint8_t coded[64], decoded[64];
+    uint32_t codedLen = fecEncode(vectorIn, sizeof(vectorIn), coded, sizeof(coded));
+    uint32_t metric = 1;
+    uint32_t decodedLen = fecDecode(coded, codedLen, decoded, &metric);
+    bool vectorOk = codedLen == sizeof(vectorCoded) && !memcmp(coded, vectorCoded, codedLen) &&
+                    decodedLen == 8 && !memcmp(decoded, vectorIn, sizeof(vectorIn)) && decoded[6] == 0x0B &&
+                    decoded[7] == 0x0B && metric == 0;
+    // CRC of the vector must match packet_codec
+    vectorOk &= crc16(vectorIn, 4, CC1101_CRC_INIT) == 0x303A;
+
+    printf("FEC test vector: %s (coded", vectorOk ? "ok" : "FAILED");
+    for (uint32_t i = 0; i < codedLen; i++) printf(" %02X", coded[i]);
+    printf(")\n");
+
+    // packets as the chip sends them: whitened + CRC, then FEC
+    PacketConfig config;
+    uint32_t frameLen = payloadLen + 3;
+    uint32_t fecLen = fecEncodedLen(frameLen);
+    std::vector<uint8_t> frames((size_t)numPackets * fecLen);
+    std::vector<uint8_t> payload(payloadLen), frame(frameLen);
+    uint32_t seed = 1;
+    for (int p = 0; p < numPackets; p++) {
+        for (auto &b : payload) b = xorshift32(seed);
+        packetEncode(config, payload.data(), payloadLen, frame.data(), frameLen);
+        fecEncode(frame.data(), frameLen, &frames[(size_t)p * fecLen], fecLen);
+    }
+
+    // error correction
+    int testPackets = numPackets < 2000 ? numPackets : 2000;
+    printf("FEC error correction, %d packets x %d bytes:\n", testPackets, payloadLen);
+    for (float sigma : {0.4f, 0.5f, 0.6f, 0.7f}) {
+        int hardOk, softOk, rawErrors;
+        errorTest(frames, fecLen, testPackets, sigma, hardOk, softOk, rawErrors);
+        printf("    channel BER %5.2f%%: packets ok hard %5.1f%%  soft %5.1f%%\n",
+               100.0 * rawErrors / ((double)testPackets * fecLen * 8), 100.0 * hardOk / testPackets,
+               100.0 * softOk / testPackets);
+    }
+
+    // throughput on hard frames (includes hard -> soft expansion and de-interleaving)
+    std::vector<uint8_t> out(fecLen);
+    uint64_t start = monotonicRawNs();
+    uint64_t bits = 0;
+    for (int p = 0; p < numPackets; p++) bits += fecDecode(&frames[(size_t)p * fecLen], fecLen, out.data(), NULL) * 8;
+    uint64_t elapsed = monotonicRawNs() - start;
+    double mbps = bits * 1e3 / elapsed;
+    printf("FEC decode: %.1f Mbit/s decoded on one core = %.0fx a 500 kbps stream\n", mbps, mbps / 0.5);
+}
@@ -0,0 +1,43 @@
+#ifndef FEC_H
+#define FEC_H
+
+#include <stdint.h>
+
+// Software version of the cc1101 forward error correction (MDMCFG1.FEC_EN), DN504:
+//
+// TX: length + payload + CRC (whitened if WHITE_DATA) + trellis terminator (0x0B, 1 or 2 bytes
+//     so the count is even) -> rate 1/2, K = 4 convolutional code -> 4 x 4 interleaver over
+//     2 bit symbols, every 4 coded bytes
+// RX: de-interleave -> Viterbi (8 states) -> then packet_codec.h de-whitening + CRC
+//
+// The decoder works on soft bits: one byte per coded bit, 0 = certain 0, 255 = certain 1,
+// 128 = erasure. Hard captures go through fecHardToSoft(). The add-compare-select of all 8
+// states runs as one 8 x int16 vector operation per decoded bit.
+
+// coded frame bytes for dataLen input bytes (length + payload + CRC)
+uint32_t fecEncodedLen(uint32_t dataLen);
+
+// DN504 encoder + interleaver, returns fecEncodedLen(dataLen) or 0 if out is too small
+uint32_t fecEncode(const uint8_t *data, uint32_t dataLen, uint8_t *out, uint32_t outSize);
+
+// bytes (MSB first) -> soft bits 0 / 255
+void fecHardToSoft(const uint8_t *in, uint32_t numBytes, uint8_t *soft);
+
+// 4 x 4 de-interleave in place, numBits a multiple of 32 (whole 4 byte blocks)
+// (the permutation is its own inverse, so this also interleaves)
+void fecDeinterleaveSoft(uint8_t *soft, uint32_t numBits);
+
+// Viterbi on de-interleaved soft bits, numBits / 2 decoded bits packed MSB first into out,
+// returns bytes written. metric (optional) = soft distance of the chosen path, 0 = no errors.
+uint32_t fecViterbiDecode(const uint8_t *soft, uint32_t numBits, uint8_t *out, uint32_t *metric);
+
+// de-interleave + Viterbi of a received frame (numBits soft bits from the sync word on, modified
+// in place), returns decoded bytes (including the trellis terminator)
+uint32_t fecDecodeSoft(uint8_t *soft, uint32_t numBits, uint8_t *out, uint32_t *metric);
+// same for a hard decision frame (bytes from the sync word on)
+uint32_t fecDecode(const uint8_t *frame, uint32_t frameLen, uint8_t *out, uint32_t *metric);
+
+// test vectors, error correction with hard and soft bits, decoded Mbit/s vs a 500 kbps stream
+void benchmarkFec(int numPackets, int payloadLen);
+
+#endif
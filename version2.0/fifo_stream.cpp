@@ -0,0 +1,613 @@
+#include <string.h>             // memset(), memcpy()
+#include <stdio.h>              // printf(), fprintf(), perror()
+#include <stdlib.h>             // aligned_alloc(), free()
+#include <unistd.h>             // close()
+#include <algorithm>            // std::min()
+#include <thread>
+
+#include "fifo_stream.h"
+#include "main_drivers.h"
+#include "helper_functions.h"   // calculateDataRate(), calculateFreqWord()
+#include "gpio_edges.h"         // gpioOpenEdges(), gpioReadEdges()
+#include "spi_util.h"           // spiXfer()
+#include "cc1101_sim.h"
+#include "pacer.h"              // monotonicNs(), sleepUntil()
+#include "cc1101_config.h"
+
+bool streamRingInit(StreamRing &ring, size_t size) {
+    size_t pow2 = 64;
+    while (pow2 < size) pow2 <<= 1;
+    ring.buf = (uint8_t *)aligned_alloc(64, pow2);
+    if (!ring.buf) {
+        perror("Failed to allocate stream ring");
+        return false;
+    }
+    ring.size = pow2;
+    ring.head = ring.tail = 0;
+    ring.gaps = ring.gapsSeen = 0;
+    ring.closed = false;
+    return true;
+}
+
+void streamRingFree(StreamRing &ring) {
+    free(ring.buf);
+    ring.buf = NULL;
+}
+
+size_t streamRingUsed(const StreamRing &ring) {
+    return __atomic_load_n(&ring.head, __ATOMIC_ACQUIRE) - __atomic_load_n(&ring.tail, __ATOMIC_ACQUIRE);
+}
+
+size_t streamRingWrite(StreamRing &ring, const uint8_t *data, size_t n) {
+    uint64_t head = ring.head;
+    size_t space = ring.size - (head - __atomic_load_n(&ring.tail, __ATOMIC_ACQUIRE));
+    n = std::min(n, space);
+    size_t at = head & (ring.size - 1);
+    size_t first = std::min(n, ring.size - at);
+    memcpy(ring.buf + at, data, first);
+    memcpy(ring.buf, data + first, n - first);
+    __atomic_store_n(&ring.head, head + n, __ATOMIC_RELEASE);
+    return n;
+}
+
+size_t streamRingRead(StreamRing &ring, uint8_t *out, size_t n, bool *gap) {
+    if (gap) *gap = false;
+    uint64_t tail = ring.tail;
+    uint64_t head = __atomic_load_n(&ring.head, __ATOMIC_ACQUIRE);     // before gaps: a gap is marked before its bytes
+    uint32_t gaps = __atomic_load_n(&ring.gaps, __ATOMIC_ACQUIRE);
+    if (gaps - ring.gapsSeen > (uint32_t)STREAM_RING_GAPS) {          // their offsets are overwritten
+        ring.gapsSeen = gaps - STREAM_RING_GAPS;
+        if (gap) *gap = true;
+    }
+    while (ring.gapsSeen != gaps && head != tail) {
+        uint64_t at = ring.gapAt[ring.gapsSeen % STREAM_RING_GAPS];
+        if (at > tail) {                                    // up to it, the gap comes with the next read
+            head = at;
+            break;
+        }
+        ring.gapsSeen++;
+        if (gap) *gap = true;
+    }
+    n = std::min(n, (size_t)(head - tail));
+    size_t at = tail & (ring.size - 1);
+    size_t first = std::min(n, ring.size - at);
+    memcpy(out, ring.buf + at, first);
+    memcpy(out + first, ring.buf, n - first);
+    __atomic_store_n(&ring.tail, tail + n, __ATOMIC_RELEASE);
+    return n;
+}
+
+void streamRingMarkGap(StreamRing &ring) {
+    uint32_t gaps = ring.gaps;
+    if (gaps && ring.gapAt[(gaps - 1) % STREAM_RING_GAPS] == ring.head) return;    // nothing written since the last one
+    ring.gapAt[gaps % STREAM_RING_GAPS] = ring.head;
+    __atomic_store_n(&ring.gaps, gaps + 1, __ATOMIC_RELEASE);
+}
+
+void streamRingClose(StreamRing &ring) {
+    __atomic_store_n(&ring.closed, true, __ATOMIC_RELEASE);
+}
+
+bool streamRingClosed(const StreamRing &ring) {
+    return __atomic_load_n(&ring.closed, __ATOMIC_ACQUIRE);
+}
+
+void streamRegisters(uint8_t *regs, const uint8_t *profile, uint32_t freqHz) {
+    memcpy(regs, profile, CFG_REGISTER);
+    regs[PKTCTRL1] &= ~0x0C;                                // no APPEND_STATUS, no CRC_AUTOFLUSH
+    regs[PKTCTRL1] &= ~0x03;                                // no address check
+    regs[PKTCTRL0] = (regs[PKTCTRL0] & ~0x07) | 0x02;       // no CRC, infinite length
+    regs[MDMCFG1] &= ~0x80;                                 // FEC needs fixed length
+    regs[MCSM1] &= ~0x0F;                                   // RXOFF / TXOFF = IDLE: a packet's end shows in MARCSTATE
+    uint32_t word = calculateFreqWord(freqHz);
+    regs[FREQ2] = (word >> 16) & 0xFF;
+    regs[FREQ1] = (word >> 8) & 0xFF;
+    regs[FREQ0] = word & 0xFF;
+}
+
+bool streamTune(Radio &radio, const uint8_t *profile, uint32_t freqHz) {
+    uint8_t regs[CFG_REGISTER];
+    streamRegisters(regs, profile, freqHz);
+    sendStrobe(radio.fd, SIDLE);
+    writeRegister(radio.fd, IOCFG2, regs, WRITE_BURST, CFG_REGISTER);
+    uint8_t fscal[3];
+    if (!calibrateSynthesizer(radio.fd, fscal, 5'000'000)) {
+        fprintf(stderr, "ERROR: %s did not calibrate\n", radio.path);
+        return false;
+    }
+    return true;
+}
+
+bool streamInit(Stream &stream, Radio &radio, const char *gpioChip, StreamRing &ring, const StreamConfig &config) {
+    memset((void *)&stream, 0, sizeof(stream));
+    stream.radio = &radio;
+    stream.config = config;
+    stream.ring = &ring;
+    stream.gdoFd = -1;
+    if (gpioChip && radio.gdoLine >= 0 && !config.pollNs) {
+        stream.gdoFd = gpioOpenEdges(gpioChip, radio.gdoLine, 0);
+        if (stream.gdoFd < 0) return false;
+    }
+    return true;
+}
+
+void streamClose(Stream &stream) {
+    if (stream.gdoFd >= 0) close(stream.gdoFd);
+    stream.gdoFd = -1;
+}
+
+void streamStop(Stream &stream) {
+    __atomic_store_n(&stream.stop, true, __ATOMIC_RELEASE);
+}
+
+// RXBYTES / TXBYTES (before the burst) + FIFO burst of n bytes, one message
+static bool fifoChunk(const Stream &stream, bool tx, uint8_t *data, int n, uint8_t *fifoBytes) {
+    SpiTransferFn transfer = stream.config.transfer;
+    int fd = stream.radio->fd;
+    static const uint8_t fifoRead[1 + 64] = {TXRXFIFO | READ_BURST};
+    uint8_t levelTx[2] = {(uint8_t)((tx ? TXBYTES : RXBYTES) | READ_BURST), 0};
+    uint8_t levelRx[2] = {0, 0};
+    uint8_t burst[1 + 64];
+    if (tx) {
+        burst[0] = TXFIFO_BURST;
+        memcpy(burst + 1, data, n);
+    }
+
+    struct spi_ioc_transfer xfers[2];
+    memset(xfers, 0, sizeof(xfers));
+    xfers[0].tx_buf = (unsigned long)levelTx;
+    xfers[0].rx_buf = (unsigned long)levelRx;
+    xfers[0].len = 2;
+    xfers[0].cs_change = 1;
+    xfers[1].tx_buf = (unsigned long)(tx ? burst : fifoRead);
+    xfers[1].rx_buf = tx ? 0 : (unsigned long)burst;
+    xfers[1].len = n + 1;
+    if (spiXfer(transfer, fd, xfers, 2) < 0) return false;
+    if (!tx) memcpy(data, burst + 1, n);
+    *fifoBytes = levelRx[1];
+    return true;
+}
+
+// bytes that may arrive / leave while a chunk message is on the bus (~75 us at 5 MHz, 500 kbps):
+// a level this close to the threshold gets another chunk instead of waiting for an edge that
+// may never come (the line never left its side of the threshold)
+constexpr int STREAM_MARGIN = 8;
+
+static int rxThreshold(const StreamConfig &config) {
+    return 4 * ((config.fifoThreshold & 0x0F) + 1);
+}
+
+static void setRegister(const Stream &stream, uint8_t reg, uint8_t value) {
+    writeRegister(stream.radio->fd, reg, &value, WRITE_SINGLE_BYTE, 1, stream.config.transfer);
+}
+
+// FIFOTHR, GDO2, PKTLEN and infinite / fixed length for a stream of total bytes (0 = not known
+// yet; a length that's a multiple of 256 leaves PKTLEN = 0, taken as 256 by the simulator, not
+// tried on a radio)
+static void setStreamRegisters(const Stream &stream, uint8_t gdo, uint64_t total) {
+    SpiTransferFn transfer = stream.config.transfer;
+    int fd = stream.radio->fd;
+    uint8_t fifothr = readRegisterWithStatus(fd, FIFOTHR, READ_SINGLE_BYTE, NULL, transfer);
+    uint8_t pktctrl0 = readRegisterWithStatus(fd, PKTCTRL0, READ_SINGLE_BYTE, NULL, transfer);
+    bool fixed = total && total < 256;
+    setRegister(stream, FIFOTHR, (fifothr & 0xF0) | (stream.config.fifoThreshold & 0x0F));
+    setRegister(stream, IOCFG2, gdo);
+    setRegister(stream, PKTLEN, total % 256);
+    setRegister(stream, PKTCTRL0, (pktctrl0 & ~0x03) | (fixed ? 0x00 : 0x02));
+}
+
+static void switchToFixed(const Stream &stream) {
+    SpiTransferFn transfer = stream.config.transfer;
+    int fd = stream.radio->fd;
+    uint8_t pktctrl0 = readRegisterWithStatus(fd, PKTCTRL0, READ_SINGLE_BYTE, NULL, transfer);
+    setRegister(stream, PKTCTRL0, pktctrl0 & ~0x03);
+}
+
+// RX chunk into the ring, what doesn't fit is dropped and leaves a gap
+static void ringChunk(Stream &stream, const uint8_t *data, int n) {
+    StreamStats &stats = stream.stats;
+    size_t taken = streamRingWrite(*stream.ring, data, n);
+    if (taken < (size_t)n) {
+        stats.ringFull += n - taken;
+        streamRingMarkGap(*stream.ring);
+    }
+    stats.bytes += n;
+    stats.chunks++;
+}
+
+static void resetStats(Stream &stream) {
+    stream.stats = StreamStats{};
+    histogramInit(stream.stats.service, 0, 10'000);        // 10 us bins, 0..640 us
+    stream.stop = false;
+}
+
+// next threshold edge (timestamp of the last one), false = only stale edges. Edges from before
+// the last chunk started are stale, the level that chunk saw is newer. No edge at all within
+// 100 ms: true with edge_ns = 0, the caller reads the level (an edge that was missed would
+// otherwise stall the stream until the FIFO over / underflows).
+static bool waitThreshold(Stream &stream, bool rising, uint64_t after_ns, uint64_t *edge_ns) {
+    if (stream.gdoFd < 0) {
+        uint64_t pollNs = stream.config.pollNs ? stream.config.pollNs : 250'000;
+        sleepUntil(monotonicNs() + pollNs);
+        *edge_ns = 0;
+        return true;
+    }
+    GpioEdge edges[16];
+    int n = gpioReadEdges(stream.gdoFd, edges, 16, 100);
+    *edge_ns = 0;
+    if (n == 0) return true;
+    bool found = false;
+    for (int i = 0; i < n; i++) {
+        if (edges[i].level == rising && edges[i].t_ns > after_ns) {
+            *edge_ns = edges[i].t_ns;
+            found = true;
+        }
+    }
+    return found;
+}
+
+// edges from before the stream starts, drained before SRX / STX: after it one could be the first
+// real threshold edge (a preempted driver), and a stream waiting for it would run into an
+// overflow / underflow
+static void drainEdges(const Stream &stream) {
+    if (stream.gdoFd < 0) return;
+    GpioEdge stale[16];
+    while (gpioReadEdges(stream.gdoFd, stale, 16, 0) > 0) {}
+}
+
+// last bytes of a known length: the radio ends the packet by itself (fixed length, back to IDLE),
+// then the FIFO may be emptied
+static void finishRx(Stream &stream, uint64_t got, uint64_t deadline) {
+    SpiTransferFn transfer = stream.config.transfer;
+    int fd = stream.radio->fd;
+    StreamStats &stats = stream.stats;
+    uint64_t total = stream.config.totalBytes;
+    for (;;) {
+        uint8_t state = readRegisterWithStatus(fd, MARCSTATE, READ_BURST, NULL, transfer) & MARCSTATE_MASK;
+        if (state == MARCSTATE_IDLE) break;
+        if (state == MARCSTATE_RXFIFO_OVERFLOW) {
+            stats.overflows++;
+            return;
+        }
+        if (monotonicNs() > deadline || __atomic_load_n(&stream.stop, __ATOMIC_ACQUIRE)) return;
+        sleepUntil(monotonicNs() + 100'000);
+    }
+    uint8_t rxbytes = readRegisterWithStatus(fd, RXBYTES, READ_BURST, NULL, transfer) & 0x7F;
+    uint8_t data[64];
+    uint8_t ignored;
+    if (rxbytes && fifoChunk(stream, false, data, rxbytes, &ignored)) {
+        ringChunk(stream, data, rxbytes);
+        got += rxbytes;
+    }
+    stats.complete = got == total && stats.overflows == 0;
+}
+
+bool streamReceive(Stream &stream, double seconds) {
+    SpiTransferFn transfer = stream.config.transfer;
+    int fd = stream.radio->fd;
+    resetStats(stream);
+    StreamStats &stats = stream.stats;
+    const StreamConfig &config = stream.config;
+    uint64_t total = config.totalBytes;
+    int threshold = rxThreshold(config);
+    bool fixed = total && total < 256;
+
+    setStreamRegisters(stream, 0x00, total);                       // GDO2: RX FIFO at or above the threshold
+    static const uint8_t flush[2] = {SIDLE, SFRX};
+    sendStrobes(fd, flush, 2, 2, NULL, transfer);
+    drainEdges(stream);
+    static const uint8_t srx = SRX;
+    sendStrobes(fd, &srx, 1, 0, NULL, transfer);
+    stats.start_ns = monotonicNs();
+    uint64_t deadline = stats.start_ns + (uint64_t)(seconds * 1e9);
+    uint64_t got = 0;                                       // bytes read since SRX
+    uint64_t sampled_ns = 0;                                // last chunk started
+    uint64_t serviced_ns = 0;                               // and ended
+
+    while (!__atomic_load_n(&stream.stop, __ATOMIC_ACQUIRE) && monotonicNs() < deadline) {
+        if (total && total - got <= (uint64_t)threshold) {
+            finishRx(stream, got, deadline);
+            stats.end_ns = monotonicNs();
+            return stats.complete;
+        }
+        uint64_t edge_ns;
+        if (!waitThreshold(stream, true, sampled_ns, &edge_ns)) continue;
+
+        // an edge after the last chunk guarantees threshold bytes (one during it: ask), after that
+        // RXBYTES tells; the last byte stays in the FIFO while receiving and RXBYTES gets a byte
+        // of margin (errata)
+        int level = edge_ns > serviced_ns ? threshold + 1 : readRegisterWithStatus(fd, RXBYTES, READ_BURST, NULL, transfer);
+        for (;;) {
+            if (level & 0x80) {
+                stats.overflows++;
+                static const uint8_t flush[3] = {SIDLE, SFRX, SRX};
+                sendStrobes(fd, flush, 3, 2, NULL, transfer);
+                streamRingMarkGap(*stream.ring);            // what was in the FIFO is gone
+                if (total) {                                // the count is lost with the flush
+                    stats.end_ns = monotonicNs();
+                    return false;
+                }
+                got = 0;
+                break;
+            }
+            int n = std::min(level - 2, 62);
+            if (total) n = (int)std::min<uint64_t>(n, total - got - 1);
+            if (n < 1) break;
+
+            uint8_t data[64];
+            uint8_t rxbytes;
+            sampled_ns = monotonicNs();
+            if (!fifoChunk(stream, false, data, n, &rxbytes)) break;
+            if (rxbytes & 0x80) {
+                level = rxbytes;
+                continue;
+            }
+            serviced_ns = monotonicNs();
+            if (edge_ns) histogramAdd(stats.service, serviced_ns - edge_ns);
+            edge_ns = 0;
+            ringChunk(stream, data, n);
+            got += n;
+            level = rxbytes - n;
+
+            if (total && !fixed && total - (got + level) < 256) {
+                switchToFixed(stream);
+                fixed = true;
+            }
+            if (level < threshold - STREAM_MARGIN) break;   // well below: the next rising edge comes
+        }
+    }
+
+    // stopped: whatever is in the FIFO (allowed to empty it in IDLE)
+    static const uint8_t idle = SIDLE;
+    sendStrobes(fd, &idle, 1, 0, NULL, transfer);
+    uint8_t rxbytes = readRegisterWithStatus(fd, RXBYTES, READ_BURST, NULL, transfer);
+    uint8_t data[64], ignored;
+    int n = rxbytes & 0x7F;
+    if (!(rxbytes & 0x80) && n && fifoChunk(stream, false, data, n, &ignored))
+        ringChunk(stream, data, n);
+    stats.end_ns = monotonicNs();
+    stats.complete = !total && stats.overflows == 0;
+    return stats.complete;
+}
+
+bool streamTransmit(Stream &stream, double seconds) {
+    SpiTransferFn transfer = stream.config.transfer;
+    int fd = stream.radio->fd;
+    resetStats(stream);
+    StreamStats &stats = stream.stats;
+    const StreamConfig &config = stream.config;
+    StreamRing &ring = *stream.ring;
+    uint64_t total = config.totalBytes;                     // 0: known once the producer closes the ring
+    int threshold = 65 - rxThreshold(config);
+    uint64_t deadline = monotonicNs() + (uint64_t)(seconds * 1e9);
+
+    // a full FIFO before STX, or all there is in a closed ring
+    for (;;) {
+        bool closed = streamRingClosed(ring);               // before the count: final once closed
+        size_t used = streamRingUsed(ring);
+        if (closed && !total) total = used;
+        if (used >= 64 || (total && used >= total)) break;
+        if (closed) {
+            fprintf(stderr, "ERROR: TX ring closed after %zu bytes\n", used);
+            return false;
+        }
+        if (monotonicNs() > deadline || __atomic_load_n(&stream.stop, __ATOMIC_ACQUIRE)) return false;
+        sleepUntil(monotonicNs() + 1'000'000);
+    }
+    bool fixed = total && total < 256;
+
+    setStreamRegisters(stream, 0x02, total);                // GDO2: TX FIFO at or above the threshold
+    static const uint8_t flush[2] = {SIDLE, SFTX};
+    sendStrobes(fd, flush, 2, 2, NULL, transfer);
+    uint8_t data[64], txbytes;
+    int first = (int)std::min<uint64_t>(64, total ? total : 64);
+    streamRingRead(ring, data, first);
+    if (!fifoChunk(stream, true, data, first, &txbytes)) return false;
+    uint64_t written = first;
+    drainEdges(stream);                                     // the fill's rising edge
+    static const uint8_t stx = STX;
+    sendStrobes(fd, &stx, 1, 0, NULL, transfer);
+    stats.start_ns = monotonicNs();
+    stats.bytes = first;
+    stats.chunks = 1;
+    uint64_t sampled_ns = stats.start_ns;                   // last chunk started
+    uint64_t serviced_ns = stats.start_ns;                  // and ended
+
+    while ((!total || written < total) && !__atomic_load_n(&stream.stop, __ATOMIC_ACQUIRE) &&
+           monotonicNs() < deadline) {
+        uint64_t edge_ns;
+        if (!waitThreshold(stream, false, sampled_ns, &edge_ns)) continue;
+
+        // an edge after the last chunk guarantees the FIFO is below the threshold (one during
+        // it: ask), after that TXBYTES tells
+        int level = edge_ns > serviced_ns ? threshold - 1 : readRegisterWithStatus(fd, TXBYTES, READ_BURST, NULL, transfer);
+        for (;;) {
+            if (level & 0x80) break;
+            if (!total && streamRingClosed(ring)) {         // the length is known from now on
+                total = written + streamRingUsed(ring);
+                setRegister(stream, PKTLEN, total % 256);
+                if (total - (written - level) < 256) {
+                    switchToFixed(stream);
+                    fixed = true;
+                }
+            }
+            int n = (int)std::min<uint64_t>(63 - level, total ? total - written : 63);
+            if (n <= 0) break;
+            int available = (int)std::min<size_t>(n, streamRingUsed(ring));
+            if (available < n) stats.ringEmpty++;
+            if (available == 0) {
+                sleepUntil(monotonicNs() + 50'000);
+                level = readRegisterWithStatus(fd, TXBYTES, READ_BURST, NULL, transfer);
+                continue;
+            }
+            n = available;
+            streamRingRead(ring, data, n);
+            sampled_ns = monotonicNs();
+            if (!fifoChunk(stream, true, data, n, &txbytes)) break;
+            if (txbytes & 0x80) {
+                level = txbytes;
+                break;
+            }
+            serviced_ns = monotonicNs();
+            if (edge_ns) histogramAdd(stats.service, serviced_ns - edge_ns);
+            edge_ns = 0;
+            stats.bytes += n;
+            stats.chunks++;
+            written += n;
+            level = txbytes + n;
+
+            if (total && !fixed && total - (written - level) < 256) {
+                switchToFixed(stream);
+                fixed = true;
+            }
+            if (level >= threshold + STREAM_MARGIN || written == total) break;    // well above: the next falling edge comes
+        }
+        if (level & 0x80) {
+            stats.underflows++;
+            break;
+        }
+    }
+
+    // until the radio ends the packet (TXOFF_MODE = IDLE)
+    uint8_t state = MARCSTATE_TX;
+    while (written == total && !stats.underflows && monotonicNs() < deadline + 10'000'000) {
+        state = readRegisterWithStatus(fd, MARCSTATE, READ_BURST, NULL, transfer) & MARCSTATE_MASK;
+        if (state == MARCSTATE_IDLE || state == MARCSTATE_TXFIFO_UNDERFLOW) break;
+        sleepUntil(monotonicNs() + 100'000);
+    }
+    if (state == MARCSTATE_TXFIFO_UNDERFLOW) stats.underflows++;
+    if (state != MARCSTATE_IDLE) {
+        static const uint8_t recover[2] = {SIDLE, SFTX};
+        sendStrobes(fd, recover, 2, 2, NULL, transfer);
+    }
+    stats.end_ns = monotonicNs();
+    stats.complete = written == total && state == MARCSTATE_IDLE && !stats.underflows;
+    return stats.complete;
+}
+
+void printStreamStats(const char *name, const StreamStats &stats) {
+    double seconds = (stats.end_ns - stats.start_ns) / 1e9;
+    const Histogram &h = stats.service;
+    printf("  %-24s %6.2f s %8.1f kB/s %7llu chunks  overflow %llu  underflow %llu  ring full %llu  ring empty %llu",
+           name, seconds, seconds > 0 ? stats.bytes / seconds / 1e3 : 0.0, (unsigned long long)stats.chunks,
+           (unsigned long long)stats.overflows, (unsigned long long)stats.underflows,
+           (unsigned long long)stats.ringFull, (unsigned long long)stats.ringEmpty);
+    if (h.count)
+        printf("  edge -> chunk p50 %3.0f us  p99 %3.0f us  max %4.0f us", histogramPercentile(h, 50) / 1e3,
+               std::min(histogramPercentile(h, 99), h.max_ns) / 1e3, h.max_ns / 1e3);
+    printf("%s\n", stats.complete ? "" : "  (INCOMPLETE)");
+}
+
+struct SimRun {
+    const char *name;
+    bool tx;
+    uint64_t totalBytes;
+    uint64_t pollNs;
+    uint64_t closeAfter;        // TX: the producer closes the ring after that many bytes (totalBytes 0)
+};
+
+// one radio of the simulator (cc1101_sim.h) in its stream model
+static void runSim(const SimRun &run, double seconds) {
+    Sim *sim = new Sim;
+    simInit(*sim, 1, 1);
+    SimRadio &simRadio = sim->radios[0];
+    streamRegisters(simRadio.regs, cc1100_MSK_500_kb, 433'920'000);
+    simRadio.airBytes = run.tx ? 0 : run.totalBytes;
+    int gdoFd = run.pollNs ? -1 : simWireGdo(*sim, 0);     // polled: GDO2 not wired
+
+    Radio radio = {};
+    snprintf(radio.path, sizeof(radio.path), "sim");
+    radio.fd = simFd(0);
+    StreamConfig config;
+    config.totalBytes = run.totalBytes;
+    config.pollNs = run.pollNs;
+    config.transfer = simTransfer;
+    StreamRing ring;
+    Stream stream;
+    if ((!run.pollNs && gdoFd < 0) || !streamRingInit(ring, 256 * 1024) ||
+        !streamInit(stream, radio, NULL, ring, config) || !simStart(*sim)) {
+        if (gdoFd >= 0) close(gdoFd);
+        delete sim;
+        return;
+    }
+    stream.gdoFd = gdoFd;                                   // streamClose() closes it
+
+    // the application: checks RX bytes as they come (starting over after a gap, so does the
+    // simulator at SRX) / feeds TX
+    bool done = false;
+    uint64_t checked = 0, mismatches = 0, gaps = 0;
+    std::thread app([&] {
+        uint8_t buf[4096];
+        uint64_t produced = 0, expect = 0;
+        uint64_t limit = run.totalBytes ? run.totalBytes : run.closeAfter;
+        auto consume = [&] {
+            size_t n;
+            bool gap;
+            while ((n = streamRingRead(ring, buf, sizeof(buf), &gap)) > 0) {
+                if (gap) {
+                    gaps++;
+                    expect = 0;
+                }
+                for (size_t i = 0; i < n; i++) mismatches += buf[i] != simStreamByte(expect++);
+                checked += n;
+            }
+        };
+        while (!__atomic_load_n(&done, __ATOMIC_ACQUIRE)) {
+            if (run.tx) {
+                size_t n = std::min<uint64_t>(sizeof(buf), limit - produced);
+                for (size_t i = 0; i < n; i++) buf[i] = simStreamByte(produced + i);
+                produced += streamRingWrite(ring, buf, n);
+                if (run.closeAfter && produced == limit && !streamRingClosed(ring)) streamRingClose(ring);
+            } else {
+                consume();
+            }
+            sleepUntil(monotonicNs() + 2'000'000);
+        }
+        if (!run.tx) consume();
+    });
+
+    if (run.tx) streamTransmit(stream, seconds);
+    else streamReceive(stream, seconds);
+    __atomic_store_n(&done, true, __ATOMIC_RELEASE);
+    app.join();
+    simStop(*sim);
+
+    printStreamStats(run.name, stream.stats);
+    if (run.tx)
+        printf("  %-24s radio sent %llu bytes, %llu out of sequence, %llu into a full FIFO\n", "",
+               (unsigned long long)simRadio.endedAt, (unsigned long long)simRadio.dataErrors,
+               (unsigned long long)simRadio.fullWrites);
+    else
+        printf("  %-24s app got %llu bytes, %llu gaps, %llu not as sent, %llu read from an empty FIFO\n", "",
+               (unsigned long long)checked, (unsigned long long)gaps, (unsigned long long)mismatches,
+               (unsigned long long)simRadio.emptyReads);
+
+    streamClose(stream);
+    streamRingFree(ring);
+    delete sim;
+}
+
+void benchmarkStream(double seconds) {
+    const uint8_t *regs = cc1100_MSK_500_kb;
+    double rate = calculateDataRate(regs[MDMCFG4] & 0x0F, regs[MDMCFG3]);
+    double nsPerByte = 8e9 / rate;
+    uint64_t length = (uint64_t)(seconds * rate / 8 / 10) | 3;     // a known length that doesn't end on 256
+    printf("FIFO streaming: simulated cc1100_MSK_500_kb (%.1f kbps = %.1f kB/s, 64 byte FIFO full in %.2f ms), "
+           "20 us/ioctl, 5 MHz SPI, known length %llu bytes\n", rate / 1e3, rate / 8e3, 64 * nsPerByte / 1e6,
+           (unsigned long long)length);
+
+    const SimRun runs[] = {
+        {"RX, threshold edges", false, 0, 0, 0},
+        {"RX, polled every 0.5 ms", false, 0, 500'000, 0},
+        {"RX, polled every 1 ms", false, 0, 1'000'000, 0},
+        {"RX, known length", false, length, 0, 0},
+        {"RX, known length", false, length, 0, 0},
+        {"RX, known length", false, length, 0, 0},
+        {"TX, known length", true, length, 0, 0},
+        {"TX, known length", true, length, 0, 0},
+        {"TX, known length", true, length, 0, 0},
+        {"TX, until ring closed", true, 0, 0, length},
+        {"TX, until ring closed", true, 0, 0, length},
+    };
+    for (const SimRun &run : runs) runSim(run, run.totalBytes || run.closeAfter ? seconds : seconds / 2);
+}
@@ -0,0 +1,116 @@
+#ifndef FIFO_STREAM_H
+#define FIFO_STREAM_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "device_manager.h"
+#include "capture_timing.h"     // Histogram
+#include "spi_queue.h"          // SpiTransferFn
+
+// Continuous streams in infinite packet length mode (PKTCTRL0.LENGTH_CONFIG = 2): after the
+// sync word the radio receives / sends bytes until told otherwise, the 64 byte FIFO is
+// serviced on its threshold instead of polled.
+//
+//   RX: GDO2 = 0x00, rising edge = RX FIFO at the threshold (FIFOTHR, 32 bytes by default)
+//   TX: GDO2 = 0x02, falling edge = TX FIFO below the threshold (33 bytes by default)
+//
+// Every chunk is one SPI message: RXBYTES / TXBYTES (overflow / underflow bit and fill level)
+// followed by the burst transfer, and another chunk follows at once when the level says the
+// line won't give a new edge. RX never reads the last byte while receiving (errata). At
+// 500 kbps a chunk of 31 bytes is due every ~500 us with ~500 us of headroom before the FIFO
+// overflows / underflows.
+//
+// With totalBytes known, PKTLEN = totalBytes % 256 from the start and the radio is switched to
+// fixed length (LENGTH_CONFIG = 0) once fewer than 256 bytes are left, so the packet ends
+// exactly there (the chip's byte counter runs mod 256 in infinite mode). Without it RX runs
+// until stopped and TX until the producer calls streamRingClose(): the length is known from
+// then on (what was sent + what is left in the ring), the same switch ends the packet. Streams
+// are raw: no length byte, CRC, FEC or status bytes.
+//
+// The application side is a StreamRing (bytes, single producer / single consumer). RX marks a
+// gap in it wherever bytes were lost (FIFO overflow, ring full), streamRingRead() stops at a gap
+// and flags the first byte after it.
+
+constexpr int STREAM_RING_GAPS = 16;        // gaps the consumer may fall behind by
+
+struct StreamRing {
+    uint8_t *buf;
+    size_t size;                            // power of two
+    alignas(64) uint64_t head;              // bytes written, by the producer only
+    uint64_t gapAt[STREAM_RING_GAPS];       // head at the gaps, by the producer only
+    uint32_t gaps;                          // gaps marked (atomic)
+    bool closed;                            // no more writes (atomic)
+    alignas(64) uint64_t tail;              // bytes read, by the consumer only
+    uint32_t gapsSeen;                      // by the consumer only
+};
+
+bool streamRingInit(StreamRing &ring, size_t size);
+void streamRingFree(StreamRing &ring);
+// as many of n as fit / are there, returns that count. gap (may be NULL): out[0] is the first
+// byte after a gap (or more than STREAM_RING_GAPS gaps went by unread)
+size_t streamRingWrite(StreamRing &ring, const uint8_t *data, size_t n);
+size_t streamRingRead(StreamRing &ring, uint8_t *out, size_t n, bool *gap = NULL);
+size_t streamRingUsed(const StreamRing &ring);
+// producer: bytes are missing before the next write
+void streamRingMarkGap(StreamRing &ring);
+// producer: nothing follows what was written
+void streamRingClose(StreamRing &ring);
+bool streamRingClosed(const StreamRing &ring);
+
+struct StreamConfig {
+    uint8_t fifoThreshold = 7;              // FIFOTHR.FIFO_THR: RX 4 * (thr + 1) bytes, TX 65 - that
+    uint64_t totalBytes = 0;                // 0 = RX until seconds / streamStop(), TX until streamRingClose()
+    uint64_t pollNs = 0;                    // > 0 or no GDO line: poll the level this often instead of edges
+    SpiTransferFn transfer = NULL;          // NULL = spiTransfer()
+};
+
+struct StreamStats {
+    uint64_t bytes;                         // moved between the FIFO and the ring
+    uint64_t chunks;                        // burst transfers
+    uint64_t overflows;                     // RX FIFO overflowed: flushed, gap in the ring
+    uint64_t underflows;                    // TX FIFO ran dry: stream cut
+    uint64_t ringFull;                      // RX bytes dropped (gap in the ring), the application didn't keep up
+    uint64_t ringEmpty;                     // TX chunks short of data
+    uint64_t start_ns;
+    uint64_t end_ns;
+    bool complete;                          // totalBytes went through and the packet ended there
+    Histogram service;                      // threshold edge -> chunk transferred
+};
+
+struct Stream {
+    Radio *radio;
+    StreamConfig config;
+    int gdoFd;                              // GPIO line events of radio->gdoLine, -1 = poll
+    StreamRing *ring;
+    bool stop;
+    StreamStats stats;
+};
+
+// profile at freqHz for streaming: infinite length, no CRC / FEC / status bytes, back to IDLE
+// after a packet. The per stream registers are set by streamReceive() / streamTransmit().
+void streamRegisters(uint8_t *regs, const uint8_t *profile, uint32_t freqHz);
+// streamRegisters() written to the radio, RX synthesizer calibrated
+bool streamTune(Radio &radio, const uint8_t *profile, uint32_t freqHz);
+
+// gpioChip: where radio.gdoLine lives, NULL = poll
+bool streamInit(Stream &stream, Radio &radio, const char *gpioChip, StreamRing &ring, const StreamConfig &config);
+void streamClose(Stream &stream);
+// from another thread, streamReceive() / streamTransmit() return within ~100 ms
+void streamStop(Stream &stream);
+
+// RX into the ring until totalBytes arrived, seconds passed or streamStop(), returns stats.complete
+// (unbounded: no overflow)
+bool streamReceive(Stream &stream, double seconds);
+// totalBytes (0: up to streamRingClose()) from the ring, waits for data as it goes, returns
+// stats.complete
+bool streamTransmit(Stream &stream, double seconds);
+
+void printStreamStats(const char *name, const StreamStats &stats);
+
+// simulated 500 kbps radio (cc1101_sim.h): unbounded RX on threshold edges vs polled every 1 ms,
+// RX and TX of a known length and TX up to a closed ring through the fixed length switch;
+// throughput, overflows / underflows, gaps, data check
+void benchmarkStream(double seconds);
+
+#endif
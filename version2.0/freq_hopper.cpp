@@ -0,0 +1,237 @@
+#include <string.h>             // memset()
+#include <stdio.h>              // printf(), fprintf()
+#include <vector>
+
+#include "freq_hopper.h"
+#include "main_drivers.h"
+#include "helper_functions.h"
+#include "device_manager.h"
+#include "cc1101_config.h"
+#include "spi_trace.h"          // spiTransfer()
+#include "pacer.h"
+
+constexpr uint64_t SCAL_TIMEOUT_NS = 2'000'000;    // datasheet: ~720 us at 26 MHz
+
+bool hopTableInit(HopTable &table, const HopPlan &plan, uint8_t *sequence) {
+    memset(&table, 0, sizeof(table));
+    if (plan.sequenceLength <= 0) {
+        fprintf(stderr, "ERROR: hop sequence length must be > 0, got %d\n", plan.sequenceLength);
+        return false;
+    }
+    table.plan = plan;
+    if (table.plan.numChannels > HOP_MAX_CHANNELS) table.plan.numChannels = HOP_MAX_CHANNELS;
+    if (table.plan.numChannels < 1) table.plan.numChannels = 1;
+    table.sequence = sequence;
+    int numChannels = table.plan.numChannels;
+
+    for (int c = 0; c < numChannels; c++) {
+        uint32_t word = calculateFreqWord(plan.baseFreqHz + (uint32_t)c * plan.spacingHz);
+        table.channels[c].freq[0] = (word >> 16) & 0xFF;
+        table.channels[c].freq[1] = (word >> 8) & 0xFF;
+        table.channels[c].freq[2] = word & 0xFF;
+    }
+
+    // back to back shuffles of all channels: every channel once per round, never twice in a row
+    uint32_t state = plan.seed ? plan.seed : 1;
+    uint8_t perm[HOP_MAX_CHANNELS];
+    for (int hop = 0; hop < plan.sequenceLength;) {
+        for (int c = 0; c < numChannels; c++) perm[c] = c;
+        for (int c = numChannels - 1; c > 0; c--) {
+            int j = xorshift32(state) % (c + 1);
+            uint8_t t = perm[c];
+            perm[c] = perm[j];
+            perm[j] = t;
+        }
+        if (hop > 0 && numChannels > 1 && perm[0] == sequence[hop - 1]) {
+            perm[0] = perm[numChannels - 1];
+            perm[numChannels - 1] = sequence[hop - 1];
+        }
+        for (int c = 0; c < numChannels && hop < plan.sequenceLength; c++) sequence[hop++] = perm[c];
+    }
+    return true;
+}
+
+bool hopTableCalibrate(HopTable &table, int fd) {
+    static const uint8_t idle = SIDLE;
+    bool ok = true;
+
+    for (int c = 0; c < table.plan.numChannels; c++) {
+        HopChannel &ch = table.channels[c];
+        sendStrobes(fd, &idle, 1, 0, NULL);
+        writeRegister(fd, FREQ2, ch.freq, WRITE_BURST, 3);
+        if (!calibrateSynthesizer(fd, ch.fscal, SCAL_TIMEOUT_NS)) {
+            fprintf(stderr, "WARNING: calibration of hop channel %d did not finish\n", c);
+            ok = false;
+        }
+    }
+    table.calibrated = ok;
+    return ok;
+}
+
+void hopBegin(int fd, HopBackup *backup) {
+    backup->mcsm0 = readRegister(fd, MCSM0, READ_SINGLE_BYTE, 1, NULL);
+    uint8_t mcsm0 = backup->mcsm0 & ~0x30;     // FS_AUTOCAL[5:4] = 0 = never, FSCAL comes from the table
+    writeRegister(fd, MCSM0, &mcsm0, WRITE_SINGLE_BYTE, 1);
+
+    static const uint8_t idle = SIDLE;
+    sendStrobes(fd, &idle, 1, 0, NULL);
+}
+
+void hopEnd(int fd, const HopBackup &backup) {
+    static const uint8_t idle = SIDLE;
+    sendStrobes(fd, &idle, 1, 0, NULL);
+    uint8_t mcsm0 = backup.mcsm0;
+    writeRegister(fd, MCSM0, &mcsm0, WRITE_SINGLE_BYTE, 1);
+}
+
+bool hopToChannel(int fd, const HopTable &table, int channel, bool tx) {
+    if (!table.calibrated) {
+        fprintf(stderr, "ERROR: hop table not calibrated (hopTableCalibrate())\n");
+        return false;
+    }
+    const HopChannel &ch = table.channels[channel];
+
+    uint8_t idle = SIDLE;
+    uint8_t freq[4] = {FREQ2 | WRITE_BURST, ch.freq[0], ch.freq[1], ch.freq[2]};
+    uint8_t fscal[4] = {FSCAL3 | WRITE_BURST, ch.fscal[0], ch.fscal[1], ch.fscal[2]};
+    uint8_t enter = tx ? STX : SRX;
+
+    struct spi_ioc_transfer spi[4];
+    memset(spi, 0, sizeof(spi));
+    const struct { uint8_t *buf; uint32_t len; } parts[4] = {{&idle, 1}, {freq, 4}, {fscal, 4}, {&enter, 1}};
+    for (int i = 0; i < 4; i++) {
+        spi[i].tx_buf = (unsigned long)parts[i].buf;
+        spi[i].len = parts[i].len;
+        spi[i].cs_change = (i < 3);
+    }
+    spi[0].delay_usecs = 2;     // IDLE reached before the synthesizer registers change
+
+    if (spiTransfer(fd, spi, 4) < 0) {
+        perror("SPI hop failed");
+        return false;
+    }
+    return true;
+}
+
+bool hopTo(int fd, const HopTable &table, int hop, bool tx) {
+    if (table.plan.sequenceLength <= 0) {
+        fprintf(stderr, "ERROR: hop table has no sequence (hopTableInit())\n");
+        return false;
+    }
+    return hopToChannel(fd, table, table.sequence[hop % table.plan.sequenceLength], tx);
+}
+
+uint64_t hopWaitSettled(int fd, bool tx, uint64_t start, uint64_t deadline) {
+    static const uint8_t nop = SNOP;
+    uint8_t want = tx ? STATE_TX : STATE_RX;
+    uint8_t status;
+    do {
+        uint64_t now = monotonicNs();
+        if (sendStrobes(fd, &nop, 1, 0, &status) && (status & STATUS_STATE_MASK) == want) return now - start;
+    } while (monotonicNs() < deadline);
+    return 0;
+}
+
+bool hopRun(int fd, const HopTable &table, uint64_t dwellNs, int numHops, bool tx,
+            DwellCallback onDwell, void *ctx, HopStats &stats) {
+    memset(&stats, 0, sizeof(stats));
+    if (table.plan.sequenceLength <= 0) {
+        fprintf(stderr, "ERROR: hop table has no sequence (hopTableInit())\n");
+        return false;
+    }
+    if (dwellNs == 0) {
+        fprintf(stderr, "ERROR: hop dwell must be > 0 ns\n");
+        return false;
+    }
+    histogramInit(stats.hopNs, 0, 2'000);           // 0 - 128 us
+    histogramInit(stats.settleNs, 0, 10'000);       // 0 - 640 us
+    histogramInit(stats.jitterNs, 0, 500);          // 0 - 32 us
+
+    Pacer pacer;
+    pacerInit(pacer, 1e9 / dwellNs, measureSleepOvershootNs());
+
+    for (int hop = 0; hop < numHops; hop++) {
+        pacerWait(pacer);
+        uint64_t deadline = pacer.nextNs - pacer.periodNs;
+        uint64_t start = monotonicNs();
+        if (!hopTo(fd, table, hop, tx)) {
+            stats.skipped = pacer.skipped;
+            return false;
+        }
+        uint64_t sent = monotonicNs();
+
+        histogramAdd(stats.jitterNs, start - deadline);
+        histogramAdd(stats.hopNs, sent - start);
+
+        uint64_t settle = hopWaitSettled(fd, tx, start, pacer.nextNs);
+        if (settle) histogramAdd(stats.settleNs, settle);
+        else stats.notSettled++;
+
+        stats.hops++;
+        if (onDwell) onDwell(hop, table.sequence[hop % table.plan.sequenceLength], ctx);
+    }
+    stats.skipped = pacer.skipped;
+    return true;
+}
+
+static void printHopStats(const char *name, const HopStats &stats) {
+    printf("%s: %llu hops, %llu deadlines skipped, %llu not settled in the dwell\n", name,
+           (unsigned long long)stats.hops, (unsigned long long)stats.skipped, (unsigned long long)stats.notSettled);
+    const struct { const char *label; const Histogram &hist; } rows[] = {
+        {"hop (SPI)", stats.hopNs}, {"hop -> RX/TX", stats.settleNs}, {"dwell jitter", stats.jitterNs}};
+    for (const auto &row : rows) {
+        printf("    %-13s mean %7.1f us  p50 %7.1f us  p99 %7.1f us  max %7.1f us\n", row.label,
+               histogramMean(row.hist) / 1e3, histogramPercentile(row.hist, 50) / 1e3,
+               histogramPercentile(row.hist, 99) / 1e3, row.hist.max_ns / 1e3);
+    }
+}
+
+void benchmarkHopper(const Radio &radio, const HopPlan &plan, uint64_t dwellNs, int numHops) {
+    static HopTable table;
+    if (plan.sequenceLength <= 0 || dwellNs == 0) {
+        fprintf(stderr, "ERROR: hop benchmark needs sequenceLength > 0 and dwellNs > 0\n");
+        return;
+    }
+    std::vector<uint8_t> sequence(plan.sequenceLength);
+
+    uint64_t start = monotonicNs();
+    hopTableInit(table, plan, sequence.data());
+    uint64_t buildNs = monotonicNs() - start;
+
+    HopBackup backup;
+    hopBegin(radio.fd, &backup);
+    start = monotonicNs();
+    hopTableCalibrate(table, radio.fd);
+    printf("%s: hop table of %d channels x %d hops built in %.1f us, calibrated in %.1f ms\n", radio.path,
+           table.plan.numChannels, plan.sequenceLength, buildNs / 1e3, (monotonicNs() - start) / 1e6);
+
+    HopStats stats;
+    hopRun(radio.fd, table, dwellNs, numHops, false, NULL, NULL, stats);
+    printHopStats("precomputed hops", stats);
+    hopEnd(radio.fd, backup);
+
+    // version1.0 style: float FREQ word, 3 single writes, strobes with usleep(), calibrate on every RX entry
+    memset(&stats, 0, sizeof(stats));
+    histogramInit(stats.hopNs, 0, 50'000);          // 0 - 3.2 ms
+    histogramInit(stats.settleNs, 0, 50'000);
+    uint8_t mcsm0 = (backup.mcsm0 & ~0x30) | 0x10;  // FS_AUTOCAL = calibrate going IDLE -> RX/TX
+    writeRegister(radio.fd, MCSM0, &mcsm0, WRITE_SINGLE_BYTE, 1);
+    for (int hop = 0; hop < numHops; hop++) {
+        double hz = plan.baseFreqHz + (double)table.sequence[hop % plan.sequenceLength] * plan.spacingHz;
+        uint32_t word = (uint32_t)((hz * 65536) / CRYSTAL_FREQUENCY);
+        uint8_t freq[3] = {(uint8_t)(word >> 16), (uint8_t)(word >> 8), (uint8_t)word};
+
+        start = monotonicNs();
+        sendStrobe(radio.fd, SIDLE);
+        for (int i = 0; i < 3; i++) writeRegister(radio.fd, FREQ2 + i, &freq[i], WRITE_SINGLE_BYTE, 1);
+        sendStrobe(radio.fd, SRX);
+        histogramAdd(stats.hopNs, monotonicNs() - start);
+
+        uint64_t settle = hopWaitSettled(radio.fd, false, start, start + 10 * dwellNs);
+        if (settle) histogramAdd(stats.settleNs, settle);
+        else stats.notSettled++;
+        stats.hops++;
+    }
+    printHopStats("float + 3 writes + autocal", stats);
+    hopEnd(radio.fd, backup);
+}
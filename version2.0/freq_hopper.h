@@ -0,0 +1,83 @@
+#ifndef FREQ_HOPPER_H
+#define FREQ_HOPPER_H
+
+#include <stdint.h>
+
+#include "capture_timing.h"
+
+struct Radio;
+
+// Frequency hopping with everything precomputed.
+//
+// A hop table holds per channel the FREQ2:0 word and the synthesizer calibration
+// (FSCAL3:1) measured once with SCAL, plus a pseudo random channel sequence from a seed.
+// With MCSM0.FS_AUTOCAL = never, a hop is then a single SPI message:
+//   SIDLE | FREQ2..0 burst | FSCAL3..1 burst | SRX (or STX)
+// no float math, no calibration (~720 us per SCAL saved), one ioctl.
+
+constexpr int HOP_MAX_CHANNELS = 256;
+
+struct HopPlan {
+    uint32_t baseFreqHz;        // channel 0
+    uint32_t spacingHz;
+    int numChannels;            // <= HOP_MAX_CHANNELS
+    uint32_t seed;              // same seed + plan = same sequence on both ends of the link
+    int sequenceLength;         // hops before the sequence repeats
+};
+
+struct HopChannel {
+    uint8_t freq[3];            // FREQ2, FREQ1, FREQ0
+    uint8_t fscal[3];           // FSCAL3, FSCAL2, FSCAL1 from SCAL on this channel
+};
+
+struct HopTable {
+    HopPlan plan;
+    HopChannel channels[HOP_MAX_CHANNELS];
+    uint8_t *sequence;          // sequenceLength channel numbers, no channel twice in a row
+    bool calibrated;
+};
+
+// fills channel words + sequence, sequence must hold plan.sequenceLength
+// returns false (table left empty) if plan.sequenceLength <= 0
+bool hopTableInit(HopTable &table, const HopPlan &plan, uint8_t *sequence);
+
+// SCAL on every channel and keep FSCAL3:1, returns false if a calibration didn't finish
+bool hopTableCalibrate(HopTable &table, int fd);
+
+struct HopStats {
+    uint64_t hops;
+    uint64_t skipped;           // dwell deadlines missed by more than a period
+    uint64_t notSettled;        // RX/TX not confirmed before the dwell ended
+    Histogram hopNs;            // SPI message time
+    Histogram settleNs;         // hop start -> status byte says RX/TX
+    Histogram jitterNs;         // hop start - deadline
+};
+
+// state hopping needs, restored by hopEnd()
+struct HopBackup {
+    uint8_t mcsm0;
+};
+
+// FS_AUTOCAL off (cached calibration is used instead), radio parked in IDLE
+void hopBegin(int fd, HopBackup *backup);
+void hopEnd(int fd, const HopBackup &backup);
+
+// one hop to sequence position `hop`, returns false if the table has no sequence or the SPI message failed
+bool hopTo(int fd, const HopTable &table, int hop, bool tx);
+// same single message hop to a table channel, for schedulers with their own order
+bool hopToChannel(int fd, const HopTable &table, int channel, bool tx);
+
+// poll the status byte until RX/TX or deadline (CLOCK_MONOTONIC), returns ns since start (0 = not settled)
+uint64_t hopWaitSettled(int fd, bool tx, uint64_t start, uint64_t deadline);
+
+// numHops hops at a fixed dwell, each one followed by waiting for RX/TX
+// onDwell (optional) runs once per dwell after the radio settled, e.g. to sample RSSI
+// returns false without hopping if the table has no sequence or dwellNs is 0, or if a hop failed
+typedef void (*DwellCallback)(int hop, int channel, void *ctx);
+bool hopRun(int fd, const HopTable &table, uint64_t dwellNs, int numHops, bool tx,
+            DwellCallback onDwell, void *ctx, HopStats &stats);
+
+// precomputed single message hops vs float FREQ math + 3 writes + autocal (version1.0 style)
+void benchmarkHopper(const Radio &radio, const HopPlan &plan, uint64_t dwellNs, int numHops);
+
+#endif
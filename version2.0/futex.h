@@ -0,0 +1,20 @@
+#ifndef FUTEX_H
+#define FUTEX_H
+
+#include <stdint.h>
+#include <time.h>               // timespec
+#include <unistd.h>             // syscall()
+#include <linux/futex.h>        // FUTEX_WAIT_PRIVATE, FUTEX_WAKE_PRIVATE
+#include <sys/syscall.h>        // SYS_futex
+
+// sleep while *word == expected (returns at once if it already changed), timeout relative, NULL = none
+inline long futexWait(uint32_t *word, uint32_t expected, const struct timespec *timeout) {
+    return syscall(SYS_futex, word, FUTEX_WAIT_PRIVATE, expected, timeout, NULL, 0);
+}
+
+// wake one waiter of word
+inline void futexWake(uint32_t *word) {
+    syscall(SYS_futex, word, FUTEX_WAKE_PRIVATE, 1, NULL, NULL, 0);
+}
+
+#endif
@@ -0,0 +1,60 @@
+#include <string.h>             // memset(), strncpy()
+#include <stdio.h>              // perror()
+#include <fcntl.h>              // open()
+#include <unistd.h>             // read(), close()
+#include <poll.h>               // poll()
+#include <sys/ioctl.h>          // ioctl()
+#include <linux/gpio.h>         // gpio_v2_line_request, gpio_v2_line_event
+
+#include "gpio_edges.h"
+
+int gpioOpenEdges(const char *chip, int line, uint32_t debounceUs) {
+    int chipFd = open(chip, O_RDONLY | O_CLOEXEC);
+    if (chipFd < 0) {
+        perror("Failed to open GPIO chip");
+        return -1;
+    }
+
+    struct gpio_v2_line_request req;
+    memset(&req, 0, sizeof(req));
+    req.offsets[0] = line;
+    req.num_lines = 1;
+    strncpy(req.consumer, "cc1101", sizeof(req.consumer) - 1);
+    req.config.flags = GPIO_V2_LINE_FLAG_INPUT | GPIO_V2_LINE_FLAG_EDGE_RISING | GPIO_V2_LINE_FLAG_EDGE_FALLING;
+    if (debounceUs) {
+        req.config.num_attrs = 1;
+        req.config.attrs[0].attr.id = GPIO_V2_LINE_ATTR_ID_DEBOUNCE;
+        req.config.attrs[0].attr.debounce_period_us = debounceUs;
+        req.config.attrs[0].mask = 1;
+    }
+    req.event_buffer_size = 1024;       // kernel side, ~100 ms of a busy remote
+
+    int ok = ioctl(chipFd, GPIO_V2_GET_LINE_IOCTL, &req);
+    close(chipFd);
+    if (ok < 0) {
+        perror("GPIO line request failed");
+        return -1;
+    }
+    return req.fd;
+}
+
+int gpioReadEdges(int lineFd, GpioEdge *out, int maxEdges, int timeoutMs) {
+    struct pollfd pfd = {lineFd, POLLIN, 0};
+    int ready = poll(&pfd, 1, timeoutMs);
+    if (ready <= 0) return ready;
+
+    constexpr int BATCH = 64;
+    struct gpio_v2_line_event events[BATCH];
+    int want = maxEdges < BATCH ? maxEdges : BATCH;
+    ssize_t n = read(lineFd, events, want * sizeof(events[0]));
+    if (n < 0) {
+        perror("GPIO event read failed");
+        return -1;
+    }
+    int count = n / sizeof(events[0]);
+    for (int i = 0; i < count; i++) {
+        out[i].t_ns = events[i].timestamp_ns;       // CLOCK_MONOTONIC
+        out[i].level = events[i].id == GPIO_V2_LINE_EVENT_RISING_EDGE;
+    }
+    return count;
+}
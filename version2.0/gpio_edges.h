@@ -0,0 +1,20 @@
+#ifndef GPIO_EDGES_H
+#define GPIO_EDGES_H
+
+#include <stdint.h>
+
+// Edges of one GPIO line from the GPIO character device (uAPI v2), both directions, with kernel
+// CLOCK_MONOTONIC timestamps: a GDO pin in serial data output (ook_decoder.h), end of packet
+// (packet_io.h) or FIFO threshold (fifo_stream.h).
+
+struct GpioEdge {
+    uint64_t t_ns;
+    uint8_t level;                  // after the edge
+};
+
+// both edges of one GPIO line, debounceUs = 0 for none, returns the line fd (-1 = failed)
+int gpioOpenEdges(const char *chip, int line, uint32_t debounceUs);
+// edges from the line fd, waits up to timeoutMs, returns edges read (0 = timeout, -1 = error)
+int gpioReadEdges(int lineFd, GpioEdge *out, int maxEdges, int timeoutMs);
+
+#endif
@@ -8,6 +8,16 @@ float calculateDataRate(uint8_t drate_e, uint8_t drate_m);
 uint32_t calculateChanSpc(uint8_t chanspc_e, uint8_t chanspc_m);
 uint32_t calculateChanBW(uint8_t chanbw_e, uint8_t chanbw_m);
 float convertRSSI(uint8_t hexRSSI);
+uint32_t calculateFrequency(uint8_t freq2, uint8_t freq1, uint8_t freq0);
+uint32_t calculateFreqWord(uint32_t freq_hz);
+
+// xorshift PRNG for shuffles and simulated signals, state must not be 0
+inline uint32_t xorshift32(uint32_t &state) {
+    state ^= state << 13;
+    state ^= state >> 17;
+    state ^= state << 5;
+    return state;
+}
 
 // debugging
 void getOrPrintBinary(uint8_t num, int bits, char *output);
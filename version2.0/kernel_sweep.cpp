@@ -0,0 +1,245 @@
+#include <stdio.h>              // printf(), fprintf(), perror(), fopen()
+#include <unistd.h>             // usleep()
+
+#include "kernel_sweep.h"
+#include "main_drivers.h"
+#include "helper_functions.h"   // convertRSSI()
+#include "device_manager.h"
+#include "capture_timing.h"     // monotonicRawNs()
+#include "spi_trace.h"          // spiTransfer()
+#include "spi_util.h"           // spidevBufsiz(), spidevAlignedLen()
+#include "cc1101_config.h"
+
+constexpr uint64_t SWEEP_SCAL_TIMEOUT_NS = 2'000'000;
+constexpr double SPI_HZ = 10'000'000;           // openSPI()
+constexpr double CS_CHANGE_US = 10;             // SPI core default gap when cs_change toggles CSn
+
+static const uint8_t rssiRead[2] = {RSSI | READ_BURST, 0};
+
+static int xfersPerPoint(const SweepPlan &plan) {
+    return 3 + plan.cachedCal + plan.readsPerPoint;
+}
+
+bool sweepCompile(CompiledSweep &sweep, const SweepPlan &plan) {
+    if (plan.numPoints < 1 || plan.numPoints > SWEEP_MAX_POINTS || plan.readsPerPoint < 1 ||
+        plan.readsPerPoint > SWEEP_MAX_READS || plan.firstChannel + (plan.numPoints - 1) * plan.channelStep > 255) {
+        fprintf(stderr, "ERROR: sweep plan out of range (%d points, %d reads per point)\n", plan.numPoints,
+                plan.readsPerPoint);
+        return false;
+    }
+
+    // spidev bytes of one point, every transfer rounded up to the DMA alignment
+    int bufsiz = spidevBufsiz();
+    int reads = plan.readsPerPoint;
+    int pointTx = spidevAlignedLen(1) + spidevAlignedLen(2) + (plan.cachedCal ? spidevAlignedLen(4) : 0) +
+                  spidevAlignedLen(1) + reads * spidevAlignedLen(2);
+    int pointRx = reads * spidevAlignedLen(2);
+    if (pointTx > bufsiz) {
+        fprintf(stderr, "ERROR: one sweep point needs %d of spidev's %d buffer bytes\n", pointTx, bufsiz);
+        return false;
+    }
+
+    sweep.plan = plan;
+    sweep.calibrated = false;
+    int perPoint = xfersPerPoint(plan);
+    sweep.tx.assign(plan.numPoints, SweepPointTx{});
+    sweep.rx.assign(plan.numPoints * reads * 2, 0);
+    sweep.xfers.assign(plan.numPoints * perPoint, spi_ioc_transfer{});
+    sweep.chunks.clear();
+    sweep.chunkPoints.clear();
+
+    int chunkXfers = 0, chunkTx = 0, chunkRx = 0;
+
+    for (int p = 0; p < plan.numPoints; p++) {
+        // new ioctl when this point doesn't fit the current one
+        if (p == 0 || chunkXfers + perPoint > SWEEP_MAX_XFERS || chunkTx + pointTx > bufsiz || chunkRx + pointRx > bufsiz) {
+            sweep.chunks.push_back(p * perPoint);
+            sweep.chunkPoints.push_back(p);
+            chunkXfers = chunkTx = chunkRx = 0;
+        }
+        chunkXfers += perPoint;
+        chunkTx += pointTx;
+        chunkRx += pointRx;
+
+        SweepPointTx &tx = sweep.tx[p];
+        tx.idle = SIDLE;
+        tx.channr[0] = CHANNR;
+        tx.channr[1] = plan.firstChannel + p * plan.channelStep;
+        tx.fscal[0] = FSCAL3 | WRITE_BURST;     // FSCAL3:1 patched in by sweepCalibrate()
+        tx.rx = SRX;
+
+        struct spi_ioc_transfer *x = &sweep.xfers[p * perPoint];
+        int n = 0;
+        x[n].tx_buf = (unsigned long)&tx.idle;
+        x[n].len = 1;
+        x[n++].delay_usecs = 2;                 // IDLE reached before CHANNR changes
+        x[n].tx_buf = (unsigned long)tx.channr;
+        x[n++].len = 2;
+        if (plan.cachedCal) {
+            x[n].tx_buf = (unsigned long)tx.fscal;
+            x[n++].len = 4;
+        }
+        x[n].tx_buf = (unsigned long)&tx.rx;
+        x[n].len = 1;
+        x[n++].delay_usecs = plan.settleUs;
+        for (int r = 0; r < reads; r++) {
+            x[n].tx_buf = (unsigned long)rssiRead;
+            x[n].rx_buf = (unsigned long)&sweep.rx[(p * reads + r) * 2];
+            x[n].len = 2;
+            x[n++].delay_usecs = (r < reads - 1) ? plan.readGapUs : 0;
+        }
+        for (int i = 0; i < perPoint; i++) x[i].cs_change = 1;
+    }
+    sweep.chunks.push_back(plan.numPoints * perPoint);
+    sweep.chunkPoints.push_back(plan.numPoints);
+
+    // last transfer of every ioctl leaves CSn alone
+    for (size_t k = 1; k < sweep.chunks.size(); k++) sweep.xfers[sweep.chunks[k] - 1].cs_change = 0;
+    return true;
+}
+
+bool sweepCalibrate(CompiledSweep &sweep, int fd) {
+    static const uint8_t idle = SIDLE;
+    bool ok = true;
+
+    for (int p = 0; p < sweep.plan.numPoints; p++) {
+        SweepPointTx &tx = sweep.tx[p];
+        sendStrobes(fd, &idle, 1, 0, NULL);
+        writeRegister(fd, CHANNR, &tx.channr[1], WRITE_SINGLE_BYTE, 1);
+        if (!calibrateSynthesizer(fd, &tx.fscal[1], SWEEP_SCAL_TIMEOUT_NS)) {
+            fprintf(stderr, "WARNING: calibration of sweep point %d (CHANNR %d) did not finish\n", p, tx.channr[1]);
+            ok = false;
+        }
+    }
+    sweep.calibrated = ok;
+    return ok;
+}
+
+bool sweepBegin(int fd, const CompiledSweep &sweep, SweepBackup *backup) {
+    if (!enterRssiMode(fd, &backup->rssi)) return false;
+    hopBegin(fd, &backup->hop);     // FS_AUTOCAL = never
+
+    if (!sweep.plan.cachedCal) {
+        uint8_t mcsm0 = (backup->hop.mcsm0 & ~0x30) | 0x10;    // FS_AUTOCAL = calibrate going IDLE -> RX
+        writeRegister(fd, MCSM0, &mcsm0, WRITE_SINGLE_BYTE, 1);
+    }
+    return true;
+}
+
+void sweepEnd(int fd, const SweepBackup &backup) {
+    hopEnd(fd, backup.hop);
+    exitRssiMode(fd, backup.rssi);
+}
+
+bool sweepRun(int fd, CompiledSweep &sweep, float *dbm, uint64_t *t_ns) {
+    const SweepPlan &plan = sweep.plan;
+    if (plan.cachedCal && !sweep.calibrated) {
+        fprintf(stderr, "ERROR: sweep uses cached calibration but sweepCalibrate() didn't succeed\n");
+        return false;
+    }
+
+    for (size_t k = 0; k + 1 < sweep.chunks.size(); k++) {
+        int first = sweep.chunks[k];
+        uint64_t start = monotonicRawNs();
+        if (spiTransfer(fd, &sweep.xfers[first], sweep.chunks[k + 1] - first) < 0) {
+            perror("SPI sweep failed");
+            return false;
+        }
+        if (t_ns) {
+            // points are evenly spaced in the ioctl (same transfers and delays each)
+            uint64_t span = monotonicRawNs() - start;
+            int p0 = sweep.chunkPoints[k], numPoints = sweep.chunkPoints[k + 1] - p0;
+            for (int p = 0; p < numPoints; p++) t_ns[p0 + p] = start + span * (p + 1) / numPoints;
+        }
+    }
+
+    int reads = plan.readsPerPoint;
+    for (int p = 0; p < plan.numPoints; p++) {
+        const uint8_t *rx = &sweep.rx[p * reads * 2];
+        float best = convertRSSI(rx[1]);
+        for (int r = 1; r < reads; r++) {
+            float v = convertRSSI(rx[r * 2 + 1]);
+            if (v > best) best = v;
+        }
+        dbm[p] = best;
+    }
+    return true;
+}
+
+// version1.0 style: strobe + usleep(), register writes and reads one ioctl each, usleep() settle
+// syscalls per point: 2 strobes x (write + usleep), CHANNR, [FSCAL], settle, reads + gaps
+static void sweepPerPoint(int fd, const CompiledSweep &sweep, float *dbm) {
+    const SweepPlan &plan = sweep.plan;
+    for (int p = 0; p < plan.numPoints; p++) {
+        uint8_t channel = sweep.tx[p].channr[1];
+        uint8_t fscal[3] = {sweep.tx[p].fscal[1], sweep.tx[p].fscal[2], sweep.tx[p].fscal[3]};
+        sendStrobe(fd, SIDLE);
+        writeRegister(fd, CHANNR, &channel, WRITE_SINGLE_BYTE, 1);
+        if (plan.cachedCal) writeRegister(fd, FSCAL3, fscal, WRITE_BURST, 3);
+        sendStrobe(fd, SRX);
+        usleep(plan.settleUs);
+
+        float best = -200.0f;
+        for (int r = 0; r < plan.readsPerPoint; r++) {
+            float v = convertRSSI(readRegister(fd, RSSI, READ_BURST, 1, NULL));
+            if (v > best) best = v;
+            if (r < plan.readsPerPoint - 1) usleep(plan.readGapUs);
+        }
+        dbm[p] = best;
+    }
+}
+
+void benchmarkKernelSweep(const Radio &radio, const SweepPlan &plan, int numSweeps) {
+    CompiledSweep sweep;
+    uint64_t start = monotonicRawNs();
+    if (!sweepCompile(sweep, plan)) return;
+    uint64_t compileNs = monotonicRawNs() - start;
+
+    SweepBackup backup;
+    if (!sweepBegin(radio.fd, sweep, &backup)) return;
+    if (plan.cachedCal && !sweepCalibrate(sweep, radio.fd)) {
+        sweepEnd(radio.fd, backup);
+        return;
+    }
+
+    // what the bus alone needs: bytes at SCLK + CSn gaps + the delays in the plan
+    int txBytes = 0, delayUs = 0;
+    for (const auto &x : sweep.xfers) {
+        txBytes += x.len;
+        delayUs += x.delay_usecs;
+    }
+    double busUs = txBytes * 8 / SPI_HZ * 1e6 + sweep.xfers.size() * CS_CHANGE_US + delayUs;
+
+    printf("%s: %d points x %d reads, %zu transfers in %zu ioctl(s), compiled in %.1f us\n", radio.path,
+           plan.numPoints, plan.readsPerPoint, sweep.xfers.size(), sweep.chunks.size() - 1, compileNs / 1e3);
+    printf("    bus estimate %.2f ms per sweep (%.0f us delays, %d bytes @ %.0f MHz, %.0f us CSn gaps)\n",
+           busUs / 1e3, (double)delayUs, txBytes, SPI_HZ / 1e6, sweep.xfers.size() * CS_CHANGE_US);
+
+    std::vector<float> dbm(plan.numPoints);
+    Histogram kernel, perPoint;
+    histogramInit(kernel, 0, 250'000);          // 0 - 16 ms
+    histogramInit(perPoint, 0, 2'000'000);      // 0 - 128 ms
+
+    for (int s = 0; s < numSweeps; s++) {
+        start = monotonicRawNs();
+        if (!sweepRun(radio.fd, sweep, dbm.data(), NULL)) break;
+        histogramAdd(kernel, monotonicRawNs() - start);
+    }
+    for (int s = 0; s < numSweeps; s++) {
+        start = monotonicRawNs();
+        sweepPerPoint(radio.fd, sweep, dbm.data());
+        histogramAdd(perPoint, monotonicRawNs() - start);
+    }
+    sweepEnd(radio.fd, backup);
+
+    const struct { const char *name; const Histogram &hist; int syscalls; } rows[] = {
+        {"kernel timed", kernel, (int)sweep.chunks.size() - 1},
+        {"per point", perPoint, plan.numPoints * (5 + plan.cachedCal + 2 * plan.readsPerPoint)},
+    };
+    for (const auto &row : rows) {
+        double meanMs = histogramMean(row.hist) / 1e6;
+        printf("    %-13s %7.1f sweeps/s  %9.0f points/s  mean %7.2f ms  p99 %7.2f ms  %5d syscalls/sweep\n",
+               row.name, 1e3 / meanMs, plan.numPoints * 1e3 / meanMs, meanMs,
+               histogramPercentile(row.hist, 99) / 1e6, row.syscalls);
+    }
+}
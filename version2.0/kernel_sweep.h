@@ -0,0 +1,82 @@
+#ifndef KERNEL_SWEEP_H
+#define KERNEL_SWEEP_H
+
+#include <stdint.h>
+#include <vector>
+
+#include <linux/spi/spidev.h>   // spi_ioc_transfer
+
+#include "rssi_stream.h"        // RssiModeBackup
+#include "freq_hopper.h"        // HopBackup
+
+struct Radio;
+
+// Kernel timed sweep
+//
+// The per point path (strobe, write CHANNR, strobe, usleep(), read RSSI) costs several
+// syscalls and a sleep per channel. Here a sweep plan is compiled once into one array of
+// spi_ioc_transfer; per point:
+//   SIDLE | CHANNR write | [FSCAL3:1 burst] | SRX + delay_usecs settle | RSSI read (+ delay_usecs gap) x reads
+// and the whole array runs as few SPI_IOC_MESSAGE ioctls as spidev allows, the settle
+// and read gaps are timed by the SPI core instead of usleep(). Per point the cost is then the
+// bus time plus the settle delay.
+//
+// Limits per ioctl: 511 transfers (14 bit ioctl size field / 32 byte spi_ioc_transfer) and
+// spidev bufsiz tx / rx bytes (/sys/module/spidev/parameters/bufsiz, 4096 by default) with
+// every transfer rounded up to SPIDEV_DMA_ALIGN, so the default fits 32 transfers; a bigger
+// bufsiz (spidev.bufsiz=65536 on the kernel command line) means fewer ioctls.
+// Points are never split across ioctls.
+
+constexpr int SWEEP_MAX_POINTS = 256;
+constexpr int SWEEP_MAX_READS = 16;             // RSSI reads per point
+constexpr int SWEEP_MAX_XFERS = 511;            // per SPI_IOC_MESSAGE
+
+struct SweepPlan {
+    uint8_t firstChannel;       // CHANNR of point 0
+    uint8_t channelStep;        // CHANNR step between points
+    int numPoints;
+    int readsPerPoint;
+    uint16_t settleUs;          // SRX -> first read: PLL settle + RSSI valid (+ ~720 us calibration without cachedCal)
+    uint16_t readGapUs;         // between reads of a point, >= 1 / f_RSSI for independent values
+    bool cachedCal;             // FSCAL3:1 per point from sweepCalibrate() instead of FS_AUTOCAL
+};
+
+struct SweepPointTx {           // tx bytes of one point, the RSSI reads share one command
+    uint8_t idle;
+    uint8_t channr[2];
+    uint8_t fscal[4];
+    uint8_t rx;
+};
+
+struct CompiledSweep {
+    SweepPlan plan;
+    std::vector<SweepPointTx> tx;
+    std::vector<uint8_t> rx;                    // numPoints * readsPerPoint * 2
+    std::vector<struct spi_ioc_transfer> xfers;
+    std::vector<int> chunks;                    // first transfer of every ioctl, numXfers last
+    std::vector<int> chunkPoints;               // first point of every ioctl, numPoints last
+    bool calibrated;
+};
+
+// build the transfer array, false if the plan doesn't fit the limits
+bool sweepCompile(CompiledSweep &sweep, const SweepPlan &plan);
+
+// SCAL on every point and patch FSCAL3:1 into the compiled transfers (cachedCal plans)
+bool sweepCalibrate(CompiledSweep &sweep, int fd);
+
+// radio state a sweep needs: RSSI mode, FS_AUTOCAL off (cachedCal) or on IDLE -> RX
+struct SweepBackup {
+    RssiModeBackup rssi;
+    HopBackup hop;
+};
+bool sweepBegin(int fd, const CompiledSweep &sweep, SweepBackup *backup);
+void sweepEnd(int fd, const SweepBackup &backup);
+
+// one sweep, dbm[numPoints] = max of the reads of each point
+// t_ns (optional) = CLOCK_MONOTONIC_RAW when each point's ioctl completed
+bool sweepRun(int fd, CompiledSweep &sweep, float *dbm, uint64_t *t_ns);
+
+// sweeps/s of the compiled sweep vs the per point path, plus the bus time estimate
+void benchmarkKernelSweep(const Radio &radio, const SweepPlan &plan, int numSweeps);
+
+#endif
@@ -0,0 +1,244 @@
+#include <string.h>             // memset()
+#include <stdio.h>              // printf(), fprintf(), fopen(), perror()
+#include <unistd.h>             // close()
+#include <sys/resource.h>       // getrusage(), RUSAGE_THREAD
+#include <algorithm>            // std::max(), std::min()
+#include <thread>
+
+#include "link_bench.h"
+#include "relay.h"              // relayTune(), relayRegisters(), relayAirtimeNs(), RELAY_MAX_PAYLOAD
+#include "packet_io.h"          // packetReceive(), packetSend(), packetWaitTxEnd()
+#include "cc1101_sim.h"
+#include "spi_util.h"           // SpiTransferFn
+#include "gpio_edges.h"         // gpioOpenEdges()
+#include "pacer.h"              // monotonicNs(), sleepUntil()
+#include "cc1101_config.h"
+
+constexpr int LINK_MIN_LENGTH = 5;          // broadcast address + sequence number
+
+static double threadCpuSeconds() {
+    struct rusage ru;
+    getrusage(RUSAGE_THREAD, &ru);
+    return ru.ru_utime.tv_sec + ru.ru_stime.tv_sec + (ru.ru_utime.tv_usec + ru.ru_stime.tv_usec) / 1e6;
+}
+
+// address 0x00 passes the profiles' address filter (ADR_CHK = 0x00 broadcast)
+constexpr uint8_t LINK_ADDRESS = 0x00;
+
+struct LinkRun {
+    Radio *rx;
+    Radio *tx;
+    SpiTransferFn transfer;     // NULL = spiTransfer()
+    int gdoFd;                  // end of packet edges of A, -1 = poll RXBYTES
+    int length;
+    uint64_t airtimeNs;
+    uint64_t txEnd_ns;          // B stops sending
+    bool stop;                  // A stops receiving
+    LinkResult *result;
+    uint8_t buf[1 + 64];        // chip status, payload, RSSI, LQI | CRC_OK
+};
+
+static uint8_t *linkBuffer(void *ctx) {
+    return ((LinkRun *)ctx)->buf;
+}
+
+// check it against what B sent (eop_ns = 0: end of packet unknown, no latency)
+static void linkReceived(void *ctx, uint8_t *buf, uint8_t len, uint64_t eop_ns) {
+    uint64_t now = monotonicNs();
+    LinkRun &run = *(LinkRun *)ctx;
+    LinkResult &result = *run.result;
+    const uint8_t *payload = buf + 1;
+    if (!(payload[len + 1] & 0x80)) {
+        result.dropped++;
+        return;
+    }
+    uint32_t seq = payload[1] | payload[2] << 8 | payload[3] << 16 | (uint32_t)payload[4] << 24;
+    bool ok = len == run.length;
+    for (int i = 0; ok && i < len; i++) ok = payload[i] == simPacketByte(LINK_ADDRESS, seq, i);
+    if (!ok) {
+        result.corrupt++;
+        return;
+    }
+    result.good++;
+    if (eop_ns) histogramAdd(result.latency, now - eop_ns);
+}
+
+static void rxThread(LinkRun &run) {
+    double cpu = threadCpuSeconds();
+    PacketRx rx;
+    rx.fd = run.rx->fd;
+    rx.transfer = run.transfer;
+    rx.gdoFd = run.gdoFd;
+    rx.stop = &run.stop;
+    rx.buffer = linkBuffer;
+    rx.received = linkReceived;
+    rx.ctx = &run;
+    packetReceive(rx);
+    run.result->dropped += rx.dropped;
+    run.result->rxErrors += rx.flushes;
+    run.result->rxCpu = threadCpuSeconds() - cpu;
+}
+
+static void txThread(LinkRun &run) {
+    double cpu = threadCpuSeconds();
+    uint8_t frame[2 + RELAY_MAX_PAYLOAD];
+    for (uint32_t seq = 0; monotonicNs() < run.txEnd_ns; seq++) {
+        for (int i = 0; i < run.length; i++) frame[2 + i] = simPacketByte(LINK_ADDRESS, seq, i);
+        if (!packetSend(run.tx->fd, run.transfer, frame, run.length)) break;
+        run.result->sent++;
+        packetWaitTxEnd(run.tx->fd, run.transfer, monotonicNs(), run.airtimeNs);
+    }
+    run.result->txCpu = threadCpuSeconds() - cpu;
+}
+
+// one profile and length, B sends for seconds, A gets until the last packet is through
+static void linkRun(LinkRun &run, const uint8_t *profile, double seconds) {
+    LinkResult &result = *run.result;
+    histogramInit(result.latency, 0, 10'000);              // 10 us bins, 0..640 us
+    run.airtimeNs = relayAirtimeNs(profile, run.length);
+    run.stop = false;
+
+    std::thread rx(rxThread, std::ref(run));
+    uint64_t start = monotonicNs();
+    run.txEnd_ns = start + (uint64_t)(seconds * 1e9);
+    std::thread tx(txThread, std::ref(run));
+    tx.join();
+    result.seconds = (monotonicNs() - start) / 1e9;
+    sleepUntil(monotonicNs() + 20'000'000);                // last packet's read
+    __atomic_store_n(&run.stop, true, __ATOMIC_RELEASE);
+    rx.join();
+
+    result.goodputBps = result.good * run.length * 8 / result.seconds;
+    result.ceilingBps = run.length * 8 * 1e9 / run.airtimeNs;
+    result.rxCpu /= result.seconds;
+    result.txCpu /= result.seconds;
+}
+
+struct ShippedProfile {
+    const char *name;
+    const uint8_t *regs;
+};
+
+static const ShippedProfile shippedProfiles[] = {
+    {"GFSK_1_2_kb", cc1100_GFSK_1_2_kb}, {"GFSK_38_4_kb", cc1100_GFSK_38_4_kb}, {"GFSK_100_kb", cc1100_GFSK_100_kb},
+    {"MSK_250_kb", cc1100_MSK_250_kb},   {"MSK_500_kb", cc1100_MSK_500_kb},     {"OOK_4_8_kb", cc1100_OOK_4_8_kb},
+};
+
+int runLinkBench(Radio *rx, Radio *tx, const LinkBenchConfig &config, LinkResult *results, int maxResults) {
+    bool simulated = !rx || !tx;
+    Radio simRx = {}, simTx = {};
+    snprintf(simRx.path, sizeof(simRx.path), "sim A");
+    snprintf(simTx.path, sizeof(simTx.path), "sim B");
+    simRx.fd = simFd(0);
+    simTx.fd = simFd(1);
+
+    LinkRun run = {};
+    run.rx = simulated ? &simRx : rx;
+    run.tx = simulated ? &simTx : tx;
+    run.transfer = simulated ? simTransfer : NULL;
+    run.gdoFd = -1;
+
+    if (!simulated && config.gpioChip && rx->gdoLine >= 0) {
+        run.gdoFd = gpioOpenEdges(config.gpioChip, rx->gdoLine, 0);
+        if (run.gdoFd < 0) return 0;
+    }
+
+    int numResults = 0;
+    for (const ShippedProfile &profile : shippedProfiles) {
+        if (!simulated && !relayTune(*rx, *tx, profile.regs, config.freqHz, config.freqHz)) {
+            fprintf(stderr, "ERROR: could not tune the radios to %s, skipped\n", profile.name);
+            continue;
+        }
+        for (int l = 0; l < config.numLengths && numResults < maxResults; l++) {
+            int length = std::min(std::max(config.lengths[l], LINK_MIN_LENGTH), RELAY_MAX_PAYLOAD);
+            LinkResult &result = results[numResults++];
+            memset((void *)&result, 0, sizeof(result));
+            result.profile = profile.name;
+            result.length = length;
+            run.length = length;
+            run.result = &result;
+            double seconds = std::max(config.seconds, config.minPackets * relayAirtimeNs(profile.regs, length) / 1e9);
+
+            if (!simulated) {
+                linkRun(run, profile.regs, seconds);
+                continue;
+            }
+            // B -> A, bit errors at A
+            Sim *sim = new Sim;
+            simInit(*sim, 2, 0x9E3779B9u ^ (uint32_t)length << 16 ^ numResults);
+            SimRadio &a = sim->radios[0];
+            SimRadio &b = sim->radios[1];
+            relayRegisters(a.regs, profile.regs, config.freqHz, false);
+            relayRegisters(b.regs, profile.regs, config.freqHz, true);
+            a.state = MARCSTATE_RX;
+            a.bitErrorRate = simBitErrorRate(a.regs, config.rxPowerDbm, config.noiseFigureDb);
+            b.state = MARCSTATE_FSTXON;
+            b.peer = 0;
+            run.gdoFd = simWireGdo(*sim, 0);
+            if (run.gdoFd >= 0 && simStart(*sim)) {
+                linkRun(run, profile.regs, seconds);
+                simStop(*sim);
+            }
+            if (run.gdoFd >= 0) close(run.gdoFd);
+            run.gdoFd = -1;
+            delete sim;
+        }
+    }
+
+    if (run.gdoFd >= 0) close(run.gdoFd);
+    return numResults;
+}
+
+// upper bin edge capped at the max, so the columns never go down left to right
+static int64_t reportPercentile(const Histogram &h, double p) {
+    return std::min(histogramPercentile(h, p), h.max_ns);
+}
+
+void printLinkReport(FILE *out, const char *title, const LinkBenchConfig &config, const LinkResult *results,
+                     int numResults) {
+    fprintf(out, "# cc1101 link benchmark: %s, %.1f s (min %d packets) per point\n", title, config.seconds,
+            config.minPackets);
+    fprintf(out, "# %-12s %4s %8s %7s %12s %12s %8s %8s %8s %8s %7s %7s\n", "profile", "len", "sent", "PER%",
+            "goodput b/s", "ceiling b/s", "p50 us", "p90 us", "p99 us", "max us", "rx cpu%", "tx cpu%");
+    for (int i = 0; i < numResults; i++) {
+        const LinkResult &r = results[i];
+        const Histogram &h = r.latency;
+        double per = r.sent ? 100.0 * (1.0 - (double)std::min(r.good, r.sent) / r.sent) : 100.0;
+        fprintf(out, "  %-12s %4d %8llu %7.2f %12.0f %12.0f", r.profile, r.length, (unsigned long long)r.sent, per,
+                r.goodputBps, r.ceilingBps);
+        if (h.count)
+            fprintf(out, " %8.0f %8.0f %8.0f %8.0f", reportPercentile(h, 50) / 1e3, reportPercentile(h, 90) / 1e3,
+                    reportPercentile(h, 99) / 1e3, h.max_ns / 1e3);
+        else
+            fprintf(out, " %8s %8s %8s %8s", "-", "-", "-", "-");
+        fprintf(out, " %7.1f %7.1f\n", 100 * r.rxCpu, 100 * r.txCpu);
+        if (r.corrupt || r.rxErrors)
+            fprintf(out, "  %-12s %4d   %llu corrupt, %llu rx errors\n", r.profile, r.length,
+                    (unsigned long long)r.corrupt, (unsigned long long)r.rxErrors);
+    }
+}
+
+void benchmarkLink(Radio *rx, Radio *tx, const LinkBenchConfig &config, const char *reportFile) {
+    static LinkResult results[LINK_MAX_RESULTS];
+    int n = runLinkBench(rx, tx, config, results, LINK_MAX_RESULTS);
+
+    char title[128];
+    if (rx && tx)
+        snprintf(title, sizeof(title), "%s -> %s at %.3f MHz%s", tx->path, rx->path, config.freqHz / 1e6,
+                 config.gpioChip ? "" : ", RXBYTES polled");
+    else
+        snprintf(title, sizeof(title), "simulated link at %.1f dBm, NF %.1f dB", config.rxPowerDbm,
+                 config.noiseFigureDb);
+    printLinkReport(stdout, title, config, results, n);
+
+    if (reportFile) {
+        FILE *file = fopen(reportFile, "w");
+        if (!file) {
+            perror("Failed to open report file");
+            return;
+        }
+        printLinkReport(file, title, config, results, n);
+        fclose(file);
+        printf("report written to %s\n", reportFile);
+    }
+}
@@ -0,0 +1,68 @@
+#ifndef LINK_BENCH_H
+#define LINK_BENCH_H
+
+#include <stdint.h>
+#include <stdio.h>
+
+#include "device_manager.h"
+#include "capture_timing.h"     // Histogram
+
+// End to end packet benchmark over every shipped profile and a sweep of payload lengths:
+// radio B sends, radio A receives (same profile and frequency, relayTune()), or the same code
+// runs against a simulated RF link.
+//
+//   goodput   payload bits per second that arrived with CRC OK and the right content
+//   PER       1 - good / sent
+//   latency   end of packet on A (GDO2 falling edge timestamp) -> packet read into userspace,
+//             "-" when A is polled (no gpioChip): the end of packet time isn't known then
+//   CPU       rx / tx thread CPU time over wall time (RUSAGE_THREAD, SPI ioctls included)
+//
+// B sends back to back: TX FIFO burst write + STX in one message, then waits in FSTXON for the
+// end of the packet. The ceiling column is payload bits / airtime of that profile and length.
+//
+// Simulated link (cc1101_sim.h): sync word always found, bit errors from noncoherent FSK / OOK
+// at rxPowerDbm over the noise floor of the profile's data rate (FEC counted as 3 dB), seeded the
+// same every run. A packet with an error ends with a GDO edge like any other, dropped by the chip
+// (CRC autoflush) or read with CRC_OK clear, as the profile says.
+//
+// The report is fixed width text without dates or host names, so runs of two releases diff cleanly.
+
+constexpr int LINK_MAX_LENGTHS = 8;
+constexpr int LINK_MAX_RESULTS = 6 * LINK_MAX_LENGTHS;     // shipped profiles x lengths
+
+struct LinkBenchConfig {
+    int lengths[LINK_MAX_LENGTHS] = {8, 20, 40, 61};       // payload bytes (address + data), 5..61
+    int numLengths = 4;
+    double seconds = 2.0;                                   // per point, or minPackets airtimes if longer
+    int minPackets = 10;
+    uint32_t freqHz = 433'920'000;                          // radios
+    const char *gpioChip = NULL;                            // GDO2 of the rx radio, NULL = poll RXBYTES (no latency)
+    float rxPowerDbm = -100.0f;                             // simulated link
+    float noiseFigureDb = 7.0f;
+};
+
+struct LinkResult {
+    const char *profile;
+    int length;
+    double seconds;
+    uint64_t sent;
+    uint64_t good;
+    uint64_t dropped;           // end of packet without a good packet (CRC, filtered)
+    uint64_t corrupt;           // CRC OK but not what was sent
+    uint64_t rxErrors;          // overflow / bad length, A flushed
+    double goodputBps;
+    double ceilingBps;
+    double rxCpu;               // fraction of one cpu
+    double txCpu;
+    Histogram latency;
+};
+
+// every profile x length, rx / tx NULL = simulated link, returns results written
+int runLinkBench(Radio *rx, Radio *tx, const LinkBenchConfig &config, LinkResult *results, int maxResults);
+void printLinkReport(FILE *out, const char *title, const LinkBenchConfig &config, const LinkResult *results,
+                     int numResults);
+
+// runLinkBench() + report to stdout and to reportFile if not NULL
+void benchmarkLink(Radio *rx, Radio *tx, const LinkBenchConfig &config, const char *reportFile);
+
+#endif
@@ -1,29 +1,82 @@
 #include "main_drivers.h"
 #include "cc1101_config.h"
 #include "helper_functions.h"
+#include "register_map.h"
+#include "device_manager.h"
+#include "rssi_stream.h"
+#include "rssi_dsp.h"
+#include "rssi_codec.h"
+#include "shm_ring.h"
+#include "spi_trace.h"
+#include "freq_hopper.h"
+#include "adaptive_scan.h"
+#include "kernel_sweep.h"
+#include "packet_codec.h"
+#include "fec.h"
+#include "ook_decoder.h"
+#include "spi_queue.h"
+#include "radio_coro.h"
+#include "diversity.h"
+#include "relay.h"
+#include "link_bench.h"
+#include "fifo_stream.h"
 
-// Define SPI device paths
-constexpr const char* SPI0_DEV = "/dev/spidev0.0";
-constexpr const char* SPI1_DEV = "/dev/spidev1.0";
+// GDO line (BCM) wired to each radio, in the order they enumerate
+constexpr int GDO_LINES[] = {GDO2};
 
 int main() {
-    // Open SPI devices
-    int spi0_fd = openSPI(SPI0_DEV);
-    int spi1_fd = openSPI(SPI1_DEV);
+    // record every SPI transfer of this run, or run again from such a recording instead of spidev
+    // spiTraceStart("session.spit");
+    // spiReplayStart("session.spit", true);
 
-    testConnections(spi0_fd, spi1_fd);
+    // find every cc1101 on /dev/spidevB.C
+    Radio radios[MAX_RADIOS];
+    int numRadios = enumerateRadios(radios, MAX_RADIOS, GDO_LINES, sizeof(GDO_LINES) / sizeof(GDO_LINES[0]));
+    if (numRadios == 0) {
+        fprintf(stderr, "ERROR: no cc1101 found\n");
+        return 1;
+    }
 
-    print_MDMCFGs(spi0_fd);
-    print_MDMCFGs(spi1_fd);
+    testConnections(radios, numRadios);
 
-    printSyncPkt(spi0_fd);
-    printSyncPkt(spi1_fd);
+    for (int i = 0; i < numRadios; i++) {
+        print_MDMCFGs(radios[i].fd);
+        printSyncPkt(radios[i].fd);
 
-    // recordToFile(spi0_fd, spi1_fd, "longRecording.csv", 10'000);    // takes ~3.3 seconds = ~3000 samples per sec?
+        // full config + status space, one burst + one ioctl per radio
+        // dumpRegisters(radios[i].fd, DUMP_JSON);
+    }
+
+    RecordOptions options;
+    options.numThreads = numRadios;     // one thread per radio
+    options.sampleRateHz = 2000;        // per radio
+    options.realtime.enabled = false;   // SCHED_FIFO + mlockall + pin to isolated cpu (needs root/CAP_SYS_NICE)
+    options.detectBursts = false;       // store burst events instead of every sample
+    options.shmName = NULL;             // e.g. "/rssi" to publish live samples to other processes
+    // benchmarkSampleRate(radios, numRadios, 10'000);
+    // benchmarkRssiMode(radios, numRadios, 100'000);
+    // benchmarkDsp(256, 100'000);
+    // benchmarkBurstDetector(10'000'000);
+    // benchmarkCodecSimulated(10'000'000);
+    // benchmarkShmRing(200'000, 64);
+    // benchmarkSpiTrace(1'000'000);
+    // benchmarkHopper(radios[0], {902'000'000, 400'000, 50, 1, 1000}, 400'000, 10'000);
+    // benchmarkAdaptiveScan(64, 60);
+    // benchmarkKernelSweep(radios[0], {0, 1, 64, 4, 100, 20, true}, 200);
+    // benchmarkPacketCodec(100'000, 61);
+    // benchmarkFec(20'000, 61);
+    // benchmarkOokDecoder(3'000);
+    // benchmarkSpiQueue(radios[0].fd, 2.0);    // -1 = simulated bus
+    // benchmarkCoroutines(8, 1000, 3.0);
+    // benchmarkDiversity(50'000, 14.0f);
+    // benchmarkRelay(20, 2.0);
+    // benchmarkLink(NULL, NULL, LinkBenchConfig(), "link_report.txt");   // &radios[1], &radios[0] = real radios
+    // benchmarkStream(3.0);
+    // recordToFile(radios, numRadios, "longRecording.csv", 5'000, options);
 
     // Close SPI devices
-    close(spi0_fd);
-    close(spi1_fd);
+    closeRadios(radios, numRadios);
+    // spiTraceStop();
 
     return 0;
 }
@@ -1,21 +1,30 @@
 #include <string.h>             // memset()
 #include <stdio.h>              // printf(), perror()
-#include <unistd.h>             // write(), usleep()
+#include <unistd.h>             // usleep()
+#include <algorithm>            // std::copy()
 #include <chrono>
+#include <vector>
 
 #include <linux/spi/spidev.h>   // spi_ioc_transfer, SPI_IOC_WR_MODE, ...
 #include <sys/ioctl.h>          // ioctl()
-#include <fcntl.h>              // open(), O_RDWR, ...
 
 #include "main_drivers.h"       // includes <stdint.h> for uint8_t, ...
 #include "helper_functions.h"
+#include "device_manager.h"
+#include "capture_timing.h"
+#include "pacer.h"
+#include "rssi_stream.h"
+#include "rssi_codec.h"
+#include "shm_ring.h"
+#include "spi_trace.h"       // spiTransfer(), spiWrite(), spiOpen()
+#include "spi_util.h"           // spiXfer()
 #include "cc1101_config.h"      // includes <stdint.h>
 #include "ansi_colors.h"
 
 
 // device = path to spidevX.X
 int openSPI(const char* device) {
-    int fd = open(device, O_RDWR);
+    int fd = spiOpen(device);
     if (fd < 0) {
         perror("Failed to open SPI device");
         return -1;
@@ -53,7 +62,7 @@ uint8_t readRegister(int fd, uint8_t reg, uint8_t cc1101MemoryOffset, uint8_t nu
     spi.rx_buf = (unsigned long)rxBuff;     // set pointer to rx buffer
     spi.len = numRegisters + 1;
     
-    if (ioctl(fd, SPI_IOC_MESSAGE(1), &spi) < 0) {
+    if (spiTransfer(fd, &spi, 1) < 0) {
         perror("SPI transfer failed");
         return 0;
     }
@@ -69,7 +78,8 @@ uint8_t readRegister(int fd, uint8_t reg, uint8_t cc1101MemoryOffset, uint8_t nu
 //      write single = 0x00
 //      write burst  = 0x40 (0100 0000)
 //      SOME REGISTERS REQUIRE BURST BIT SET ALWAYS (SEE PAGE 70)
-void writeRegister(int fd, uint8_t reg, uint8_t *data, uint8_t cc1101MemoryOffset, uint8_t numRegisters) {
+void writeRegister(int fd, uint8_t reg, uint8_t *data, uint8_t cc1101MemoryOffset, uint8_t numRegisters,
+                   SpiTransferFn transfer) {
     uint8_t txBuff[numRegisters + 1];   // address + data
 
     txBuff[0] = reg | cc1101MemoryOffset;   // set burst bit
@@ -81,94 +91,557 @@ void writeRegister(int fd, uint8_t reg, uint8_t *data, uint8_t cc1101MemoryOffse
     spi.tx_buf = (unsigned long)txBuff;
     spi.len = numRegisters + 1;
 
-    if (ioctl(fd, SPI_IOC_MESSAGE(1), &spi) < 0) {
-        perror("SPI write failed");
-    }
+    spiXfer(transfer, fd, &spi, 1);
 }
 
 // send byte strobe/command using write syscall
 void sendStrobe(int fd, uint8_t strobe) {
-    write(fd, &strobe, 1);
+    spiWrite(fd, &strobe, 1);
     usleep(500);  // allow the command to process/state to change
 }
 
+// status regs can't be burst read (burst bit selects status space), so read each one
+// as its own 2 byte transfer but chain them all into a single ioctl
+// cs_change = 1 releases CSn between transfers so the cc1101 sees separate commands
+bool readStatusRegisters(int fd, uint8_t firstReg, uint8_t numRegisters, uint8_t *returnBuff) {
+    constexpr int MAX_STATUS_REGS = 16;
+    if (numRegisters == 0 || numRegisters > MAX_STATUS_REGS) return false;
+
+    uint8_t txBuff[MAX_STATUS_REGS][2];
+    uint8_t rxBuff[MAX_STATUS_REGS][2];
+    struct spi_ioc_transfer spi[MAX_STATUS_REGS];
+    memset(spi, 0, sizeof(spi));
+
+    for (int i = 0; i < numRegisters; i++) {
+        txBuff[i][0] = (firstReg + i) | READ_BURST;
+        txBuff[i][1] = 0;
+        spi[i].tx_buf = (unsigned long)txBuff[i];
+        spi[i].rx_buf = (unsigned long)rxBuff[i];
+        spi[i].len = 2;
+        spi[i].cs_change = (i < numRegisters - 1);
+    }
+
+    if (spiTransfer(fd, spi, numRegisters) < 0) {
+        perror("SPI status read failed");
+        return false;
+    }
+
+    for (int i = 0; i < numRegisters; i++) returnBuff[i] = rxBuff[i][1];
+    return true;
+}
+
+// one register read that also returns the chip status byte clocked out with the header
+// (state + RX FIFO bytes), so a single transfer gives both the value and the radio's state
+uint8_t readRegisterWithStatus(int fd, uint8_t reg, uint8_t cc1101MemoryOffset, uint8_t *chipStatus,
+                               SpiTransferFn transfer) {
+    uint8_t txBuff[2] = {(uint8_t)(reg | cc1101MemoryOffset), 0};
+    uint8_t rxBuff[2] = {0, 0};
+
+    struct spi_ioc_transfer spi;
+    memset(&spi, 0, sizeof(spi));
+    spi.tx_buf = (unsigned long)txBuff;
+    spi.rx_buf = (unsigned long)rxBuff;
+    spi.len = 2;
+
+    int ret = spiXfer(transfer, fd, &spi, 1);
+    if (chipStatus) *chipStatus = rxBuff[0];       // 0 (IDLE) on failure
+    return ret < 0 ? 0 : rxBuff[1];
+}
+
+// several strobes in one ioctl, CSn released between them
+// delayUs: kernel timed gap after each strobe (spi_ioc_transfer.delay_usecs), no usleep() per strobe
+// statusBuff (optional): chip status byte seen with each strobe (= state before it executed)
+bool sendStrobes(int fd, const uint8_t *strobes, int numStrobes, uint16_t delayUs, uint8_t *statusBuff,
+                 SpiTransferFn transfer) {
+    if (numStrobes <= 0 || numStrobes > MAX_STROBES) {
+        fprintf(stderr, "ERROR: %d strobes in one message, 1 .. %d\n", numStrobes, MAX_STROBES);
+        return false;
+    }
+
+    uint8_t txBuff[MAX_STROBES];
+    uint8_t rxBuff[MAX_STROBES];
+    struct spi_ioc_transfer spi[MAX_STROBES];
+    memset(spi, 0, sizeof(spi));
+
+    for (int i = 0; i < numStrobes; i++) {
+        txBuff[i] = strobes[i];
+        spi[i].tx_buf = (unsigned long)&txBuff[i];
+        spi[i].rx_buf = (unsigned long)&rxBuff[i];
+        spi[i].len = 1;
+        spi[i].delay_usecs = (i < numStrobes - 1) ? delayUs : 0;
+        spi[i].cs_change = (i < numStrobes - 1);
+    }
+
+    if (spiXfer(transfer, fd, spi, numStrobes) < 0) return false;
+    if (statusBuff) memcpy(statusBuff, rxBuff, numStrobes);
+    return true;
+}
+
+// RX FIFO overflowed or the radio fell out of RX:
+// SIDLE, SFRX, SRX as one message, then poll SNOP until the status byte says RX
+// returns ns until RX was confirmed, 0 = still not in RX after timeoutNs
+uint64_t recoverRx(int fd, uint64_t timeoutNs) {
+    static const uint8_t sequence[] = {SIDLE, SFRX, SRX};
+    uint64_t start = monotonicRawNs();
+
+    // 2 us after each strobe: SFRX is only accepted once IDLE is reached
+    if (!sendStrobes(fd, sequence, sizeof(sequence), 2, NULL)) return 0;
+
+    // RX is entered after the synthesizer settles (+ calibration if MCSM0.FS_AUTOCAL asks for it)
+    const uint8_t nop = SNOP;
+    uint8_t status;
+    do {
+        if (sendStrobes(fd, &nop, 1, 0, &status) && (status & STATUS_STATE_MASK) == STATE_RX) {
+            return monotonicRawNs() - start;
+        }
+    } while (monotonicRawNs() - start < timeoutNs);
+    return 0;
+}
+
+// make overflows rarer when sampling RSSI in FIFO mode (sampleRadio() also flushes a FIFO that
+// is close to full): RXOFF_MODE = STAY_RX so a received packet doesn't drop the radio to IDLE,
+// FIFO_THR = 15 (RX 64 bytes) so the threshold only trips when the FIFO is actually full
+void configureRxRecovery(int fd) {
+    uint8_t mcsm1 = readRegister(fd, MCSM1, READ_SINGLE_BYTE, 1, NULL);
+    uint8_t fifothr = readRegister(fd, FIFOTHR, READ_SINGLE_BYTE, 1, NULL);
+    mcsm1 = (mcsm1 & 0xF3) | (0x03 << 2);  // RXOFF_MODE[3:2] = 3 = stay in RX
+    fifothr = (fifothr & 0xF0) | 0x0F;     // FIFO_THR[3:0], keep ADC_RETENTION / CLOSE_IN_RX
+    writeRegister(fd, MCSM1, &mcsm1, WRITE_SINGLE_BYTE, 1);
+    writeRegister(fd, FIFOTHR, &fifothr, WRITE_SINGLE_BYTE, 1);
+}
+
+// SCAL on the current frequency (radio in IDLE), wait until it's back in IDLE and read
+// the result FSCAL3:1 into fscal[3] so it can be written back instead of calibrating again
+bool calibrateSynthesizer(int fd, uint8_t *fscal, uint64_t timeoutNs) {
+    const uint8_t cal = SCAL, nop = SNOP;
+    uint64_t start = monotonicRawNs();
+    if (!sendStrobes(fd, &cal, 1, 0, NULL)) return false;
+
+    uint8_t status = 0xFF;
+    do {
+        if (sendStrobes(fd, &nop, 1, 0, &status) && (status & STATUS_STATE_MASK) == STATE_IDLE) break;
+    } while (monotonicRawNs() - start < timeoutNs);
+    if ((status & STATUS_STATE_MASK) != STATE_IDLE) return false;
+
+    readRegister(fd, FSCAL3, READ_BURST, 3, fscal);
+    return true;
+}
+
 // try to read PARTNUM and VERSION registers and print them
-void testConnections(int spi0_fd, int spi1_fd) {
-    uint8_t partnum1 = readRegister(spi0_fd, PARTNUM, READ_BURST, 1, NULL);
-    uint8_t version1 = readRegister(spi0_fd, VERSION, READ_BURST, 1, NULL);
-    uint8_t partnum2 = readRegister(spi1_fd, PARTNUM, READ_BURST, 1, NULL);
-    uint8_t version2 = readRegister(spi1_fd, VERSION, READ_BURST, 1, NULL);
+void testConnections(const Radio *radios, int numRadios) {
+    for (int i = 0; i < numRadios; i++) {
+        uint8_t partnum = readRegister(radios[i].fd, PARTNUM, READ_BURST, 1, NULL);
+        uint8_t version = readRegister(radios[i].fd, VERSION, READ_BURST, 1, NULL);
 
-    printf("CC1101 #1 (SPI0) - PARTNUM: 0x%02X, VERSION: 0x%02X\n", partnum1, version1);
-    printf("CC1101 #2 (SPI1) - PARTNUM: 0x%02X, VERSION: 0x%02X\n", partnum2, version2);
+        printf("CC1101 #%d (%s) - PARTNUM: 0x%02X, VERSION: 0x%02X, GDO: %d, CPU: %d\n",
+               i + 1, radios[i].path, partnum, version, radios[i].gdoLine, radios[i].cpu);
+    }
 }
 
 
-// num_samples: number of RSSI values (32-bit/4-byte floats) to record (stack limited to ~8MB)
-void recordToFile(int spi0_fd, int spi1_fd, const char *filename, int num_samples) {
-    // set max rx fifo
-    uint8_t maxFifo = 0x0F;
-    writeRegister(spi0_fd, FIFOTHR, &maxFifo, WRITE_SINGLE_BYTE, 1);
-    writeRegister(spi1_fd, FIFOTHR, &maxFifo, WRITE_SINGLE_BYTE, 1);
+// events of one radio, context samples of all events back to back. Sized before recording:
+// the detector callback runs on the acquisition thread and must not allocate, what doesn't
+// fit is counted instead.
+constexpr int BURST_SINK_EVENTS = 4096;
+constexpr int BURST_SINK_CONTEXT = 64 * BURST_CONTEXT_MAX;
 
-    // buffer to hold rssi values to write to file
-    float rssiBuffer[num_samples];
-    int   index = 0; 
+struct BurstSink {
+    std::vector<BurstEvent> events;         // numEvents used
+    std::vector<RssiSample> context;        // numContext used
+    size_t numEvents = 0;
+    size_t numContext = 0;
+    uint64_t droppedEvents = 0;             // sink full
+    uint64_t cutContext = 0;                // events stored with only part of their context
+};
 
-    FILE *csvFile = fopen(filename, "w");
-    if (!csvFile) {
-        fprintf(stderr, "ERROR: Could not open %s for writing\n", filename);
-        close(spi0_fd); close(spi1_fd);
+constexpr uint64_t RX_RECOVERY_TIMEOUT_NS = 2'000'000;
+constexpr uint8_t RX_FLUSH_BYTES = 60;      // RXBYTES above this: flush before the FIFO overflows
+
+struct RxRecoveryStats {
+    uint64_t recoveries;                    // overflowed / fell out of RX
+    uint64_t flushes;                       // flushed before it overflowed
+    uint64_t failed;                        // RX not confirmed within RX_RECOVERY_TIMEOUT_NS
+    uint64_t blindNs;                       // total time not in RX: recovering, and since the last sample in RX before an overflow
+    uint64_t maxBlindNs;
+    uint64_t lastRxNs;                      // last sample that saw RX
+};
+
+struct RecordContext {
+    std::vector<RssiSample> rssi[MAX_RADIOS];   // per radio, indexed by Radio::index
+    std::vector<BurstDetector> detectors;   // per radio when detecting bursts
+    BurstSink bursts[MAX_RADIOS];
+    uint64_t skipped[MAX_RADIOS];           // deadlines the pacer had to drop
+    RxRecoveryStats recovery[MAX_RADIOS];
+    ShmRingWriter *shm;                     // live samples for other processes, NULL = off
+    int num_samples;                        // per radio
+    uint64_t spinNs;
+    const RecordOptions *options;
+};
+
+static double targetRate(const RecordOptions &options, const Radio &radio) {
+    double rate = options.radioSampleRateHz[radio.index];
+    return (rate > 0) ? rate : options.sampleRateHz;
+}
+
+// SIDLE, SFRX, SRX and a fresh sample; blind from sinceNs (when RX was last seen) to RX again
+static void restartRx(const Radio &radio, RssiSample &sample, RxRecoveryStats &stats, uint64_t sinceNs) {
+    uint64_t start = monotonicRawNs();
+    uint64_t recoveryNs = recoverRx(radio.fd, RX_RECOVERY_TIMEOUT_NS);
+    if (!recoveryNs) {
+        stats.failed++;
+        recoveryNs = RX_RECOVERY_TIMEOUT_NS;
+    }
+    uint64_t blindNs = recoveryNs + (sinceNs && sinceNs < start ? start - sinceNs : 0);
+    stats.blindNs += blindNs;
+    if (blindNs > stats.maxBlindNs) stats.maxBlindNs = blindNs;
+
+    // the sample before was taken outside RX / before the flush, replace it
+    sample.raw = readRegister(radio.fd, RSSI, READ_BURST, 1, NULL);
+    sample.t_ns = monotonicRawNs();
+    stats.lastRxNs = sample.t_ns;
+}
+
+// one sample of one radio: rx fifo overflow check (+ recovery), then the RSSI read
+// in RSSI mode the FIFO is unused so only the RSSI read is left
+static void sampleRadio(const Radio &radio, RssiSample &sample, bool rssiMode, RxRecoveryStats &stats) {
+    if (rssiMode) {
+        sample.raw = readRegister(radio.fd, RSSI, READ_BURST, 1, NULL);
+        sample.t_ns = monotonicRawNs();
         return;
     }
 
-    // put both cc1101s in RX
-    sendStrobe(spi0_fd, SRX);
-    sendStrobe(spi1_fd, SRX); 
-    
-    bool recording = true;
-    auto startTime = std::chrono::high_resolution_clock::now();
-    while (recording) {
-        // check marcstate and rxbytes for rx fifo overflow
-        uint8_t marcstate0 = readRegister(spi0_fd, MARCSTATE, READ_BURST, 1, NULL) & 0x1F;
-        uint8_t marcstate1 = readRegister(spi1_fd, MARCSTATE, READ_BURST, 1, NULL) & 0x1F;
-        uint8_t rxbytes0 = readRegister(spi0_fd, RXBYTES, READ_BURST, 1, NULL) & 0x7F;
-        uint8_t rxbytes1 = readRegister(spi1_fd, RXBYTES, READ_BURST, 1, NULL) & 0x7F;
-
-        if (marcstate0 != 0x0D || rxbytes0 > 60) {
-            printf("SPI0: RXBYTES = %d, MARCSTATE = 0x%02X\n", rxbytes0, marcstate0);
-            sendStrobe(spi0_fd, SFRX); // Flush RX FIFO
-            sendStrobe(spi0_fd, SRX); // Re-enter RX mode
+    // the status byte of the RSSI read tells if we're still in RX (overflow = its own state)
+    // and how full the RX FIFO is (saturates at 15), so RXBYTES is only read once that's 15+
+    uint8_t status;
+    sample.raw = readRegisterWithStatus(radio.fd, RSSI, READ_BURST, &status);
+    sample.t_ns = monotonicRawNs();     // stamp at SPI completion
+    if ((status & STATUS_STATE_MASK) != STATE_RX) {
+        // overflowed somewhere after the last sample in RX, nothing was received since
+        stats.recoveries++;
+        restartRx(radio, sample, stats, stats.lastRxNs);
+        return;
+    }
+    if ((status & STATUS_FIFO_BYTES_MASK) == STATUS_FIFO_BYTES_MASK) {
+        uint8_t rxbytes = readRegister(radio.fd, RXBYTES, READ_BURST, 1, NULL);
+        if ((rxbytes & 0x80) || (rxbytes & 0x7F) > RX_FLUSH_BYTES) {
+            stats.flushes++;
+            restartRx(radio, sample, stats, 0);
+            return;
+        }
+    }
+    stats.lastRxNs = sample.t_ns;
+}
+
+// acquisition loop for one shard of radios (runs on its own thread)
+// every radio has its own pacer, the loop always serves whichever deadline is due first
+static void recordShard(Radio **shard, int shardSize, void *ctx) {
+    RecordContext *record = (RecordContext *)ctx;
+
+    const RealtimeConfig &realtime = record->options->realtime;
+    RealtimeStatus status = {false, false, -1};
+    if (realtime.enabled) {
+        int shardId = shard[0]->index;  // radio i goes to shard i % numThreads
+        status = enterRealtime(realtime, shardId, shard[0]->cpu);
+        printf("shard %d: %s, cpu %d%s\n", shardId, status.fifo ? "SCHED_FIFO" : "SCHED_OTHER",
+               status.cpu, status.pinned ? "" : " (not pinned)");
+    }
+
+    // put all cc1101s in RX
+    bool rssiMode = record->options->rssiMode;
+    RssiModeBackup backups[MAX_RADIOS];
+    for (int r = 0; r < shardSize; r++) {
+        if (rssiMode) enterRssiMode(shard[r]->fd, &backups[r]);
+        else if (!recoverRx(shard[r]->fd, RX_RECOVERY_TIMEOUT_NS)) fprintf(stderr, "WARNING: %s did not enter RX\n", shard[r]->path);
+    }
+
+    // RSSI mode takes batch[r] reads per deadline in one ioctl, so its pacer runs at rate / batch[r]
+    Pacer pacers[MAX_RADIOS];
+    RxRecoveryStats recovery[MAX_RADIOS] = {};
+    int count[MAX_RADIOS] = {0};
+    int published[MAX_RADIOS] = {0};
+    int batch[MAX_RADIOS];
+    for (int r = 0; r < shardSize; r++) {
+        double rate = targetRate(*record->options, *shard[r]);
+        batch[r] = rssiMode ? rssiBatchSize(rate) : 1;
+        pacerInit(pacers[r], rate / batch[r], record->spinNs);
+    }
+
+    int remaining = shardSize;
+    while (remaining) {
+        // earliest deadline first, ties (e.g. unpaced) go round robin by ticks
+        int next = -1;
+        for (int r = 0; r < shardSize; r++) {
+            if (count[r] == record->num_samples) continue;
+            if (next < 0 || pacers[r].nextNs < pacers[next].nextNs ||
+                (pacers[r].nextNs == pacers[next].nextNs && pacers[r].ticks < pacers[next].ticks)) next = r;
+        }
+
+        pacerWait(pacers[next]);
+        int index = shard[next]->index;
+        RssiSample *samples = &record->rssi[index][count[next]];
+        int n = (record->num_samples - count[next] < batch[next]) ? record->num_samples - count[next] : batch[next];
+        if (!rssiMode) sampleRadio(*shard[next], samples[0], false, recovery[next]);
+        else if (!readRssiBatch(shard[next]->fd, n, samples)) {
+            for (int i = 0; i < n; i++) sampleRadio(*shard[next], samples[i], true, recovery[next]);
         }
-        if (marcstate1 != 0x0D || rxbytes1 > 60) {
-            printf("SPI1: RXBYTES = %d, MARCSTATE = 0x%02X\n", rxbytes1, marcstate1);
-            sendStrobe(spi1_fd, SFRX);
-            sendStrobe(spi1_fd, SRX);
+        if (!record->detectors.empty()) burstProcess(record->detectors[index], samples, n);
+        count[next] += n;
+
+        // shmBatch samples per frame, the rest in a last short one
+        int shmBatch = record->options->shmBatch;
+        while (record->shm && (count[next] - published[next] >= shmBatch ||
+                               (count[next] == record->num_samples && published[next] < count[next]))) {
+            int m = (count[next] - published[next] < shmBatch) ? count[next] - published[next] : shmBatch;
+            shmRingPublishSamples(*record->shm, index, &record->rssi[index][published[next]], m);
+            published[next] += m;
+        }
+        if (count[next] == record->num_samples) remaining--;
+    }
+
+    for (int r = 0; r < shardSize; r++) {
+        record->skipped[shard[r]->index] = pacers[r].skipped * batch[r];
+        record->recovery[shard[r]->index] = recovery[r];
+        if (!record->detectors.empty()) burstFlush(record->detectors[shard[r]->index]);
+        if (rssiMode) exitRssiMode(shard[r]->fd, backups[r]);
+    }
+    exitRealtime(status);
+}
+
+// sample spacing of every radio + skew of every radio against the first one
+static void reportTiming(Radio *radios, int numRadios, RecordContext &record) {
+    int num_samples = record.num_samples;
+    uint64_t toleranceNs = record.options->alignToleranceNs;
+    uint64_t deadlineNs = record.options->realtime.deadlineNs;
+    char title[64];
+
+    for (int i = 0; i < numRadios; i++) {
+        const RssiSample *samples = record.rssi[radios[i].index].data();
+
+        Histogram jitter;
+        histogramInit(jitter, -200'000, 6'250);     // +-200us around the mean period
+        double period = measureJitter(samples, num_samples, jitter);
+
+        snprintf(title, sizeof(title), "%s jitter (mean period %.1f us)", radios[i].path, period / 1e3);
+        printHistogram(title, jitter);
+
+        double target = targetRate(*record.options, radios[i]);
+        double achieved = (period > 0) ? 1e9 / period : 0.0;
+        if (target > 0) {
+            printf("    rate: target %.1f Hz, achieved %.1f Hz (%+.2f%%), %llu deadlines skipped\n", target, achieved,
+                   100.0 * (achieved - target) / target, (unsigned long long)record.skipped[radios[i].index]);
+        } else {
+            printf("    rate: unpaced, achieved %.1f Hz\n", achieved);
+        }
+
+        uint64_t limitNs = (target > 0 ? (uint64_t)(1e9 / target) : (uint64_t)period) + deadlineNs;
+        uint64_t misses = countDeadlineMisses(samples, num_samples, limitNs);
+        printf("    deadline misses (> %.1f us): %llu / %d\n", limitNs / 1e3, (unsigned long long)misses, num_samples - 1);
+
+        const RxRecoveryStats &rec = record.recovery[radios[i].index];
+        if (rec.recoveries || rec.flushes) {
+            printf("    RX recoveries: %llu, flushes: %llu (%llu failed), blind %.1f us total, %.1f us mean, %.1f us max\n",
+                   (unsigned long long)rec.recoveries, (unsigned long long)rec.flushes, (unsigned long long)rec.failed,
+                   rec.blindNs / 1e3, rec.blindNs / 1e3 / (rec.recoveries + rec.flushes), rec.maxBlindNs / 1e3);
         }
+    }
+
+    std::vector<SamplePair> pairs(num_samples);
+    for (int i = 1; i < numRadios; i++) {
+        Histogram skew;
+        int64_t binNs = (2 * (int64_t)toleranceNs) / HISTOGRAM_BINS + 1;
+        histogramInit(skew, -(int64_t)toleranceNs, binNs);
 
-        usleep(500);  // .5ms
+        int numPairs = alignSamples(record.rssi[radios[0].index].data(), num_samples,
+                                    record.rssi[radios[i].index].data(), num_samples,
+                                    toleranceNs, pairs.data(), num_samples, &skew);
 
-        uint8_t rssi_raw_0 = readRegister(spi0_fd, RSSI, READ_BURST, 1, NULL);
-        uint8_t rssi_raw_1 = readRegister(spi1_fd, RSSI, READ_BURST, 1, NULL);
-        float rssi_dbm_0 = convertRSSI(rssi_raw_0);
-        float rssi_dbm_1 = convertRSSI(rssi_raw_1);
+        snprintf(title, sizeof(title), "%s -> %s skew (%d/%d paired)", radios[0].path, radios[i].path, numPairs, num_samples);
+        printHistogram(title, skew);
+    }
+}
+
+static void storeBurst(const BurstEvent &event, void *ctx) {
+    BurstSink *sink = (BurstSink *)ctx;
+    if (sink->numEvents == sink->events.size()) {
+        sink->droppedEvents++;
+        return;
+    }
+    BurstEvent &stored = sink->events[sink->numEvents++];
+    stored = event;
+    stored.context = NULL;                  // points into the detector, only valid in here
+    size_t room = sink->context.size() - sink->numContext;
+    if ((size_t)event.numContext > room) {
+        stored.numContext = (int)room;
+        sink->cutContext++;
+    }
+    std::copy(event.context, event.context + stored.numContext, sink->context.begin() + sink->numContext);
+    sink->numContext += stored.numContext;
+}
 
-        printf("RSSI (SPI0): %.2f dBm | RSSI (SPI1): %.2f dBm\n", rssi_dbm_0, rssi_dbm_1);
+// one line per event, raw context (if any) in <filename>.context.csv
+// returns bytes written
+static long writeBursts(Radio *radios, int numRadios, RecordContext &record, FILE *csvFile, const char *filename) {
+    fprintf(csvFile, "radio,freq_hz,start_ns,end_ns,duration_us,peak_dBm,mean_dBm,floor_dBm,samples\n");
 
-        rssiBuffer[index++] = rssi_dbm_0;
-        rssiBuffer[index++] = rssi_dbm_1;
+    FILE *contextFile = NULL;
+    if (record.options->burst.preTrigger || record.options->burst.postTrigger) {
+        char contextName[256];
+        snprintf(contextName, sizeof(contextName), "%s.context.csv", filename);
+        contextFile = fopen(contextName, "w");
+        if (contextFile) fprintf(contextFile, "radio,event,t_ns,dBm\n");
+    }
 
-        if (index >= num_samples) {
-            auto endTime = std::chrono::high_resolution_clock::now();
-            std::chrono::duration<double> duration = endTime - startTime;
-            printf("Recorded for %.1f seconds\n", duration.count());
+    for (int i = 0; i < numRadios; i++) {
+        const BurstSink &sink = record.bursts[radios[i].index];
+        size_t offset = 0;
+        for (size_t e = 0; e < sink.numEvents; e++) {
+            const BurstEvent &ev = sink.events[e];
+            fprintf(csvFile, "%s,%u,%llu,%llu,%.1f,%.1f,%.2f,%.2f,%u\n", radios[i].path, ev.freq_hz,
+                    (unsigned long long)ev.start_ns, (unsigned long long)ev.end_ns, (ev.end_ns - ev.start_ns) / 1e3,
+                    ev.peak_dbm, ev.mean_dbm, ev.floor_dbm, ev.numSamples);
 
-            for (int i = 0; i < num_samples; i++) {
-                fprintf(csvFile, "%.2f\n", rssiBuffer[i]);
+            for (int c = 0; contextFile && c < ev.numContext; c++) {
+                const RssiSample &sample = sink.context[offset + c];
+                fprintf(contextFile, "%s,%zu,%llu,%.1f\n", radios[i].path, e, (unsigned long long)sample.t_ns, convertRSSI(sample.raw));
             }
+            offset += ev.numContext;
+        }
+        printf("%s: %zu bursts, %llu too short, %llu dropped, %llu with context cut\n", radios[i].path,
+               sink.numEvents, (unsigned long long)record.detectors[radios[i].index].discarded,
+               (unsigned long long)sink.droppedEvents, (unsigned long long)sink.cutContext);
+    }
+
+    long bytes = ftell(csvFile);
+    if (contextFile) {
+        bytes += ftell(contextFile);
+        fclose(contextFile);
+    }
+    return bytes;
+}
+
+// num_samples: number of RSSI values to record per radio
+// radios are split over options.numThreads acquisition threads
+// file gets a timestamp (CLOCK_MONOTONIC_RAW ns) and a dBm column per radio
+// options.compress: .rssc instead, radio i of the file = radios[i]
+bool checkRecordOptions(const RecordOptions &options, int num_samples) {
+    if (num_samples <= 0) {
+        fprintf(stderr, "ERROR: num_samples = %d, must be > 0\n", num_samples);
+        return false;
+    }
+    if (options.shmName && (options.shmBatch < 1 ||
+                            (size_t)options.shmBatch * sizeof(RssiSample) > SHM_RING_MAX_SLOT_BYTES)) {
+        fprintf(stderr, "ERROR: shmBatch = %d, must be 1 .. %zu samples\n", options.shmBatch,
+                SHM_RING_MAX_SLOT_BYTES / sizeof(RssiSample));
+        return false;
+    }
+    return true;
+}
+
+void recordToFile(Radio *radios, int numRadios, const char *filename, int num_samples, const RecordOptions &options) {
+    if (numRadios > MAX_RADIOS) numRadios = MAX_RADIOS;
+    if (!checkRecordOptions(options, num_samples)) return;
+
+    // stay in RX after packets, max rx fifo threshold
+    for (int i = 0; i < numRadios; i++) configureRxRecovery(radios[i].fd);
+
+    // buffers to hold rssi values to write to file
+    // realtime: lock first so the buffers below are allocated + touched (assign) into locked memory
+    bool locked = options.realtime.enabled && lockMemory();
+
+    RecordContext record;
+    ShmRingWriter shm;
+    record.shm = NULL;
+    if (options.shmName) {
+        uint32_t slotBytes = options.shmBatch * sizeof(RssiSample);
+        if (shmRingCreate(shm, options.shmName, SHM_RING_SLOTS, slotBytes)) record.shm = &shm;
+        else fprintf(stderr, "WARNING: could not create shared memory ring %s, recording without it\n", options.shmName);
+    }
+    record.num_samples = num_samples;
+    record.options = &options;
+    record.spinNs = (options.spinNs >= 0) ? options.spinNs : measureSleepOvershootNs();
+    printf("pacer busy poll tail: %.1f us\n", record.spinNs / 1e3);
+    for (int i = 0; i < numRadios; i++) record.rssi[radios[i].index].assign(num_samples, RssiSample{0, 0});
+
+    if (options.detectBursts) {
+        record.detectors.resize(MAX_RADIOS);
+        for (int i = 0; i < numRadios; i++) {
+            uint8_t freq[3];
+            readRegister(radios[i].fd, FREQ2, READ_BURST, 3, freq);
+            uint32_t freq_hz = calculateFrequency(freq[0], freq[1], freq[2]);
+
+            BurstSink &sink = record.bursts[radios[i].index];
+            sink.events.assign(BURST_SINK_EVENTS, BurstEvent{});
+            if (options.burst.preTrigger || options.burst.postTrigger) sink.context.assign(BURST_SINK_CONTEXT, RssiSample{0, 0});
+            burstInit(record.detectors[radios[i].index], options.burst, radios[i].index, freq_hz, storeBurst, &sink);
+        }
+    }
+
+    auto startTime = std::chrono::high_resolution_clock::now();
+    runOnRadios(radios, numRadios, options.numThreads, recordShard, &record);
+    auto endTime = std::chrono::high_resolution_clock::now();
+    std::chrono::duration<double> duration = endTime - startTime;
+    printf("Recorded %d samples x %d radios for %.1f seconds\n", num_samples, numRadios, duration.count());
+    if (locked) unlockMemory();
+    if (record.shm) shmRingDestroy(shm, true);     // attached readers keep their mapping and can drain the tail
+
+    reportTiming(radios, numRadios, record);
+
+    // only the file that gets written is created: .rssc, or csv of bursts / samples
+    if (options.compress && !options.detectBursts) {
+        RssiEncoder enc;
+        encoderInit(enc);
+        for (int i = 0; i < numRadios; i++) {
+            const std::vector<RssiSample> &rssi = record.rssi[radios[i].index];
+            encoderAdd(enc, i, rssi.data(), num_samples, options.compressTimestamps);
+        }
+        if (writeRssc(filename, enc, numRadios)) {
+            printf("wrote %zu bytes for %d samples x %d radios\n", enc.data.size(), num_samples, numRadios);
+        }
+        return;
+    }
+
+    FILE *csvFile = fopen(filename, "w");
+    if (!csvFile) {
+        fprintf(stderr, "ERROR: Could not open %s for writing\n", filename);
+        return;
+    }
 
-            recording = false;
+    if (options.detectBursts) {
+        long bytes = writeBursts(radios, numRadios, record, csvFile, filename);
+        long rawBytes = (long)num_samples * numRadios * 28;     // ~ one "t_ns,dBm" pair per sample in the raw csv
+        printf("wrote %ld bytes of events instead of ~%ld bytes of samples (%.0fx less)\n", bytes, rawBytes,
+               bytes ? (double)rawBytes / bytes : 0.0);
+        fclose(csvFile);
+        return;
+    }
+
+    for (int i = 0; i < numRadios; i++) fprintf(csvFile, "%s%s t_ns,%s dBm", (i ? "," : ""), radios[i].path, radios[i].path);
+    fprintf(csvFile, "\n");
+    for (int s = 0; s < num_samples; s++) {
+        for (int i = 0; i < numRadios; i++) {
+            const RssiSample &sample = record.rssi[radios[i].index][s];
+            fprintf(csvFile, "%s%llu,%.2f", (i ? "," : ""), (unsigned long long)sample.t_ns, convertRSSI(sample.raw));
         }
+        fprintf(csvFile, "\n");
     }
+    fclose(csvFile);
 }
 
+// unpaced sampleRadio() loop per radio = max rate one radio can be sampled at on this bus
+void benchmarkSampleRate(Radio *radios, int numRadios, int num_samples) {
+    std::vector<RssiSample> samples(num_samples);
+
+    for (int i = 0; i < numRadios; i++) {
+        configureRxRecovery(radios[i].fd);
+        recoverRx(radios[i].fd, RX_RECOVERY_TIMEOUT_NS);
+        RxRecoveryStats recovery = {};
+
+        uint64_t start = monotonicRawNs();
+        for (int s = 0; s < num_samples; s++) sampleRadio(radios[i], samples[s], false, recovery);
+        uint64_t elapsed = monotonicRawNs() - start;
+
+        printf("%s: %d samples in %.1f ms = %.1f us/sample = max %.0f samples/s, %llu RX recoveries, %llu flushes (%.1f us blind)\n",
+               radios[i].path, num_samples, elapsed / 1e6, elapsed / 1e3 / num_samples, num_samples * 1e9 / elapsed,
+               (unsigned long long)recovery.recoveries, (unsigned long long)recovery.flushes, recovery.blindNs / 1e3);
+    }
+}
@@ -5,12 +5,48 @@
 #include <unistd.h>
 #include <stdio.h>
 
+#include "realtime.h"
+#include "device_manager.h"
+#include "burst_detector.h"
+#include "spi_util.h"           // SpiTransferFn
+
 int openSPI(const char* device);
 uint8_t readRegister(int fd, uint8_t reg, uint8_t cc1101MemoryOffset, uint8_t numRegisters, uint8_t *returnBuff);
-void writeRegister(int fd, uint8_t reg, uint8_t *data, uint8_t cc1101MemoryOffset, uint8_t numRegisters);
+// transfer: NULL = spiTransfer(), else a simulator / executor (spi_util.h)
+void writeRegister(int fd, uint8_t reg, uint8_t *data, uint8_t cc1101MemoryOffset, uint8_t numRegisters,
+                   SpiTransferFn transfer = NULL);
 void sendStrobe(int fd, uint8_t strobe);
+bool readStatusRegisters(int fd, uint8_t firstReg, uint8_t numRegisters, uint8_t *returnBuff);
+uint8_t readRegisterWithStatus(int fd, uint8_t reg, uint8_t cc1101MemoryOffset, uint8_t *chipStatus,
+                               SpiTransferFn transfer = NULL);
+constexpr int MAX_STROBES = 8;      // per sendStrobes() message, more is an error
+bool sendStrobes(int fd, const uint8_t *strobes, int numStrobes, uint16_t delayUs, uint8_t *statusBuff,
+                 SpiTransferFn transfer = NULL);
+uint64_t recoverRx(int fd, uint64_t timeoutNs);
+void configureRxRecovery(int fd);
+bool calibrateSynthesizer(int fd, uint8_t *fscal, uint64_t timeoutNs);
+
+struct RecordOptions {
+    int numThreads = 1;                     // acquisition threads, radios are sharded across them
+    double sampleRateHz = 1000;             // target rate per radio, <= 0 = as fast as possible
+    double radioSampleRateHz[MAX_RADIOS] = {};  // per radio override (by Radio::index), 0 = sampleRateHz
+    int64_t spinNs = -1;                    // busy poll tail before each deadline, -1 = measure sleep overshoot
+    bool rssiMode = false;                  // continuous RX without FIFO (rssi_stream.h), batched reads, no overflow polling
+    uint64_t alignToleranceNs = 100'000;    // max distance between two radios' samples to pair them
+    RealtimeConfig realtime;                // opt-in SCHED_FIFO + mlockall + cpu pinning
+    bool detectBursts = false;              // write burst events (burst_detector.h) instead of raw samples
+    BurstConfig burst;
+    bool compress = false;                  // write raw samples as .rssc (rssi_codec.h) instead of csv
+    bool compressTimestamps = true;         // keep exact timestamps in the .rssc, false = interpolated
+    const char *shmName = NULL;             // also publish samples live into this shm ring (shm_ring.h), e.g. "/rssi"
+    int shmBatch = 64;                      // samples per ring frame, 1 .. SHM_RING_MAX_SLOT_BYTES / sizeof(RssiSample)
+};
+
+// values recordToFile() can't run with, printed as ERROR
+bool checkRecordOptions(const RecordOptions &options, int num_samples);
 
-void testConnections(int fd1, int fd2);
-void recordToFile(int spi0_fd, int spi1_fd, const char *filename, int num_samples);
+void testConnections(const Radio *radios, int numRadios);
+void recordToFile(Radio *radios, int numRadios, const char *filename, int num_samples, const RecordOptions &options = RecordOptions());
+void benchmarkSampleRate(Radio *radios, int numRadios, int num_samples);
 
 #endif
\ No newline at end of file
@@ -0,0 +1,115 @@
+#ifndef OOK_DECODER_H
+#define OOK_DECODER_H
+
+#include <stdint.h>
+#include <stdio.h>
+
+#include "gpio_edges.h"         // GpioEdge
+
+struct Radio;
+
+// OOK remote control decoding from GDO edges
+//
+// The radio runs the cc1100_OOK_4_8_kb profile in asynchronous serial mode with the GDO pin
+// on "serial data output" (IOCFGx = 0x0D), so the pin follows the demodulated carrier. Edges
+// come from the GPIO character device (uAPI v2) with kernel CLOCK_MONOTONIC timestamps.
+//
+// The decoder turns edges into pulse (carrier on) and gap widths, groups them online into
+// width clusters (nearest center within tolerance, centers follow a running mean), cuts frames
+// at long gaps and decodes each frame by what its widths look like:
+//   PWM:        2 pulse widths, pulse + gap about constant  -> long pulse = 1
+//   PPM:        1 pulse width, 2 gap widths                  -> long gap = 1
+//   Manchester: every width ~T or ~2T                        -> high then low = 1 (G.E. Thomas)
+// Everything lives in the OokDecoder struct, no allocation after ookInit().
+//
+// edge files: text, one edge per line "t_ns level" (level after the edge), '#' comments
+
+constexpr int OOK_MAX_WIDTHS = 1024;        // pulse + gap widths per frame
+constexpr int OOK_MAX_BITS = 512;
+constexpr int OOK_MAX_CLUSTERS = 8;         // per kind (pulse / gap)
+
+enum OokEncoding : uint8_t {
+    OOK_UNKNOWN = 0,                // widths kept in the frame, no bits
+    OOK_PWM = 1,
+    OOK_PPM = 2,
+    OOK_MANCHESTER = 3
+};
+
+struct OokFrame {
+    uint64_t start_ns;
+    uint64_t end_ns;                // falling edge of the last pulse
+    OokEncoding encoding;
+    int numPulses;
+    int numBits;
+    uint32_t shortNs;               // short width (T for Manchester)
+    uint32_t longNs;
+    uint8_t bits[OOK_MAX_BITS / 8]; // MSB first
+    const uint32_t *widths;         // pulse, gap, pulse, ... only valid inside the callback
+    int numWidths;
+};
+
+typedef void (*OokFrameCallback)(const OokFrame &frame, void *ctx);
+
+struct OokConfig {
+    uint32_t resetGapNs = 4'000'000;    // a gap this long ends the frame
+    uint32_t maxPulseNs = 10'000'000;   // longer carrier = not a remote, frame dropped
+    uint32_t glitchNs = 40'000;         // shorter runs are merged into their neighbours
+    float tolerance = 0.3f;             // relative width distance to share a cluster / class
+    int minPulses = 8;                  // shorter frames are noise
+};
+
+struct OokCluster {
+    uint32_t centerNs;
+    uint32_t count;
+};
+
+struct OokDecoder {
+    OokConfig config;
+    OokFrameCallback callback;
+    void *callbackCtx;
+
+    bool started;
+    uint8_t level;
+    uint64_t lastEdge_ns;
+    uint64_t frameStart_ns;
+    uint32_t widths[OOK_MAX_WIDTHS];
+    int numWidths;
+
+    OokCluster pulses[OOK_MAX_CLUSTERS];
+    OokCluster gaps[OOK_MAX_CLUSTERS];
+    int numPulseClusters;
+    int numGapClusters;
+
+    OokFrame frame;
+
+    uint64_t edges;                 // totals
+    uint64_t frames;                // with an encoding
+    uint64_t unknown;               // passed to the callback as OOK_UNKNOWN
+    uint64_t dropped;               // too short / carrier too long
+};
+
+void ookInit(OokDecoder &dec, const OokConfig &config, OokFrameCallback callback, void *callbackCtx);
+void ookEdge(OokDecoder &dec, uint64_t t_ns, uint8_t level);
+void ookEdges(OokDecoder &dec, const GpioEdge *edges, int numEdges);
+
+// end the current frame if nothing happened for resetGapNs before now_ns (call on poll timeouts)
+void ookIdle(OokDecoder &dec, uint64_t now_ns);
+// end the current frame now (end of file / capture)
+void ookFlush(OokDecoder &dec);
+
+// edge files, ookDecodeFile() streams it through the decoder, returns edges read (-1 = can't open)
+bool ookWriteEdge(FILE *file, const GpioEdge &edge);
+long ookDecodeFile(OokDecoder &dec, const char *filename);
+
+// cc1100_OOK_4_8_kb at freqHz, asynchronous serial output on IOCFGx (gdoReg = IOCFG0 / IOCFG2), RX
+bool ookConfigureRadio(int fd, uint32_t freqHz, uint8_t gdoReg);
+
+// capture + decode on radio.gdoLine for seconds, edges also saved to recordFile if not NULL
+bool ookCapture(const Radio &radio, const char *chip, double seconds, const char *recordFile,
+                OokFrameCallback callback, void *ctx);
+
+// simulated PWM / PPM / Manchester remotes with jitter through an edge file: decoded frames
+// correct and edges/s of the decoder
+void benchmarkOokDecoder(int numFrames);
+
+#endif
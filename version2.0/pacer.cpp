@@ -0,0 +1,71 @@
+#include <errno.h>              // EINTR
+#include <stdio.h>              // fprintf()
+#include <string.h>             // strerror()
+#include <algorithm>            // std::sort()
+
+#include "pacer.h"
+
+void sleepUntil(uint64_t deadlineNs) {
+    struct timespec ts;
+    ts.tv_sec = deadlineNs / 1'000'000'000ull;
+    ts.tv_nsec = deadlineNs % 1'000'000'000ull;
+    int err;
+    while ((err = clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL)) == EINTR) {}
+    if (err) fprintf(stderr, "ERROR: clock_nanosleep failed: %s\n", strerror(err));
+}
+
+uint64_t measureSleepOvershootNs() {
+    constexpr int NUM_SLEEPS = 200;
+    uint64_t overshoot[NUM_SLEEPS];
+
+    for (int i = 0; i < NUM_SLEEPS; i++) {
+        uint64_t deadline = monotonicNs() + 100'000;
+        sleepUntil(deadline);
+        overshoot[i] = monotonicNs() - deadline;
+    }
+    std::sort(overshoot, overshoot + NUM_SLEEPS);
+    return overshoot[NUM_SLEEPS * 99 / 100];
+}
+
+void pacerInit(Pacer &pacer, double rateHz, uint64_t spinNs) {
+    pacer.periodNs = (rateHz > 0) ? (uint64_t)(1e9 / rateHz) : 0;
+    pacer.nextNs = monotonicNs();
+    pacer.spinNs = spinNs;
+    pacer.ticks = 0;
+    pacer.skipped = 0;
+}
+
+void pacerWait(Pacer &pacer) {
+    pacer.ticks++;
+    if (pacer.periodNs == 0) return;
+
+    uint64_t now = monotonicNs();
+
+    // more than a period behind: drop the missed deadlines instead of bursting to catch up
+    if (now > pacer.nextNs + pacer.periodNs) {
+        uint64_t behind = (now - pacer.nextNs) / pacer.periodNs;
+        pacer.skipped += behind;
+        pacer.nextNs += behind * pacer.periodNs;
+    }
+
+    if (pacer.nextNs > now + pacer.spinNs && pacer.periodNs >= 2 * pacer.spinNs) {
+        sleepUntil(pacer.nextNs - pacer.spinNs);
+    }
+    while (monotonicNs() < pacer.nextNs) {}     // busy poll tail
+
+    pacer.nextNs += pacer.periodNs;
+}
+
+bool pacerDue(Pacer &pacer, uint64_t nowNs) {
+    if (pacer.periodNs && nowNs < pacer.nextNs) return false;
+    pacer.ticks++;
+    if (pacer.periodNs == 0) return true;
+
+    if (nowNs > pacer.nextNs + pacer.periodNs) {
+        uint64_t behind = (nowNs - pacer.nextNs) / pacer.periodNs;
+        pacer.skipped += behind;
+        pacer.nextNs += behind * pacer.periodNs;
+    }
+    pacer.nextNs += pacer.periodNs;
+    return true;
+}
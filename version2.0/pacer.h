@@ -0,0 +1,42 @@
+#ifndef PACER_H
+#define PACER_H
+
+#include <stdint.h>
+#include <time.h>
+
+// fixed rate deadline scheduler: deadlines are absolute (start + n * period) so time spent
+// on SPI between waits is compensated automatically and errors don't accumulate
+struct Pacer {
+    uint64_t periodNs;
+    uint64_t nextNs;        // next deadline (CLOCK_MONOTONIC)
+    uint64_t spinNs;        // sleep until nextNs - spinNs, busy poll the rest
+    uint64_t ticks;         // deadlines served
+    uint64_t skipped;       // deadlines dropped because we were more than a period late
+};
+
+inline uint64_t monotonicNs() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1'000'000'000ull + ts.tv_nsec;
+}
+
+// clock_nanosleep(TIMER_ABSTIME) until deadlineNs (CLOCK_MONOTONIC), restarted on EINTR only.
+// Deadlines are on CLOCK_MONOTONIC (clock_nanosleep can't sleep on MONOTONIC_RAW) while sample
+// timestamps are MONOTONIC_RAW: rates measured from timestamps can differ by the NTP slew (<= 500 ppm).
+void sleepUntil(uint64_t deadlineNs);
+
+// how late clock_nanosleep(TIMER_ABSTIME) wakes up on this box (p99 over a few hundred sleeps)
+uint64_t measureSleepOvershootNs();
+
+// rateHz <= 0 = don't pace (waits return immediately)
+// spinNs = busy poll tail, periods shorter than 2 * spinNs are busy polled completely
+void pacerInit(Pacer &pacer, double rateHz, uint64_t spinNs);
+
+// block until the next deadline, then schedule the one after it
+void pacerWait(Pacer &pacer);
+
+// non blocking version for event loops: true (and schedule the next one) if the deadline
+// has passed at nowNs, same skipping as pacerWait(). Sleep until pacer.nextNs in between.
+bool pacerDue(Pacer &pacer, uint64_t nowNs);
+
+#endif
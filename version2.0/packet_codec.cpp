@@ -0,0 +1,261 @@
+#include <string.h>             // memcpy(), memcmp()
+#include <stdio.h>              // printf()
+#include <vector>
+
+#include "packet_codec.h"
+#include "main_drivers.h"       // readRegister()
+#include "capture_timing.h"     // monotonicRawNs()
+#include "cc1101_config.h"
+
+typedef uint8_t v16u8 __attribute__((vector_size(16)));
+
+static inline v16u8 load16(const uint8_t *p) { v16u8 v; memcpy(&v, p, 16); return v; }
+static inline void store16(uint8_t *p, v16u8 v) { memcpy(p, &v, 16); }
+
+// two periods back to back, so any run of up to PN9_PERIOD bytes is contiguous from any phase
+struct Pn9Table {
+    uint8_t bytes[2 * PN9_PERIOD];
+
+    constexpr Pn9Table() : bytes() {
+        uint16_t state = 0x1FF;
+        for (int i = 0; i < 2 * PN9_PERIOD; i++) {
+            bytes[i] = state & 0xFF;
+            for (int b = 0; b < 8; b++) {
+                uint16_t bit = (state ^ (state >> 5)) & 1;
+                state = (state >> 1) | (bit << 8);
+            }
+        }
+    }
+};
+
+// t[k][x] = CRC register after byte x followed by k zero bytes (register 0 before)
+struct CrcTables {
+    uint16_t t[8][256];
+
+    constexpr CrcTables() : t() {
+        for (int x = 0; x < 256; x++) {
+            uint16_t r = x << 8;
+            for (int b = 0; b < 8; b++) r = (r & 0x8000) ? (r << 1) ^ 0x8005 : r << 1;
+            t[0][x] = r;
+        }
+        for (int k = 1; k < 8; k++)
+            for (int x = 0; x < 256; x++) t[k][x] = (t[k - 1][x] << 8) ^ t[0][t[k - 1][x] >> 8];
+    }
+};
+
+static constexpr Pn9Table pn9Table;
+static constexpr CrcTables crcTables;
+
+void pn9Whiten(uint8_t *data, size_t n, size_t offset) {
+    size_t pos = offset % PN9_PERIOD;
+    while (n > 0) {
+        size_t chunk = n < (size_t)PN9_PERIOD ? n : PN9_PERIOD;
+        const uint8_t *pn9 = pn9Table.bytes + pos;
+        size_t i = 0;
+        for (; i + 16 <= chunk; i += 16) store16(data + i, load16(data + i) ^ load16(pn9 + i));
+        for (; i < chunk; i++) data[i] ^= pn9[i];
+        data += chunk;
+        n -= chunk;
+        pos = (pos + chunk) % PN9_PERIOD;
+    }
+}
+
+uint16_t crc16(const uint8_t *data, size_t n, uint16_t crc) {
+    const auto &t = crcTables.t;
+    for (; n >= 8; n -= 8, data += 8) {
+        crc = t[7][data[0] ^ (crc >> 8)] ^ t[6][data[1] ^ (crc & 0xFF)] ^ t[5][data[2]] ^ t[4][data[3]] ^
+              t[3][data[4]] ^ t[2][data[5]] ^ t[1][data[6]] ^ t[0][data[7]];
+    }
+    for (; n > 0; n--, data++) crc = (crc << 8) ^ t[0][(crc >> 8) ^ *data];
+    return crc;
+}
+
+// DN509
+void pn9WhitenReference(uint8_t *data, size_t n) {
+    uint16_t state = 0x1FF;
+    for (size_t i = 0; i < n; i++) {
+        data[i] ^= state & 0xFF;
+        for (int b = 0; b < 8; b++) {
+            uint16_t bit = (state ^ (state >> 5)) & 1;
+            state = (state >> 1) | (bit << 8);
+        }
+    }
+}
+
+// DN502 culCalcCRC()
+uint16_t crc16Reference(const uint8_t *data, size_t n, uint16_t crc) {
+    for (size_t i = 0; i < n; i++) {
+        uint8_t byte = data[i];
+        for (int b = 0; b < 8; b++) {
+            if (((crc & 0x8000) >> 8) ^ (byte & 0x80)) crc = (crc << 1) ^ 0x8005;
+            else crc = crc << 1;
+            byte <<= 1;
+        }
+    }
+    return crc;
+}
+
+PacketConfig packetConfigFromRadio(int fd) {
+    uint8_t pktctrl0 = readRegister(fd, PKTCTRL0, READ_SINGLE_BYTE, 1, NULL);
+    PacketConfig config;
+    config.whitening = pktctrl0 & 0x40;                     // WHITE_DATA[6]
+    config.crc = pktctrl0 & 0x04;                           // CRC_EN[2]
+    config.lengthMode = (PacketLengthMode)(pktctrl0 & 0x03);  // LENGTH_CONFIG[1:0]
+    config.fixedLength = readRegister(fd, PKTLEN, READ_SINGLE_BYTE, 1, NULL);
+    return config;
+}
+
+static void decodeFrame(const PacketConfig &config, uint8_t *frame, uint32_t frameLen, DecodedPacket &out) {
+    out = {frame, 0, true, false};
+
+    if (config.lengthMode == PACKET_INFINITE) {
+        if (config.whitening) pn9Whiten(frame, frameLen, 0);
+        out.len = frameLen > 0xFFFF ? 0xFFFF : frameLen;
+        return;
+    }
+
+    uint32_t header = config.lengthMode == PACKET_VARIABLE;
+    if (frameLen < header) {
+        out.truncated = true;
+        out.crcOk = false;
+        return;
+    }
+    if (header && config.whitening) pn9Whiten(frame, 1, 0);
+    uint32_t len = header ? frame[0] : config.fixedLength;
+    uint32_t total = header + len + (config.crc ? 2 : 0);
+    if (total > frameLen) {
+        out.truncated = true;
+        out.crcOk = false;
+        return;
+    }
+    if (config.whitening) pn9Whiten(frame + header, total - header, header);
+
+    out.data = frame + header;
+    out.len = len;
+    if (config.crc) {
+        uint16_t received = (frame[header + len] << 8) | frame[header + len + 1];
+        out.crcOk = crc16(frame, header + len, CC1101_CRC_INIT) == received;
+    }
+}
+
+int packetDecodeBatch(const PacketConfig &config, uint8_t *const *frames, const uint32_t *frameLens,
+                      int numFrames, DecodedPacket *out) {
+    int ok = 0;
+    for (int i = 0; i < numFrames; i++) {
+        decodeFrame(config, frames[i], frameLens[i], out[i]);
+        ok += out[i].crcOk;
+    }
+    return ok;
+}
+
+uint32_t packetEncode(const PacketConfig &config, const uint8_t *payload, uint16_t len, uint8_t *out, uint32_t outSize) {
+    uint32_t header = config.lengthMode == PACKET_VARIABLE;
+    uint32_t crcBytes = (config.crc && config.lengthMode != PACKET_INFINITE) ? 2 : 0;
+    uint32_t total = header + len + crcBytes;
+    if (total > outSize || (header && len > 255) || (config.lengthMode == PACKET_FIXED && len != config.fixedLength))
+        return 0;
+
+    if (header) out[0] = len;
+    memcpy(out + header, payload, len);
+    if (crcBytes) {
+        uint16_t crc = crc16(out, header + len, CC1101_CRC_INIT);
+        out[header + len] = crc >> 8;
+        out[header + len + 1] = crc & 0xFF;
+    }
+    if (config.whitening) pn9Whiten(out, total, 0);
+    return total;
+}
+
+// bytes/ns = GB/s
+static double gbps(uint64_t bytes, uint64_t ns) {
+    return ns ? (double)bytes / ns : 0.0;
+}
+
+void benchmarkPacketCodec(int numPackets, int payloadLen) {
+    if (payloadLen > 255) payloadLen = 255;
+    PacketConfig config;            // variable length, whitening, CRC
+    uint32_t stride = payloadLen + 3;
+
+    std::vector<uint8_t> encoded((size_t)numPackets * stride), work(encoded.size());
+    std::vector<uint8_t *> frames(numPackets);
+    std::vector<uint32_t> frameLens(numPackets, stride);
+    std::vector<DecodedPacket> decoded(numPackets);
+
+    uint32_t seed = 1;
+    std::vector<uint8_t> payload(payloadLen);
+    for (int i = 0; i < numPackets; i++) {
+        for (auto &b : payload) {
+            seed = seed * 1103515245 + 12345;
+            b = seed >> 16;
+        }
+        packetEncode(config, payload.data(), payloadLen, &encoded[(size_t)i * stride], stride);
+        frames[i] = &work[(size_t)i * stride];
+    }
+
+    // bit exactness against the app note loops
+    static const uint8_t dn509[] = {0xFF, 0xE1, 0x1D, 0x9A, 0xED, 0x85, 0x33, 0x24};
+    std::vector<uint8_t> a(2000), b(2000);
+    bool exact = memcmp(pn9Table.bytes, dn509, sizeof(dn509)) == 0;
+    for (size_t n = 0; n < a.size(); n += 37) {
+        for (size_t i = 0; i < n; i++) a[i] = b[i] = encoded[i % encoded.size()];
+        pn9Whiten(a.data(), n, 0);
+        pn9WhitenReference(b.data(), n);
+        exact &= memcmp(a.data(), b.data(), n) == 0;
+        exact &= crc16(encoded.data(), n % encoded.size(), CC1101_CRC_INIT) ==
+                 crc16Reference(encoded.data(), n % encoded.size(), CC1101_CRC_INIT);
+    }
+    // whitening from an offset = the tail of whitening from the start
+    memcpy(a.data(), encoded.data(), 1000);
+    memcpy(b.data(), encoded.data(), 1000);
+    pn9Whiten(a.data(), 1000, 0);
+    pn9Whiten(b.data() + 600, 400, 600);
+    exact &= memcmp(a.data() + 600, b.data() + 600, 400) == 0;
+
+    memcpy(work.data(), encoded.data(), work.size());
+    int passed = packetDecodeBatch(config, frames.data(), frameLens.data(), numPackets, decoded.data());
+    exact &= passed == numPackets && decoded[0].len == payloadLen;
+    memcpy(work.data(), encoded.data(), work.size());
+    work[stride + 5] ^= 0x10;     // one flipped bit in packet 1
+    exact &= packetDecodeBatch(config, frames.data(), frameLens.data(), numPackets, decoded.data()) == numPackets - 1 &&
+             !decoded[1].crcOk;
+
+    printf("packet codec: %d packets x %d bytes, bit exact vs DN509/DN502 loops: %s\n", numPackets, payloadLen,
+           exact ? "yes" : "NO");
+
+    // throughput, enough passes for ~64 MB per measurement
+    size_t bytes = work.size();
+    int passes = (int)(64'000'000 / bytes) + 1;
+    int refPasses = passes / 16 + 1;
+    volatile uint16_t sink = 0;
+
+    uint64_t start = monotonicRawNs();
+    for (int p = 0; p < passes; p++) pn9Whiten(work.data(), bytes, 0);
+    uint64_t whitenNs = monotonicRawNs() - start;
+
+    start = monotonicRawNs();
+    for (int p = 0; p < refPasses; p++) pn9WhitenReference(work.data(), bytes);
+    uint64_t whitenRefNs = monotonicRawNs() - start;
+
+    start = monotonicRawNs();
+    for (int p = 0; p < passes; p++) sink = sink ^ crc16(work.data(), bytes, CC1101_CRC_INIT);
+    uint64_t crcNs = monotonicRawNs() - start;
+
+    start = monotonicRawNs();
+    for (int p = 0; p < refPasses; p++) sink = sink ^ crc16Reference(work.data(), bytes, CC1101_CRC_INIT);
+    uint64_t crcRefNs = monotonicRawNs() - start;
+
+    uint64_t decodeNs = 0;
+    for (int p = 0; p < passes; p++) {
+        memcpy(work.data(), encoded.data(), bytes);
+        start = monotonicRawNs();
+        packetDecodeBatch(config, frames.data(), frameLens.data(), numPackets, decoded.data());
+        decodeNs += monotonicRawNs() - start;
+    }
+
+    printf("    PN9 whitening   table %6.2f GB/s   bit loop %6.3f GB/s\n", gbps(bytes * passes, whitenNs),
+           gbps(bytes * refPasses, whitenRefNs));
+    printf("    CRC-16          slice-by-8 %6.2f GB/s   bit loop %6.3f GB/s\n", gbps(bytes * passes, crcNs),
+           gbps(bytes * refPasses, crcRefNs));
+    printf("    batch decode    %6.2f GB/s   %.1f M packets/s\n", gbps(bytes * passes, decodeNs),
+           (double)numPackets * passes * 1e3 / decodeNs);
+}
@@ -0,0 +1,68 @@
+#ifndef PACKET_CODEC_H
+#define PACKET_CODEC_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// Software version of the cc1101 packet engine's data whitening and CRC, for frames captured
+// in raw / infinite length mode (bytes after the sync word) and decoded off the chip.
+//
+// whitening: PN9, x^9 + x^5 + 1, state reset to 0x1FF at the sync word, every byte after it
+//            (length, address, payload, CRC) XORed with the low 8 bits of the state, then the
+//            state is clocked 8 times (DN509). Sequence starts FF E1 1D 9A ED 85 ...
+// CRC-16:    x^16 + x^15 + x^2 + 1 (0x8005), init 0xFFFF, MSB first, no final XOR, over the
+//            de-whitened length, address and payload, sent MSB first (DN502)
+//
+// The byte sequence of PN9 repeats every 511 bytes, so whitening is a XOR with a precomputed
+// table (16 bytes per step). CRC uses slice-by-8 tables (8 bytes per step, no bit loop).
+// Both tables are built at compile time.
+
+constexpr int PN9_PERIOD = 511;                 // bytes
+constexpr uint16_t CC1101_CRC_INIT = 0xFFFF;
+
+// XOR n bytes with the PN9 sequence starting `offset` bytes after the sync word
+// (whitening and de-whitening are the same operation)
+void pn9Whiten(uint8_t *data, size_t n, size_t offset);
+
+// CRC-16 of the cc1101, crc = value so far (CC1101_CRC_INIT for a new packet)
+uint16_t crc16(const uint8_t *data, size_t n, uint16_t crc);
+
+// bit at a time versions straight from the app notes, reference for the table versions
+void pn9WhitenReference(uint8_t *data, size_t n);
+uint16_t crc16Reference(const uint8_t *data, size_t n, uint16_t crc);
+
+enum PacketLengthMode : uint8_t {
+    PACKET_FIXED = 0,           // PKTCTRL0.LENGTH_CONFIG
+    PACKET_VARIABLE = 1,        // first byte = length of what follows (address + payload)
+    PACKET_INFINITE = 2
+};
+
+struct PacketConfig {
+    bool whitening = true;                          // PKTCTRL0.WHITE_DATA
+    bool crc = true;                                // PKTCTRL0.CRC_EN
+    PacketLengthMode lengthMode = PACKET_VARIABLE;
+    uint8_t fixedLength = 0;                        // PKTLEN, fixed length mode
+};
+
+// PKTCTRL0 / PKTLEN of a radio
+PacketConfig packetConfigFromRadio(int fd);
+
+struct DecodedPacket {
+    const uint8_t *data;        // address + payload, inside the (de-whitened in place) frame
+    uint16_t len;
+    bool crcOk;                 // always true without CRC
+    bool truncated;             // frame shorter than the length byte says, nothing else valid
+};
+
+// de-whiten numFrames frames in place (frames[i] = bytes from the sync word on) and check
+// their CRC, returns how many passed. Infinite length frames are only de-whitened (whole frame).
+int packetDecodeBatch(const PacketConfig &config, uint8_t *const *frames, const uint32_t *frameLens,
+                      int numFrames, DecodedPacket *out);
+
+// frame as the chip would send it after the sync word, returns its length (0 = doesn't fit)
+uint32_t packetEncode(const PacketConfig &config, const uint8_t *payload, uint16_t len, uint8_t *out, uint32_t outSize);
+
+// GB/s of whitening, CRC (bit loop vs slice-by-8) and batch decode, plus bit exactness checks
+void benchmarkPacketCodec(int numPackets, int payloadLen);
+
+#endif
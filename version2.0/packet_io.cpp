@@ -0,0 +1,157 @@
+#include <string.h>             // memset()
+
+#include "packet_io.h"
+#include "main_drivers.h"       // readRegisterWithStatus(), sendStrobes()
+#include "gpio_edges.h"         // gpioReadEdges()
+#include "pacer.h"              // monotonicNs(), sleepUntil()
+#include "cc1101_config.h"
+
+uint8_t packetRxBytes(int fd, SpiTransferFn transfer) {
+    uint8_t last = readRegisterWithStatus(fd, RXBYTES, READ_BURST, NULL, transfer);
+    for (int i = 0; i < 4; i++) {
+        uint8_t now = readRegisterWithStatus(fd, RXBYTES, READ_BURST, NULL, transfer);
+        if (now == last) break;
+        last = now;
+    }
+    return last;
+}
+
+static void flushRx(PacketRx &rx) {
+    static const uint8_t strobes[3] = {SIDLE, SFRX, SRX};
+    sendStrobes(rx.fd, strobes, 3, 2, NULL, rx.transfer);
+    rx.flushes++;
+}
+
+// IDLE -> RX calibrates again (MCSM0.FS_AUTOCAL)
+static void recalibrateRx(const PacketRx &rx) {
+    static const uint8_t strobes[2] = {SIDLE, SRX};
+    sendStrobes(rx.fd, strobes, 2, 2, NULL, rx.transfer);
+}
+
+// burst read of a packet whose length byte was already read
+static void readPacket(PacketRx &rx, uint8_t len, uint64_t eop_ns) {
+    static const uint8_t fifoRead[1 + 64] = {TXRXFIFO | READ_BURST};
+    uint8_t *buf = rx.buffer(rx.ctx);
+    struct spi_ioc_transfer xfer;
+    memset(&xfer, 0, sizeof(xfer));
+    xfer.tx_buf = (unsigned long)fifoRead;
+    xfer.rx_buf = (unsigned long)buf;
+    xfer.len = len + 3;
+    if (spiXfer(rx.transfer, rx.fd, &xfer, 1) < 0) return;
+    rx.received(rx.ctx, buf, len, eop_ns);
+}
+
+static void receiveEdges(PacketRx &rx) {
+    uint64_t lastRecal = monotonicNs();
+    uint8_t lastIdleBytes = 0;
+
+    while (!__atomic_load_n(rx.stop, __ATOMIC_ACQUIRE)) {
+        GpioEdge edges[16];
+        int n = gpioReadEdges(rx.gdoFd, edges, 16, PACKET_QUIET_MS);
+        if (n < 0) break;
+
+        for (int i = 0; i < n; i++) {
+            if (edges[i].level) continue;                   // sync word
+            uint8_t status;
+            uint8_t len = readRegisterWithStatus(rx.fd, TXRXFIFO, READ_SINGLE_BYTE, &status, rx.transfer);
+            if ((status & STATUS_STATE_MASK) == STATE_RXFIFO_OVERFLOW) {
+                flushRx(rx);
+                break;                                      // rest of the edges belong to flushed packets
+            }
+            if ((status & STATUS_FIFO_BYTES_MASK) == 0) {   // chip dropped it
+                rx.dropped++;
+                continue;
+            }
+            if (len == 0 || len > PACKET_MAX_PAYLOAD) {
+                flushRx(rx);
+                break;
+            }
+            readPacket(rx, len, edges[i].t_ns);
+        }
+        if (n > 0) continue;
+
+        // quiet: anything left in the FIFO without an edge (missed event) is flushed
+        uint8_t rxbytes = packetRxBytes(rx.fd, rx.transfer);
+        if ((rxbytes & 0x80) || (rxbytes && rxbytes == lastIdleBytes)) {
+            flushRx(rx);
+            rxbytes = 0;
+        }
+        lastIdleBytes = rxbytes;
+        uint64_t now = monotonicNs();
+        if (rx.recalNs && rxbytes == 0 && now - lastRecal >= rx.recalNs) {
+            recalibrateRx(rx);
+            lastRecal = now;
+        }
+    }
+}
+
+static void receivePoll(PacketRx &rx) {
+    uint64_t lastRecal = monotonicNs();
+    int len = -1;                                           // length byte of the packet being received
+
+    while (!__atomic_load_n(rx.stop, __ATOMIC_ACQUIRE)) {
+        uint8_t rxbytes = packetRxBytes(rx.fd, rx.transfer);
+        if (rxbytes & 0x80) {
+            flushRx(rx);
+            len = -1;
+            continue;
+        }
+        int available = rxbytes & 0x7F;
+        if (len < 0 && available >= 2) {                    // never empty the FIFO while receiving (errata)
+            len = readRegisterWithStatus(rx.fd, TXRXFIFO, READ_SINGLE_BYTE, NULL, rx.transfer);
+            available--;
+            if (len == 0 || len > PACKET_MAX_PAYLOAD) {
+                flushRx(rx);
+                len = -1;
+                continue;
+            }
+        }
+        if (len >= 0 && available >= len + 2) {
+            readPacket(rx, len, 0);
+            len = -1;
+            continue;
+        }
+
+        uint64_t now = monotonicNs();
+        if (rx.recalNs && len < 0 && available == 0 && now - lastRecal >= rx.recalNs) {
+            recalibrateRx(rx);
+            lastRecal = now;
+        }
+        sleepUntil(now + rx.pollNs);
+    }
+}
+
+void packetReceive(PacketRx &rx) {
+    if (rx.gdoFd >= 0) receiveEdges(rx);
+    else receivePoll(rx);
+}
+
+bool packetSend(int fd, SpiTransferFn transfer, uint8_t *frame, uint8_t len) {
+    static const uint8_t stx = STX;
+    frame[0] = TXFIFO_BURST;
+    frame[1] = len;
+    struct spi_ioc_transfer xfers[2];
+    memset(xfers, 0, sizeof(xfers));
+    xfers[0].tx_buf = (unsigned long)frame;
+    xfers[0].len = len + 2;
+    xfers[0].cs_change = 1;
+    xfers[1].tx_buf = (unsigned long)&stx;
+    xfers[1].len = 1;
+    return spiXfer(transfer, fd, xfers, 2) >= 0;
+}
+
+bool packetWaitTxEnd(int fd, SpiTransferFn transfer, uint64_t stx_ns, uint64_t airtimeNs) {
+    uint64_t end = stx_ns + airtimeNs;
+    uint64_t now = monotonicNs();
+    if (end > now + 50'000) sleepUntil(end - 50'000);
+
+    uint64_t deadline = end + 5'000'000;
+    for (;;) {
+        uint8_t state = readRegisterWithStatus(fd, MARCSTATE, READ_BURST, NULL, transfer) & MARCSTATE_MASK;
+        if (state == MARCSTATE_FSTXON) return true;
+        if (state == MARCSTATE_TXFIFO_UNDERFLOW || monotonicNs() > deadline) break;
+    }
+    static const uint8_t strobes[3] = {SIDLE, SFTX, SFSTXON};
+    sendStrobes(fd, strobes, 3, 2, NULL, transfer);
+    return false;
+}
@@ -0,0 +1,55 @@
+#ifndef PACKET_IO_H
+#define PACKET_IO_H
+
+#include <stdint.h>
+
+#include "spi_util.h"           // SpiTransferFn
+
+// Variable length packets between the CC1101 FIFOs and userspace (PKTCTRL0.LENGTH_CONFIG = 1,
+// APPEND_STATUS), the RX and TX paths of the relay and the link benchmark. Every access goes
+// through a transfer function (NULL = spiTransfer()), so the same code runs on the simulator.
+//
+// RX with a GDO line (GDO2 = 0x06): every falling edge is one packet in the FIFO, or one the chip
+// dropped (CRC autoflush, address / length filter), so the length byte is read without asking
+// RXBYTES first. Bytes left in the FIFO without an edge over a quiet period (a missed event) are
+// flushed. Without a line RXBYTES is polled and a packet is read once it's all there; the FIFO is
+// never read empty while receiving (errata), so the length byte waits for a second byte. When a
+// packet ended is only known with the line.
+//
+// TX: TX FIFO burst write + STX in one message, the radio is back in FSTXON (MCSM1.TXOFF_MODE)
+// after the airtime.
+
+constexpr int PACKET_MAX_PAYLOAD = 61;      // variable length + 2 status bytes in the 64 byte FIFO
+constexpr int PACKET_QUIET_MS = 100;        // edge wait, also how soon packetReceive() sees *stop
+
+// RXBYTES can be wrong while the FIFO is being written (errata), read until two reads agree
+uint8_t packetRxBytes(int fd, SpiTransferFn transfer);
+
+struct PacketRx {
+    int fd = -1;
+    SpiTransferFn transfer = NULL;
+    int gdoFd = -1;                         // end of packet edges, -1 = poll RXBYTES
+    uint64_t pollNs = 50'000;               // RXBYTES poll period without a line
+    uint64_t recalNs = 0;                   // SIDLE, SRX (FS_AUTOCAL) when idle this often, 0 = never
+    const bool *stop = NULL;                // set from another thread, atomic
+
+    // where the next packet is read to: chip status, payload, RSSI, LQI | CRC_OK (1 + 64 bytes)
+    uint8_t *(*buffer)(void *ctx) = NULL;
+    // that packet, payload from buf[1]. eop_ns = its end of packet edge, 0 = polled (not known)
+    void (*received)(void *ctx, uint8_t *buf, uint8_t len, uint64_t eop_ns) = NULL;
+    void *ctx = NULL;
+
+    uint64_t dropped = 0;                   // end of packet edge without bytes: the chip dropped it
+    uint64_t flushes = 0;                   // overflow, bad length, stuck bytes: SIDLE, SFRX, SRX
+};
+
+// until *rx.stop
+void packetReceive(PacketRx &rx);
+
+// frame: 2 bytes of room (FIFO header, length), then len payload bytes. false = transfer failed
+bool packetSend(int fd, SpiTransferFn transfer, uint8_t *frame, uint8_t len);
+// sleeps through the airtime after STX (stx_ns), then polls MARCSTATE for FSTXON. false = it
+// didn't get there (TX FIFO underflow, or 5 ms late) and was put back with SIDLE, SFTX, SFSTXON
+bool packetWaitTxEnd(int fd, SpiTransferFn transfer, uint64_t stx_ns, uint64_t airtimeNs);
+
+#endif
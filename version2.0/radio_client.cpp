@@ -0,0 +1,139 @@
+#include <string.h>             // memcpy(), strncpy()
+#include <stdio.h>              // fprintf()
+#include <unistd.h>             // close()
+#include <poll.h>               // poll()
+#include <sys/socket.h>         // socket(), connect(), send(), recv()
+#include <sys/un.h>             // sockaddr_un
+
+#include "radio_client.h"
+
+// recv one message, stream frames go to the callback
+// returns bytes (0 if it was a stream frame), -1 = disconnected
+static int receive(RadioClient &client, uint8_t *buff) {
+    ssize_t len = recv(client.fd, buff, MSG_MAX_BYTES, 0);
+    if (len < (ssize_t)sizeof(MsgHeader)) return -1;
+
+    const MsgHeader *header = (const MsgHeader *)buff;
+    if (header->type == MSG_SAMPLES && header->id == 0) {
+        if (client.onSamples && len >= (ssize_t)(sizeof(MsgHeader) + sizeof(MsgSamples))) {
+            MsgSamples frame;
+            memcpy(&frame, buff + sizeof(MsgHeader), sizeof(frame));
+            size_t have = (len - sizeof(MsgHeader) - sizeof(MsgSamples)) / sizeof(RssiSample);
+            if (frame.numSamples > have) frame.numSamples = have;
+            client.onSamples(header->radio, frame, (const RssiSample *)(buff + sizeof(MsgHeader) + sizeof(MsgSamples)),
+                             client.ctx);
+        }
+        return 0;
+    }
+    return len;
+}
+
+// send a request and wait for its reply, returns reply payload bytes copied, -1 = error reply / disconnected
+static int request(RadioClient &client, MsgType type, uint8_t radio, const void *payload, size_t len,
+                   void *reply, size_t maxReply) {
+    uint8_t buff[MSG_MAX_BYTES];
+    if (sizeof(MsgHeader) + len > sizeof(buff)) return -1;
+
+    MsgHeader header = {(uint16_t)type, radio, 0, ++client.nextId};
+    if (header.id == 0) header.id = ++client.nextId;
+    memcpy(buff, &header, sizeof(header));
+    if (len) memcpy(buff + sizeof(header), payload, len);
+    if (send(client.fd, buff, sizeof(header) + len, MSG_NOSIGNAL) < 0) return -1;
+
+    for (;;) {
+        int got = receive(client, buff);
+        if (got < 0) return -1;
+        if (got == 0) continue;
+
+        const MsgHeader *replyHeader = (const MsgHeader *)buff;
+        if (replyHeader->id != header.id) continue;     // reply to a request we gave up on
+        if (replyHeader->type == MSG_ERROR) return -1;
+
+        size_t bytes = got - sizeof(MsgHeader);
+        if (bytes > maxReply) bytes = maxReply;
+        if (bytes) memcpy(reply, buff + sizeof(MsgHeader), bytes);
+        return bytes;
+    }
+}
+
+bool clientConnect(RadioClient &client, const char *socketPath, SampleFrameCallback onSamples, void *ctx) {
+    client.fd = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0);
+    client.nextId = 0;
+    client.numRadios = 0;
+    client.onSamples = onSamples;
+    client.ctx = ctx;
+    if (client.fd < 0) return false;
+
+    struct sockaddr_un addr = {};
+    addr.sun_family = AF_UNIX;
+    strncpy(addr.sun_path, socketPath, sizeof(addr.sun_path) - 1);
+    if (connect(client.fd, (struct sockaddr *)&addr, sizeof(addr)) < 0) {
+        clientClose(client);
+        return false;
+    }
+
+    MsgHello hello = {RADIO_PROTOCOL_VERSION, 0};
+    if (request(client, MSG_HELLO, 0, &hello, sizeof(hello), &hello, sizeof(hello)) != sizeof(hello) ||
+        hello.version != RADIO_PROTOCOL_VERSION) {
+        fprintf(stderr, "ERROR: %s speaks protocol %d, we speak %d\n", socketPath, hello.version, RADIO_PROTOCOL_VERSION);
+        clientClose(client);
+        return false;
+    }
+    client.numRadios = hello.numRadios;
+    return true;
+}
+
+void clientClose(RadioClient &client) {
+    if (client.fd >= 0) close(client.fd);
+    client.fd = -1;
+}
+
+int clientListRadios(RadioClient &client, MsgRadioInfo *out, int maxRadios) {
+    int bytes = request(client, MSG_LIST_RADIOS, 0, NULL, 0, out, maxRadios * sizeof(MsgRadioInfo));
+    return (bytes < 0) ? 0 : bytes / sizeof(MsgRadioInfo);
+}
+
+bool clientReadRegisters(RadioClient &client, uint8_t radio, uint8_t reg, uint8_t offset, uint8_t count, uint8_t *out) {
+    MsgRegAccess access = {reg, offset, count, 0};
+    return request(client, MSG_READ_REGS, radio, &access, sizeof(access), out, count) == count;
+}
+
+bool clientWriteRegisters(RadioClient &client, uint8_t radio, uint8_t reg, uint8_t offset, uint8_t count, const uint8_t *data) {
+    uint8_t payload[sizeof(MsgRegAccess) + 64];
+    if (count > 64) return false;
+
+    MsgRegAccess access = {reg, offset, count, 0};
+    memcpy(payload, &access, sizeof(access));
+    memcpy(payload + sizeof(access), data, count);
+    return request(client, MSG_WRITE_REGS, radio, payload, sizeof(access) + count, NULL, 0) == 0;
+}
+
+int clientStrobe(RadioClient &client, uint8_t radio, uint8_t strobe) {
+    MsgRegAccess access = {strobe, 0, 1, 0};
+    uint8_t status;
+    return (request(client, MSG_STROBE, radio, &access, sizeof(access), &status, 1) == 1) ? status : -1;
+}
+
+double clientSubscribe(RadioClient &client, uint8_t radio, double sampleRateHz, int batch) {
+    MsgSubscribe subscribe = {(float)sampleRateHz, (uint16_t)batch, 0};
+    if (request(client, MSG_SUBSCRIBE, radio, &subscribe, sizeof(subscribe), &subscribe, sizeof(subscribe)) != sizeof(subscribe)) {
+        return -1;
+    }
+    return subscribe.sampleRateHz;
+}
+
+bool clientUnsubscribe(RadioClient &client, uint8_t radio) {
+    return request(client, MSG_UNSUBSCRIBE, radio, NULL, 0, NULL, 0) == 0;
+}
+
+int clientPoll(RadioClient &client, int timeoutMs) {
+    uint8_t buff[MSG_MAX_BYTES];
+    int frames = 0;
+
+    struct pollfd pfd = {client.fd, POLLIN, 0};
+    while (poll(&pfd, 1, frames ? 0 : timeoutMs) > 0) {
+        if (receive(client, buff) < 0) return -1;
+        frames++;
+    }
+    return frames;
+}
@@ -0,0 +1,43 @@
+#ifndef RADIO_CLIENT_H
+#define RADIO_CLIENT_H
+
+#include <stdint.h>
+
+#include "capture_timing.h"
+#include "radio_protocol.h"
+
+// client side of radiod (radio_server.h): register access and sample streams over the socket
+// instead of opening /dev/spidev directly, so any number of tools can share the radios.
+// Calls are synchronous; stream frames arriving while waiting for a reply go to onSamples.
+
+typedef void (*SampleFrameCallback)(uint8_t radio, const MsgSamples &frame, const RssiSample *samples, void *ctx);
+
+struct RadioClient {
+    int fd;
+    uint32_t nextId;
+    uint16_t numRadios;
+    SampleFrameCallback onSamples;
+    void *ctx;
+};
+
+bool clientConnect(RadioClient &client, const char *socketPath, SampleFrameCallback onSamples, void *ctx);
+void clientClose(RadioClient &client);
+
+// returns number of radios written to out
+int clientListRadios(RadioClient &client, MsgRadioInfo *out, int maxRadios);
+
+// same arguments as readRegister() / writeRegister(), count up to 64
+bool clientReadRegisters(RadioClient &client, uint8_t radio, uint8_t reg, uint8_t offset, uint8_t count, uint8_t *out);
+bool clientWriteRegisters(RadioClient &client, uint8_t radio, uint8_t reg, uint8_t offset, uint8_t count, const uint8_t *data);
+// returns chip status byte, -1 = failed
+int clientStrobe(RadioClient &client, uint8_t radio, uint8_t strobe);
+
+// returns the stream rate the server runs (max of all subscribers), < 0 = failed
+double clientSubscribe(RadioClient &client, uint8_t radio, double sampleRateHz, int batch);
+bool clientUnsubscribe(RadioClient &client, uint8_t radio);
+
+// wait up to timeoutMs for stream frames and hand them to onSamples
+// returns frames handled, -1 = server went away
+int clientPoll(RadioClient &client, int timeoutMs);
+
+#endif
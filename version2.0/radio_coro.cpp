@@ -0,0 +1,397 @@
+#include <string.h>             // memset()
+#include <errno.h>              // errno, EINTR
+#include <stdio.h>              // printf(), fprintf(), perror()
+#include <unistd.h>             // close()
+#include <sys/epoll.h>          // epoll_create1(), epoll_ctl(), epoll_wait()
+#include <sys/timerfd.h>        // timerfd_create(), timerfd_settime()
+#include <sys/resource.h>       // getrusage()
+#include <thread>
+#include <vector>
+
+#include "radio_coro.h"
+#include "main_drivers.h"
+#include "helper_functions.h"   // convertRSSI()
+#include "gpio_edges.h"         // gpioOpenEdges(), gpioReadEdges()
+#include "packet_io.h"          // packetRxBytes(), PACKET_MAX_PAYLOAD
+#include "pacer.h"
+#include "cc1101_config.h"
+
+bool coLoopInit(CoLoop &loop) {
+    loop.epollFd = epoll_create1(EPOLL_CLOEXEC);
+    loop.timerFd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    if (loop.epollFd < 0 || loop.timerFd < 0) {
+        perror("Failed to create coroutine loop");
+        coLoopClose(loop);
+        return false;
+    }
+    struct epoll_event ev;
+    ev.events = EPOLLIN;
+    ev.data.ptr = &loop.timerFd;        // marks the timer, everything else is a CoWaiter
+    epoll_ctl(loop.epollFd, EPOLL_CTL_ADD, loop.timerFd, &ev);
+    loop.armedNs = 0;
+    return true;
+}
+
+void coLoopClose(CoLoop &loop) {
+    loop.tasks.clear();
+    loop.timers.clear();
+    if (loop.timerFd >= 0) close(loop.timerFd);
+    if (loop.epollFd >= 0) close(loop.epollFd);
+    loop.timerFd = loop.epollFd = -1;
+}
+
+void coSpawn(CoLoop &loop, Task<void> task) {
+    std::coroutine_handle<> h = task.handle;
+    loop.tasks.push_back(std::move(task));
+    h.resume();
+}
+
+bool CoWait::await_suspend(std::coroutine_handle<> h) {
+    waiter.handle = h;
+    waiter.timedOut = false;
+    if (waiter.fd >= 0) {
+        struct epoll_event ev;
+        ev.events = EPOLLIN;
+        ev.data.ptr = &waiter;
+        if (epoll_ctl(loop.epollFd, EPOLL_CTL_ADD, waiter.fd, &ev) < 0) {
+            perror("epoll_ctl failed");
+            waiter.timedOut = true;
+            return false;
+        }
+        loop.fdWaiters++;
+    }
+    if (waiter.deadline_ns) loop.timers.push_back(&waiter);
+    return true;
+}
+
+CoWait coSleepUntil(CoLoop &loop, uint64_t deadline_ns) {
+    return CoWait{loop, {{}, -1, deadline_ns ? deadline_ns : 1, false}};
+}
+
+CoWait coSleep(CoLoop &loop, uint64_t ns) {
+    return coSleepUntil(loop, monotonicNs() + ns);
+}
+
+CoWait coReadable(CoLoop &loop, int fd, uint64_t timeoutNs) {
+    return CoWait{loop, {{}, fd, timeoutNs ? monotonicNs() + timeoutNs : 0, false}};
+}
+
+static void wake(CoLoop &loop, CoWaiter &waiter, bool timedOut) {
+    if (waiter.fd >= 0) {
+        epoll_ctl(loop.epollFd, EPOLL_CTL_DEL, waiter.fd, NULL);
+        loop.fdWaiters--;
+    }
+    if (waiter.deadline_ns) {
+        for (size_t i = 0; i < loop.timers.size(); i++) {
+            if (loop.timers[i] != &waiter) continue;
+            loop.timers[i] = loop.timers.back();
+            loop.timers.pop_back();
+            break;
+        }
+    }
+    waiter.timedOut = timedOut;
+    loop.resumes++;
+    waiter.handle.resume();     // may add / remove waiters, callers rescan afterwards
+}
+
+// one expired waiter at a time (or due within the slack), resuming it can change the timer list
+static bool wakeExpired(CoLoop &loop, uint64_t now) {
+    for (CoWaiter *waiter : loop.timers) {
+        if (waiter->deadline_ns > now) continue;
+        wake(loop, *waiter, true);
+        return true;
+    }
+    return false;
+}
+
+static void reapTasks(CoLoop &loop) {
+    for (size_t i = 0; i < loop.tasks.size();) {
+        if (loop.tasks[i].handle.done()) {
+            loop.tasks[i] = std::move(loop.tasks.back());
+            loop.tasks.pop_back();
+        } else {
+            i++;
+        }
+    }
+}
+
+void coRun(CoLoop &loop) {
+    constexpr int MAX_EVENTS = 16;
+    struct epoll_event events[MAX_EVENTS];
+
+    for (;;) {
+        reapTasks(loop);
+        if (loop.tasks.empty()) break;
+        if (wakeExpired(loop, monotonicNs() + loop.slackNs)) continue;
+
+        uint64_t earliest = 0;
+        for (CoWaiter *waiter : loop.timers)
+            if (!earliest || waiter->deadline_ns < earliest) earliest = waiter->deadline_ns;
+        if (!earliest && loop.fdWaiters == 0) {
+            fprintf(stderr, "ERROR: %zu coroutines wait on nothing, stopping the loop\n", loop.tasks.size());
+            break;
+        }
+        if (earliest != loop.armedNs) {
+            struct itimerspec its;
+            memset(&its, 0, sizeof(its));
+            its.it_value.tv_sec = earliest / 1'000'000'000;
+            its.it_value.tv_nsec = earliest % 1'000'000'000;
+            timerfd_settime(loop.timerFd, TFD_TIMER_ABSTIME, &its, NULL);    // 0 disarms
+            loop.armedNs = earliest;
+        }
+
+        int n = epoll_wait(loop.epollFd, events, MAX_EVENTS, -1);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            perror("epoll_wait failed");
+            break;
+        }
+        loop.wakeups++;
+
+        // fd waiters first, then timers on the next pass
+        for (int i = 0; i < n; i++) {
+            if (events[i].data.ptr == &loop.timerFd) {
+                loop.armedNs = UINT64_MAX;      // expired, the next timerfd_settime() clears it (no read())
+                continue;
+            }
+            wake(loop, *(CoWaiter *)events[i].data.ptr, false);
+        }
+    }
+}
+
+uint8_t CoRadio::readNow(uint8_t reg) {
+    if (radio->fd >= 0) return readRegister(radio->fd, reg, reg >= CFG_REGISTER ? READ_BURST : READ_SINGLE_BYTE, 1, NULL);
+
+    if (reg == RSSI) {
+        simSeed = simSeed * 1103515245 + 12345;
+        return 0x80 + ((simSeed >> 16) & 0x1F);     // about -138 .. -122 dBm of noise
+    }
+    return simRegs[reg & 0x3F];
+}
+
+void CoRadio::writeNow(uint8_t reg, uint8_t value) {
+    if (radio->fd >= 0) writeRegister(radio->fd, reg, &value, WRITE_SINGLE_BYTE, 1);
+    else simRegs[reg & 0x3F] = value;
+}
+
+uint8_t CoRadio::strobeNow(uint8_t s) {
+    if (radio->fd >= 0) {
+        uint8_t status = 0;
+        sendStrobes(radio->fd, &s, 1, 0, &status);     // no usleep() like sendStrobe(), it would stall the loop
+        return status;
+    }
+    uint8_t &marcstate = simRegs[MARCSTATE];
+    uint8_t status = marcstate == MARCSTATE_RX ? STATE_RX : marcstate == MARCSTATE_TX ? STATE_TX : STATE_IDLE;
+    if (s == SRX) marcstate = MARCSTATE_RX;
+    else if (s == STX) marcstate = MARCSTATE_TX;
+    else if (s == SIDLE || s == SRES) marcstate = MARCSTATE_IDLE;
+    return status;
+}
+
+Task<bool> CoRadio::waitState(uint8_t marcState, uint64_t timeoutNs) {
+    uint64_t deadline = monotonicNs() + timeoutNs;
+    for (;;) {
+        if ((readNow(MARCSTATE) & MARCSTATE_MASK) == marcState) co_return true;
+        if (monotonicNs() >= deadline) co_return false;
+        co_await coSleep(*loop, pollNs);
+    }
+}
+
+Task<CoPacket> CoRadio::recvPacket(uint64_t timeoutNs) {
+    CoPacket packet;
+    memset(&packet, 0, sizeof(packet));
+    uint64_t deadline = monotonicNs() + timeoutNs;
+    int len = -1;                       // length byte once it was read
+
+    for (;;) {
+        uint8_t rxbytes = radio->fd >= 0 ? packetRxBytes(radio->fd, NULL) : readNow(RXBYTES);
+        if (rxbytes & 0x80) {           // overflow: flush and back to RX
+            strobeNow(SIDLE);
+            strobeNow(SFRX);
+            strobeNow(SRX);
+            len = -1;
+        } else {
+            int available = rxbytes & 0x7F;
+            if (len < 0 && available >= 2) {    // never empty the FIFO while receiving (errata)
+                len = readNow(TXRXFIFO);
+                available--;
+                if (len == 0 || len > PACKET_MAX_PAYLOAD) {     // not a packet of this config, start over
+                    strobeNow(SIDLE);
+                    strobeNow(SFRX);
+                    strobeNow(SRX);
+                    len = -1;
+                    continue;
+                }
+            }
+            if (len >= 0 && available >= len + 2) {
+                uint8_t buf[64];
+                readRegister(radio->fd, TXRXFIFO, READ_BURST, len + 2, buf);
+                memcpy(packet.data, buf, len);
+                packet.ok = true;
+                packet.len = len;
+                packet.rssiDbm = convertRSSI(buf[len]);
+                packet.crcOk = buf[len + 1] & 0x80;
+                packet.lqi = buf[len + 1] & 0x7F;
+                co_return packet;
+            }
+        }
+
+        uint64_t now = monotonicNs();
+        if (now >= deadline) co_return packet;
+        if (gdoFd >= 0 && len < 0) {
+            if (co_await coReadable(*loop, gdoFd, deadline - now)) {
+                GpioEdge edges[16];
+                while (gpioReadEdges(gdoFd, edges, 16, 0) == 16) {}     // drain, the FIFO is the truth
+            }
+        } else {
+            co_await coSleep(*loop, pollNs);
+        }
+    }
+}
+
+bool coRadioInit(CoRadio &radio, CoLoop &loop, Radio &hw, const char *gpioChip) {
+    memset(radio.simRegs, 0, sizeof(radio.simRegs));
+    radio.loop = &loop;
+    radio.radio = &hw;
+    radio.gdoFd = -1;
+    radio.pollNs = 200'000;
+    radio.simRegs[MARCSTATE] = MARCSTATE_IDLE;
+    radio.simSeed = 1 + hw.index;
+    if (gpioChip && hw.gdoLine >= 0 && hw.fd >= 0) {
+        radio.gdoFd = gpioOpenEdges(gpioChip, hw.gdoLine, 0);
+        if (radio.gdoFd < 0) return false;
+    }
+    return true;
+}
+
+void coRadioClose(CoRadio &radio) {
+    if (radio.gdoFd >= 0) close(radio.gdoFd);
+    radio.gdoFd = -1;
+}
+
+struct SamplerStats {
+    uint64_t samples;
+    uint64_t latenessSum_ns;
+    uint64_t latenessMax_ns;
+    uint32_t checksum;
+};
+
+static void addSample(SamplerStats &stats, uint64_t due, uint8_t raw) {
+    uint64_t now = monotonicNs();
+    uint64_t late = now > due ? now - due : due - now;     // early with timer slack
+    stats.samples++;
+    stats.latenessSum_ns += late;
+    if (late > stats.latenessMax_ns) stats.latenessMax_ns = late;
+    stats.checksum += raw;
+}
+
+static Task<> coSampler(CoRadio &radio, double rateHz, uint64_t phaseNs, uint64_t end, SamplerStats &stats) {
+    Pacer pacer;
+    pacerInit(pacer, rateHz, 0);
+    pacer.nextNs += phaseNs;
+    co_await radio.strobe(SRX);
+    if (!co_await radio.waitState(MARCSTATE_RX, 10'000'000)) co_return;
+    while (pacer.nextNs < end) {
+        uint64_t due = pacer.nextNs;
+        co_await coSleepUntil(*radio.loop, due);
+        uint64_t now = monotonicNs();
+        if (!pacerDue(pacer, now > due ? now : due)) continue;     // with slack it may be a bit early
+        addSample(stats, due, co_await radio.read(RSSI));
+    }
+}
+
+struct RunUsage {
+    double cpuSeconds;
+    long contextSwitches;
+};
+
+static RunUsage usageNow() {
+    struct rusage ru;
+    getrusage(RUSAGE_SELF, &ru);
+    return {ru.ru_utime.tv_sec + ru.ru_stime.tv_sec + (ru.ru_utime.tv_usec + ru.ru_stime.tv_usec) / 1e6,
+            ru.ru_nvcsw + ru.ru_nivcsw};
+}
+
+static void printRun(const char *name, int threads, const RunUsage &before, const RunUsage &after,
+                     const SamplerStats *stats, int numRadios, double seconds) {
+    SamplerStats total = {};
+    for (int i = 0; i < numRadios; i++) {
+        total.samples += stats[i].samples;
+        total.latenessSum_ns += stats[i].latenessSum_ns;
+        if (stats[i].latenessMax_ns > total.latenessMax_ns) total.latenessMax_ns = stats[i].latenessMax_ns;
+    }
+    printf("    %-18s %3d threads  %8.0f samples/s  %8.0f ctx switches/s  CPU %5.1f%%  |t - due| mean %6.1f us  max %7.1f us\n",
+           name, threads, total.samples / seconds, (after.contextSwitches - before.contextSwitches) / seconds,
+           100.0 * (after.cpuSeconds - before.cpuSeconds) / seconds,
+           total.samples ? total.latenessSum_ns / 1e3 / total.samples : 0.0, total.latenessMax_ns / 1e3);
+}
+
+void benchmarkCoroutines(int numRadios, double rateHz, double seconds) {
+    if (numRadios > MAX_RADIOS) numRadios = MAX_RADIOS;
+    Radio radios[MAX_RADIOS];
+    memset(radios, 0, sizeof(radios));
+    CoRadio coRadios[MAX_RADIOS];
+    CoLoop loop;
+    if (!coLoopInit(loop)) return;
+    for (int i = 0; i < numRadios; i++) {
+        radios[i].fd = -1;
+        radios[i].index = i;
+        radios[i].gdoLine = -1;
+        coRadioInit(coRadios[i], loop, radios[i], NULL);
+    }
+    printf("coroutines vs threads: %d simulated radios, RSSI at %.0f Hz each, %.1f s per run\n", numRadios, rateHz,
+           seconds);
+
+    // radios spread over the period, so each deadline is its own wakeup in both runs
+    uint64_t phaseNs = (uint64_t)(1e9 / rateHz / numRadios);
+
+    // thread per radio, each sleeping in clock_nanosleep() between reads
+    SamplerStats threadStats[MAX_RADIOS] = {};
+    RunUsage before = usageNow();
+    uint64_t end = monotonicNs() + (uint64_t)(seconds * 1e9);
+    std::vector<std::thread> threads;
+    for (int i = 0; i < numRadios; i++) {
+        threads.emplace_back([&, i]() {
+            CoRadio &radio = coRadios[i];
+            Pacer pacer;
+            pacerInit(pacer, rateHz, 0);
+            pacer.nextNs += i * phaseNs;
+            radio.strobeNow(SRX);
+            while (pacer.nextNs < end) {
+                uint64_t due = pacer.nextNs;
+                pacerWait(pacer);
+                addSample(threadStats[i], due, radio.readNow(RSSI));
+            }
+        });
+    }
+    for (auto &t : threads) t.join();
+    RunUsage after = usageNow();
+    printRun("thread per radio", numRadios, before, after, threadStats, numRadios, seconds);
+
+    // one thread, one coroutine per radio
+    SamplerStats coStats[MAX_RADIOS] = {};
+    before = usageNow();
+    end = monotonicNs() + (uint64_t)(seconds * 1e9);
+    for (int i = 0; i < numRadios; i++) coSpawn(loop, coSampler(coRadios[i], rateHz, i * phaseNs, end, coStats[i]));
+    coRun(loop);
+    after = usageNow();
+    printRun("one coroutine loop", 1, before, after, coStats, numRadios, seconds);
+    printf("    loop: %llu epoll wakeups, %llu resumes\n", (unsigned long long)loop.wakeups,
+           (unsigned long long)loop.resumes);
+
+    // same with timer slack of 2 phase steps, deadlines that close share one wakeup
+    memset(coStats, 0, sizeof(coStats));
+    loop.slackNs = 2 * phaseNs;
+    loop.wakeups = loop.resumes = 0;
+    before = usageNow();
+    end = monotonicNs() + (uint64_t)(seconds * 1e9);
+    for (int i = 0; i < numRadios; i++) coSpawn(loop, coSampler(coRadios[i], rateHz, i * phaseNs, end, coStats[i]));
+    coRun(loop);
+    after = usageNow();
+    printRun("loop + timer slack", 1, before, after, coStats, numRadios, seconds);
+    printf("    loop: %llu epoll wakeups, %llu resumes, slack %.0f us\n", (unsigned long long)loop.wakeups,
+           (unsigned long long)loop.resumes, loop.slackNs / 1e3);
+
+    for (int i = 0; i < numRadios; i++) coRadioClose(coRadios[i]);
+    coLoopClose(loop);
+}
@@ -0,0 +1,194 @@
+#ifndef RADIO_CORO_H
+#define RADIO_CORO_H
+
+#include <stdint.h>
+#include <coroutine>
+#include <exception>            // std::terminate()
+#include <type_traits>
+#include <utility>              // std::exchange()
+#include <vector>
+
+#include "device_manager.h"
+
+// Coroutine API for driving many radios from one thread
+//
+//   Task<> poll(CoRadio &radio) {
+//       co_await radio.strobe(SRX);
+//       if (!co_await radio.waitState(MARCSTATE_RX, 5'000'000)) co_return;
+//       for (;;) {
+//           CoPacket p = co_await radio.recvPacket(1'000'000'000);
+//           uint8_t rssi = co_await radio.read(RSSI);
+//           ...
+//       }
+//   }
+//
+// One CoLoop per thread: an epoll set over GPIO line event fds plus one timerfd armed on the
+// earliest sleeping coroutine (CLOCK_MONOTONIC, absolute). Register access is a spidev ioctl
+// of a few us, so read() / write() / strobe() complete in place (never suspend); what used to
+// be usleep() or a busy MARCSTATE poll suspends the coroutine instead and the thread serves
+// the other radios. Everything runs on the loop's thread, so no locking between coroutines.
+//
+// Task<T> is lazy (starts when awaited or coSpawn()ed) and resumes its awaiter when it ends
+// (symmetric transfer, no stack growth). Exceptions aren't used, one escaping terminates.
+
+template <typename T = void> struct Task;
+
+struct TaskPromiseBase {
+    std::coroutine_handle<> continuation;
+
+    struct FinalAwaiter {
+        bool await_ready() noexcept { return false; }
+        template <typename P> std::coroutine_handle<> await_suspend(std::coroutine_handle<P> h) noexcept {
+            std::coroutine_handle<> next = h.promise().continuation;
+            return next ? next : std::noop_coroutine();
+        }
+        void await_resume() noexcept {}
+    };
+
+    std::suspend_always initial_suspend() noexcept { return {}; }
+    FinalAwaiter final_suspend() noexcept { return {}; }
+    void unhandled_exception() { std::terminate(); }
+};
+
+template <typename T> struct TaskPromise : TaskPromiseBase {
+    T value{};
+    Task<T> get_return_object();
+    void return_value(T v) { value = std::move(v); }
+};
+
+template <> struct TaskPromise<void> : TaskPromiseBase {
+    Task<void> get_return_object();
+    void return_void() {}
+};
+
+template <typename T> struct Task {
+    using promise_type = TaskPromise<T>;
+    std::coroutine_handle<promise_type> handle;
+
+    explicit Task(std::coroutine_handle<promise_type> h) : handle(h) {}
+    Task(Task &&other) noexcept : handle(std::exchange(other.handle, {})) {}
+    Task &operator=(Task &&other) noexcept {
+        if (this != &other) {
+            if (handle) handle.destroy();
+            handle = std::exchange(other.handle, {});
+        }
+        return *this;
+    }
+    ~Task() {
+        if (handle) handle.destroy();
+    }
+
+    bool await_ready() const noexcept { return false; }
+    std::coroutine_handle<> await_suspend(std::coroutine_handle<> awaiter) noexcept {
+        handle.promise().continuation = awaiter;
+        return handle;
+    }
+    T await_resume() {
+        if constexpr (!std::is_void_v<T>) return std::move(handle.promise().value);
+    }
+};
+
+template <typename T> Task<T> TaskPromise<T>::get_return_object() {
+    return Task<T>(std::coroutine_handle<TaskPromise<T>>::from_promise(*this));
+}
+
+inline Task<void> TaskPromise<void>::get_return_object() {
+    return Task<void>(std::coroutine_handle<TaskPromise<void>>::from_promise(*this));
+}
+
+// awaitable that is already done (register access)
+template <typename T> struct CoReady {
+    T value;
+    bool await_ready() const noexcept { return true; }
+    void await_suspend(std::coroutine_handle<>) const noexcept {}
+    T await_resume() { return value; }
+};
+
+struct CoLoop;
+
+// one suspended coroutine waiting for a deadline and / or a readable fd
+struct CoWaiter {
+    std::coroutine_handle<> handle;
+    int fd;                     // -1 = deadline only
+    uint64_t deadline_ns;       // CLOCK_MONOTONIC, 0 = none
+    bool timedOut;
+};
+
+struct CoWait {
+    CoLoop &loop;
+    CoWaiter waiter;
+
+    bool await_ready() const noexcept { return false; }
+    bool await_suspend(std::coroutine_handle<> h);     // false = couldn't wait, resume at once
+    bool await_resume() const noexcept { return !waiter.timedOut; }    // fd readable (sleeps: false)
+};
+
+struct CoLoop {
+    int epollFd = -1;
+    int timerFd = -1;
+    uint64_t armedNs = 0;                   // timerfd deadline, 0 = disarmed, UINT64_MAX = fired
+    uint64_t slackNs = 0;                   // wake sleepers due this much early too, to share wakeups
+    std::vector<CoWaiter *> timers;         // few (one per radio), scanned linearly
+    std::vector<Task<void>> tasks;          // spawned, reaped when done
+    int fdWaiters = 0;
+
+    uint64_t wakeups = 0;                   // epoll_wait returns
+    uint64_t resumes = 0;
+};
+
+bool coLoopInit(CoLoop &loop);
+void coLoopClose(CoLoop &loop);
+// starts task (runs until its first suspension), the loop owns it from then on
+void coSpawn(CoLoop &loop, Task<void> task);
+// until every spawned task has finished
+void coRun(CoLoop &loop);
+
+CoWait coSleepUntil(CoLoop &loop, uint64_t deadline_ns);
+CoWait coSleep(CoLoop &loop, uint64_t ns);
+// true = fd readable, false = timeoutNs passed first (0 = no timeout)
+CoWait coReadable(CoLoop &loop, int fd, uint64_t timeoutNs);
+
+struct CoPacket {
+    bool ok;                    // a packet was read
+    bool crcOk;                 // appended status (PKTCTRL1.APPEND_STATUS)
+    uint8_t len;
+    float rssiDbm;
+    uint8_t lqi;
+    uint8_t data[64];
+};
+
+struct CoRadio {
+    CoLoop *loop;
+    Radio *radio;
+    int gdoFd;                  // GPIO line events of radio->gdoLine, -1 = poll RXBYTES instead
+    uint64_t pollNs;            // MARCSTATE / RXBYTES poll period when there is nothing to wait on
+
+    // simulated radio (radio->fd < 0): register file, strobes move MARCSTATE
+    uint8_t simRegs[0x40];
+    uint32_t simSeed;
+
+    uint8_t readNow(uint8_t reg);
+    void writeNow(uint8_t reg, uint8_t value);
+    uint8_t strobeNow(uint8_t strobe);
+
+    CoReady<uint8_t> read(uint8_t reg) { return {readNow(reg)}; }
+    CoReady<bool> write(uint8_t reg, uint8_t value) { writeNow(reg, value); return {true}; }
+    CoReady<uint8_t> strobe(uint8_t s) { return {strobeNow(s)}; }     // chip status byte
+
+    // MARCSTATE == marcState within timeoutNs, polled every pollNs
+    Task<bool> waitState(uint8_t marcState, uint64_t timeoutNs);
+    // next packet (variable length + appended status, the default profiles): GDO2 = 0x07 asserts
+    // on a packet with CRC OK, without a GDO line RXBYTES is polled. ok = false on timeout.
+    Task<CoPacket> recvPacket(uint64_t timeoutNs);
+};
+
+// gpioChip: where radio.gdoLine lives (e.g. "/dev/gpiochip0"), NULL = no GDO events
+bool coRadioInit(CoRadio &radio, CoLoop &loop, Radio &hw, const char *gpioChip);
+void coRadioClose(CoRadio &radio);
+
+// numRadios simulated radios sampling RSSI at rateHz for seconds, deadlines spread over the
+// period: one thread per radio with clock_nanosleep() vs one CoLoop thread (with and without
+// timer slack), context switches (getrusage), CPU time and deadline error of each
+void benchmarkCoroutines(int numRadios, double rateHz, double seconds);
+
+#endif
@@ -0,0 +1,78 @@
+#ifndef RADIO_PROTOCOL_H
+#define RADIO_PROTOCOL_H
+
+#include <stdint.h>
+
+// Wire protocol between radiod (radio_server.h) and its clients (radio_client.h).
+// Unix SOCK_SEQPACKET socket, so every send() is one message: MsgHeader + payload.
+// Requests carry a client chosen id that comes back in the reply; stream frames
+// (MSG_SAMPLES) are pushed with id 0 and can arrive in between. All little endian.
+
+constexpr const char *RADIOD_SOCKET = "/tmp/radiod.sock";
+constexpr uint16_t RADIO_PROTOCOL_VERSION = 1;
+constexpr int MSG_MAX_BYTES = 16 * 1024;
+
+enum MsgType : uint16_t {
+    MSG_HELLO = 1,          // -> MsgHello                      <- MsgHello
+    MSG_LIST_RADIOS,        // -> -                             <- MsgRadioInfo[n]
+    MSG_READ_REGS,          // -> MsgRegAccess                  <- n bytes
+    MSG_WRITE_REGS,         // -> MsgRegAccess + n bytes        <- -
+    MSG_STROBE,             // -> MsgRegAccess (reg = strobe)   <- chip status byte
+    MSG_SUBSCRIBE,          // -> MsgSubscribe                  <- MsgSubscribe (rate actually used)
+    MSG_UNSUBSCRIBE,        // -> -                             <- -
+    MSG_SAMPLES,            // pushed: MsgSamples + RssiSample[numSamples]
+    MSG_ERROR               // <- MsgError, instead of the normal reply
+};
+
+struct MsgHeader {
+    uint16_t type;          // MsgType
+    uint8_t radio;          // Radio::index the message is about
+    uint8_t reserved;
+    uint32_t id;            // request id, 0 = pushed stream frame
+};
+
+struct MsgHello {
+    uint16_t version;
+    uint16_t numRadios;
+};
+
+struct MsgRadioInfo {
+    char path[32];
+    uint8_t index;
+    uint8_t partnum;
+    uint8_t version;
+    uint8_t subscribers;
+    float sampleRateHz;     // current stream rate, 0 = idle
+};
+
+struct MsgRegAccess {
+    uint8_t reg;
+    uint8_t offset;         // READ_SINGLE_BYTE / READ_BURST / WRITE_* as for readRegister()
+    uint8_t count;
+    uint8_t reserved;
+};
+
+struct MsgSubscribe {
+    float sampleRateHz;     // stream rate is the max of all subscribers' (server caps it)
+    uint16_t batch;         // samples per MSG_SAMPLES frame (server caps it)
+    uint16_t reserved;
+};
+
+struct MsgSamples {
+    uint64_t seq;           // per radio frame counter, gaps = frames dropped for this client
+    uint32_t numSamples;
+    uint32_t dropped;       // frames dropped for this client so far (slow reader)
+};
+
+enum MsgErrorCode : uint16_t {
+    ERR_BAD_REQUEST = 1,
+    ERR_NO_RADIO,
+    ERR_SPI
+};
+
+struct MsgError {
+    uint16_t code;          // MsgErrorCode
+    uint16_t reserved;
+};
+
+#endif
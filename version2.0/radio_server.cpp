@@ -0,0 +1,488 @@
+#include <string.h>             // memcpy(), memset(), strncpy()
+#include <stdio.h>              // printf(), perror()
+#include <unistd.h>             // close(), read(), write(), unlink()
+#include <errno.h>              // errno, EAGAIN
+#include <sys/socket.h>         // socket(), bind(), listen(), accept4(), send(), recv()
+#include <sys/un.h>             // sockaddr_un
+#include <sys/epoll.h>          // epoll_create1(), epoll_ctl(), epoll_wait()
+#include <sys/timerfd.h>        // timerfd_create(), timerfd_settime()
+#include <sys/eventfd.h>        // eventfd()
+#include <algorithm>            // std::min()
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#include "radio_server.h"
+#include "radio_client.h"
+#include "main_drivers.h"
+#include "cc1101_config.h"
+
+// epoll data: fds >= 0 are clients (slot index), these are the rest
+constexpr uint64_t EV_LISTEN = ~0ull;
+constexpr uint64_t EV_TIMER = ~0ull - 1;
+constexpr uint64_t EV_STOP = ~0ull - 2;
+
+int simulateRadios(Radio *radios, int numRadios) {
+    if (numRadios > MAX_RADIOS) numRadios = MAX_RADIOS;
+    for (int i = 0; i < numRadios; i++) {
+        memset(&radios[i], 0, sizeof(radios[i]));
+        snprintf(radios[i].path, sizeof(radios[i].path), "sim%d", i);
+        radios[i].fd = -1;
+        radios[i].index = i;
+        radios[i].version = 0x14;
+        radios[i].gdoLine = -1;
+        radios[i].cpu = -1;
+    }
+    return numRadios;
+}
+
+// ===================== radio access =====================
+
+static uint8_t simRssi(RadioServer &server) {
+    server.simSeed = server.simSeed * 1103515245 + 12345;
+    return (uint8_t)(int8_t)(-52 + (int)((server.simSeed >> 16) % 9) - 4);     // -100 dBm +-2 dB
+}
+
+static void sampleStream(RadioServer &server, const Radio &radio, RssiSample &sample) {
+    sample.raw = (radio.fd < 0) ? simRssi(server) : readRegister(radio.fd, RSSI, READ_BURST, 1, NULL);
+    sample.t_ns = monotonicRawNs();
+}
+
+static bool readRegs(RadioServer &server, const Radio &radio, const MsgRegAccess &access, uint8_t *out) {
+    if (radio.fd < 0) {
+        for (int i = 0; i < access.count; i++) out[i] = server.simRegs[radio.index][(access.reg + i) & 0x3F];
+        return true;
+    }
+    // status regs (burst bit + 0x30..) can't be burst read
+    if (access.count > 1 && access.offset == READ_BURST && access.reg >= PARTNUM) {
+        return readStatusRegisters(radio.fd, access.reg, access.count, out);
+    }
+    if (access.count == 1) {
+        out[0] = readRegister(radio.fd, access.reg, access.offset, 1, NULL);
+        return true;
+    }
+    return readRegister(radio.fd, access.reg, access.offset, access.count, out) == 1;
+}
+
+static void writeRegs(RadioServer &server, const Radio &radio, const MsgRegAccess &access, const uint8_t *data) {
+    if (radio.fd < 0) {
+        for (int i = 0; i < access.count; i++) server.simRegs[radio.index][(access.reg + i) & 0x3F] = data[i];
+        return;
+    }
+    writeRegister(radio.fd, access.reg, (uint8_t *)data, access.offset, access.count);
+}
+
+// ===================== streams =====================
+
+static void sendTo(RadioServer &server, int c, const void *buff, size_t len) {
+    if (send(server.clients[c].fd, buff, len, MSG_DONTWAIT | MSG_NOSIGNAL) < 0 && errno != EAGAIN) {
+        perror("send");
+    }
+}
+
+// one frame, every subscriber, never blocks
+static void flushStream(RadioServer &server, int r) {
+    ServerStream &stream = server.streams[r];
+    if (stream.count == 0) return;
+
+    uint8_t buff[MSG_MAX_BYTES];
+    MsgHeader header = {MSG_SAMPLES, (uint8_t)r, 0, 0};
+    MsgSamples frame = {stream.seq++, (uint32_t)stream.count, 0};
+    size_t len = sizeof(header) + sizeof(frame) + stream.count * sizeof(RssiSample);
+    memcpy(buff, &header, sizeof(header));
+    memcpy(buff + sizeof(header) + sizeof(frame), stream.samples, stream.count * sizeof(RssiSample));
+    stream.count = 0;
+
+    for (int c = 0; c < SERVER_MAX_CLIENTS; c++) {
+        ServerClient &client = server.clients[c];
+        if (client.fd < 0 || client.rateHz[r] == 0) continue;
+
+        frame.dropped = client.dropped[r];
+        memcpy(buff + sizeof(header), &frame, sizeof(frame));
+        if (send(client.fd, buff, len, MSG_DONTWAIT | MSG_NOSIGNAL) < 0) {
+            client.dropped[r]++;
+            server.framesDropped++;
+        } else {
+            client.framesSent++;
+            server.framesSent++;
+        }
+    }
+}
+
+// rate = max, batch = min of the subscribers, start / stop the radio when that changes
+static void updateStream(RadioServer &server, int r) {
+    ServerStream &stream = server.streams[r];
+    const Radio &radio = server.radios[r];
+
+    double rate = 0;
+    int batch = SERVER_MAX_BATCH;
+    for (const ServerClient &client : server.clients) {
+        if (client.fd < 0 || client.rateHz[r] == 0) continue;
+        if (client.rateHz[r] > rate) rate = client.rateHz[r];
+        if (client.batch[r] < batch) batch = client.batch[r];
+    }
+
+    if (rate == 0) {
+        if (stream.active) {
+            flushStream(server, r);
+            if (radio.fd >= 0) exitRssiMode(radio.fd, stream.backup);
+            stream.active = false;
+            stream.rateHz = 0;
+        }
+        return;
+    }
+
+    if (!stream.active) {
+        if (radio.fd >= 0) enterRssiMode(radio.fd, &stream.backup);
+        stream.active = true;
+        stream.count = 0;
+    }
+    if (rate != stream.rateHz) pacerInit(stream.pacer, rate, 0);
+    if (batch < stream.count) flushStream(server, r);
+    stream.rateHz = rate;
+    stream.batch = batch;
+}
+
+// sample every stream whose deadline passed, then arm the timer for the next one. At most one
+// batch per stream per call: a stream that is behind catches up over several passes with the
+// epoll loop in between. Returns the next deadline (CLOCK_MONOTONIC), 0 = no stream running
+static uint64_t serviceStreams(RadioServer &server) {
+    uint64_t now = monotonicNs();
+    uint64_t next = 0;
+
+    for (int r = 0; r < server.numRadios; r++) {
+        ServerStream &stream = server.streams[r];
+        if (!stream.active) continue;
+
+        for (int taken = 0; taken < stream.batch && pacerDue(stream.pacer, now); taken++) {
+            if (stream.count == 0) stream.batchStartNs = now;
+            sampleStream(server, server.radios[r], stream.samples[stream.count++]);
+            if (stream.count >= stream.batch) flushStream(server, r);
+            now = monotonicNs();
+        }
+        // partial batch at low rates: don't let it sit
+        if (stream.count && now - stream.batchStartNs >= SERVER_FLUSH_NS) flushStream(server, r);
+
+        uint64_t due = stream.pacer.nextNs;
+        if (stream.count && stream.batchStartNs + SERVER_FLUSH_NS < due) due = stream.batchStartNs + SERVER_FLUSH_NS;
+        if (!next || due < next) next = due;
+    }
+
+    struct itimerspec spec = {};
+    spec.it_value.tv_sec = next / 1'000'000'000ull;
+    spec.it_value.tv_nsec = next % 1'000'000'000ull;
+    if (next && spec.it_value.tv_sec == 0 && spec.it_value.tv_nsec == 0) spec.it_value.tv_nsec = 1;
+    timerfd_settime(server.timerFd, TFD_TIMER_ABSTIME, &spec, NULL);     // next = 0 disarms
+    return next;
+}
+
+// ===================== clients =====================
+
+static void closeClient(RadioServer &server, int c) {
+    ServerClient &client = server.clients[c];
+    epoll_ctl(server.epollFd, EPOLL_CTL_DEL, client.fd, NULL);
+    close(client.fd);
+    client.fd = -1;
+    for (int r = 0; r < server.numRadios; r++) {
+        if (client.rateHz[r] == 0) continue;
+        client.rateHz[r] = 0;
+        updateStream(server, r);
+    }
+}
+
+static void acceptClient(RadioServer &server) {
+    int fd = accept4(server.listenFd, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC);
+    if (fd < 0) return;
+
+    int c = 0;
+    while (c < SERVER_MAX_CLIENTS && server.clients[c].fd >= 0) c++;
+    if (c == SERVER_MAX_CLIENTS) {
+        fprintf(stderr, "WARNING: radiod: client limit (%d) reached\n", SERVER_MAX_CLIENTS);
+        close(fd);
+        return;
+    }
+
+    memset(&server.clients[c], 0, sizeof(ServerClient));
+    server.clients[c].fd = fd;
+    struct epoll_event ev = {};
+    ev.events = EPOLLIN;
+    ev.data.u64 = c;
+    epoll_ctl(server.epollFd, EPOLL_CTL_ADD, fd, &ev);
+}
+
+static void replyError(RadioServer &server, int c, const MsgHeader &request, MsgErrorCode code) {
+    uint8_t buff[sizeof(MsgHeader) + sizeof(MsgError)];
+    MsgHeader header = {MSG_ERROR, request.radio, 0, request.id};
+    MsgError error = {code, 0};
+    memcpy(buff, &header, sizeof(header));
+    memcpy(buff + sizeof(header), &error, sizeof(error));
+    sendTo(server, c, buff, sizeof(buff));
+}
+
+static void handleRequest(RadioServer &server, int c, const uint8_t *msg, size_t len) {
+    MsgHeader request;
+    memcpy(&request, msg, sizeof(request));
+    const uint8_t *payload = msg + sizeof(MsgHeader);
+    size_t payloadLen = len - sizeof(MsgHeader);
+    server.requests++;
+
+    uint8_t buff[MSG_MAX_BYTES];
+    MsgHeader header = {request.type, request.radio, 0, request.id};
+    uint8_t *reply = buff + sizeof(MsgHeader);
+    size_t replyLen = 0;
+
+    bool needsRadio = request.type != MSG_HELLO && request.type != MSG_LIST_RADIOS;
+    if (needsRadio && request.radio >= server.numRadios) return replyError(server, c, request, ERR_NO_RADIO);
+    const Radio &radio = server.radios[needsRadio ? request.radio : 0];
+
+    MsgRegAccess access = {};
+    if (request.type == MSG_READ_REGS || request.type == MSG_WRITE_REGS || request.type == MSG_STROBE) {
+        if (payloadLen < sizeof(access)) return replyError(server, c, request, ERR_BAD_REQUEST);
+        memcpy(&access, payload, sizeof(access));
+        if (access.count == 0 || access.count > 64) return replyError(server, c, request, ERR_BAD_REQUEST);
+    }
+
+    switch (request.type) {
+        case MSG_HELLO: {
+            MsgHello hello = {RADIO_PROTOCOL_VERSION, (uint16_t)server.numRadios};
+            memcpy(reply, &hello, sizeof(hello));
+            replyLen = sizeof(hello);
+            break;
+        }
+        case MSG_LIST_RADIOS:
+            for (int r = 0; r < server.numRadios; r++) {
+                MsgRadioInfo info = {};
+                strncpy(info.path, server.radios[r].path, sizeof(info.path) - 1);
+                info.index = r;
+                info.partnum = server.radios[r].partnum;
+                info.version = server.radios[r].version;
+                for (const ServerClient &client : server.clients) info.subscribers += (client.fd >= 0 && client.rateHz[r] > 0);
+                info.sampleRateHz = server.streams[r].active ? server.streams[r].rateHz : 0;
+                memcpy(reply + replyLen, &info, sizeof(info));
+                replyLen += sizeof(info);
+            }
+            break;
+        case MSG_READ_REGS:
+            if (!readRegs(server, radio, access, reply)) return replyError(server, c, request, ERR_SPI);
+            replyLen = access.count;
+            break;
+        case MSG_WRITE_REGS:
+            if (payloadLen < sizeof(access) + access.count) return replyError(server, c, request, ERR_BAD_REQUEST);
+            writeRegs(server, radio, access, payload + sizeof(access));
+            break;
+        case MSG_STROBE:
+            if (radio.fd < 0) reply[0] = STATE_RX;
+            else if (!sendStrobes(radio.fd, &access.reg, 1, 0, reply)) return replyError(server, c, request, ERR_SPI);
+            replyLen = 1;
+            break;
+        case MSG_SUBSCRIBE: {
+            MsgSubscribe subscribe;
+            if (payloadLen < sizeof(subscribe)) return replyError(server, c, request, ERR_BAD_REQUEST);
+            memcpy(&subscribe, payload, sizeof(subscribe));
+            if (!(subscribe.sampleRateHz > 0)) return replyError(server, c, request, ERR_BAD_REQUEST);
+
+            ServerClient &client = server.clients[c];
+            client.rateHz[request.radio] = std::min(subscribe.sampleRateHz, SERVER_MAX_RATE_HZ);
+            client.batch[request.radio] = (subscribe.batch > 0 && subscribe.batch < SERVER_MAX_BATCH) ? subscribe.batch : SERVER_MAX_BATCH;
+            updateStream(server, request.radio);
+
+            subscribe.sampleRateHz = server.streams[request.radio].rateHz;
+            subscribe.batch = server.streams[request.radio].batch;
+            memcpy(reply, &subscribe, sizeof(subscribe));
+            replyLen = sizeof(subscribe);
+            break;
+        }
+        case MSG_UNSUBSCRIBE:
+            server.clients[c].rateHz[request.radio] = 0;
+            updateStream(server, request.radio);
+            break;
+        default:
+            return replyError(server, c, request, ERR_BAD_REQUEST);
+    }
+
+    memcpy(buff, &header, sizeof(header));
+    sendTo(server, c, buff, sizeof(header) + replyLen);
+}
+
+static void serviceClient(RadioServer &server, int c) {
+    uint8_t msg[MSG_MAX_BYTES];
+    for (;;) {
+        ssize_t len = recv(server.clients[c].fd, msg, sizeof(msg), MSG_DONTWAIT);
+        if (len < 0 && errno == EAGAIN) return;
+        if (len < (ssize_t)sizeof(MsgHeader)) {     // gone (0) or garbage
+            closeClient(server, c);
+            return;
+        }
+        handleRequest(server, c, msg, len);
+    }
+}
+
+// ===================== server =====================
+
+bool serverInit(RadioServer &server, Radio *radios, int numRadios, const char *socketPath) {
+    memset(&server, 0, sizeof(server));
+    server.radios = radios;
+    server.numRadios = (numRadios > MAX_RADIOS) ? MAX_RADIOS : numRadios;
+    server.simSeed = 1;
+    server.spinNs = measureSleepOvershootNs();
+    for (ServerClient &client : server.clients) client.fd = -1;
+    strncpy(server.socketPath, socketPath, sizeof(server.socketPath) - 1);
+
+    server.listenFd = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    server.epollFd = epoll_create1(EPOLL_CLOEXEC);
+    server.timerFd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    server.stopFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (server.listenFd < 0 || server.epollFd < 0 || server.timerFd < 0 || server.stopFd < 0) {
+        perror("radiod");
+        serverClose(server);
+        return false;
+    }
+
+    struct sockaddr_un addr = {};
+    addr.sun_family = AF_UNIX;
+    strncpy(addr.sun_path, socketPath, sizeof(addr.sun_path) - 1);
+    unlink(socketPath);     // stale socket of an earlier run
+    if (bind(server.listenFd, (struct sockaddr *)&addr, sizeof(addr)) < 0 || listen(server.listenFd, 16) < 0) {
+        perror("radiod: bind");
+        serverClose(server);
+        return false;
+    }
+
+    const struct { int fd; uint64_t tag; } sources[] = {
+        {server.listenFd, EV_LISTEN}, {server.timerFd, EV_TIMER}, {server.stopFd, EV_STOP}};
+    for (const auto &src : sources) {
+        struct epoll_event ev = {};
+        ev.events = EPOLLIN;
+        ev.data.u64 = src.tag;
+        epoll_ctl(server.epollFd, EPOLL_CTL_ADD, src.fd, &ev);
+    }
+    return true;
+}
+
+void serverRun(RadioServer &server) {
+    struct epoll_event events[SERVER_MAX_CLIENTS + 3];
+
+    uint64_t next = 0;
+
+    for (;;) {
+        // deadline closer than the timer wakeup latency: poll instead of sleeping (same idea as pacerWait())
+        bool spin = next && next < monotonicNs() + server.spinNs;
+        int n = epoll_wait(server.epollFd, events, SERVER_MAX_CLIENTS + 3, spin ? 0 : -1);
+        if (n < 0 && errno != EINTR) {
+            perror("epoll_wait");
+            return;
+        }
+
+        // streams first, requests in between samples
+        next = serviceStreams(server);
+        for (int i = 0; i < n; i++) {
+            uint64_t tag = events[i].data.u64;
+            if (tag == EV_STOP) return;
+            if (tag == EV_LISTEN) acceptClient(server);
+            else if (tag == EV_TIMER) {
+                uint64_t expirations;
+                while (read(server.timerFd, &expirations, sizeof(expirations)) > 0) {}
+            } else if (server.clients[tag].fd >= 0) {
+                serviceClient(server, tag);
+                next = serviceStreams(server);
+            }
+        }
+    }
+}
+
+void serverStop(RadioServer &server) {
+    uint64_t one = 1;
+    if (write(server.stopFd, &one, sizeof(one)) < 0) {}
+}
+
+void serverClose(RadioServer &server) {
+    for (int c = 0; c < SERVER_MAX_CLIENTS; c++) {
+        if (server.clients[c].fd >= 0) closeClient(server, c);
+    }
+    for (int fd : {server.listenFd, server.epollFd, server.timerFd, server.stopFd}) {
+        if (fd >= 0) close(fd);
+    }
+    if (server.socketPath[0]) unlink(server.socketPath);
+    server.listenFd = server.epollFd = server.timerFd = server.stopFd = -1;
+}
+
+// ===================== benchmark =====================
+
+struct BenchClient {
+    RadioClient client;
+    uint64_t samples;
+    uint64_t frames;
+    uint64_t gaps;          // missing frame seqs = frames dropped for us
+    uint64_t lastSeq;
+};
+
+static void countFrame(uint8_t, const MsgSamples &frame, const RssiSample *, void *ctx) {
+    BenchClient *bench = (BenchClient *)ctx;
+    if (bench->frames && frame.seq > bench->lastSeq + 1) bench->gaps += frame.seq - bench->lastSeq - 1;
+    bench->lastSeq = frame.seq;
+    bench->frames++;
+    bench->samples += frame.numSamples;
+}
+
+void benchmarkRadioServer(int numClients, double sampleRateHz, int seconds) {
+    const char *socketPath = "/tmp/radiod_bench.sock";
+    Radio radios[2];
+    int numRadios = simulateRadios(radios, 2);
+
+    static RadioServer server;
+    if (!serverInit(server, radios, numRadios, socketPath)) return;
+    std::thread serverThread(serverRun, std::ref(server));
+
+    // every client takes both radios' streams
+    std::vector<BenchClient> clients(numClients);
+    std::vector<std::thread> threads;
+    std::atomic<bool> running(true);
+    for (BenchClient &bench : clients) {
+        bench = BenchClient{};
+        threads.emplace_back([&bench, &running, socketPath, numRadios, sampleRateHz]() {
+            if (!clientConnect(bench.client, socketPath, countFrame, &bench)) return;
+            for (int r = 0; r < numRadios; r++) clientSubscribe(bench.client, r, sampleRateHz, 0);
+            while (running && clientPoll(bench.client, 10) >= 0) {}
+            clientClose(bench.client);
+        });
+    }
+
+    // request latency while the streams run
+    RadioClient control;
+    Histogram latency;
+    histogramInit(latency, 0, 5'000);       // 0 - 320 us
+    if (clientConnect(control, socketPath, NULL, NULL)) {
+        uint64_t end = monotonicRawNs() + (uint64_t)seconds * 1'000'000'000ull;
+        uint8_t regs[8];
+        while (monotonicRawNs() < end) {
+            uint64_t start = monotonicRawNs();
+            clientReadRegisters(control, 0, MDMCFG4, READ_BURST, sizeof(regs), regs);
+            histogramAdd(latency, monotonicRawNs() - start);
+            usleep(1000);
+        }
+        clientClose(control);
+    }
+
+    running = false;
+    for (std::thread &t : threads) t.join();
+    serverStop(server);
+    serverThread.join();
+
+    uint64_t expected = (uint64_t)(std::min(sampleRateHz, (double)SERVER_MAX_RATE_HZ) * seconds) * numRadios;
+    printf("radiod, %d clients x %d radios @ %.0f Hz for %d s\n", numClients, numRadios, sampleRateHz, seconds);
+    for (int i = 0; i < numClients; i++) {
+        const BenchClient &bench = clients[i];
+        printf("    client %2d: %8.0f samples/s (%.1f%% of %.0f), %llu frames, %llu dropped\n", i,
+               (double)bench.samples / seconds, 100.0 * bench.samples / expected, (double)expected / seconds,
+               (unsigned long long)bench.frames, (unsigned long long)bench.gaps);
+    }
+    uint64_t received = 0;
+    for (const BenchClient &bench : clients) received += bench.samples;
+    printf("    server: %llu frames sent, %llu dropped, fan-out %.2f M samples/s (%.1f MB/s)\n",
+           (unsigned long long)server.framesSent, (unsigned long long)server.framesDropped,
+           received / 1e6 / seconds, received * sizeof(RssiSample) / 1e6 / seconds);
+    printf("    register read round trip: mean %.1f us, p50 %.1f us, p99 %.1f us, max %.1f us (%llu requests)\n",
+           histogramMean(latency) / 1e3, histogramPercentile(latency, 50) / 1e3, histogramPercentile(latency, 99) / 1e3,
+           latency.max_ns / 1e3, (unsigned long long)latency.count);
+    serverClose(server);
+}
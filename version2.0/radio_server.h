@@ -0,0 +1,81 @@
+#ifndef RADIO_SERVER_H
+#define RADIO_SERVER_H
+
+#include <stdint.h>
+
+#include "device_manager.h"
+#include "capture_timing.h"
+#include "pacer.h"
+#include "rssi_stream.h"
+#include "radio_protocol.h"
+
+// radiod: owns every radio and is the only thing touching SPI, clients talk to it over
+// a Unix socket (radio_protocol.h, client side in radio_client.h).
+//
+// One thread, one epoll loop. A timerfd armed on the earliest stream deadline drives
+// sampling (streams first), requests (register access, subscriptions) are served in
+// between, so SPI access is serialized without locks. Samples of a radio are batched
+// and the same frame goes to every subscriber with a non blocking send: a client that
+// doesn't keep up loses frames (counted in its frames), it never stalls sampling.
+
+constexpr int SERVER_MAX_CLIENTS = 64;
+constexpr int SERVER_MAX_BATCH = (MSG_MAX_BYTES - sizeof(MsgHeader) - sizeof(MsgSamples)) / sizeof(RssiSample);
+constexpr uint64_t SERVER_FLUSH_NS = 20'000'000;    // max age of a partial batch before it is sent anyway
+constexpr float SERVER_MAX_RATE_HZ = 20'000;        // subscriptions are capped here (one RSSI read is ~25 us of SPI)
+
+struct ServerClient {
+    int fd;                                 // -1 = free slot
+    float rateHz[MAX_RADIOS];               // 0 = not subscribed
+    uint16_t batch[MAX_RADIOS];
+    uint32_t dropped[MAX_RADIOS];           // frames that didn't fit in its socket buffer
+    uint64_t framesSent;
+};
+
+struct ServerStream {
+    bool active;
+    double rateHz;                          // max of subscribers
+    int batch;                              // min of subscribers
+    Pacer pacer;
+    RssiSample samples[SERVER_MAX_BATCH];
+    int count;
+    uint64_t batchStartNs;                  // CLOCK_MONOTONIC of the batch's first sample
+    uint64_t seq;
+    RssiModeBackup backup;
+};
+
+struct RadioServer {
+    Radio *radios;
+    int numRadios;
+    int listenFd;
+    int epollFd;
+    int timerFd;
+    int stopFd;                             // eventfd, serverStop() writes it
+    char socketPath[108];
+    uint64_t spinNs;                        // timer wakeup latency, closer deadlines are polled
+    ServerClient clients[SERVER_MAX_CLIENTS];
+    ServerStream streams[MAX_RADIOS];
+
+    // simulated radios (Radio::fd < 0): noise samples + a register file
+    uint8_t simRegs[MAX_RADIOS][0x40];
+    uint32_t simSeed;
+
+    uint64_t requests;
+    uint64_t framesSent;
+    uint64_t framesDropped;
+};
+
+// fills radios with numRadios simulated cc1101s (fd = -1), for running without hardware
+int simulateRadios(Radio *radios, int numRadios);
+
+bool serverInit(RadioServer &server, Radio *radios, int numRadios, const char *socketPath);
+// serve until serverStop()
+void serverRun(RadioServer &server);
+// async signal safe, can be called from a signal handler or another thread
+void serverStop(RadioServer &server);
+void serverClose(RadioServer &server);
+
+// server + numClients clients on simulated radios in this process: per client stream
+// throughput / drops, and request round trip latency while all streams run
+void benchmarkRadioServer(int numClients, double sampleRateHz, int seconds);
+
+#endif
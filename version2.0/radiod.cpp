@@ -0,0 +1,59 @@
+#include <stdio.h>              // printf(), fprintf()
+#include <stdlib.h>             // atoi(), atof()
+#include <string.h>             // strcmp()
+#include <signal.h>             // sigaction()
+
+#include "radio_server.h"
+#include "cc1101_config.h"
+
+// radiod [--socket path] [--simulate n] [--bench clients rateHz seconds]
+// owns every cc1101 found on /dev/spidevB.C and serves them on a Unix socket (radio_protocol.h)
+
+constexpr int GDO_LINES[] = {GDO2};
+
+static RadioServer server;
+
+static void onSignal(int) {
+    serverStop(server);
+}
+
+int main(int argc, char **argv) {
+    const char *socketPath = RADIOD_SOCKET;
+    int simulated = 0;
+
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "--socket") && i + 1 < argc) socketPath = argv[++i];
+        else if (!strcmp(argv[i], "--simulate") && i + 1 < argc) simulated = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--bench") && i + 3 < argc) {
+            benchmarkRadioServer(atoi(argv[i + 1]), atof(argv[i + 2]), atoi(argv[i + 3]));
+            return 0;
+        } else {
+            fprintf(stderr, "usage: %s [--socket path] [--simulate n] [--bench clients rateHz seconds]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    Radio radios[MAX_RADIOS];
+    int numRadios = simulated ? simulateRadios(radios, simulated)
+                              : enumerateRadios(radios, MAX_RADIOS, GDO_LINES, sizeof(GDO_LINES) / sizeof(GDO_LINES[0]));
+    if (numRadios == 0) {
+        fprintf(stderr, "ERROR: no cc1101 found\n");
+        return 1;
+    }
+
+    if (!serverInit(server, radios, numRadios, socketPath)) return 1;
+
+    struct sigaction sa = {};
+    sa.sa_handler = onSignal;
+    sigaction(SIGINT, &sa, NULL);
+    sigaction(SIGTERM, &sa, NULL);
+
+    printf("radiod: %d radio(s) on %s\n", numRadios, socketPath);
+    serverRun(server);
+
+    printf("radiod: %llu requests, %llu frames sent, %llu dropped\n", (unsigned long long)server.requests,
+           (unsigned long long)server.framesSent, (unsigned long long)server.framesDropped);
+    serverClose(server);
+    if (!simulated) closeRadios(radios, numRadios);
+    return 0;
+}
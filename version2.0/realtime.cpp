@@ -0,0 +1,129 @@
+#include <stdio.h>              // fprintf(), fopen()
+#include <string.h>             // strerror()
+#include <errno.h>
+#include <unistd.h>             // sysconf()
+#include <sched.h>              // sched_param, cpu_set_t
+#include <pthread.h>            // pthread_setschedparam(), pthread_setaffinity_np()
+#include <sys/mman.h>           // mlockall()
+#include <alloca.h>
+#include <mutex>
+
+#include "realtime.h"
+
+// cpus a SCHED_FIFO thread is pinned to
+static std::mutex fifoCpusLock;
+static bool fifoCpus[CPU_SETSIZE];
+
+// false if another SCHED_FIFO thread has cpu, unpinned (-1) always succeeds
+static bool claimFifoCpu(int cpu) {
+    if (cpu < 0 || cpu >= CPU_SETSIZE) return true;
+    std::lock_guard<std::mutex> lock(fifoCpusLock);
+    if (fifoCpus[cpu]) return false;
+    fifoCpus[cpu] = true;
+    return true;
+}
+
+static void releaseFifoCpu(int cpu) {
+    if (cpu < 0 || cpu >= CPU_SETSIZE) return;
+    std::lock_guard<std::mutex> lock(fifoCpusLock);
+    fifoCpus[cpu] = false;
+}
+
+bool lockMemory() {
+    if (mlockall(MCL_CURRENT | MCL_FUTURE) != 0) {
+        fprintf(stderr, "WARNING: mlockall failed (%s), capture may page fault\n", strerror(errno));
+        return false;
+    }
+    return true;
+}
+
+void unlockMemory() {
+    munlockall();
+}
+
+void prefault(void *buf, size_t len) {
+    long pageSize = sysconf(_SC_PAGESIZE);
+    volatile uint8_t *p = (volatile uint8_t *)buf;
+    for (size_t i = 0; i < len; i += pageSize) p[i] = p[i];
+    if (len) p[len - 1] = p[len - 1];
+}
+
+// grow the stack once while still allowed to fault, mlockall keeps it resident afterwards
+void prefaultStack(size_t stackBytes) {
+    if (stackBytes == 0) return;
+    volatile uint8_t *stack = (volatile uint8_t *)alloca(stackBytes);
+    long pageSize = sysconf(_SC_PAGESIZE);
+    for (size_t i = 0; i < stackBytes; i += pageSize) stack[i] = 0;
+}
+
+// format is a list like "2-3,5"
+int getIsolatedCpus(int *cpus, int maxCpus) {
+    FILE *f = fopen("/sys/devices/system/cpu/isolated", "r");
+    if (!f) return 0;
+
+    char line[256] = {0};
+    if (!fgets(line, sizeof(line), f)) line[0] = '\0';
+    fclose(f);
+
+    int count = 0;
+    char *p = line;
+    while (*p && *p != '\n' && count < maxCpus) {
+        int first = 0, last = 0, used = 0;
+        if (sscanf(p, "%d-%d%n", &first, &last, &used) != 2) {
+            if (sscanf(p, "%d%n", &first, &used) != 1) break;
+            last = first;
+        }
+        for (int c = first; c <= last && count < maxCpus; c++) cpus[count++] = c;
+        p += used;
+        if (*p == ',') p++;
+    }
+    return count;
+}
+
+RealtimeStatus enterRealtime(const RealtimeConfig &config, int shard, int fallbackCpu) {
+    RealtimeStatus status = {false, false, -1};
+
+    // isolated cpus are handed out round robin per shard
+    int cpu = config.cpu;
+    if (cpu < 0) {
+        int isolated[MAX_ISOLATED_CPUS];
+        int numIsolated = getIsolatedCpus(isolated, MAX_ISOLATED_CPUS);
+        cpu = numIsolated ? isolated[shard % numIsolated] : fallbackCpu;
+        if (!numIsolated) fprintf(stderr, "WARNING: no isolated cpus (isolcpus=), using cpu %d\n", cpu);
+    }
+
+    if (cpu >= 0) {
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        CPU_SET(cpu, &set);
+        int err = pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+        if (err) fprintf(stderr, "WARNING: could not pin to cpu %d (%s)\n", cpu, strerror(err));
+        status.pinned = (err == 0);
+        status.cpu = cpu;
+    }
+
+    int fifoCpu = status.pinned ? cpu : -1;
+    if (!claimFifoCpu(fifoCpu)) {
+        fprintf(stderr, "WARNING: cpu %d already runs a SCHED_FIFO thread, shard %d stays SCHED_OTHER\n", cpu, shard);
+    } else {
+        struct sched_param param;
+        param.sched_priority = config.priority;
+        int err = pthread_setschedparam(pthread_self(), SCHED_FIFO, &param);
+        if (err) fprintf(stderr, "WARNING: SCHED_FIFO %d not permitted (%s), staying SCHED_OTHER\n", config.priority, strerror(err));
+        status.fifo = (err == 0);
+        if (!status.fifo) releaseFifoCpu(fifoCpu);
+    }
+
+    // memory locking is per process (lockMemory()), only the stack is per thread
+    prefaultStack(config.prefaultStackBytes);
+
+    return status;
+}
+
+void exitRealtime(const RealtimeStatus &status) {
+    if (!status.fifo) return;
+    struct sched_param param;
+    param.sched_priority = 0;
+    pthread_setschedparam(pthread_self(), SCHED_OTHER, &param);
+    releaseFifoCpu(status.pinned ? status.cpu : -1);
+}
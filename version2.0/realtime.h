@@ -0,0 +1,42 @@
+#ifndef REALTIME_H
+#define REALTIME_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+constexpr int MAX_ISOLATED_CPUS = 16;
+
+struct RealtimeConfig {
+    bool enabled = false;
+    int priority = 80;                      // SCHED_FIFO priority (1-99)
+    int cpu = -1;                           // pin to this cpu, -1 = isolated cpus (isolcpus=) round robin per shard, without any the radio's cpu
+    size_t prefaultStackBytes = 256 * 1024; // stack touched up front so the loop never page faults
+    uint64_t deadlineNs = 250'000;          // sample interval longer than period + this = deadline miss
+};
+
+// what enterRealtime() actually got, anything false was degraded with a warning
+struct RealtimeStatus {
+    bool fifo;
+    bool pinned;
+    int cpu;
+};
+
+// mlockall(MCL_CURRENT | MCL_FUTURE), false + warning if not permitted (needs CAP_IPC_LOCK or rlimit)
+bool lockMemory();
+void unlockMemory();
+
+// touch every page of buf / of the next stackBytes of stack
+void prefault(void *buf, size_t len);
+void prefaultStack(size_t stackBytes);
+
+// cpus listed in /sys/devices/system/cpu/isolated, returns count
+int getIsolatedCpus(int *cpus, int maxCpus);
+
+// switch the calling thread to SCHED_FIFO + pin it, fallbackCpu is used when config.cpu = -1
+// and there are no isolated cpus. One SCHED_FIFO thread per cpu: busy polling FIFO threads on
+// the same cpu starve each other, so a second one on a taken cpu stays SCHED_OTHER (warning).
+RealtimeStatus enterRealtime(const RealtimeConfig &config, int shard, int fallbackCpu);
+// back to SCHED_OTHER and give the cpu free for the next SCHED_FIFO thread
+void exitRealtime(const RealtimeStatus &status);
+
+#endif
@@ -0,0 +1,448 @@
+#include <string.h>             // memcpy()
+#include <stdio.h>              // fwrite(), perror()
+
+#include <linux/spi/spidev.h>   // spi_ioc_transfer
+
+#include "register_map.h"
+#include "main_drivers.h"
+#include "cc1101_config.h"
+#include "ansi_colors.h"
+#include "spi_trace.h"          // spiTransfer()
+
+// ===================== enum names (datasheet section 29) =====================
+
+// GDOx_CFG, table 41 (pg. 62)
+static constexpr const char *GDO_CFG_NAMES[64] = {
+    "RXFIFO_THR", "RXFIFO_THR_PKT", "TXFIFO_THR", "TXFIFO_FULL",
+    "RXFIFO_OVERFLOW", "TXFIFO_UNDERFLOW", "SYNC_WORD", "PKT_CRC_OK",
+    "PQT_REACHED", "CCA", "PLL_LOCK", "SERIAL_CLK",
+    "SYNC_SERIAL_DATA", "ASYNC_SERIAL_DATA", "CARRIER_SENSE", "CRC_OK",
+    NULL, NULL, NULL, NULL, NULL, NULL, "RX_HARD_DATA1", "RX_HARD_DATA0",
+    NULL, NULL, NULL, "PA_PD", "LNA_PD", "RX_SYMBOL_TICK", NULL, NULL,
+    NULL, NULL, NULL, NULL, "WOR_EVNT0", "WOR_EVNT1", "CLK_256", "CLK_32K",
+    NULL, "CHIP_RDYn", NULL, "XOSC_STABLE", NULL, NULL, "HIGH_IMPEDANCE", "HW_TO_0",
+    "CLK_XOSC/1", "CLK_XOSC/1.5", "CLK_XOSC/2", "CLK_XOSC/3",
+    "CLK_XOSC/4", "CLK_XOSC/6", "CLK_XOSC/8", "CLK_XOSC/12",
+    "CLK_XOSC/16", "CLK_XOSC/24", "CLK_XOSC/32", "CLK_XOSC/48",
+    "CLK_XOSC/64", "CLK_XOSC/96", "CLK_XOSC/128", "CLK_XOSC/192"
+};
+static constexpr const char *CLOSE_IN_RX_NAMES[4]   = {"0dB", "6dB", "12dB", "18dB"};
+static constexpr const char *ADR_CHK_NAMES[4]       = {"NONE", "ADDR", "ADDR_BCAST_00", "ADDR_BCAST_00_FF"};
+static constexpr const char *PKT_FORMAT_NAMES[4]    = {"NORMAL", "SYNC_SERIAL", "RANDOM_TX", "ASYNC_SERIAL"};
+static constexpr const char *LENGTH_CONFIG_NAMES[4] = {"FIXED", "VARIABLE", "INFINITE", NULL};
+static constexpr const char *MOD_FORMAT_NAMES[8]    = {"2-FSK", "GFSK", NULL, "ASK/OOK", "4-FSK", NULL, NULL, "MSK"};
+static constexpr const char *SYNC_MODE_NAMES[8]     = {"NONE", "15/16", "16/16", "30/32",
+                                                       "CS_ONLY", "15/16+CS", "16/16+CS", "30/32+CS"};
+static constexpr const char *NUM_PREAMBLE_NAMES[8]  = {"2", "3", "4", "6", "8", "12", "16", "24"};
+static constexpr const char *RX_TIME_NAMES[8]       = {"T0", "T1", "T2", "T3", "T4", "T5", "T6", "UNTIL_END"};
+static constexpr const char *CCA_MODE_NAMES[4]      = {"ALWAYS", "RSSI_BELOW_THR", "UNLESS_RX", "RSSI_BELOW_THR_UNLESS_RX"};
+static constexpr const char *RXOFF_MODE_NAMES[4]    = {"IDLE", "FSTXON", "TX", "STAY_RX"};
+static constexpr const char *TXOFF_MODE_NAMES[4]    = {"IDLE", "FSTXON", "STAY_TX", "RX"};
+static constexpr const char *FS_AUTOCAL_NAMES[4]    = {"NEVER", "IDLE_TO_RXTX", "RXTX_TO_IDLE", "EVERY_4TH_RXTX_TO_IDLE"};
+static constexpr const char *PO_TIMEOUT_NAMES[4]    = {"1", "16", "64", "256"};
+static constexpr const char *FOC_PRE_K_NAMES[4]     = {"K", "2K", "3K", "4K"};
+static constexpr const char *FOC_POST_K_NAMES[2]    = {"SAME_AS_PRE", "K/2"};
+static constexpr const char *FOC_LIMIT_NAMES[4]     = {"0", "BW/8", "BW/4", "BW/2"};
+static constexpr const char *BS_PRE_KI_NAMES[4]     = {"KI", "2KI", "3KI", "4KI"};
+static constexpr const char *BS_PRE_KP_NAMES[4]     = {"KP", "2KP", "3KP", "4KP"};
+static constexpr const char *BS_POST_KI_NAMES[2]    = {"SAME_AS_PRE", "KI/2"};
+static constexpr const char *BS_POST_KP_NAMES[2]    = {"SAME_AS_PRE", "KP"};
+static constexpr const char *BS_LIMIT_NAMES[4]      = {"0", "3.125%", "6.25%", "12.5%"};
+static constexpr const char *MAX_DVGA_GAIN_NAMES[4] = {"ALL", "ALL-1", "ALL-2", "ALL-3"};
+static constexpr const char *MAX_LNA_GAIN_NAMES[8]  = {"MAX", "MAX-2.6dB", "MAX-6.1dB", "MAX-7.4dB",
+                                                       "MAX-9.2dB", "MAX-11.5dB", "MAX-14.6dB", "MAX-17.1dB"};
+static constexpr const char *MAGN_TARGET_NAMES[8]   = {"24dB", "27dB", "30dB", "33dB", "36dB", "38dB", "40dB", "42dB"};
+static constexpr const char *CS_REL_THR_NAMES[4]    = {"DISABLED", "+6dB", "+10dB", "+14dB"};
+static constexpr const char *HYST_LEVEL_NAMES[4]    = {"NONE", "LOW", "MEDIUM", "LARGE"};
+static constexpr const char *WAIT_TIME_NAMES[4]     = {"8", "16", "24", "32"};
+static constexpr const char *AGC_FREEZE_NAMES[4]    = {"NORMAL", "FREEZE_ON_SYNC", "FREEZE_ANALOG", "FREEZE_ALL"};
+static constexpr const char *EVENT1_NAMES[8]        = {"4", "6", "8", "12", "16", "24", "32", "48"};
+static constexpr const char *WOR_RES_NAMES[4]       = {"1P", "2^5P", "2^10P", "2^15P"};
+static constexpr const char *MARC_STATE_NAMES[32]   = {
+    "SLEEP", "IDLE", "XOFF", "VCOON_MC", "REGON_MC", "MANCAL", "VCOON", "REGON",
+    "STARTCAL", "BWBOOST", "FS_LOCK", "IFADCON", "ENDCAL", "RX", "RX_END", "RX_RST",
+    "TXRX_SWITCH", "RXFIFO_OVERFLOW", "FSTXON", "TX", "TX_END", "RXTX_SWITCH", "TXFIFO_UNDERFLOW", NULL,
+    NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL
+};
+
+// ===================== field table =====================
+// sorted by register address, reserved bits left out
+
+static constexpr RegisterField FIELDS[] = {
+    {"GDO2_INV",              IOCFG2,   6, 6, NULL},
+    {"GDO2_CFG",              IOCFG2,   5, 0, GDO_CFG_NAMES},
+    {"GDO_DS",                IOCFG1,   7, 7, NULL},
+    {"GDO1_INV",              IOCFG1,   6, 6, NULL},
+    {"GDO1_CFG",              IOCFG1,   5, 0, GDO_CFG_NAMES},
+    {"TEMP_SENSOR_ENABLE",    IOCFG0,   7, 7, NULL},
+    {"GDO0_INV",              IOCFG0,   6, 6, NULL},
+    {"GDO0_CFG",              IOCFG0,   5, 0, GDO_CFG_NAMES},
+    {"ADC_RETENTION",         FIFOTHR,  6, 6, NULL},
+    {"CLOSE_IN_RX",           FIFOTHR,  5, 4, CLOSE_IN_RX_NAMES},
+    {"FIFO_THR",              FIFOTHR,  3, 0, NULL},
+    {"SYNC_15_8",             SYNC1,    7, 0, NULL},
+    {"SYNC_7_0",              SYNC0,    7, 0, NULL},
+    {"PACKET_LENGTH",         PKTLEN,   7, 0, NULL},
+    {"PQT",                   PKTCTRL1, 7, 5, NULL},
+    {"CRC_AUTOFLUSH",         PKTCTRL1, 3, 3, NULL},
+    {"APPEND_STATUS",         PKTCTRL1, 2, 2, NULL},
+    {"ADR_CHK",               PKTCTRL1, 1, 0, ADR_CHK_NAMES},
+    {"WHITE_DATA",            PKTCTRL0, 6, 6, NULL},
+    {"PKT_FORMAT",            PKTCTRL0, 5, 4, PKT_FORMAT_NAMES},
+    {"CRC_EN",                PKTCTRL0, 2, 2, NULL},
+    {"LENGTH_CONFIG",         PKTCTRL0, 1, 0, LENGTH_CONFIG_NAMES},
+    {"DEVICE_ADDR",           ADDR,     7, 0, NULL},
+    {"CHAN",                  CHANNR,   7, 0, NULL},
+    {"FREQ_IF",               FSCTRL1,  4, 0, NULL},
+    {"FREQOFF",               FSCTRL0,  7, 0, NULL},
+    {"FREQ_23_16",            FREQ2,    7, 0, NULL},
+    {"FREQ_15_8",             FREQ1,    7, 0, NULL},
+    {"FREQ_7_0",              FREQ0,    7, 0, NULL},
+    {"CHANBW_E",              MDMCFG4,  7, 6, NULL},
+    {"CHANBW_M",              MDMCFG4,  5, 4, NULL},
+    {"DRATE_E",               MDMCFG4,  3, 0, NULL},
+    {"DRATE_M",               MDMCFG3,  7, 0, NULL},
+    {"DEM_DCFILT_OFF",        MDMCFG2,  7, 7, NULL},
+    {"MOD_FORMAT",            MDMCFG2,  6, 4, MOD_FORMAT_NAMES},
+    {"MANCHESTER_EN",         MDMCFG2,  3, 3, NULL},
+    {"SYNC_MODE",             MDMCFG2,  2, 0, SYNC_MODE_NAMES},
+    {"FEC_EN",                MDMCFG1,  7, 7, NULL},
+    {"NUM_PREAMBLE",          MDMCFG1,  6, 4, NUM_PREAMBLE_NAMES},
+    {"CHANSPC_E",             MDMCFG1,  1, 0, NULL},
+    {"CHANSPC_M",             MDMCFG0,  7, 0, NULL},
+    {"DEVIATION_E",           DEVIATN,  6, 4, NULL},
+    {"DEVIATION_M",           DEVIATN,  2, 0, NULL},
+    {"RX_TIME_RSSI",          MCSM2,    4, 4, NULL},
+    {"RX_TIME_QUAL",          MCSM2,    3, 3, NULL},
+    {"RX_TIME",               MCSM2,    2, 0, RX_TIME_NAMES},
+    {"CCA_MODE",              MCSM1,    5, 4, CCA_MODE_NAMES},
+    {"RXOFF_MODE",            MCSM1,    3, 2, RXOFF_MODE_NAMES},
+    {"TXOFF_MODE",            MCSM1,    1, 0, TXOFF_MODE_NAMES},
+    {"FS_AUTOCAL",            MCSM0,    5, 4, FS_AUTOCAL_NAMES},
+    {"PO_TIMEOUT",            MCSM0,    3, 2, PO_TIMEOUT_NAMES},
+    {"PIN_CTRL_EN",           MCSM0,    1, 1, NULL},
+    {"XOSC_FORCE_ON",         MCSM0,    0, 0, NULL},
+    {"FOC_BS_CS_GATE",        FOCCFG,   5, 5, NULL},
+    {"FOC_PRE_K",             FOCCFG,   4, 3, FOC_PRE_K_NAMES},
+    {"FOC_POST_K",            FOCCFG,   2, 2, FOC_POST_K_NAMES},
+    {"FOC_LIMIT",             FOCCFG,   1, 0, FOC_LIMIT_NAMES},
+    {"BS_PRE_KI",             BSCFG,    7, 6, BS_PRE_KI_NAMES},
+    {"BS_PRE_KP",             BSCFG,    5, 4, BS_PRE_KP_NAMES},
+    {"BS_POST_KI",            BSCFG,    3, 3, BS_POST_KI_NAMES},
+    {"BS_POST_KP",            BSCFG,    2, 2, BS_POST_KP_NAMES},
+    {"BS_LIMIT",              BSCFG,    1, 0, BS_LIMIT_NAMES},
+    {"MAX_DVGA_GAIN",         AGCCTRL2, 7, 6, MAX_DVGA_GAIN_NAMES},
+    {"MAX_LNA_GAIN",          AGCCTRL2, 5, 3, MAX_LNA_GAIN_NAMES},
+    {"MAGN_TARGET",           AGCCTRL2, 2, 0, MAGN_TARGET_NAMES},
+    {"AGC_LNA_PRIORITY",      AGCCTRL1, 6, 6, NULL},
+    {"CARRIER_SENSE_REL_THR", AGCCTRL1, 5, 4, CS_REL_THR_NAMES},
+    {"CARRIER_SENSE_ABS_THR", AGCCTRL1, 3, 0, NULL},
+    {"HYST_LEVEL",            AGCCTRL0, 7, 6, HYST_LEVEL_NAMES},
+    {"WAIT_TIME",             AGCCTRL0, 5, 4, WAIT_TIME_NAMES},
+    {"AGC_FREEZE",            AGCCTRL0, 3, 2, AGC_FREEZE_NAMES},
+    {"FILTER_LENGTH",         AGCCTRL0, 1, 0, NULL},
+    {"EVENT0_15_8",           WOREVT1,  7, 0, NULL},
+    {"EVENT0_7_0",            WOREVT0,  7, 0, NULL},
+    {"RC_PD",                 WORCTRL,  7, 7, NULL},
+    {"EVENT1",                WORCTRL,  6, 4, EVENT1_NAMES},
+    {"RC_CAL",                WORCTRL,  3, 3, NULL},
+    {"WOR_RES",               WORCTRL,  1, 0, WOR_RES_NAMES},
+    {"LNA_CURRENT",           FREND1,   7, 6, NULL},
+    {"LNA2MIX_CURRENT",       FREND1,   5, 4, NULL},
+    {"LODIV_BUF_CURRENT_RX",  FREND1,   3, 2, NULL},
+    {"MIX_CURRENT",           FREND1,   1, 0, NULL},
+    {"LODIV_BUF_CURRENT_TX",  FREND0,   5, 4, NULL},
+    {"PA_POWER",              FREND0,   2, 0, NULL},
+    {"FSCAL3_7_6",            FSCAL3,   7, 6, NULL},
+    {"CHP_CURR_CAL_EN",       FSCAL3,   5, 4, NULL},
+    {"FSCAL3_3_0",            FSCAL3,   3, 0, NULL},
+    {"VCO_CORE_H_EN",         FSCAL2,   5, 5, NULL},
+    {"FSCAL2",                FSCAL2,   4, 0, NULL},
+    {"FSCAL1",                FSCAL1,   5, 0, NULL},
+    {"FSCAL0",                FSCAL0,   6, 0, NULL},
+    {"RCCTRL1",               RCCTRL1,  6, 0, NULL},
+    {"RCCTRL0",               RCCTRL0,  6, 0, NULL},
+    {"FSTEST",                FSTEST,   7, 0, NULL},
+    {"PTEST",                 PTEST,    7, 0, NULL},
+    {"AGCTEST",               AGCTEST,  7, 0, NULL},
+    {"TEST2",                 TEST2,    7, 0, NULL},
+    {"TEST1",                 TEST1,    7, 0, NULL},
+    {"TEST0_7_2",             TEST0,    7, 2, NULL},
+    {"VCO_SEL_CAL_EN",        TEST0,    1, 1, NULL},
+    {"TEST0_0",               TEST0,    0, 0, NULL},
+
+    {"PARTNUM",               PARTNUM,        7, 0, NULL},
+    {"VERSION",               VERSION,        7, 0, NULL},
+    {"FREQOFF_EST",           FREQEST,        7, 0, NULL},
+    {"CRC_OK",                LQI,            7, 7, NULL},
+    {"LQI_EST",               LQI,            6, 0, NULL},
+    {"RSSI",                  RSSI,           7, 0, NULL},
+    {"MARC_STATE",            MARCSTATE,      4, 0, MARC_STATE_NAMES},
+    {"TIME_15_8",             WORTIME1,       7, 0, NULL},
+    {"TIME_7_0",              WORTIME0,       7, 0, NULL},
+    {"CRC_OK",                PKTSTATUS,      7, 7, NULL},
+    {"CS",                    PKTSTATUS,      6, 6, NULL},
+    {"PQT_REACHED",           PKTSTATUS,      5, 5, NULL},
+    {"CCA",                   PKTSTATUS,      4, 4, NULL},
+    {"SFD",                   PKTSTATUS,      3, 3, NULL},
+    {"GDO2",                  PKTSTATUS,      2, 2, NULL},
+    {"GDO0",                  PKTSTATUS,      0, 0, NULL},
+    {"VCO_VC_DAC",            VCO_VC_DAC,     7, 0, NULL},
+    {"TXFIFO_UNDERFLOW",      TXBYTES,        7, 7, NULL},
+    {"NUM_TXBYTES",           TXBYTES,        6, 0, NULL},
+    {"RXFIFO_OVERFLOW",       RXBYTES,        7, 7, NULL},
+    {"NUM_RXBYTES",           RXBYTES,        6, 0, NULL},
+    {"RCCTRL1_STATUS",        RCCTRL1_STATUS, 6, 0, NULL},
+    {"RCCTRL0_STATUS",        RCCTRL0_STATUS, 6, 0, NULL},
+};
+constexpr uint8_t NUM_FIELDS = sizeof(FIELDS) / sizeof(FIELDS[0]);
+
+static constexpr const char *REGISTER_NAMES[NUM_CONFIG_REGS + NUM_STATUS_REGS] = {
+    "IOCFG2", "IOCFG1", "IOCFG0", "FIFOTHR", "SYNC1", "SYNC0", "PKTLEN", "PKTCTRL1",
+    "PKTCTRL0", "ADDR", "CHANNR", "FSCTRL1", "FSCTRL0", "FREQ2", "FREQ1", "FREQ0",
+    "MDMCFG4", "MDMCFG3", "MDMCFG2", "MDMCFG1", "MDMCFG0", "DEVIATN", "MCSM2", "MCSM1",
+    "MCSM0", "FOCCFG", "BSCFG", "AGCCTRL2", "AGCCTRL1", "AGCCTRL0", "WOREVT1", "WOREVT0",
+    "WORCTRL", "FREND1", "FREND0", "FSCAL3", "FSCAL2", "FSCAL1", "FSCAL0", "RCCTRL1",
+    "RCCTRL0", "FSTEST", "PTEST", "AGCTEST", "TEST2", "TEST1", "TEST0",
+    "PARTNUM", "VERSION", "FREQEST", "LQI", "RSSI", "MARCSTATE", "WORTIME1", "WORTIME0",
+    "PKTSTATUS", "VCO_VC_DAC", "TXBYTES", "RXBYTES", "RCCTRL1_STATUS", "RCCTRL0_STATUS"
+};
+
+// config regs map to 0..46, status regs to 47..60
+static constexpr int registerIndex(uint8_t addr) {
+    if (addr < NUM_CONFIG_REGS) return addr;
+    if (addr >= FIRST_STATUS_REG && addr < FIRST_STATUS_REG + NUM_STATUS_REGS) return NUM_CONFIG_REGS + addr - FIRST_STATUS_REG;
+    return -1;
+}
+
+struct RegisterTable {
+    RegisterInfo regs[NUM_CONFIG_REGS + NUM_STATUS_REGS];
+};
+
+// build the per register index into FIELDS at compile time
+static constexpr RegisterTable buildRegisterTable() {
+    RegisterTable table{};
+    for (int i = 0; i < NUM_CONFIG_REGS + NUM_STATUS_REGS; i++) {
+        uint8_t addr = (i < NUM_CONFIG_REGS) ? i : FIRST_STATUS_REG + i - NUM_CONFIG_REGS;
+        table.regs[i] = {REGISTER_NAMES[i], addr, 0, 0};
+    }
+    for (int f = NUM_FIELDS - 1; f >= 0; f--) {
+        RegisterInfo &info = table.regs[registerIndex(FIELDS[f].reg)];
+        info.firstField = f;
+        info.numFields++;
+    }
+    return table;
+}
+
+static constexpr RegisterTable REGISTERS = buildRegisterTable();
+
+// every register has at least one field, and fields are grouped by register
+static constexpr bool tableIsValid() {
+    for (int f = 1; f < NUM_FIELDS; f++) {
+        if (registerIndex(FIELDS[f].reg) < registerIndex(FIELDS[f - 1].reg)) return false;
+        if (FIELDS[f].msb > 7 || FIELDS[f].lsb > FIELDS[f].msb) return false;
+    }
+    for (const RegisterInfo &info : REGISTERS.regs) {
+        if (info.numFields == 0) return false;
+    }
+    return true;
+}
+static_assert(tableIsValid(), "register field table is out of order or incomplete");
+
+const RegisterInfo *getRegisterInfo(uint8_t addr) {
+    int i = registerIndex(addr);
+    return (i < 0) ? NULL : &REGISTERS.regs[i];
+}
+
+const RegisterField *getRegisterField(uint8_t index) {
+    return (index < NUM_FIELDS) ? &FIELDS[index] : NULL;
+}
+
+uint8_t getNumRegisterFields() {
+    return NUM_FIELDS;
+}
+
+// ===================== SPI =====================
+
+bool readConfigSpace(int fd, uint8_t *cfg) {
+    return readRegister(fd, IOCFG2, READ_BURST, NUM_CONFIG_REGS, cfg) != 0;
+}
+
+bool readStatusSpace(int fd, uint8_t *status) {
+    return readStatusRegisters(fd, FIRST_STATUS_REG, NUM_STATUS_REGS, status);
+}
+
+// transfer 0 = config burst, then one 2 byte transfer per status reg (burst bit selects status space)
+bool readAllRegisters(int fd, uint8_t *cfg, uint8_t *status) {
+    uint8_t cfgTx[NUM_CONFIG_REGS + 1] = {IOCFG2 | READ_BURST};
+    uint8_t cfgRx[NUM_CONFIG_REGS + 1];
+    uint8_t statusTx[NUM_STATUS_REGS][2];
+    uint8_t statusRx[NUM_STATUS_REGS][2];
+    struct spi_ioc_transfer spi[1 + NUM_STATUS_REGS];
+    memset(spi, 0, sizeof(spi));
+
+    spi[0].tx_buf = (unsigned long)cfgTx;
+    spi[0].rx_buf = (unsigned long)cfgRx;
+    spi[0].len = sizeof(cfgTx);
+    spi[0].cs_change = 1;
+    for (int i = 0; i < NUM_STATUS_REGS; i++) {
+        statusTx[i][0] = (FIRST_STATUS_REG + i) | READ_BURST;
+        statusTx[i][1] = 0;
+        spi[1 + i].tx_buf = (unsigned long)statusTx[i];
+        spi[1 + i].rx_buf = (unsigned long)statusRx[i];
+        spi[1 + i].len = 2;
+        spi[1 + i].cs_change = (i < NUM_STATUS_REGS - 1);
+    }
+
+    if (spiTransfer(fd, spi, 1 + NUM_STATUS_REGS) < 0) {
+        perror("SPI register dump failed");
+        return false;
+    }
+    memcpy(cfg, cfgRx + 1, NUM_CONFIG_REGS);
+    for (int i = 0; i < NUM_STATUS_REGS; i++) status[i] = statusRx[i][1];
+    return true;
+}
+
+// ===================== formatting =====================
+// hand rolled appends instead of snprintf, a full dump is ~150 fields
+
+struct OutBuff {
+    char *pos;
+    char *end;      // one before the real end (room for '\0')
+};
+
+static inline void put(OutBuff &out, const char *s) {
+    while (*s && out.pos < out.end) *out.pos++ = *s++;
+}
+
+static inline void putChar(OutBuff &out, char c) {
+    if (out.pos < out.end) *out.pos++ = c;
+}
+
+static inline void putHex(OutBuff &out, uint8_t v) {
+    static const char digits[] = "0123456789ABCDEF";
+    putChar(out, '0'); putChar(out, 'x');
+    putChar(out, digits[v >> 4]);
+    putChar(out, digits[v & 0x0F]);
+}
+
+static inline void putUint(OutBuff &out, uint32_t v) {
+    char tmp[10];
+    int n = 0;
+    do { tmp[n++] = '0' + (v % 10); v /= 10; } while (v);
+    while (n) putChar(out, tmp[--n]);
+}
+
+static inline void putBinary(OutBuff &out, uint8_t v, int bits) {
+    for (int i = bits - 1; i >= 0; i--) putChar(out, (v & (1 << i)) ? '1' : '0');
+}
+
+static void formatText(const RegisterInfo &info, uint8_t value, bool color, OutBuff &out) {
+    if (color) put(out, BLUE);
+    put(out, info.name);
+    if (color) put(out, RESET);
+    put(out, " ("); putHex(out, info.addr); put(out, "): ");
+    putHex(out, value); put(out, " = "); putUint(out, value); put(out, " = "); putBinary(out, value, 8);
+    putChar(out, '\n');
+
+    for (int f = info.firstField; f < info.firstField + info.numFields; f++) {
+        const RegisterField &field = FIELDS[f];
+        int width = field.msb - field.lsb + 1;
+        uint8_t v = (value >> field.lsb) & ((1 << width) - 1);
+
+        put(out, "    ");
+        if (color) put(out, BG_BRIGHT_YELLOW);
+        put(out, field.name);
+        if (color) put(out, RESET);
+        put(out, ": "); putHex(out, v); put(out, " = "); putUint(out, v); put(out, " = "); putBinary(out, v, width);
+        if (field.enumNames) {
+            put(out, " (");
+            put(out, field.enumNames[v] ? field.enumNames[v] : "reserved");
+            putChar(out, ')');
+        }
+        putChar(out, '\n');
+    }
+}
+
+static void formatJson(const RegisterInfo &info, uint8_t value, OutBuff &out) {
+    putChar(out, '"'); put(out, info.name); put(out, "\":{\"addr\":"); putUint(out, info.addr);
+    put(out, ",\"value\":"); putUint(out, value); put(out, ",\"fields\":{");
+
+    for (int f = info.firstField; f < info.firstField + info.numFields; f++) {
+        const RegisterField &field = FIELDS[f];
+        uint8_t v = (value >> field.lsb) & ((1 << (field.msb - field.lsb + 1)) - 1);
+
+        if (f != info.firstField) putChar(out, ',');
+        putChar(out, '"'); put(out, field.name); put(out, "\":");
+        if (field.enumNames) {
+            put(out, "{\"value\":"); putUint(out, v); put(out, ",\"name\":");
+            if (field.enumNames[v]) { putChar(out, '"'); put(out, field.enumNames[v]); putChar(out, '"'); }
+            else put(out, "null");
+            putChar(out, '}');
+        } else {
+            putUint(out, v);
+        }
+    }
+    put(out, "}}");
+}
+
+static void formatRange(const uint8_t *values, uint8_t firstReg, uint8_t numRegs, DumpFormat format, OutBuff &out) {
+    bool first = true;
+    for (int i = 0; i < numRegs; i++) {
+        const RegisterInfo *info = getRegisterInfo(firstReg + i);
+        if (!info) continue;
+
+        if (format == DUMP_JSON) {
+            if (!first) putChar(out, ',');
+            formatJson(*info, values[i], out);
+        } else {
+            formatText(*info, values[i], format == DUMP_COLOR, out);
+        }
+        first = false;
+    }
+}
+
+size_t formatRegisters(const uint8_t *values, uint8_t firstReg, uint8_t numRegs, DumpFormat format, char *out, size_t outSize) {
+    if (outSize == 0) return 0;
+    OutBuff buff = {out, out + outSize - 1};
+
+    if (format == DUMP_JSON) putChar(buff, '{');
+    formatRange(values, firstReg, numRegs, format, buff);
+    if (format == DUMP_JSON) putChar(buff, '}');
+
+    *buff.pos = '\0';
+    return buff.pos - out;
+}
+
+size_t formatRegisterDump(int fd, const uint8_t *cfg, const uint8_t *status, DumpFormat format, char *out, size_t outSize) {
+    if (outSize == 0) return 0;
+    OutBuff buff = {out, out + outSize - 1};
+
+    if (format == DUMP_JSON) {
+        put(buff, "{\"fd\":"); putUint(buff, fd);
+        put(buff, ",\"config\":{");
+        formatRange(cfg, IOCFG2, NUM_CONFIG_REGS, format, buff);
+        put(buff, "},\"status\":{");
+        formatRange(status, FIRST_STATUS_REG, NUM_STATUS_REGS, format, buff);
+        put(buff, "}}\n");
+    } else {
+        put(buff, "========== config regs for fd: "); putUint(buff, fd); put(buff, " ==========\n");
+        formatRange(cfg, IOCFG2, NUM_CONFIG_REGS, format, buff);
+        put(buff, "========== status regs for fd: "); putUint(buff, fd); put(buff, " ==========\n");
+        formatRange(status, FIRST_STATUS_REG, NUM_STATUS_REGS, format, buff);
+    }
+
+    *buff.pos = '\0';
+    return buff.pos - out;
+}
+
+void dumpRegisters(int fd, DumpFormat format) {
+    static char dumpBuff[REGISTER_DUMP_BUFF_SIZE];
+    uint8_t cfg[NUM_CONFIG_REGS];
+    uint8_t status[NUM_STATUS_REGS];
+
+    if (!readAllRegisters(fd, cfg, status)) return;
+
+    size_t len = formatRegisterDump(fd, cfg, status, format, dumpBuff, sizeof(dumpBuff));
+    fwrite(dumpBuff, 1, len, stdout);
+}
@@ -0,0 +1,57 @@
+#ifndef REGISTER_MAP_H
+#define REGISTER_MAP_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// config space = 0x00-0x2E (47 regs), status space = 0x30-0x3D (14 regs)
+constexpr uint8_t NUM_CONFIG_REGS = 47;
+constexpr uint8_t NUM_STATUS_REGS = 14;
+constexpr uint8_t FIRST_STATUS_REG = 0x30;
+
+// one bit field of a register (datasheet section 29)
+struct RegisterField {
+    const char *name;
+    uint8_t reg;                    // register address
+    uint8_t msb;                    // highest bit of field
+    uint8_t lsb;                    // lowest bit of field
+    const char *const *enumNames;   // NULL = plain number, else 1 << width names (NULL entry = reserved)
+};
+
+// register name + slice of the field table belonging to it
+struct RegisterInfo {
+    const char *name;
+    uint8_t addr;
+    uint8_t firstField;
+    uint8_t numFields;
+};
+
+enum DumpFormat {
+    DUMP_TEXT,      // plain text, one line per register/field
+    DUMP_COLOR,     // same as text with ansi colors (terminal)
+    DUMP_JSON       // one json object
+};
+
+// big enough for a full config + status dump of one radio in any format
+constexpr size_t REGISTER_DUMP_BUFF_SIZE = 32 * 1024;
+
+const RegisterInfo *getRegisterInfo(uint8_t addr);   // NULL if not a config/status reg
+const RegisterField *getRegisterField(uint8_t index);
+uint8_t getNumRegisterFields();
+
+// read all 47 config regs in one burst / all 14 status regs in one ioctl
+bool readConfigSpace(int fd, uint8_t *cfg);
+bool readStatusSpace(int fd, uint8_t *status);
+// both in one SPI_IOC_MESSAGE (config burst + 14 status transfers)
+bool readAllRegisters(int fd, uint8_t *cfg, uint8_t *status);
+
+// format numRegs register values (values[i] belongs to firstReg + i) into out, returns length written
+size_t formatRegisters(const uint8_t *values, uint8_t firstReg, uint8_t numRegs, DumpFormat format, char *out, size_t outSize);
+
+// format config + status of one radio, returns length written
+size_t formatRegisterDump(int fd, const uint8_t *cfg, const uint8_t *status, DumpFormat format, char *out, size_t outSize);
+
+// read + format + print everything for one radio
+void dumpRegisters(int fd, DumpFormat format);
+
+#endif
@@ -0,0 +1,444 @@
+#include <string.h>             // memset(), memcpy(), strerror()
+#include <stdio.h>              // printf(), fprintf(), perror()
+#include <unistd.h>             // close(), sysconf()
+#include <pthread.h>            // pthread_setaffinity_np()
+#include <algorithm>            // std::max()
+#include <thread>
+
+#include "relay.h"
+#include "main_drivers.h"
+#include "helper_functions.h"   // calculateDataRate(), calculateFreqWord(), convertRSSI()
+#include "gpio_edges.h"         // gpioOpenEdges()
+#include "spi_util.h"           // spiXfer()
+#include "packet_io.h"          // packetReceive(), packetSend(), packetWaitTxEnd()
+#include "cc1101_sim.h"
+#include "futex.h"              // futexWait(), futexWake()
+#include "pacer.h"              // monotonicNs(), sleepUntil()
+#include "cc1101_config.h"
+
+uint64_t relayAirtimeNs(const uint8_t *regs, int payloadLen) {
+    static const uint8_t preambleBytes[8] = {2, 3, 4, 6, 8, 12, 16, 24};   // MDMCFG1.NUM_PREAMBLE
+    double rate = calculateDataRate(regs[MDMCFG4] & 0x0F, regs[MDMCFG3]);
+    int preamble = preambleBytes[(regs[MDMCFG1] >> 4) & 0x07];
+    int syncMode = regs[MDMCFG2] & 0x07;
+    int sync = (syncMode == 0 || syncMode == 4) ? 0 : (syncMode == 3 || syncMode == 7) ? 4 : 2;
+    int body = 1 + payloadLen + ((regs[PKTCTRL0] & 0x04) ? 2 : 0);     // length byte, CRC
+    if (regs[MDMCFG1] & 0x80) body = 2 * (body + body % 2);             // FEC: rate 1/2, interleaved in pairs
+    uint64_t bits = (uint64_t)(preamble + sync + body) * 8;
+    if (regs[MDMCFG2] & 0x08) bits *= 2;                                // Manchester
+    return (uint64_t)(bits * 1e9 / rate);
+}
+
+static const uint8_t *patableFor(uint32_t freqHz) {
+    if (freqHz < 348'000'000) return patable_power_315;
+    if (freqHz < 464'000'000) return patable_power_433;
+    if (freqHz < 891'500'000) return patable_power_868;
+    return patable_power_915;
+}
+
+void relayRegisters(uint8_t *regs, const uint8_t *profile, uint32_t freqHz, bool tx) {
+    memcpy(regs, profile, CFG_REGISTER);
+    regs[IOCFG2] = 0x06;                                    // asserts on sync word, deasserts at end of packet
+    regs[PKTCTRL0] = (regs[PKTCTRL0] & ~0x03) | 0x01;       // variable length
+    regs[PKTLEN] = RELAY_MAX_PAYLOAD;
+    regs[PKTCTRL1] |= 0x04;                                 // APPEND_STATUS (RSSI, LQI + CRC_OK)
+    if (tx) regs[MCSM1] = (regs[MCSM1] & ~0x03) | 0x01;     // TXOFF_MODE = FSTXON
+    else regs[MCSM1] |= 0x0C;                               // RXOFF_MODE = stay in RX
+    uint32_t word = calculateFreqWord(freqHz);
+    regs[FREQ2] = (word >> 16) & 0xFF;
+    regs[FREQ1] = (word >> 8) & 0xFF;
+    regs[FREQ0] = word & 0xFF;
+}
+
+bool relayTune(Radio &rx, Radio &tx, const uint8_t *profile, uint32_t rxFreqHz, uint32_t txFreqHz) {
+    uint8_t regs[CFG_REGISTER];
+    uint8_t fscal[3];
+    relayRegisters(regs, profile, rxFreqHz, false);
+    sendStrobe(rx.fd, SIDLE);
+    writeRegister(rx.fd, IOCFG2, regs, WRITE_BURST, CFG_REGISTER);
+    bool ok = calibrateSynthesizer(rx.fd, fscal, 5'000'000);
+    sendStrobe(rx.fd, SFRX);
+    sendStrobe(rx.fd, SRX);
+
+    relayRegisters(regs, profile, txFreqHz, true);
+    uint8_t patable[8];
+    memcpy(patable, patableFor(txFreqHz), 8);
+    if (((regs[MDMCFG2] >> 4) & 0x07) == 3) {               // OOK: PATABLE[0] = off, [1] = on
+        patable[1] = patable[7];
+        patable[0] = 0x00;
+    }
+    sendStrobe(tx.fd, SIDLE);
+    writeRegister(tx.fd, IOCFG2, regs, WRITE_BURST, CFG_REGISTER);
+    writeRegister(tx.fd, PATABLE_BURST, patable, 0, 8);
+    ok &= calibrateSynthesizer(tx.fd, fscal, 5'000'000);
+    sendStrobe(tx.fd, SFTX);
+    sendStrobe(tx.fd, SFSTXON);
+
+    uint8_t rxState = readRegister(rx.fd, MARCSTATE, READ_BURST, 1, NULL) & MARCSTATE_MASK;
+    uint8_t txState = readRegister(tx.fd, MARCSTATE, READ_BURST, 1, NULL) & MARCSTATE_MASK;
+    if (rxState != MARCSTATE_RX) fprintf(stderr, "ERROR: %s not in RX (MARCSTATE = 0x%02X)\n", rx.path, rxState);
+    if (txState != MARCSTATE_FSTXON) fprintf(stderr, "ERROR: %s not in FSTXON (MARCSTATE = 0x%02X)\n", tx.path, txState);
+    return ok && rxState == MARCSTATE_RX && txState == MARCSTATE_FSTXON;
+}
+
+bool relayInit(Relay &relay, Radio &rx, Radio &tx, const char *gpioChip, const RelayConfig &config) {
+    memset((void *)&relay, 0, sizeof(relay));
+    relay.config = config;
+    relay.rx = &rx;
+    relay.tx = &tx;
+    relay.gdoFd = -1;
+    if (gpioChip && rx.gdoLine >= 0) {
+        relay.gdoFd = gpioOpenEdges(gpioChip, rx.gdoLine, 0);
+        if (relay.gdoFd < 0) return false;
+    }
+
+    // airtime of every length from what B is actually configured to
+    uint8_t regs[1 + CFG_REGISTER] = {IOCFG2 | READ_BURST};
+    uint8_t values[1 + CFG_REGISTER];
+    struct spi_ioc_transfer xfer;
+    memset(&xfer, 0, sizeof(xfer));
+    xfer.tx_buf = (unsigned long)regs;
+    xfer.rx_buf = (unsigned long)values;
+    xfer.len = 1 + CFG_REGISTER;
+    if (spiXfer(relay.config.transfer, tx.fd, &xfer, 1) < 0) {
+        relayClose(relay);
+        return false;
+    }
+    for (int len = 0; len <= RELAY_MAX_PAYLOAD; len++) relay.txAirtimeNs[len] = relayAirtimeNs(values + 1, len);
+
+    uint8_t txState = readRegisterWithStatus(tx.fd, MARCSTATE, READ_BURST, NULL, relay.config.transfer) & MARCSTATE_MASK;
+    if (txState != MARCSTATE_FSTXON)
+        fprintf(stderr, "WARNING: %s not in FSTXON (MARCSTATE = 0x%02X), first TX pays for calibration\n",
+                tx.path, txState);
+    return true;
+}
+
+void relayClose(Relay &relay) {
+    if (relay.gdoFd >= 0) close(relay.gdoFd);
+    relay.gdoFd = -1;
+}
+
+static RealtimeStatus pinRelayThread(const Relay &relay, int cpu, int shard, const char *name) {
+    RealtimeStatus status = {false, false, -1};
+    if (relay.config.realtime.enabled) {
+        RealtimeConfig realtime = relay.config.realtime;
+        realtime.cpu = cpu;
+        status = enterRealtime(realtime, shard, cpu);
+        printf("relay %s: %s, cpu %d%s\n", name, status.fifo ? "SCHED_FIFO" : "SCHED_OTHER", status.cpu,
+               status.pinned ? "" : " (not pinned)");
+    } else if (cpu >= 0) {
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        CPU_SET(cpu, &set);
+        int err = pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+        if (err) fprintf(stderr, "WARNING: relay %s could not pin to cpu %d (%s)\n", name, cpu, strerror(err));
+    }
+    return status;
+}
+
+struct RelayRx {
+    Relay *relay;
+    RelaySlot scratch;                      // read into when the ring is full, then dropped
+};
+
+// straight into the next ring slot: frame[1] = chip status, payload from frame[2]
+static uint8_t *relaySlot(void *ctx) {
+    RelayRx &rx = *(RelayRx *)ctx;
+    Relay &relay = *rx.relay;
+    uint32_t head = relay.head;
+    bool full = head - __atomic_load_n(&relay.tail, __ATOMIC_ACQUIRE) >= RELAY_SLOTS;
+    return (full ? rx.scratch.frame : relay.slots[head % RELAY_SLOTS].frame) + 1;
+}
+
+static void relayReceived(void *ctx, uint8_t *buf, uint8_t len, uint64_t eop_ns) {
+    RelayRx &rx = *(RelayRx *)ctx;
+    Relay &relay = *rx.relay;
+    RelayStats &stats = relay.stats;
+    stats.received++;
+    uint8_t status = buf[2 + len];
+    if (!(status & 0x80)) {
+        stats.crcFail++;
+        return;
+    }
+    if (buf == rx.scratch.frame + 1) {
+        stats.overruns++;
+        return;
+    }
+    uint32_t head = relay.head;
+    RelaySlot &slot = relay.slots[head % RELAY_SLOTS];
+    slot.len = len;
+    slot.frame[1] = len;
+    slot.rssiDbm = convertRSSI(buf[1 + len]);
+    slot.lqi = status & 0x7F;
+    slot.eop_ns = eop_ns;
+    slot.ready_ns = monotonicNs();
+    if (eop_ns) histogramAdd(stats.rxLatency, slot.ready_ns - eop_ns);
+
+    __atomic_store_n(&relay.head, head + 1, __ATOMIC_SEQ_CST);
+    if (__atomic_load_n(&relay.sleeping, __ATOMIC_SEQ_CST)) futexWake(&relay.head);
+}
+
+static void rxThread(Relay &relay) {
+    int cpu = relay.config.rxCpu >= 0 ? relay.config.rxCpu : relay.rx->cpu;
+    RealtimeStatus status = pinRelayThread(relay, cpu, 0, "rx");
+
+    RelayRx ctx;
+    ctx.relay = &relay;
+    PacketRx rx;
+    rx.fd = relay.rx->fd;
+    rx.transfer = relay.config.transfer;
+    rx.gdoFd = relay.gdoFd;
+    rx.pollNs = relay.config.pollNs;
+    rx.recalNs = relay.config.recalNs;
+    rx.stop = &relay.stop;
+    rx.buffer = relaySlot;
+    rx.received = relayReceived;
+    rx.ctx = &ctx;
+    packetReceive(rx);
+    relay.stats.received += rx.dropped;                     // the chip dropped them: bad CRC
+    relay.stats.crcFail += rx.dropped;
+    relay.stats.rxErrors += rx.flushes;
+    exitRealtime(status);
+}
+
+// IDLE -> FSTXON calibrates again (MCSM0.FS_AUTOCAL)
+static void recalibrateTx(const Relay &relay) {
+    static const uint8_t strobes[2] = {SIDLE, SFSTXON};
+    sendStrobes(relay.tx->fd, strobes, 2, 2, NULL, relay.config.transfer);
+}
+
+static void txThread(Relay &relay) {
+    int cpu = relay.config.txCpu >= 0 ? relay.config.txCpu : relay.tx->cpu;
+    RealtimeStatus status = pinRelayThread(relay, cpu, 1, "tx");
+
+    RelayStats &stats = relay.stats;
+    const RelayConfig &config = relay.config;
+    uint32_t tail = relay.tail;
+    uint64_t lastStx = 0, lastEnd = 0;
+    uint64_t lastRecal = monotonicNs();
+
+    for (;;) {
+        if (__atomic_load_n(&relay.head, __ATOMIC_ACQUIRE) == tail) {
+            if (__atomic_load_n(&relay.stop, __ATOMIC_ACQUIRE)) break;
+            uint64_t spinEnd = monotonicNs() + config.spinNs;
+            while (__atomic_load_n(&relay.head, __ATOMIC_ACQUIRE) == tail && monotonicNs() < spinEnd) {}
+            if (__atomic_load_n(&relay.head, __ATOMIC_ACQUIRE) != tail) continue;
+
+            __atomic_store_n(&relay.sleeping, 1, __ATOMIC_SEQ_CST);
+            struct timespec timeout = {0, 100'000'000};
+            futexWait(&relay.head, tail, &timeout);         // returns at once if head moved since
+            __atomic_store_n(&relay.sleeping, 0, __ATOMIC_SEQ_CST);
+
+            uint64_t now = monotonicNs();
+            if (config.recalNs && __atomic_load_n(&relay.head, __ATOMIC_ACQUIRE) == tail &&
+                now - lastRecal >= config.recalNs) {
+                recalibrateTx(relay);
+                lastRecal = now;
+            }
+            continue;
+        }
+
+        RelaySlot &slot = relay.slots[tail % RELAY_SLOTS];
+        uint64_t taken = monotonicNs();
+        histogramAdd(stats.handoff, taken - slot.ready_ns);
+
+        uint8_t len = slot.len;
+        if (config.txAddress >= 0) slot.frame[2] = config.txAddress;
+        bool keep = !config.rewrite || config.rewrite(slot.frame + 2, &len, config.rewriteCtx);
+        if (!keep || len == 0 || len > RELAY_MAX_PAYLOAD) {
+            stats.dropped++;
+            __atomic_store_n(&relay.tail, ++tail, __ATOMIC_RELEASE);
+            continue;
+        }
+
+        // TX FIFO burst write + STX in one message
+        bool sent = packetSend(relay.tx->fd, config.transfer, slot.frame, len);
+        uint64_t done = monotonicNs();
+
+        // it was waiting when the last packet ended: STX to STX is all relay work + airtime
+        if (lastStx && slot.ready_ns <= lastEnd) {
+            stats.busyCycles++;
+            stats.busyNs += done - lastStx;
+        }
+        if (sent) {
+            stats.forwarded++;
+            histogramAdd(stats.txLatency, done - taken);
+            if (slot.eop_ns) histogramAdd(stats.latency, done - slot.eop_ns);
+        }
+        __atomic_store_n(&relay.tail, ++tail, __ATOMIC_RELEASE);
+
+        // back to FSTXON after the packet (TXOFF_MODE)
+        if (sent && !packetWaitTxEnd(relay.tx->fd, config.transfer, done, relay.txAirtimeNs[len])) stats.txTimeouts++;
+        lastStx = done;
+        lastEnd = monotonicNs();
+    }
+    exitRealtime(status);
+}
+
+void relayRun(Relay &relay, double seconds) {
+    int rxCpu = relay.config.rxCpu >= 0 ? relay.config.rxCpu : relay.rx->cpu;
+    int txCpu = relay.config.txCpu >= 0 ? relay.config.txCpu : relay.tx->cpu;
+    if (rxCpu >= 0 && rxCpu == txCpu) fprintf(stderr, "WARNING: relay rx and tx thread share cpu %d\n", rxCpu);
+
+    relay.head = relay.tail = 0;
+    relay.sleeping = 0;
+    relay.stop = false;
+    relay.stats = RelayStats{};
+    histogramInit(relay.stats.rxLatency, 0, 10'000);       // 10 us bins, 0..640 us
+    histogramInit(relay.stats.handoff, 0, 10'000);
+    histogramInit(relay.stats.txLatency, 0, 10'000);
+    histogramInit(relay.stats.latency, 0, 25'000);         // 25 us bins, 0..1.6 ms
+
+    std::thread tx(txThread, std::ref(relay));
+    std::thread rx(rxThread, std::ref(relay));
+    sleepUntil(monotonicNs() + (uint64_t)(seconds * 1e9));
+    __atomic_store_n(&relay.stop, true, __ATOMIC_RELEASE);
+    rx.join();
+    futexWake(&relay.head);
+    tx.join();
+}
+
+static void printLatency(const char *name, const Histogram &h) {
+    printf("    %-22s mean %7.1f us  p50 %6.0f us  p99 %6.0f us  max %7.0f us\n", name, histogramMean(h) / 1e3,
+           histogramPercentile(h, 50) / 1e3, std::min(histogramPercentile(h, 99), h.max_ns) / 1e3, h.max_ns / 1e3);
+}
+
+void printRelayStats(const Relay &relay, double seconds) {
+    const RelayStats &stats = relay.stats;
+    printf("relay %s -> %s: %llu received (%llu CRC fail, %llu rx errors, %llu overruns), %llu forwarded "
+           "(%llu dropped, %llu tx timeouts), %.1f packets/s\n",
+           relay.rx->path, relay.tx->path, (unsigned long long)stats.received, (unsigned long long)stats.crcFail,
+           (unsigned long long)stats.rxErrors, (unsigned long long)stats.overruns,
+           (unsigned long long)stats.forwarded, (unsigned long long)stats.dropped,
+           (unsigned long long)stats.txTimeouts, seconds > 0 ? stats.forwarded / seconds : 0.0);
+    printLatency("end of packet -> STX", stats.latency);
+    printLatency("  read from A", stats.rxLatency);
+    printLatency("  handoff", stats.handoff);
+    printLatency("  TX FIFO + STX", stats.txLatency);
+    if (stats.busyCycles)
+        printf("    back to back: %.1f us per packet, max %.1f packets/s\n", stats.busyNs / 1e3 / stats.busyCycles,
+               stats.busyCycles * 1e9 / stats.busyNs);
+}
+
+// simulated radio pair (cc1101_sim.h): packets from outside end on A, B sends on air to nobody
+constexpr uint8_t SIM_RX_ADDRESS = 0x01;
+constexpr uint8_t SIM_TX_ADDRESS = 0x02;
+
+struct RelaySimCheck {
+    uint8_t len;
+    uint32_t nextSeq;
+    uint64_t corrupt;
+};
+
+// what B puts on air: the packet A got, address rewritten
+static void simCheckTx(const uint8_t *payload, uint8_t len, void *ctx) {
+    RelaySimCheck &check = *(RelaySimCheck *)ctx;
+    uint32_t seq = payload[1] | payload[2] << 8 | payload[3] << 16 | (uint32_t)payload[4] << 24;
+    bool ok = len == check.len && payload[0] == SIM_TX_ADDRESS && seq >= check.nextSeq;
+    for (int i = 5; ok && i < len; i++) ok = payload[i] == simPacketByte(SIM_RX_ADDRESS, seq, i);
+    if (!ok) check.corrupt++;
+    check.nextSeq = seq + 1;
+}
+
+// a packet ends on A every periodNs
+static void simInject(Sim &sim, uint8_t len, uint64_t periodNs, uint64_t end_ns) {
+    uint8_t payload[RELAY_MAX_PAYLOAD];
+    uint32_t seq = 0;
+    for (uint64_t t = monotonicNs() + periodNs; t < end_ns; t += periodNs, seq++) {
+        for (int i = 0; i < len; i++) payload[i] = simPacketByte(SIM_RX_ADDRESS, seq, i);
+        sleepUntil(t);
+        simReceive(sim, 0, payload, len);
+    }
+}
+
+static bool simRun(Relay &relay, const uint8_t *profile, int payloadLen, uint64_t periodNs, double seconds,
+                   const RelayConfig &config, Radio &rx, Radio &tx, RelaySimCheck &check) {
+    Sim *sim = new Sim;
+    simInit(*sim, 2, 1);
+    SimRadio &a = sim->radios[0];
+    SimRadio &b = sim->radios[1];
+    relayRegisters(a.regs, profile, 433'920'000, false);
+    relayRegisters(b.regs, profile, 433'920'000, true);
+    a.state = MARCSTATE_RX;
+    b.state = MARCSTATE_FSTXON;
+    check = RelaySimCheck{(uint8_t)payloadLen, 0, 0};
+    b.txHook = simCheckTx;
+    b.txHookCtx = &check;
+
+    int gdoFd = simWireGdo(*sim, 0);
+    bool ok = gdoFd >= 0 && simStart(*sim);
+    if (ok && relayInit(relay, rx, tx, NULL, config)) {
+        relay.gdoFd = gdoFd;                                // relayClose() closes it
+        std::thread inject(simInject, std::ref(*sim), (uint8_t)payloadLen, periodNs,
+                           monotonicNs() + (uint64_t)(seconds * 1e9));
+        relayRun(relay, seconds + 0.05);                    // + the last packet's way through
+        inject.join();
+        relayClose(relay);
+    } else {
+        ok = false;
+        if (gdoFd >= 0) close(gdoFd);
+    }
+    if (sim->air.joinable()) simStop(*sim);
+    delete sim;
+    return ok;
+}
+
+void benchmarkRelay(int payloadLen, double seconds) {
+    struct Profile {
+        const char *name;
+        const uint8_t *regs;
+    };
+    const Profile profiles[] = {
+        {"GFSK 1.2k", cc1100_GFSK_1_2_kb},  {"GFSK 38.4k", cc1100_GFSK_38_4_kb}, {"GFSK 100k", cc1100_GFSK_100_kb},
+        {"MSK 250k", cc1100_MSK_250_kb},    {"MSK 500k", cc1100_MSK_500_kb},     {"OOK 4.8k", cc1100_OOK_4_8_kb},
+    };
+    if (payloadLen < 5) payloadLen = 5;                     // address + sequence number
+    if (payloadLen > RELAY_MAX_PAYLOAD) payloadLen = RELAY_MAX_PAYLOAD;
+
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    RelayConfig config;
+    config.txAddress = SIM_TX_ADDRESS;
+    config.spinNs = cpus > 1 ? 50'000 : 0;                  // spinning on a shared cpu only delays the rx thread
+    config.recalNs = 0;
+    config.transfer = simTransfer;
+    Radio rx = {}, tx = {};
+    snprintf(rx.path, sizeof(rx.path), "sim A");
+    snprintf(tx.path, sizeof(tx.path), "sim B");
+    rx.fd = simFd(0);
+    tx.fd = simFd(1);
+    rx.cpu = cpus > 1 ? 0 : -1;
+    tx.cpu = cpus > 1 ? 1 : -1;
+
+    printf("relay: simulated radio pair (20 us/ioctl, 5 MHz SPI), %d byte payload, %ld cpu(s), handoff %s\n",
+           payloadLen, cpus, config.spinNs ? "spin + futex" : "futex");
+    printf("  %-10s %9s %10s %11s   latency at half the max rate: end of packet -> STX\n", "profile",
+           "airtime", "line rate", "max relay");
+
+    Relay *relay = new Relay;
+    RelaySimCheck check;
+    for (const Profile &p : profiles) {
+        uint64_t airtime = relayAirtimeNs(p.regs, payloadLen);
+        double runSeconds = std::max(seconds, 20 * airtime / 1e9);
+
+        // A receives back to back, B can't keep up (same airtime + relay work): the busy cycles
+        // give the max sustained rate
+        if (!simRun(*relay, p.regs, payloadLen, airtime, runSeconds, config, rx, tx, check)) break;
+        const RelayStats &saturated = relay->stats;
+        double maxRate = saturated.busyCycles ? saturated.busyCycles * 1e9 / saturated.busyNs
+                                              : saturated.forwarded / runSeconds;
+        uint64_t corrupt = check.corrupt;
+
+        uint64_t period = (uint64_t)(2e9 / maxRate);
+        if (!simRun(*relay, p.regs, payloadLen, period, std::max(seconds, 20 * period / 1e9), config, rx, tx, check)) break;
+        const RelayStats &half = relay->stats;
+        corrupt += check.corrupt;
+        printf("  %-10s %7.2f ms %8.1f/s %9.1f/s   p50 %4.0f us  p99 %4.0f us  max %5.0f us  "
+               "(read %.0f + handoff %.0f + tx %.0f us p50)%s%s\n",
+               p.name, airtime / 1e6, 1e9 / airtime, maxRate, histogramPercentile(half.latency, 50) / 1e3,
+               std::min(histogramPercentile(half.latency, 99), half.latency.max_ns) / 1e3,
+               half.latency.max_ns / 1e3, histogramPercentile(half.rxLatency, 50) / 1e3,
+               histogramPercentile(half.handoff, 50) / 1e3, histogramPercentile(half.txLatency, 50) / 1e3,
+               half.forwarded + half.overruns < half.received ? "  (LOST)" : "", corrupt ? "  (DATA MISMATCH)" : "");
+    }
+    delete relay;
+}
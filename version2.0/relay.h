@@ -0,0 +1,118 @@
+#ifndef RELAY_H
+#define RELAY_H
+
+#include <stdint.h>
+
+#include "device_manager.h"
+#include "capture_timing.h"     // Histogram
+#include "realtime.h"
+#include "spi_queue.h"          // SpiTransferFn
+#include "packet_io.h"          // PACKET_MAX_PAYLOAD
+
+// Relay: radio A receives, radio B sends every good packet on (e.g. between two bands)
+//
+//   rx thread (radio A)                             tx thread (radio B)
+//   GDO2 falling edge = end of packet (0x06)
+//   length byte, FIFO burst read straight   --->   header rewrite in place, then one ioctl:
+//   into the next ring slot                 slot   TX FIFO burst write + STX
+//
+// A slot is laid out the way both transfers need it: the burst read lands at frame + 1 (chip
+// status byte, payload, RSSI, LQI) and the TX FIFO write goes out from frame[0] (header, length,
+// payload), so the packet is never copied between the two ioctls (packet_io.h reads into and
+// sends from the slot). The ring is single producer, single consumer; the tx thread busy polls
+// it for spinNs, then sleeps on a futex.
+//
+// Radio B waits in FSTXON (MCSM1.TXOFF_MODE) with the synthesizer already calibrated, so STX
+// puts the preamble on air within a few us instead of after an IDLE -> TX calibration (~800 us).
+// Strobes in the hot path are plain transfers (no sendStrobe() settling sleeps).
+//
+// latency = end of packet on A (GPIO event timestamp, CLOCK_MONOTONIC) to the STX ioctl returned,
+// only measured with a GDO line (polling RXBYTES doesn't tell when the packet ended)
+
+constexpr int RELAY_SLOTS = 64;             // power of two
+constexpr int RELAY_MAX_PAYLOAD = PACKET_MAX_PAYLOAD;
+
+// header rewrite, in place on the tx thread: payload = address + data, *len may change
+// (up to RELAY_MAX_PAYLOAD), false = drop the packet
+typedef bool (*RelayRewrite)(uint8_t *payload, uint8_t *len, void *ctx);
+
+struct RelayConfig {
+    int txAddress = -1;                     // >= 0: overwrite the address byte (payload[0]) first
+    RelayRewrite rewrite = NULL;
+    void *rewriteCtx = NULL;
+    int64_t spinNs = 50'000;                // tx thread polls the ring this long before sleeping, 0 = always sleep
+    uint64_t pollNs = 50'000;               // RXBYTES poll period of radio A without a GDO line
+    uint64_t recalNs = 60'000'000'000;      // recalibrate a radio when idle this often, 0 = never
+    int rxCpu = -1;                         // -1 = Radio::cpu of the rx radio
+    int txCpu = -1;
+    RealtimeConfig realtime;                // enabled = SCHED_FIFO for both threads
+    SpiTransferFn transfer = NULL;          // NULL = spiTransfer()
+};
+
+struct RelaySlot {
+    uint64_t eop_ns;                        // end of packet on A (edge timestamp), 0 = not known (polled)
+    uint64_t ready_ns;                      // published to the ring
+    float rssiDbm;
+    uint8_t lqi;
+    uint8_t len;                            // payload bytes
+    uint8_t frame[2 + 64];                  // TX FIFO header, length, payload (+ RSSI, LQI as read)
+};
+
+struct RelayStats {
+    // rx thread
+    uint64_t received;                      // packets read from A
+    uint64_t crcFail;
+    uint64_t rxErrors;                      // bad length, overflow, FIFO stuck: A flushed
+    uint64_t overruns;                      // ring full, packet dropped
+    Histogram rxLatency;                    // end of packet -> in the ring
+
+    // tx thread
+    uint64_t forwarded;
+    uint64_t dropped;                       // by the rewrite
+    uint64_t txTimeouts;                    // B didn't get back to FSTXON, recovered
+    uint64_t busyCycles;                    // STX to STX with the next packet already waiting
+    uint64_t busyNs;
+    Histogram handoff;                      // in the ring -> taken by the tx thread
+    Histogram txLatency;                    // taken -> STX done
+    Histogram latency;                      // end of packet -> STX done
+};
+
+struct Relay {
+    RelayConfig config;
+    Radio *rx;
+    Radio *tx;
+    int gdoFd;                              // GPIO line events of rx->gdoLine, -1 = poll RXBYTES
+    uint64_t txAirtimeNs[RELAY_MAX_PAYLOAD + 1];    // by payload length, from B's registers
+
+    RelaySlot slots[RELAY_SLOTS];
+    alignas(64) uint32_t head;              // written by the rx thread only
+    uint32_t sleeping;                      // tx thread sleeps on head
+    alignas(64) uint32_t tail;              // written by the tx thread only
+    bool stop;
+
+    RelayStats stats;
+};
+
+// time on air of one variable length packet (preamble, sync, length byte, payload, CRC) with
+// the modem and packet settings of regs (a profile or a radio's registers)
+uint64_t relayAirtimeNs(const uint8_t *regs, int payloadLen);
+
+// profile at freqHz for the relay: GDO2 = end of packet, variable length, APPEND_STATUS, and
+// RXOFF_MODE = RX (rx) or TXOFF_MODE = FSTXON (tx)
+void relayRegisters(uint8_t *regs, const uint8_t *profile, uint32_t freqHz, bool tx);
+// A: relayRegisters() at rxFreqHz, RX. B: relayRegisters() at txFreqHz, PATABLE of that band,
+// calibrated and waiting in FSTXON
+bool relayTune(Radio &rx, Radio &tx, const uint8_t *profile, uint32_t rxFreqHz, uint32_t txFreqHz);
+
+// gpioChip: where rx.gdoLine lives, NULL = poll RXBYTES instead
+bool relayInit(Relay &relay, Radio &rx, Radio &tx, const char *gpioChip, const RelayConfig &config);
+void relayClose(Relay &relay);
+// rx and tx thread for seconds (each pinned to its cpu), returns when both stopped
+void relayRun(Relay &relay, double seconds);
+void printRelayStats(const Relay &relay, double seconds);
+
+// simulated radio pair per profile (cc1101_sim.h):
+// max sustained relay rate with A receiving back to back, latency distribution at half that rate
+void benchmarkRelay(int payloadLen, double seconds);
+
+#endif
@@ -0,0 +1,427 @@
+#include <string.h>             // memcpy(), memset()
+#include <algorithm>            // std::upper_bound()
+
+#include "rssi_codec.h"
+
+// everything is stored little endian (Pi and x86 both are), so plain memcpy in/out
+template <typename T> static inline void putLE(uint8_t *p, T v) { memcpy(p, &v, sizeof(T)); }
+template <typename T> static inline T getLE(const uint8_t *p) { T v; memcpy(&v, p, sizeof(T)); return v; }
+
+static inline uint8_t zigzag8(uint8_t a, uint8_t b) {
+    int8_t d = (int8_t)(uint8_t)(b - a);
+    return (uint8_t)((d << 1) ^ (d >> 7));
+}
+
+static inline size_t putVarint(uint8_t *p, uint64_t v) {
+    size_t n = 0;
+    while (v >= 0x80) { p[n++] = (uint8_t)v | 0x80; v >>= 7; }
+    p[n++] = (uint8_t)v;
+    return n;
+}
+
+static inline size_t varintLen(uint64_t v) {
+    size_t n = 1;
+    while (v >= 0x80) { v >>= 7; n++; }
+    return n;
+}
+
+// false = ran off the end of the buffer
+static inline bool getVarint(const uint8_t *&p, const uint8_t *end, uint64_t &v) {
+    v = 0;
+    for (int shift = 0; p < end && shift < 64; shift += 7) {
+        uint8_t b = *p++;
+        v |= (uint64_t)(b & 0x7F) << shift;
+        if (!(b & 0x80)) return true;
+    }
+    return false;
+}
+
+// ===================== encode =====================
+
+size_t encodeBlock(const RssiSample *samples, int numSamples, bool timestamps, uint8_t *out) {
+    if (numSamples < 1 || numSamples > CODEC_BLOCK_SAMPLES) return 0;
+    int numDeltas = numSamples - 1;
+
+    uint8_t z[CODEC_BLOCK_SAMPLES];
+    uint8_t widest = 0;
+    size_t rleBytes = 0;
+    for (int i = 0; i < numDeltas; i++) {
+        z[i] = zigzag8(samples[i].raw, samples[i + 1].raw);
+        widest |= z[i];
+    }
+    for (int i = 0; i < numDeltas;) {
+        int run = 1;
+        while (i + run < numDeltas && z[i + run] == z[i]) run++;
+        rleBytes += 1 + varintLen(run);
+        i += run;
+    }
+
+    uint8_t width = 0;
+    while (widest >> width) width++;
+    size_t packBytes = ((size_t)numDeltas * width + 7) / 8;
+    CodecMode mode = (rleBytes < packBytes) ? CODEC_RLE : CODEC_BITPACK;
+
+    uint8_t *p = out + CODEC_BLOCK_HEADER;
+    if (mode == CODEC_BITPACK) {
+        uint64_t acc = 0;
+        int bits = 0;
+        for (int i = 0; i < numDeltas; i++) {
+            acc |= (uint64_t)z[i] << bits;
+            bits += width;
+            while (bits >= 8) { *p++ = (uint8_t)acc; acc >>= 8; bits -= 8; }
+        }
+        if (bits) *p++ = (uint8_t)acc;
+    } else {
+        for (int i = 0; i < numDeltas;) {
+            int run = 1;
+            while (i + run < numDeltas && z[i + run] == z[i]) run++;
+            *p++ = z[i];
+            p += putVarint(p, run);
+            i += run;
+        }
+    }
+
+    uint64_t t_first = samples[0].t_ns;
+    uint64_t t_last = samples[numDeltas].t_ns;
+    if (timestamps && numDeltas) {
+        int64_t nominal = (int64_t)(t_last - t_first) / numDeltas;
+        for (int i = 1; i < numSamples; i++) {
+            int64_t r = (int64_t)(samples[i].t_ns - samples[i - 1].t_ns) - nominal;
+            p += putVarint(p, ((uint64_t)r << 1) ^ (uint64_t)(r >> 63));
+        }
+    }
+
+    size_t payload = p - (out + CODEC_BLOCK_HEADER);
+    memset(out, 0, CODEC_BLOCK_HEADER);
+    out[0] = mode;
+    out[1] = width;
+    out[2] = timestamps ? CODEC_FLAG_TIMESTAMPS : 0;
+    out[3] = samples[0].raw;
+    putLE<uint16_t>(out + 4, (uint16_t)numSamples);
+    putLE<uint32_t>(out + 8, (uint32_t)payload);
+    putLE<uint64_t>(out + 16, t_first);
+    putLE<uint64_t>(out + 24, t_last);
+    return CODEC_BLOCK_HEADER + payload;
+}
+
+// ===================== decode =====================
+
+typedef uint8_t v16u8 __attribute__((vector_size(16)));
+
+static inline v16u8 load16(const uint8_t *p) { v16u8 v; memcpy(&v, p, 16); return v; }
+static inline void store16(uint8_t *p, v16u8 v) { memcpy(p, &v, 16); }
+
+// inclusive prefix sum of 16 bytes (mod 256) in 4 shift + add steps
+static inline v16u8 prefix16(v16u8 v) {
+    const v16u8 zero = {};
+    v += __builtin_shuffle(zero, v, (v16u8){0, 16, 17, 18, 19, 20, 21, 22, 23, 24, 25, 26, 27, 28, 29, 30});
+    v += __builtin_shuffle(zero, v, (v16u8){0, 0, 16, 17, 18, 19, 20, 21, 22, 23, 24, 25, 26, 27, 28, 29});
+    v += __builtin_shuffle(zero, v, (v16u8){0, 0, 0, 0, 16, 17, 18, 19, 20, 21, 22, 23, 24, 25, 26, 27});
+    v += __builtin_shuffle(zero, v, (v16u8){0, 0, 0, 0, 0, 0, 0, 0, 16, 17, 18, 19, 20, 21, 22, 23});
+    return v;
+}
+
+static bool unpackDeltas(const uint8_t *p, const uint8_t *end, uint8_t mode, uint8_t width, int numDeltas, uint8_t *z) {
+    if (mode == CODEC_RLE) {
+        int i = 0;
+        while (i < numDeltas) {
+            if (p >= end) return false;
+            uint8_t value = *p++;
+            uint64_t run;
+            if (!getVarint(p, end, run) || run > (uint64_t)(numDeltas - i)) return false;
+            memset(z + i, value, run);
+            i += run;
+        }
+        return true;
+    }
+
+    if (width > 8 || (size_t)(end - p) < ((size_t)numDeltas * width + 7) / 8) return false;
+    switch (width) {
+        case 0: memset(z, 0, numDeltas); break;
+        case 8: memcpy(z, p, numDeltas); break;
+        case 4:
+            for (int i = 0; i < numDeltas / 2; i++) { z[2 * i] = p[i] & 0x0F; z[2 * i + 1] = p[i] >> 4; }
+            if (numDeltas & 1) z[numDeltas - 1] = p[numDeltas / 2] & 0x0F;
+            break;
+        case 2:
+            for (int i = 0; i < numDeltas; i++) z[i] = (p[i >> 2] >> ((i & 3) * 2)) & 0x03;
+            break;
+        case 1:
+            for (int i = 0; i < numDeltas; i++) z[i] = (p[i >> 3] >> (i & 7)) & 0x01;
+            break;
+        default: {
+            uint64_t acc = 0;
+            int bits = 0;
+            uint8_t mask = (1 << width) - 1;
+            for (int i = 0; i < numDeltas; i++) {
+                while (bits < width) { acc |= (uint64_t)*p++ << bits; bits += 8; }
+                z[i] = acc & mask;
+                acc >>= width;
+                bits -= width;
+            }
+        }
+    }
+    return true;
+}
+
+// header + deltas -> raw bytes, returns sample count (0 = corrupt), payload end of the deltas in *tsStart
+static int decodeRaw(const uint8_t *in, size_t len, uint8_t *raw, const uint8_t **tsStart) {
+    if (len < CODEC_BLOCK_HEADER) return 0;
+    uint8_t mode = in[0], width = in[1];
+    int numSamples = getLE<uint16_t>(in + 4);
+    uint32_t payload = getLE<uint32_t>(in + 8);
+    if (numSamples < 1 || numSamples > CODEC_BLOCK_SAMPLES || CODEC_BLOCK_HEADER + payload > len) return 0;
+
+    const uint8_t *p = in + CODEC_BLOCK_HEADER;
+    const uint8_t *end = p + payload;
+    int numDeltas = numSamples - 1;
+
+    // unpack the zigzag deltas straight into raw[1..]
+    if (!unpackDeltas(p, end, mode, width, numDeltas, raw + 1)) return 0;
+    if (tsStart) {
+        if (mode == CODEC_RLE) {
+            int i = 0;
+            while (i < numDeltas) { p++; uint64_t run; getVarint(p, end, run); i += run; }
+            *tsStart = p;
+        } else {
+            *tsStart = p + ((size_t)numDeltas * width + 7) / 8;
+        }
+    }
+
+    // zigzag -> delta -> running sum, 16 at a time
+    raw[0] = in[3];
+    uint8_t prev = raw[0];
+    int i = 1;
+    for (; i + 16 <= numSamples; i += 16) {
+        v16u8 zz = load16(raw + i);
+        v16u8 d = (zz >> 1) ^ ((v16u8){} - (zz & 1));
+        v16u8 sum = prefix16(d) + prev;
+        store16(raw + i, sum);
+        prev = sum[15];
+    }
+    for (; i < numSamples; i++) {
+        uint8_t zz = raw[i];
+        prev += (uint8_t)((zz >> 1) ^ (uint8_t)-(zz & 1));
+        raw[i] = prev;
+    }
+    return numSamples;
+}
+
+int decodeBlockRaw(const uint8_t *in, size_t len, uint8_t *raw) {
+    return decodeRaw(in, len, raw, NULL);
+}
+
+int decodeBlock(const uint8_t *in, size_t len, RssiSample *out) {
+    uint8_t raw[CODEC_BLOCK_SAMPLES + 16];
+    const uint8_t *ts = NULL;
+    int numSamples = decodeRaw(in, len, raw, &ts);
+    if (!numSamples) return 0;
+
+    uint64_t t_first = getLE<uint64_t>(in + 16);
+    uint64_t t_last = getLE<uint64_t>(in + 24);
+    int numDeltas = numSamples - 1;
+    int64_t nominal = numDeltas ? (int64_t)(t_last - t_first) / numDeltas : 0;
+
+    out[0] = {t_first, raw[0]};
+    if (in[2] & CODEC_FLAG_TIMESTAMPS) {
+        const uint8_t *end = in + CODEC_BLOCK_HEADER + getLE<uint32_t>(in + 8);
+        uint64_t t = t_first;
+        for (int i = 1; i < numSamples; i++) {
+            uint64_t zz;
+            if (!getVarint(ts, end, zz)) return 0;
+            int64_t r = (int64_t)(zz >> 1) ^ -(int64_t)(zz & 1);
+            t += nominal + r;
+            out[i] = {t, raw[i]};
+        }
+    } else {
+        // t_first + span * i / numDeltas without the divide per sample
+        uint64_t span = t_last - t_first;
+        uint64_t step = numDeltas ? span / numDeltas : 0, rem = numDeltas ? span % numDeltas : 0;
+        uint64_t t = t_first, frac = 0;
+        for (int i = 1; i < numSamples; i++) {
+            t += step;
+            frac += rem;
+            if (frac >= (uint64_t)numDeltas) { t++; frac -= numDeltas; }
+            out[i] = {t, raw[i]};
+        }
+    }
+    return numSamples;
+}
+
+// ===================== encoder / file =====================
+
+void encoderInit(RssiEncoder &enc) {
+    enc.data.clear();
+    enc.index.clear();
+    memset(enc.samplesPerRadio, 0, sizeof(enc.samplesPerRadio));
+}
+
+void encoderAdd(RssiEncoder &enc, uint8_t radio, const RssiSample *samples, int numSamples, bool timestamps) {
+    uint8_t block[CODEC_MAX_BLOCK_BYTES];
+
+    for (int i = 0; i < numSamples; i += CODEC_BLOCK_SAMPLES) {
+        int n = (numSamples - i < CODEC_BLOCK_SAMPLES) ? numSamples - i : CODEC_BLOCK_SAMPLES;
+        size_t bytes = encodeBlock(samples + i, n, timestamps, block);
+
+        enc.index.push_back({radio, enc.samplesPerRadio[radio], enc.data.size(), samples[i].t_ns});
+        enc.data.insert(enc.data.end(), block, block + bytes);
+        enc.samplesPerRadio[radio] += n;
+    }
+}
+
+constexpr size_t RSSC_HEADER = 8;
+constexpr size_t RSSC_INDEX_ENTRY = 25;
+
+bool writeRssc(const char *filename, const RssiEncoder &enc, uint16_t numRadios) {
+    FILE *f = fopen(filename, "wb");
+    if (!f) {
+        fprintf(stderr, "ERROR: Could not open %s for writing\n", filename);
+        return false;
+    }
+
+    uint8_t header[RSSC_HEADER] = {'R', 'S', 'S', 'C'};
+    putLE<uint16_t>(header + 4, CODEC_VERSION);
+    putLE<uint16_t>(header + 6, numRadios);
+    fwrite(header, 1, sizeof(header), f);
+    fwrite(enc.data.data(), 1, enc.data.size(), f);
+
+    uint64_t indexOffset = RSSC_HEADER + enc.data.size();
+    for (const CodecBlockIndex &idx : enc.index) {
+        uint8_t entry[RSSC_INDEX_ENTRY];
+        entry[0] = idx.radio;
+        putLE<uint64_t>(entry + 1, idx.firstSample);
+        putLE<uint64_t>(entry + 9, RSSC_HEADER + idx.offset);
+        putLE<uint64_t>(entry + 17, idx.t_first_ns);
+        fwrite(entry, 1, sizeof(entry), f);
+    }
+
+    uint8_t footer[16];
+    putLE<uint64_t>(footer, enc.index.size());
+    putLE<uint64_t>(footer + 8, indexOffset);
+    fwrite(footer, 1, sizeof(footer), f);
+
+    bool ok = !ferror(f);
+    fclose(f);
+    return ok;
+}
+
+bool rsscOpen(RsscReader &reader, const char *filename) {
+    reader.file = fopen(filename, "rb");
+    if (!reader.file) return false;
+
+    uint8_t header[RSSC_HEADER], footer[16];
+    if (fread(header, 1, sizeof(header), reader.file) != sizeof(header) || memcmp(header, "RSSC", 4) != 0 ||
+        getLE<uint16_t>(header + 4) != CODEC_VERSION ||
+        fseek(reader.file, -16, SEEK_END) != 0 || fread(footer, 1, sizeof(footer), reader.file) != sizeof(footer)) {
+        rsscClose(reader);
+        return false;
+    }
+    reader.numRadios = getLE<uint16_t>(header + 6);
+
+    uint64_t numBlocks = getLE<uint64_t>(footer);
+    fseek(reader.file, (long)getLE<uint64_t>(footer + 8), SEEK_SET);
+    for (auto &radioIndex : reader.index) radioIndex.clear();
+
+    for (uint64_t b = 0; b < numBlocks; b++) {
+        uint8_t entry[RSSC_INDEX_ENTRY];
+        if (fread(entry, 1, sizeof(entry), reader.file) != sizeof(entry)) {
+            rsscClose(reader);
+            return false;
+        }
+        CodecBlockIndex idx = {entry[0], getLE<uint64_t>(entry + 1), getLE<uint64_t>(entry + 9), getLE<uint64_t>(entry + 17)};
+        reader.index[idx.radio].push_back(idx);
+    }
+    return true;
+}
+
+void rsscClose(RsscReader &reader) {
+    if (reader.file) fclose(reader.file);
+    reader.file = NULL;
+}
+
+int rsscReadBlock(RsscReader &reader, uint8_t radio, uint64_t sample, RssiSample *out, uint64_t *firstSample) {
+    const std::vector<CodecBlockIndex> &index = reader.index[radio];
+    auto it = std::upper_bound(index.begin(), index.end(), sample,
+                               [](uint64_t s, const CodecBlockIndex &idx) { return s < idx.firstSample; });
+    if (it == index.begin()) return 0;
+    --it;
+
+    static thread_local uint8_t block[CODEC_MAX_BLOCK_BYTES];
+    if (fseek(reader.file, (long)it->offset, SEEK_SET) != 0 ||
+        fread(block, 1, CODEC_BLOCK_HEADER, reader.file) != CODEC_BLOCK_HEADER) return 0;
+
+    uint32_t payload = getLE<uint32_t>(block + 8);
+    if (CODEC_BLOCK_HEADER + payload > sizeof(block) ||
+        fread(block + CODEC_BLOCK_HEADER, 1, payload, reader.file) != payload) return 0;
+
+    int n = decodeBlock(block, CODEC_BLOCK_HEADER + payload, out);
+    if (n && sample >= it->firstSample + n) return 0;   // past the end of the radio's samples
+    if (firstSample) *firstSample = it->firstSample;
+    return n;
+}
+
+// ===================== benchmark =====================
+
+void benchmarkCodec(const char *name, const RssiSample *samples, int numSamples) {
+    for (int withTs = 0; withTs < 2; withTs++) {
+        RssiEncoder enc;
+        encoderInit(enc);
+        enc.data.reserve((size_t)numSamples * 2 + CODEC_MAX_BLOCK_BYTES);
+
+        uint64_t start = monotonicRawNs();
+        encoderAdd(enc, 0, samples, numSamples, withTs);
+        uint64_t encodeNs = monotonicRawNs() - start;
+
+        std::vector<uint8_t> raw(CODEC_BLOCK_SAMPLES + 16);
+        std::vector<RssiSample> decoded(CODEC_BLOCK_SAMPLES);
+        bool match = true;
+
+        start = monotonicRawNs();
+        for (size_t b = 0; b < enc.index.size(); b++) {
+            size_t end = (b + 1 < enc.index.size()) ? enc.index[b + 1].offset : enc.data.size();
+            decodeBlockRaw(&enc.data[enc.index[b].offset], end - enc.index[b].offset, raw.data());
+        }
+        uint64_t decodeRawNs = monotonicRawNs() - start;
+
+        start = monotonicRawNs();
+        for (size_t b = 0; b < enc.index.size(); b++) {
+            size_t end = (b + 1 < enc.index.size()) ? enc.index[b + 1].offset : enc.data.size();
+            int n = decodeBlock(&enc.data[enc.index[b].offset], end - enc.index[b].offset, decoded.data());
+            const RssiSample *orig = samples + enc.index[b].firstSample;
+            for (int i = 0; i < n; i++) {
+                if (decoded[i].raw != orig[i].raw || (withTs && decoded[i].t_ns != orig[i].t_ns)) match = false;
+            }
+        }
+        uint64_t decodeNs = monotonicRawNs() - start;
+
+        // ratio against the uncompressed samples (raw byte, + u64 timestamp if kept) and the csv (~28 bytes per sample)
+        double rawBytes = (double)numSamples * (withTs ? 9 : 1);
+        printf("%s%s: %d samples -> %zu bytes, %.2f bits/sample (%.1fx vs raw, %.0fx vs csv)%s\n", name,
+               withTs ? " +timestamps" : "", numSamples, enc.data.size(), 8.0 * enc.data.size() / numSamples,
+               rawBytes / enc.data.size(), 28.0 * numSamples / enc.data.size(), match ? "" : " MISMATCH");
+        printf("    encode %.2f GB/s, decode raw %.2f GB/s, decode samples %.2f GB/s\n",
+               (double)numSamples / encodeNs, (double)numSamples / decodeRawNs, (double)numSamples / decodeNs);
+    }
+}
+
+void benchmarkCodecSimulated(int numSamples) {
+    std::vector<RssiSample> samples(numSamples);
+    uint32_t seed = 1;
+    auto rnd = [&seed]() { seed = seed * 1103515245 + 12345; return (seed >> 16) & 0x7FFF; };
+
+    // quiet band: -100 dBm +-1 dB, 2 kHz with ~5 us of timestamp jitter
+    uint64_t t = 0;
+    for (int i = 0; i < numSamples; i++) {
+        t += 500'000 + rnd() % 10'000 - 5'000;
+        samples[i] = {t, (uint8_t)(int8_t)(-52 + (int)(rnd() % 5) - 2)};
+    }
+    benchmarkCodec("quiet band", samples.data(), numSamples);
+
+    // busy band: -95 dBm +-4 dB with -50 dBm bursts
+    for (int i = 0; i < numSamples; i++) {
+        int raw = -42 + (int)(rnd() % 17) - 8;
+        if (i % 1000 < 100) raw = 48 + (int)(rnd() % 3);
+        samples[i].raw = (uint8_t)(int8_t)raw;
+    }
+    benchmarkCodec("busy band", samples.data(), numSamples);
+}
@@ -0,0 +1,82 @@
+#ifndef RSSI_CODEC_H
+#define RSSI_CODEC_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <vector>
+
+#include "capture_timing.h"
+
+// Compressed RSSI capture format (.rssc)
+//
+// Samples keep the raw 1 byte RSSI register value. Per radio, samples are cut into blocks of
+// up to CODEC_BLOCK_SAMPLES, each block stores the first value and then zigzag coded deltas,
+// packed either as fixed width bit fields (width = widest delta in the block, 0 for a constant
+// block) or as (delta, varint run length) pairs, whichever is smaller. Timestamps are optional:
+// without them they are interpolated between the block's first and last timestamp, with them
+// every interval is stored as a varint residual against the block's mean interval.
+//
+// file:  "RSSC" | u16 version | u16 numRadios | blocks ... | index | u64 numBlocks | u64 indexOffset
+// block: u8 mode | u8 width | u8 flags | u8 firstRaw | u16 count | u16 reserved | u32 payloadBytes
+//        | u64 t_first_ns | u64 t_last_ns | payload (deltas, then timestamp residuals)
+// index: one CodecBlockIndex per block, so a reader can seek straight to any sample or time
+
+constexpr int CODEC_BLOCK_SAMPLES = 4096;
+constexpr uint16_t CODEC_VERSION = 1;
+constexpr size_t CODEC_BLOCK_HEADER = 32;
+constexpr size_t CODEC_MAX_BLOCK_BYTES = CODEC_BLOCK_HEADER + 2 * CODEC_BLOCK_SAMPLES + 10 * CODEC_BLOCK_SAMPLES;
+
+enum CodecMode : uint8_t {
+    CODEC_BITPACK = 0,
+    CODEC_RLE = 1
+};
+
+constexpr uint8_t CODEC_FLAG_TIMESTAMPS = 0x01;
+
+struct CodecBlockIndex {
+    uint8_t radio;
+    uint64_t firstSample;   // sample number of the block's first sample within its radio
+    uint64_t offset;        // byte offset of the block in the file / buffer
+    uint64_t t_first_ns;
+};
+
+// encode 1..CODEC_BLOCK_SAMPLES samples into out (CODEC_MAX_BLOCK_BYTES), returns bytes written
+size_t encodeBlock(const RssiSample *samples, int numSamples, bool timestamps, uint8_t *out);
+
+// decode one block, out needs CODEC_BLOCK_SAMPLES, returns samples decoded (0 = corrupt)
+int decodeBlock(const uint8_t *in, size_t len, RssiSample *out);
+// raw register bytes only (no timestamps), the fast path
+int decodeBlockRaw(const uint8_t *in, size_t len, uint8_t *raw);
+
+// whole captures in memory: blocks back to back + index
+struct RssiEncoder {
+    std::vector<uint8_t> data;
+    std::vector<CodecBlockIndex> index;
+    uint64_t samplesPerRadio[256];
+};
+
+void encoderInit(RssiEncoder &enc);
+void encoderAdd(RssiEncoder &enc, uint8_t radio, const RssiSample *samples, int numSamples, bool timestamps);
+
+// file = header + encoder data + index (offsets are rebased on the header)
+bool writeRssc(const char *filename, const RssiEncoder &enc, uint16_t numRadios);
+
+// load the index of an .rssc file + decode single blocks from it
+struct RsscReader {
+    FILE *file;
+    uint16_t numRadios;
+    std::vector<CodecBlockIndex> index[256];    // per radio, ordered by firstSample
+};
+
+bool rsscOpen(RsscReader &reader, const char *filename);
+void rsscClose(RsscReader &reader);
+// decode the block holding sample number `sample` of `radio`, returns samples in out (0 = not found)
+int rsscReadBlock(RsscReader &reader, uint8_t radio, uint64_t sample, RssiSample *out, uint64_t *firstSample);
+
+// compression ratio + encode/decode GB/s (raw bytes) of samples
+void benchmarkCodec(const char *name, const RssiSample *samples, int numSamples);
+// same on simulated captures (quiet noise, noisy band with bursts)
+void benchmarkCodecSimulated(int numSamples);
+
+#endif
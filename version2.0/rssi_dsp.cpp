@@ -0,0 +1,287 @@
+#include <string.h>             // memset(), memcpy()
+#include <stdio.h>              // printf()
+#include <math.h>               // INFINITY
+#include <vector>
+
+#include "rssi_dsp.h"
+#include "capture_timing.h"     // monotonicRawNs()
+
+typedef float v4sf __attribute__((vector_size(16)));
+
+static inline v4sf load4(const float *p) { v4sf v; memcpy(&v, p, sizeof(v)); return v; }
+static inline void store4(float *p, v4sf v) { memcpy(p, &v, sizeof(v)); }
+static inline v4sf splat4(float x) { return (v4sf){x, x, x, x}; }
+static inline v4sf max4(v4sf a, v4sf b) { return a > b ? a : b; }
+
+static inline size_t align16(size_t n) { return (n + 15) & ~(size_t)15; }
+
+// percentile bins are the RSSI register resolution: bin = (dBm + 138) * 2
+static inline uint8_t quantizeDbm(float dbm) {
+    float q = (dbm + 138.0f) * 2.0f + 0.5f;
+    if (q < 0) return 0;
+    if (q > DSP_PERCENTILE_BINS - 1) return DSP_PERCENTILE_BINS - 1;
+    return (uint8_t)q;
+}
+
+// same window for sizing and init, percentile counts are uint16
+static inline int clampWindow(int window) {
+    if (window < 1) return 1;
+    return (window > DSP_MAX_WINDOW) ? DSP_MAX_WINDOW : window;
+}
+
+size_t dspStageBytes(DspStageType type, int numChannels, int window) {
+    window = clampWindow(window);
+    size_t bytes = align16(numChannels * sizeof(float));    // state
+    if (type == DSP_BOXCAR) bytes += align16((size_t)window * numChannels * sizeof(float));
+    if (type == DSP_PERCENTILE) {
+        bytes += align16((size_t)numChannels * DSP_PERCENTILE_BINS * sizeof(uint16_t));
+        bytes += align16((size_t)window * numChannels);
+    }
+    return bytes;
+}
+
+void dspStageInit(DspStage &stage, DspStageType type, int numChannels, int window, float param, void *mem) {
+    memset(&stage, 0, sizeof(stage));
+    stage.type = type;
+    stage.numChannels = numChannels;
+    stage.window = clampWindow(window);
+    stage.param = param;
+
+    uint8_t *p = (uint8_t *)mem;
+    stage.state = (float *)p;
+    p += align16(numChannels * sizeof(float));
+    if (type == DSP_BOXCAR) {
+        stage.history = (float *)p;
+        p += align16((size_t)stage.window * numChannels * sizeof(float));
+    }
+    if (type == DSP_PERCENTILE) {
+        stage.counts = (uint16_t *)p;
+        p += align16((size_t)numChannels * DSP_PERCENTILE_BINS * sizeof(uint16_t));
+        stage.ring = p;
+    }
+    dspStageReset(stage);
+}
+
+void dspStageReset(DspStage &stage) {
+    int nc = stage.numChannels;
+    stage.pos = 0;
+    stage.filled = 0;
+
+    bool holdsMax = (stage.type == DSP_DECIMATE_MAX || stage.type == DSP_PEAK_HOLD || stage.type == DSP_MAX_HOLD_DECAY);
+    for (int c = 0; c < nc; c++) stage.state[c] = holdsMax ? -INFINITY : 0.0f;
+
+    if (stage.history) memset(stage.history, 0, (size_t)stage.window * nc * sizeof(float));
+    if (stage.counts) memset(stage.counts, 0, (size_t)nc * DSP_PERCENTILE_BINS * sizeof(uint16_t));
+}
+
+// ===================== kernels =====================
+
+static bool boxcar(DspStage &s, const float *in, float *out) {
+    int nc = s.numChannels;
+    float *old = s.history + (size_t)s.pos * nc;
+    if (s.filled < s.window) s.filled++;
+    v4sf scale = splat4(1.0f / s.filled);
+
+    // old slots are 0 until the window has filled once, so sum += in - old works from the start
+    int c = 0;
+    for (; c + 4 <= nc; c += 4) {
+        v4sf x = load4(in + c);
+        v4sf sum = load4(s.state + c) + x - load4(old + c);
+        store4(s.state + c, sum);
+        store4(old + c, x);
+        store4(out + c, sum * scale);
+    }
+    for (; c < nc; c++) {
+        s.state[c] += in[c] - old[c];
+        old[c] = in[c];
+        out[c] = s.state[c] / s.filled;
+    }
+
+    // once per window: rebuild the sums from history so float rounding can't drift
+    if (++s.pos == s.window) {
+        s.pos = 0;
+        memset(s.state, 0, nc * sizeof(float));
+        for (int w = 0; w < s.window; w++) {
+            const float *h = s.history + (size_t)w * nc;
+            for (c = 0; c < nc; c++) s.state[c] += h[c];
+        }
+    }
+    return true;
+}
+
+static bool ema(DspStage &s, const float *in, float *out) {
+    int nc = s.numChannels;
+    if (s.filled == 0) {
+        memcpy(s.state, in, nc * sizeof(float));
+        s.filled = 1;
+    }
+
+    v4sf alpha = splat4(s.param);
+    int c = 0;
+    for (; c + 4 <= nc; c += 4) {
+        v4sf y = load4(s.state + c);
+        y += alpha * (load4(in + c) - y);
+        store4(s.state + c, y);
+        store4(out + c, y);
+    }
+    for (; c < nc; c++) {
+        s.state[c] += s.param * (in[c] - s.state[c]);
+        out[c] = s.state[c];
+    }
+    return true;
+}
+
+static bool decimate(DspStage &s, const float *in, float *out) {
+    int nc = s.numChannels;
+    bool useMax = (s.type == DSP_DECIMATE_MAX);
+
+    int c = 0;
+    for (; c + 4 <= nc; c += 4) {
+        v4sf acc = load4(s.state + c), x = load4(in + c);
+        store4(s.state + c, useMax ? max4(acc, x) : acc + x);
+    }
+    for (; c < nc; c++) s.state[c] = useMax ? (in[c] > s.state[c] ? in[c] : s.state[c]) : s.state[c] + in[c];
+
+    if (++s.pos < s.window) return false;
+
+    float scale = useMax ? 1.0f : 1.0f / s.window;
+    for (c = 0; c < nc; c++) {
+        out[c] = s.state[c] * scale;
+        s.state[c] = useMax ? -INFINITY : 0.0f;
+    }
+    s.pos = 0;
+    return true;
+}
+
+static bool hold(DspStage &s, const float *in, float *out) {
+    int nc = s.numChannels;
+    v4sf decay = splat4(s.type == DSP_MAX_HOLD_DECAY ? s.param : 0.0f);
+
+    int c = 0;
+    for (; c + 4 <= nc; c += 4) {
+        v4sf y = max4(load4(in + c), load4(s.state + c) - decay);
+        store4(s.state + c, y);
+        store4(out + c, y);
+    }
+    float d = decay[0];
+    for (; c < nc; c++) {
+        float y = s.state[c] - d;
+        s.state[c] = (in[c] > y) ? in[c] : y;
+        out[c] = s.state[c];
+    }
+    return true;
+}
+
+// per channel histogram of the window, scatter/gather so this one stays scalar
+static bool percentile(DspStage &s, const float *in, float *out) {
+    int nc = s.numChannels;
+    uint8_t *slot = s.ring + (size_t)s.pos * nc;
+    bool full = (s.filled == s.window);
+    if (!full) s.filled++;
+
+    uint32_t rank = (uint32_t)(s.param / 100.0f * (s.filled - 1) + 0.5f);
+    for (int c = 0; c < nc; c++) {
+        uint16_t *counts = s.counts + (size_t)c * DSP_PERCENTILE_BINS;
+        if (full) counts[slot[c]]--;
+        slot[c] = quantizeDbm(in[c]);
+        counts[slot[c]]++;
+
+        uint32_t seen = 0;
+        int bin = 0;
+        for (; bin < DSP_PERCENTILE_BINS - 1; bin++) {
+            seen += counts[bin];
+            if (seen > rank) break;
+        }
+        out[c] = bin * 0.5f - 138.0f;
+    }
+
+    if (++s.pos == s.window) s.pos = 0;
+    return true;
+}
+
+bool dspStageProcess(DspStage &stage, const float *in, float *out) {
+    switch (stage.type) {
+        case DSP_BOXCAR:            return boxcar(stage, in, out);
+        case DSP_EMA:               return ema(stage, in, out);
+        case DSP_DECIMATE_MEAN:
+        case DSP_DECIMATE_MAX:      return decimate(stage, in, out);
+        case DSP_PEAK_HOLD:
+        case DSP_MAX_HOLD_DECAY:    return hold(stage, in, out);
+        case DSP_PERCENTILE:        return percentile(stage, in, out);
+    }
+    return false;
+}
+
+// ===================== chain =====================
+
+void dspChainInit(DspChain &chain, int numChannels, float *scratch) {
+    chain.numStages = 0;
+    chain.numChannels = numChannels;
+    chain.scratch = scratch;
+}
+
+void dspChainAdd(DspChain &chain, DspStage *stage) {
+    if (chain.numStages < DSP_MAX_STAGES) chain.stages[chain.numStages++] = stage;
+}
+
+// ping pong between the two scratch frames, last stage writes straight to out
+bool dspChainProcess(DspChain &chain, const float *in, float *out) {
+    const float *src = in;
+    for (int i = 0; i < chain.numStages; i++) {
+        float *dst = (i == chain.numStages - 1) ? out : chain.scratch + (i & 1) * chain.numChannels;
+        if (!dspStageProcess(*chain.stages[i], src, dst)) return false;
+        src = dst;
+    }
+    if (chain.numStages == 0) memcpy(out, in, chain.numChannels * sizeof(float));
+    return true;
+}
+
+void dspRawToDbm(const uint8_t *raw, float *out, int n) {
+    v4sf half = splat4(0.5f), offset = splat4(74.0f);
+    int i = 0;
+    for (; i + 4 <= n; i += 4) {
+        v4sf x = {(float)(int8_t)raw[i], (float)(int8_t)raw[i + 1], (float)(int8_t)raw[i + 2], (float)(int8_t)raw[i + 3]};
+        store4(out + i, x * half - offset);
+    }
+    for (; i < n; i++) out[i] = (int8_t)raw[i] * 0.5f - 74.0f;
+}
+
+// ===================== benchmark =====================
+
+void benchmarkDsp(int numChannels, int numFrames) {
+    static const struct { DspStageType type; const char *name; int window; float param; } stages[] = {
+        {DSP_BOXCAR,         "boxcar(16)",       16, 0.0f},
+        {DSP_EMA,            "ema(0.1)",         1,  0.1f},
+        {DSP_DECIMATE_MEAN,  "decimate_mean(8)", 8,  0.0f},
+        {DSP_DECIMATE_MAX,   "decimate_max(8)",  8,  0.0f},
+        {DSP_PEAK_HOLD,      "peak_hold",        1,  0.0f},
+        {DSP_MAX_HOLD_DECAY, "max_hold(0.5dB)",  1,  0.5f},
+        {DSP_PERCENTILE,     "p10(64)",          64, 10.0f},
+    };
+
+    // fake sweep frames: noise floor around -100 dBm with a few strong channels
+    constexpr int NUM_TEST_FRAMES = 64;
+    std::vector<float> frames((size_t)NUM_TEST_FRAMES * numChannels);
+    uint32_t seed = 1;
+    for (size_t i = 0; i < frames.size(); i++) {
+        seed = seed * 1103515245 + 12345;
+        frames[i] = -100.0f + (seed >> 16) % 20 * 0.5f + ((i % numChannels) % 17 == 0 ? 40.0f : 0.0f);
+    }
+    std::vector<float> out(numChannels);
+
+    printf("DSP benchmark, %d channels x %d frames\n", numChannels, numFrames);
+    for (const auto &st : stages) {
+        std::vector<uint8_t> mem(dspStageBytes(st.type, numChannels, st.window));
+        DspStage stage;
+        dspStageInit(stage, st.type, numChannels, st.window, st.param, mem.data());
+
+        uint64_t start = monotonicRawNs();
+        for (int f = 0; f < numFrames; f++) {
+            dspStageProcess(stage, &frames[(size_t)(f % NUM_TEST_FRAMES) * numChannels], out.data());
+        }
+        uint64_t elapsed = monotonicRawNs() - start;
+
+        printf("    %-18s %10.0f frames/s  %8.1f M channel samples/s\n", st.name,
+               numFrames * 1e9 / elapsed, (double)numFrames * numChannels * 1e3 / elapsed);
+    }
+}
@@ -0,0 +1,64 @@
+#ifndef RSSI_DSP_H
+#define RSSI_DSP_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// Streaming DSP on RSSI frames (one float dBm per channel, a single radio stream is 1 channel).
+// Stages never allocate: dspStageBytes() tells the caller how much memory to hand to
+// dspStageInit(), after that processing only touches that memory.
+// Kernels work on 4 channels at a time with gcc vector extensions (NEON on the Pi, SSE on x86).
+
+constexpr int DSP_MAX_STAGES = 8;
+constexpr int DSP_PERCENTILE_BINS = 256;    // 0.5 dB steps from -138 dBm, same resolution as the RSSI register
+constexpr int DSP_MAX_WINDOW = 65535;       // windows are clamped to 1 .. this (uint16 percentile counts)
+
+enum DspStageType {
+    DSP_BOXCAR,             // mean of the last window frames
+    DSP_EMA,                // y += alpha * (x - y), param = alpha
+    DSP_DECIMATE_MEAN,      // one mean frame out per window frames in
+    DSP_DECIMATE_MAX,       // one max frame out per window frames in
+    DSP_PEAK_HOLD,          // max since reset
+    DSP_MAX_HOLD_DECAY,     // y = max(x, y - param), param = decay in dB per frame
+    DSP_PERCENTILE          // param'th percentile of the last window frames (e.g. 10 = noise floor)
+};
+
+struct DspStage {
+    DspStageType type;
+    int numChannels;
+    int window;
+    float param;
+    int pos;                // ring position / frames accumulated
+    int filled;             // frames in the window so far
+    float *state;           // numChannels (running sum, ema, hold, accumulator)
+    float *history;         // boxcar: window * numChannels
+    uint8_t *ring;          // percentile: window * numChannels quantized values
+    uint16_t *counts;       // percentile: numChannels * DSP_PERCENTILE_BINS
+};
+
+// stages run in order, output of one is input of the next
+struct DspChain {
+    DspStage *stages[DSP_MAX_STAGES];
+    int numStages;
+    int numChannels;
+    float *scratch;         // 2 * numChannels, from the caller
+};
+
+size_t dspStageBytes(DspStageType type, int numChannels, int window);
+void dspStageInit(DspStage &stage, DspStageType type, int numChannels, int window, float param, void *mem);
+void dspStageReset(DspStage &stage);
+
+// false = this input produced no output frame (decimation)
+bool dspStageProcess(DspStage &stage, const float *in, float *out);
+
+void dspChainInit(DspChain &chain, int numChannels, float *scratch);
+void dspChainAdd(DspChain &chain, DspStage *stage);
+bool dspChainProcess(DspChain &chain, const float *in, float *out);
+
+// raw RSSI register bytes -> dBm, same as convertRSSI()
+void dspRawToDbm(const uint8_t *raw, float *out, int n);
+
+// frames/s of every stage type at numChannels
+void benchmarkDsp(int numChannels, int numFrames);
+
+#endif
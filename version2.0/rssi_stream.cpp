@@ -0,0 +1,135 @@
+#include <string.h>             // memset()
+#include <stdio.h>              // printf(), perror()
+#include <math.h>               // ceil()
+#include <vector>
+
+#include <linux/spi/spidev.h>   // spi_ioc_transfer
+
+#include "rssi_stream.h"
+#include "main_drivers.h"
+#include "helper_functions.h"
+#include "device_manager.h"
+#include "cc1101_config.h"
+#include "spi_trace.h"       // spiTransfer()
+
+bool enterRssiMode(int fd, RssiModeBackup *backup) {
+    uint8_t pktctrl0 = readRegister(fd, PKTCTRL0, READ_SINGLE_BYTE, 1, NULL);
+    uint8_t mcsm1 = readRegister(fd, MCSM1, READ_SINGLE_BYTE, 1, NULL);
+    if (backup) *backup = {pktctrl0, mcsm1};
+
+    sendStrobe(fd, SIDLE);
+
+    pktctrl0 = (pktctrl0 & 0xCF) | (0x03 << 4);     // PKT_FORMAT[5:4] = 3 = asynchronous serial
+    mcsm1 = (mcsm1 & 0xF3) | (0x03 << 2);           // RXOFF_MODE[3:2] = 3 = stay in RX
+    writeRegister(fd, PKTCTRL0, &pktctrl0, WRITE_SINGLE_BYTE, 1);
+    writeRegister(fd, MCSM1, &mcsm1, WRITE_SINGLE_BYTE, 1);
+
+    sendStrobe(fd, SFRX);
+    sendStrobe(fd, SRX);
+
+    uint8_t marcstate = readRegister(fd, MARCSTATE, READ_BURST, 1, NULL) & 0x1F;
+    if (marcstate != 0x0D) {
+        printf("RSSI mode: fd %d did not enter RX (MARCSTATE = 0x%02X)\n", fd, marcstate);
+        return false;
+    }
+    return true;
+}
+
+void exitRssiMode(int fd, const RssiModeBackup &backup) {
+    sendStrobe(fd, SIDLE);
+    uint8_t pktctrl0 = backup.pktctrl0;
+    uint8_t mcsm1 = backup.mcsm1;
+    writeRegister(fd, PKTCTRL0, &pktctrl0, WRITE_SINGLE_BYTE, 1);
+    writeRegister(fd, MCSM1, &mcsm1, WRITE_SINGLE_BYTE, 1);
+    sendStrobe(fd, SFRX);
+}
+
+// datasheet 17.3: f_RSSI = 2 * BW_channel / (8 * 2^FILTER_LENGTH)
+double rssiUpdateRateHz(int fd) {
+    uint8_t mdmcfg4 = readRegister(fd, MDMCFG4, READ_SINGLE_BYTE, 1, NULL);
+    uint8_t agcctrl0 = readRegister(fd, AGCCTRL0, READ_SINGLE_BYTE, 1, NULL);
+
+    uint32_t chanbw = calculateChanBW((mdmcfg4 >> 6) & 0x03, (mdmcfg4 >> 4) & 0x03);
+    uint8_t filter_length = agcctrl0 & 0x03;
+    return 2.0 * chanbw / (8 * (1 << filter_length));
+}
+
+bool readRssiBatch(int fd, int numReads, RssiSample *out) {
+    if (numReads <= 0 || numReads > RSSI_BATCH_MAX) return false;
+
+    static const uint8_t txBuff[2] = {RSSI | READ_BURST, 0};   // same command for every read
+    uint8_t rxBuff[RSSI_BATCH_MAX][2];
+    struct spi_ioc_transfer spi[RSSI_BATCH_MAX];
+    memset(spi, 0, sizeof(spi[0]) * numReads);
+
+    for (int i = 0; i < numReads; i++) {
+        spi[i].tx_buf = (unsigned long)txBuff;
+        spi[i].rx_buf = (unsigned long)rxBuff[i];
+        spi[i].len = 2;
+        spi[i].cs_change = (i < numReads - 1);
+    }
+
+    uint64_t start = monotonicRawNs();
+    if (spiTransfer(fd, spi, numReads) < 0) {
+        perror("SPI RSSI batch failed");
+        return false;
+    }
+    uint64_t end = monotonicRawNs();
+
+    // transfers are evenly spaced on the bus, read i completes at start + (i + 1) / n of the ioctl
+    uint64_t span = end - start;
+    for (int i = 0; i < numReads; i++) {
+        out[i].raw = rxBuff[i][1];
+        out[i].t_ns = start + span * (i + 1) / numReads;
+    }
+    return true;
+}
+
+static int clampBatch(int batchSize) {
+    if (batchSize > RSSI_BATCH_MAX) batchSize = RSSI_BATCH_MAX;
+    if (batchSize > spidevBufsiz() / SPIDEV_DMA_ALIGN) batchSize = spidevBufsiz() / SPIDEV_DMA_ALIGN;
+    if (batchSize < 1) batchSize = 1;
+    return batchSize;
+}
+
+int rssiBatchSize(double rateHz) {
+    if (rateHz <= 0) return clampBatch(RSSI_BATCH_MAX);
+    return clampBatch((int)ceil(rateHz / RSSI_BATCH_TICK_HZ));
+}
+
+int captureRssi(const Radio &radio, RssiSample *out, int numSamples, int batchSize) {
+    batchSize = clampBatch(batchSize);
+
+    int count = 0;
+    while (count < numSamples) {
+        int n = (numSamples - count < batchSize) ? numSamples - count : batchSize;
+        if (!readRssiBatch(radio.fd, n, &out[count])) break;
+        count += n;
+    }
+    return count;
+}
+
+void benchmarkRssiMode(Radio *radios, int numRadios, int numSamples) {
+    std::vector<RssiSample> samples(numSamples);
+    static const int batchSizes[] = {1, 4, 16, RSSI_BATCH_MAX};
+
+    for (int i = 0; i < numRadios; i++) {
+        RssiModeBackup backup;
+        if (!enterRssiMode(radios[i].fd, &backup)) continue;
+        printf("%s: RSSI mode, f_RSSI = %.1f kHz\n", radios[i].path, rssiUpdateRateHz(radios[i].fd) / 1e3);
+
+        for (int batch : batchSizes) {
+            uint64_t start = monotonicRawNs();
+            int n = captureRssi(radios[i], samples.data(), numSamples, batch);
+            uint64_t elapsed = monotonicRawNs() - start;
+
+            // how many reads saw a new value (rough measure of oversampling)
+            int changes = 0;
+            for (int s = 1; s < n; s++) changes += (samples[s].raw != samples[s - 1].raw);
+
+            printf("    batch %2d: %d samples in %.1f ms = %.0f samples/s (%d value changes)\n",
+                   batch, n, elapsed / 1e6, n * 1e9 / elapsed, changes);
+        }
+        exitRssiMode(radios[i].fd, backup);
+    }
+}
@@ -0,0 +1,57 @@
+#ifndef RSSI_STREAM_H
+#define RSSI_STREAM_H
+
+#include <stdint.h>
+
+#include "capture_timing.h"
+#include "spi_util.h"           // SPIDEV_DEFAULT_BUFSIZ, SPIDEV_DMA_ALIGN
+
+struct Radio;
+
+// Max rate RSSI sampling
+//
+// Packet RX fills the 64 byte RX FIFO with noise, so the normal loop has to poll
+// MARCSTATE/RXBYTES and flush on overflow. In RSSI mode the radio runs in asynchronous
+// serial mode (PKTCTRL0.PKT_FORMAT = 3): demodulated data goes straight to the GDO pins,
+// the FIFO is never written, and RXOFF_MODE = STAY_RX keeps it in RX. The sample loop is
+// then only RSSI reads, batched up to RSSI_BATCH_MAX per ioctl (one 2 byte transfer each,
+// CSn toggled between them; spidev counts each as SPIDEV_DMA_ALIGN bytes of its bufsiz).
+//
+// Limits per radio:
+//   bus:  2 bytes @ 10 MHz = 1.6 us per read + CSn gap + per transfer driver overhead,
+//         roughly 100k - 300k reads/s with batching vs ~5k/s with one ioctl per read
+//   chip: RSSI only changes at f_RSSI = 2 * BW_channel / (8 * 2^FILTER_LENGTH) (datasheet 17.3),
+//         e.g. 203 kHz at 812 kHz BW, 14.5 kHz at 58 kHz BW. Reads faster than that repeat values.
+// benchmarkRssiMode() measures the real number on the target.
+
+constexpr int RSSI_BATCH_MAX = SPIDEV_DEFAULT_BUFSIZ / SPIDEV_DMA_ALIGN;     // 32
+
+// registers enterRssiMode() changes, restored by exitRssiMode()
+struct RssiModeBackup {
+    uint8_t pktctrl0;
+    uint8_t mcsm1;
+};
+
+bool enterRssiMode(int fd, RssiModeBackup *backup);
+void exitRssiMode(int fd, const RssiModeBackup &backup);
+
+// f_RSSI of the current config (from MDMCFG4 and AGCCTRL0)
+double rssiUpdateRateHz(int fd);
+
+// numReads RSSI reads (<= RSSI_BATCH_MAX) in one ioctl
+// timestamps are interpolated between submit and completion of the ioctl
+bool readRssiBatch(int fd, int numReads, RssiSample *out);
+
+// reads per ioctl for sampling at rateHz (<= 0 = unpaced): one read per deadline up to
+// RSSI_BATCH_TICK_HZ deadlines/s, above that enough reads per deadline to stay under it,
+// capped by RSSI_BATCH_MAX and the spidev bufsiz. Reads of one batch are bus spaced.
+constexpr double RSSI_BATCH_TICK_HZ = 2000;
+int rssiBatchSize(double rateHz);
+
+// fill numSamples as fast as possible, batchSize reads per ioctl, returns samples read
+int captureRssi(const Radio &radio, RssiSample *out, int numSamples, int batchSize);
+
+// samples/s for batch sizes 1..RSSI_BATCH_MAX on every radio
+void benchmarkRssiMode(Radio *radios, int numRadios, int numSamples);
+
+#endif
@@ -0,0 +1,308 @@
+#include <string.h>             // memcpy(), memset(), strncpy()
+#include <stdio.h>              // printf(), perror()
+#include <unistd.h>             // ftruncate(), close(), getpid(), pread()
+#include <errno.h>              // EEXIST, EPERM
+#include <signal.h>             // kill()
+#include <sys/mman.h>           // shm_open(), mmap(), munmap()
+#include <sys/stat.h>           // fstat()
+#include <fcntl.h>              // O_CREAT, O_RDWR, ...
+#include <thread>
+#include <vector>
+
+#include "shm_ring.h"
+#include "pacer.h"
+
+static inline size_t slotStride(uint32_t slotBytes) {
+    return (sizeof(ShmSlotHeader) + slotBytes + 63) & ~(size_t)63;     // keep slots on cache lines
+}
+
+static inline size_t valueBytes(uint8_t type) {
+    return (type == SHM_FRAME_SAMPLES) ? sizeof(RssiSample) : sizeof(float);
+}
+
+// ===================== writer =====================
+
+// existing ring whose writer process still runs, anything else under the name is stale
+static bool ringHasLiveWriter(const char *name, uint64_t *pid) {
+    int fd = shm_open(name, O_RDONLY, 0);
+    if (fd < 0) return false;
+
+    ShmRingHeader h;
+    bool live = false;
+    if (pread(fd, &h, sizeof(h), 0) == sizeof(h) && memcmp(h.magic, SHM_RING_MAGIC, sizeof(h.magic)) == 0) {
+        *pid = h.writerPid;
+        live = h.writerPid && (kill((pid_t)h.writerPid, 0) == 0 || errno == EPERM);
+    }
+    close(fd);
+    return live;
+}
+
+bool shmRingCreate(ShmRingWriter &writer, const char *name, uint32_t numSlots, uint32_t slotBytes) {
+    memset(&writer, 0, sizeof(writer));
+    if (numSlots == 0 || slotBytes == 0 || slotBytes > SHM_RING_MAX_SLOT_BYTES) {
+        fprintf(stderr, "ERROR: shared memory ring of %u slots x %u bytes\n", numSlots, slotBytes);
+        return false;
+    }
+
+    int fd = shm_open(name, O_CREAT | O_EXCL | O_RDWR, 0644);
+    if (fd < 0 && errno == EEXIST) {
+        uint64_t pid = 0;
+        if (ringHasLiveWriter(name, &pid)) {
+            fprintf(stderr, "ERROR: shared memory ring %s is in use by pid %llu\n", name, (unsigned long long)pid);
+            return false;
+        }
+        shm_unlink(name);   // stale ring of a writer that exited without unlinking it
+        fd = shm_open(name, O_CREAT | O_EXCL | O_RDWR, 0644);
+    }
+    if (fd < 0) {
+        perror("shm_open");
+        return false;
+    }
+
+    writer.slotStride = slotStride(slotBytes);
+    writer.mapBytes = sizeof(ShmRingHeader) + (size_t)numSlots * writer.slotStride;
+    if (ftruncate(fd, writer.mapBytes) < 0) {   // zero filled, so every seq starts at 0 = empty
+        perror("ftruncate");
+        close(fd);
+        shm_unlink(name);
+        return false;
+    }
+
+    void *map = mmap(NULL, writer.mapBytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) {
+        perror("mmap");
+        shm_unlink(name);
+        return false;
+    }
+
+    writer.header = (ShmRingHeader *)map;
+    writer.slots = (uint8_t *)map + sizeof(ShmRingHeader);
+    strncpy(writer.name, name, sizeof(writer.name) - 1);
+
+    ShmRingHeader &h = *writer.header;
+    h.version = SHM_RING_VERSION;
+    h.headerBytes = sizeof(ShmRingHeader);
+    h.numSlots = numSlots;
+    h.slotBytes = slotBytes;
+    h.writerPid = getpid();
+    // magic last: a reader attaching mid-create sees no magic and fails cleanly
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    memcpy(h.magic, SHM_RING_MAGIC, sizeof(h.magic));
+    return true;
+}
+
+void shmRingDestroy(ShmRingWriter &writer, bool unlink) {
+    if (writer.header) munmap(writer.header, writer.mapBytes);
+    if (unlink && writer.name[0]) shm_unlink(writer.name);
+    memset(&writer, 0, sizeof(writer));
+}
+
+uint64_t shmRingPublish(ShmRingWriter &writer, const ShmSlotHeader &frame, const void *payload, size_t payloadBytes) {
+    ShmRingHeader &h = *writer.header;
+    uint64_t n = __atomic_fetch_add(&h.writeCount, 1, __ATOMIC_RELAXED);
+    ShmSlotHeader *slot = (ShmSlotHeader *)(writer.slots + (n % h.numSlots) * writer.slotStride);
+
+    // odd = being written, the fence keeps the payload stores after it
+    __atomic_store_n(&slot->seq, 2 * n + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+
+    if (payloadBytes > h.slotBytes) payloadBytes = h.slotBytes;
+    slot->frame = n;
+    slot->type = frame.type;
+    slot->radio = frame.radio;
+    slot->numValues = payloadBytes / valueBytes(frame.type);
+    slot->t_ns = frame.t_ns;
+    slot->freq_hz = frame.freq_hz;
+    slot->step_hz = frame.step_hz;
+    memcpy(slot + 1, payload, payloadBytes);
+    slot->publish_ns = monotonicRawNs();
+
+    __atomic_store_n(&slot->seq, 2 * n + 2, __ATOMIC_RELEASE);
+    return n;
+}
+
+uint64_t shmRingPublishSamples(ShmRingWriter &writer, uint8_t radio, const RssiSample *samples, int numSamples) {
+    ShmSlotHeader frame = {};
+    frame.type = SHM_FRAME_SAMPLES;
+    frame.radio = radio;
+    frame.t_ns = numSamples ? samples[0].t_ns : 0;
+    return shmRingPublish(writer, frame, samples, (size_t)numSamples * sizeof(RssiSample));
+}
+
+uint64_t shmRingPublishSweep(ShmRingWriter &writer, uint64_t t_ns, uint32_t freqHz, uint32_t stepHz,
+                             const float *dbm, int numChannels) {
+    ShmSlotHeader frame = {};
+    frame.type = SHM_FRAME_SWEEP;
+    frame.t_ns = t_ns;
+    frame.freq_hz = freqHz;
+    frame.step_hz = stepHz;
+    return shmRingPublish(writer, frame, dbm, (size_t)numChannels * sizeof(float));
+}
+
+// ===================== reader =====================
+
+bool shmRingAttach(ShmRingReader &reader, const char *name, bool startAtOldest) {
+    memset(&reader, 0, sizeof(reader));
+    int fd = shm_open(name, O_RDONLY, 0);
+    if (fd < 0) return false;
+
+    struct stat st;
+    if (fstat(fd, &st) < 0 || (size_t)st.st_size < sizeof(ShmRingHeader)) {
+        close(fd);
+        return false;
+    }
+    void *map = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) return false;
+
+    const ShmRingHeader *h = (const ShmRingHeader *)map;
+    bool valid = memcmp(h->magic, SHM_RING_MAGIC, sizeof(h->magic)) == 0;
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    valid = valid && h->version == SHM_RING_VERSION && h->headerBytes == sizeof(ShmRingHeader) &&
+            sizeof(ShmRingHeader) + (size_t)h->numSlots * slotStride(h->slotBytes) <= (size_t)st.st_size;
+    if (!valid) {
+        fprintf(stderr, "ERROR: %s is not a version %d RSSI ring\n", name, SHM_RING_VERSION);
+        munmap(map, st.st_size);
+        return false;
+    }
+
+    reader.header = h;
+    reader.slots = (const uint8_t *)map + sizeof(ShmRingHeader);
+    reader.slotStride = slotStride(h->slotBytes);
+    reader.mapBytes = st.st_size;
+
+    uint64_t written = __atomic_load_n(&h->writeCount, __ATOMIC_ACQUIRE);
+    if (!startAtOldest) reader.next = written;
+    else reader.next = (written > h->numSlots) ? written - h->numSlots : 0;
+    return true;
+}
+
+void shmRingDetach(ShmRingReader &reader) {
+    if (reader.header) munmap((void *)reader.header, reader.mapBytes);
+    memset(&reader, 0, sizeof(reader));
+}
+
+const ShmSlotHeader *shmRingPeek(ShmRingReader &reader) {
+    const ShmRingHeader &h = *reader.header;
+    for (;;) {
+        uint64_t written = __atomic_load_n(&h.writeCount, __ATOMIC_ACQUIRE);
+        if (reader.next >= written) return NULL;
+
+        // lapped: everything older than one ring behind is gone
+        if (written - reader.next > h.numSlots) {
+            reader.lost += written - h.numSlots - reader.next;
+            reader.next = written - h.numSlots;
+        }
+
+        const ShmSlotHeader *slot = (const ShmSlotHeader *)(reader.slots + (reader.next % h.numSlots) * reader.slotStride);
+        uint64_t expected = 2 * reader.next + 2;
+        uint64_t seq = __atomic_load_n(&slot->seq, __ATOMIC_ACQUIRE);
+        if (seq == expected) return slot;
+        if (seq < expected) return NULL;    // claimed but still being written
+
+        reader.lost++;                      // already reused for a newer frame
+        reader.next++;
+    }
+}
+
+bool shmRingRelease(ShmRingReader &reader, const ShmSlotHeader *slot) {
+    // everything read from the slot happens before the second seq load
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    bool valid = __atomic_load_n(&slot->seq, __ATOMIC_RELAXED) == 2 * reader.next + 2;
+    if (!valid) reader.lost++;
+    reader.next++;
+    return valid;
+}
+
+int shmRingRead(ShmRingReader &reader, ShmSlotHeader *frame, void *payload, size_t maxPayloadBytes) {
+    for (;;) {
+        const ShmSlotHeader *slot = shmRingPeek(reader);
+        if (!slot) return 0;
+
+        memcpy(frame, slot, sizeof(*frame));
+        size_t bytes = (size_t)frame->numValues * valueBytes(frame->type);
+        if (bytes > reader.header->slotBytes) bytes = reader.header->slotBytes;     // torn header, caught below
+        if (bytes > maxPayloadBytes) bytes = maxPayloadBytes;
+        memcpy(payload, slot + 1, bytes);
+
+        if (shmRingRelease(reader, slot)) return 1;
+    }
+}
+
+// ===================== benchmark =====================
+
+struct ShmBenchResult {
+    int attached;           // 1 = reading, -1 = attach failed
+    uint64_t frames;
+    uint64_t lost;
+    Histogram latency;
+};
+
+static void benchReader(const char *name, uint64_t numFrames, ShmBenchResult *result) {
+    ShmRingReader reader;
+    bool ok = shmRingAttach(reader, name, true);
+    __atomic_store_n(&result->attached, ok ? 1 : -1, __ATOMIC_RELEASE);
+    if (!ok) return;
+
+    while (reader.next < numFrames) {
+        const ShmSlotHeader *slot = shmRingPeek(reader);
+        if (!slot) continue;
+
+        // zero copy: touch the samples in place, no memcpy out
+        const RssiSample *samples = (const RssiSample *)shmSlotPayload(slot);
+        if (slot->numValues) {
+            volatile uint8_t last = samples[slot->numValues - 1].raw;
+            (void)last;
+        }
+        uint64_t publish = slot->publish_ns;
+        if (shmRingRelease(reader, slot)) {
+            result->frames++;
+            histogramAdd(result->latency, monotonicRawNs() - publish);
+        }
+    }
+    result->lost = reader.lost;
+    shmRingDetach(reader);
+}
+
+void benchmarkShmRing(int numFrames, int samplesPerFrame) {
+    const char *name = "/rssi_ring_bench";
+    std::vector<RssiSample> samples(samplesPerFrame);
+    for (int i = 0; i < samplesPerFrame; i++) samples[i] = {(uint64_t)i * 500'000, (uint8_t)(i & 0x7F)};
+    size_t frameBytes = samples.size() * sizeof(RssiSample);
+
+    // unpaced = throughput, paced at 10k frames/s = latency with an idle reader
+    for (double rate : {0.0, 10'000.0}) {
+        ShmRingWriter writer;
+        if (!shmRingCreate(writer, name, 1024, frameBytes)) return;
+
+        ShmBenchResult result = {};
+        histogramInit(result.latency, 0, 1'000);   // 0 - 64 us
+        std::thread reader(benchReader, name, (uint64_t)numFrames, &result);
+        while (__atomic_load_n(&result.attached, __ATOMIC_ACQUIRE) == 0) std::this_thread::yield();
+        if (result.attached < 0) {
+            fprintf(stderr, "ERROR: benchmark reader could not attach to %s\n", name);
+            reader.join();
+            shmRingDestroy(writer, true);
+            return;
+        }
+
+        Pacer pacer;
+        pacerInit(pacer, rate, 50'000);
+        uint64_t start = monotonicRawNs();
+        for (int f = 0; f < numFrames; f++) {
+            pacerWait(pacer);
+            shmRingPublishSamples(writer, 0, samples.data(), samplesPerFrame);
+        }
+        uint64_t elapsed = monotonicRawNs() - start;
+        reader.join();
+
+        printf("shm ring %s, %d x %d samples: writer %.2f M frames/s (%.2f GB/s), reader got %llu, lost %llu\n",
+               rate > 0 ? "paced 10 kHz" : "unpaced", numFrames, samplesPerFrame, numFrames * 1e3 / elapsed,
+               (double)numFrames * frameBytes / elapsed, (unsigned long long)result.frames, (unsigned long long)result.lost);
+        printf("    publish -> read latency: mean %.2f us, p50 %.2f us, p99 %.2f us, max %.2f us\n",
+               histogramMean(result.latency) / 1e3, histogramPercentile(result.latency, 50) / 1e3,
+               histogramPercentile(result.latency, 99) / 1e3, result.latency.max_ns / 1e3);
+        shmRingDestroy(writer, true);
+    }
+}
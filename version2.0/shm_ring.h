@@ -0,0 +1,108 @@
+#ifndef SHM_RING_H
+#define SHM_RING_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "capture_timing.h"
+
+// POSIX shared memory ring (/dev/shm/<name>) the acquisition side publishes frames into,
+// for any number of local reader processes (dashboards, loggers, alerting).
+//
+// Fixed size slots, slot = frame % numSlots. Every slot has its own seqlock: the writer sets
+// seq = 2 * frame + 1 while copying in, then 2 * frame + 2. A reader copies the slot out and
+// keeps it only if seq was 2 * frame + 2 before and after, so the writer never waits on
+// readers and a reader that falls more than numSlots behind just loses frames (counted).
+// Frame numbers are claimed with an atomic add, so several acquisition threads can publish.
+//
+// layout: ShmRingHeader | numSlots x (ShmSlotHeader + slotBytes payload)
+
+constexpr char SHM_RING_MAGIC[4] = {'R', 'S', 'S', 'R'};
+constexpr uint16_t SHM_RING_VERSION = 1;
+constexpr uint32_t SHM_RING_SLOTS = 1024;    // default depth, frames a reader may fall behind
+constexpr uint32_t SHM_RING_MAX_SLOT_BYTES = 64 * 1024;    // payload per slot (64 MB at the default depth)
+
+enum ShmFrameType : uint8_t {
+    SHM_FRAME_SAMPLES = 0,  // numValues RssiSample of one radio
+    SHM_FRAME_SWEEP = 1,    // numValues float dBm, channel i at freq_hz + i * step_hz
+    SHM_FRAME_DIVERSITY = 2 // numValues float, DIV_STAT_FIELDS per branch (diversity.h)
+};
+
+struct ShmRingHeader {
+    char magic[4];
+    uint16_t version;
+    uint16_t headerBytes;   // sizeof(ShmRingHeader), readers check it
+    uint32_t numSlots;
+    uint32_t slotBytes;     // payload bytes per slot
+    uint64_t writeCount;    // frames claimed so far (atomic)
+    uint64_t writerPid;
+    uint8_t pad[32];
+};
+
+struct ShmSlotHeader {
+    uint64_t seq;           // seqlock, see above (atomic)
+    uint64_t frame;
+    uint8_t type;           // ShmFrameType
+    uint8_t radio;
+    uint16_t reserved;
+    uint32_t numValues;
+    uint64_t t_ns;          // first sample / sweep start, CLOCK_MONOTONIC_RAW
+    uint64_t publish_ns;    // when the frame was published, CLOCK_MONOTONIC_RAW
+    uint32_t freq_hz;       // sweeps: first channel
+    uint32_t step_hz;       // sweeps: channel spacing
+    uint8_t pad[16];
+};
+
+static_assert(sizeof(ShmRingHeader) == 64, "ring header is part of the shared layout");
+static_assert(sizeof(ShmSlotHeader) == 64, "slot header is part of the shared layout");
+
+// writer side
+struct ShmRingWriter {
+    ShmRingHeader *header;
+    uint8_t *slots;
+    size_t slotStride;
+    size_t mapBytes;
+    char name[64];
+};
+
+// creates /dev/shm/<name>, name starts with '/'. Fails if the ring of a running writer has the
+// name, a stale one left by a writer that exited is replaced.
+bool shmRingCreate(ShmRingWriter &writer, const char *name, uint32_t numSlots, uint32_t slotBytes);
+// unmap, unlink = true removes the name (attached readers keep their mapping)
+void shmRingDestroy(ShmRingWriter &writer, bool unlink);
+
+// payload bytes are cut to slotBytes, returns the frame number
+uint64_t shmRingPublish(ShmRingWriter &writer, const ShmSlotHeader &frame, const void *payload, size_t payloadBytes);
+uint64_t shmRingPublishSamples(ShmRingWriter &writer, uint8_t radio, const RssiSample *samples, int numSamples);
+uint64_t shmRingPublishSweep(ShmRingWriter &writer, uint64_t t_ns, uint32_t freqHz, uint32_t stepHz,
+                             const float *dbm, int numChannels);
+
+// reader side, read only mapping
+struct ShmRingReader {
+    const ShmRingHeader *header;
+    const uint8_t *slots;
+    size_t slotStride;
+    size_t mapBytes;
+    uint64_t next;          // next frame to read
+    uint64_t lost;          // frames overwritten before we got to them
+};
+
+// startAtOldest = false: only frames published after attaching
+bool shmRingAttach(ShmRingReader &reader, const char *name, bool startAtOldest);
+void shmRingDetach(ShmRingReader &reader);
+
+// copy the next frame out: 1 = got one, 0 = nothing new yet
+// payload gets min(numValues * value size, maxPayloadBytes) bytes
+int shmRingRead(ShmRingReader &reader, ShmSlotHeader *frame, void *payload, size_t maxPayloadBytes);
+
+// zero copy: pointer to the next frame's slot in the mapping (NULL = nothing new yet).
+// Use the data, then shmRingRelease(); false = the writer overwrote it meanwhile, drop what was read.
+const ShmSlotHeader *shmRingPeek(ShmRingReader &reader);
+bool shmRingRelease(ShmRingReader &reader, const ShmSlotHeader *slot);
+
+inline const void *shmSlotPayload(const ShmSlotHeader *slot) { return slot + 1; }
+
+// writer thread -> reader in another mapping: frames/s, GB/s and publish -> read latency
+void benchmarkShmRing(int numFrames, int samplesPerFrame);
+
+#endif
@@ -0,0 +1,378 @@
+#include <string.h>             // memset(), memcpy()
+#include <stdio.h>              // printf()
+#include <unistd.h>             // usleep()
+#include <vector>
+
+#include "spi_queue.h"
+#include "spi_trace.h"          // spiTransfer()
+#include "futex.h"              // futexWait(), futexWake()
+#include "cc1101_config.h"
+
+void spiCommandInit(SpiCommand &cmd, SpiCommandKind kind, SpiPriority priority, uint8_t reg, uint8_t len) {
+    memset(&cmd, 0, sizeof(cmd));
+    cmd.kind = kind;
+    cmd.priority = priority < SPI_NUM_PRIORITIES ? priority : SPI_PRIO_TELEMETRY;
+    cmd.reg = reg;
+    cmd.len = len < SPI_QUEUE_MAX_DATA ? len : SPI_QUEUE_MAX_DATA;
+}
+
+void spiSubmit(SpiExecutor &ex, SpiCommand &cmd) {
+    cmd.done = 0;
+    cmd.ok = false;
+    cmd.submit_ns = monotonicRawNs();
+
+    SpiCommand **inbox = &ex.inbox[ex.prioritize ? cmd.priority : 0];
+    SpiCommand *head = __atomic_load_n(inbox, __ATOMIC_RELAXED);
+    do {
+        cmd.next = head;
+    } while (!__atomic_compare_exchange_n(inbox, &head, &cmd, true, __ATOMIC_RELEASE, __ATOMIC_RELAXED));
+
+    __atomic_fetch_add(&ex.wakeSeq, 1, __ATOMIC_SEQ_CST);
+    if (__atomic_load_n(&ex.sleeping, __ATOMIC_SEQ_CST)) futexWake(&ex.wakeSeq);
+}
+
+bool spiWait(SpiCommand &cmd, uint64_t timeoutNs) {
+    uint64_t deadline = monotonicRawNs() + timeoutNs;
+    uint32_t pending = 0;
+    while (__atomic_load_n(&cmd.done, __ATOMIC_ACQUIRE) != 1) {
+        // 2 = someone sleeps on it, so completion only pays for the wake when needed
+        if (!__atomic_compare_exchange_n(&cmd.done, &pending, 2, false, __ATOMIC_ACQUIRE, __ATOMIC_ACQUIRE) &&
+            pending == 1)
+            break;
+        pending = 0;
+        struct timespec ts, *timeout = NULL;
+        if (timeoutNs) {
+            uint64_t now = monotonicRawNs();
+            if (now >= deadline) return false;      // still queued, cmd must stay valid
+            ts.tv_sec = (deadline - now) / 1'000'000'000;
+            ts.tv_nsec = (deadline - now) % 1'000'000'000;
+            timeout = &ts;
+        }
+        futexWait(&cmd.done, 2, timeout);
+    }
+    return cmd.ok;
+}
+
+// one transfer of a message, several commands when merged
+struct XferPlan {
+    SpiCommandKind kind;
+    uint8_t reg;
+    uint8_t len;            // data bytes after the header
+    uint16_t delayUs;
+};
+
+struct PendingList {
+    SpiCommand *head;
+    SpiCommand *tail;
+};
+
+struct MessageBuffers {
+    XferPlan plans[SPI_QUEUE_MAX_XFERS];
+    uint8_t tx[SPI_QUEUE_MAX_XFERS][1 + SPI_QUEUE_MAX_DATA];
+    uint8_t rx[SPI_QUEUE_MAX_XFERS][1 + SPI_QUEUE_MAX_DATA];
+    struct spi_ioc_transfer xfers[SPI_QUEUE_MAX_XFERS];
+    SpiCommand *cmds[SPI_QUEUE_MAX_CMDS];
+    uint8_t cmdXfer[SPI_QUEUE_MAX_CMDS];
+    uint8_t cmdOffset[SPI_QUEUE_MAX_CMDS];
+};
+
+// inbox stacks -> pending lists in submit order, returns true if anything is pending
+static bool takeInbox(SpiExecutor &ex, PendingList *pending) {
+    bool any = false;
+    for (int p = 0; p < SPI_NUM_PRIORITIES; p++) {
+        SpiCommand *stack = __atomic_exchange_n(&ex.inbox[p], (SpiCommand *)NULL, __ATOMIC_ACQUIRE);
+        SpiCommand *list = NULL, *last = stack;
+        while (stack) {
+            SpiCommand *next = stack->next;
+            stack->next = list;
+            list = stack;
+            stack = next;
+        }
+        if (list) {
+            if (pending[p].tail) pending[p].tail->next = list;
+            else pending[p].head = list;
+            pending[p].tail = last;
+        }
+        any |= pending[p].head != NULL;
+    }
+    return any;
+}
+
+static uint8_t headerByte(const XferPlan &plan) {
+    switch (plan.kind) {
+    case SPI_CMD_READ:
+        if (plan.reg >= CFG_REGISTER && plan.reg != TXRXFIFO) return plan.reg | READ_BURST;    // status space
+        return plan.reg | (plan.len > 1 ? READ_BURST : READ_SINGLE_BYTE);
+    case SPI_CMD_WRITE:
+        return plan.reg | (plan.len > 1 ? WRITE_BURST : WRITE_SINGLE_BYTE);
+    default:
+        return plan.reg;
+    }
+}
+
+// cmd joins plan's burst: config registers only, reads may overlap, writes must follow on
+static bool canMerge(const XferPlan &plan, const SpiCommand &cmd) {
+    if (plan.kind != cmd.kind || plan.delayUs || cmd.delayUs) return false;
+    if (plan.kind != SPI_CMD_READ && plan.kind != SPI_CMD_WRITE) return false;
+    uint32_t planEnd = plan.reg + plan.len;
+    uint32_t cmdEnd = cmd.reg + cmd.len;
+    if (plan.reg >= CFG_REGISTER || cmdEnd > CFG_REGISTER || cmd.len == 0) return false;
+    if (plan.kind == SPI_CMD_WRITE) return cmd.reg == planEnd;
+    return cmd.reg >= plan.reg && cmd.reg <= planEnd;
+}
+
+static void complete(SpiCommand &cmd) {
+    if (cmd.callback) {
+        __atomic_store_n(&cmd.done, 1, __ATOMIC_RELEASE);
+        cmd.callback(cmd, cmd.ctx);         // may submit cmd again
+        return;
+    }
+    if (__atomic_exchange_n(&cmd.done, 1, __ATOMIC_RELEASE) == 2)
+        futexWake(&cmd.done);               // cmd may be gone already, a stray wake is harmless
+}
+
+// builds one message from the front of list and runs it, or one exclusive command
+static void serve(SpiExecutor &ex, PendingList &list, MessageBuffers &m) {
+    SpiQueueStats &stats = ex.stats;
+    SpiTransferFn transfer = ex.transfer ? ex.transfer : spiTransfer;
+
+    if (list.head->kind == SPI_CMD_EXCLUSIVE) {
+        SpiCommand &cmd = *list.head;
+        list.head = cmd.next;
+        if (!list.head) list.tail = NULL;
+        cmd.start_ns = monotonicRawNs();
+        histogramAdd(stats.queueLatency[cmd.priority], cmd.start_ns - cmd.submit_ns);
+        stats.commands[cmd.priority]++;
+        if (cmd.run) cmd.run(ex.fd, cmd.ctx);
+        cmd.ok = cmd.run != NULL;
+        cmd.done_ns = monotonicRawNs();
+        complete(cmd);
+        return;
+    }
+
+    int numXfers = 0, numCmds = 0;
+    while (list.head && list.head->kind != SPI_CMD_EXCLUSIVE && numCmds < SPI_QUEUE_MAX_CMDS) {
+        SpiCommand &cmd = *list.head;
+        if (numXfers > 0 && canMerge(m.plans[numXfers - 1], cmd)) {
+            XferPlan &plan = m.plans[numXfers - 1];
+            uint32_t end = cmd.reg + cmd.len;
+            if (end > (uint32_t)plan.reg + plan.len) plan.len = end - plan.reg;
+            stats.merged++;
+        } else {
+            if (numXfers == SPI_QUEUE_MAX_XFERS) break;
+            m.plans[numXfers++] = {cmd.kind, cmd.reg, cmd.kind == SPI_CMD_STROBE ? (uint8_t)0 : cmd.len, cmd.delayUs};
+        }
+        m.cmds[numCmds] = &cmd;
+        m.cmdXfer[numCmds] = numXfers - 1;
+        m.cmdOffset[numCmds] = cmd.kind == SPI_CMD_STROBE ? 0 : cmd.reg - m.plans[numXfers - 1].reg;
+        numCmds++;
+        list.head = cmd.next;
+        if (!list.head) list.tail = NULL;
+    }
+
+    memset(m.xfers, 0, numXfers * sizeof(m.xfers[0]));
+    for (int x = 0; x < numXfers; x++) {
+        m.tx[x][0] = headerByte(m.plans[x]);
+        memset(&m.tx[x][1], 0, m.plans[x].len);
+        m.xfers[x].tx_buf = (unsigned long)m.tx[x];
+        m.xfers[x].rx_buf = (unsigned long)m.rx[x];
+        m.xfers[x].len = 1 + m.plans[x].len;
+        m.xfers[x].delay_usecs = m.plans[x].delayUs;
+        m.xfers[x].cs_change = (x < numXfers - 1);
+    }
+    for (int c = 0; c < numCmds; c++)
+        if (m.cmds[c]->kind == SPI_CMD_WRITE)
+            memcpy(&m.tx[m.cmdXfer[c]][1 + m.cmdOffset[c]], m.cmds[c]->data, m.cmds[c]->len);
+
+    uint64_t start = monotonicRawNs();
+    bool ok = transfer(ex.fd, m.xfers, numXfers) >= 0;
+    uint64_t end = monotonicRawNs();
+
+    stats.messages++;
+    stats.transfers += numXfers;
+    if (!ok) stats.failed += numCmds;
+    for (int c = 0; c < numCmds; c++) {
+        SpiCommand &cmd = *m.cmds[c];
+        const uint8_t *rx = m.rx[m.cmdXfer[c]];
+        cmd.status = rx[0];
+        if (cmd.kind == SPI_CMD_READ) memcpy(cmd.data, &rx[1 + m.cmdOffset[c]], cmd.len);
+        cmd.ok = ok;
+        cmd.start_ns = start;
+        cmd.done_ns = end;
+        histogramAdd(stats.queueLatency[cmd.priority], start - cmd.submit_ns);
+        stats.commands[cmd.priority]++;
+        complete(cmd);
+    }
+}
+
+static void executorRun(SpiExecutor &ex) {
+    static thread_local MessageBuffers m;   // ~4 KB + 1.5 KB of transfers, one per executor thread
+    PendingList pending[SPI_NUM_PRIORITIES] = {};
+
+    for (;;) {
+        uint32_t seq = __atomic_load_n(&ex.wakeSeq, __ATOMIC_SEQ_CST);
+        if (!takeInbox(ex, pending)) {
+            if (__atomic_load_n(&ex.stopping, __ATOMIC_ACQUIRE)) break;
+            __atomic_store_n(&ex.sleeping, 1, __ATOMIC_SEQ_CST);
+            futexWait(&ex.wakeSeq, seq, NULL);      // returns at once if anything was submitted since seq
+            __atomic_store_n(&ex.sleeping, 0, __ATOMIC_SEQ_CST);
+            continue;
+        }
+        int p = 0;
+        while (!pending[p].head) p++;
+        serve(ex, pending[p], m);
+    }
+}
+
+void spiExecutorStart(SpiExecutor &ex, int fd, SpiTransferFn transfer) {
+    ex.fd = fd;
+    ex.transfer = transfer;
+    for (auto &inbox : ex.inbox) inbox = NULL;
+    ex.wakeSeq = 0;
+    ex.sleeping = 0;
+    ex.stopping = false;
+    ex.stats = SpiQueueStats{};
+    for (auto &hist : ex.stats.queueLatency) histogramInit(hist, 0, 25'000);    // 25 us bins, 0..1.6 ms
+    ex.thread = std::thread(executorRun, std::ref(ex));
+}
+
+void spiExecutorStop(SpiExecutor &ex) {
+    if (!ex.thread.joinable()) return;
+    __atomic_store_n(&ex.stopping, true, __ATOMIC_RELEASE);
+    __atomic_fetch_add(&ex.wakeSeq, 1, __ATOMIC_SEQ_CST);
+    futexWake(&ex.wakeSeq);
+    ex.thread.join();
+}
+
+bool spiQueueRead(SpiExecutor &ex, SpiPriority priority, uint8_t reg, uint8_t *out, uint8_t len) {
+    if (len == 0 || len > SPI_QUEUE_MAX_DATA) return false;
+    SpiCommand cmd;
+    spiCommandInit(cmd, SPI_CMD_READ, priority, reg, len);
+    spiSubmit(ex, cmd);
+    if (!spiWait(cmd)) return false;
+    memcpy(out, cmd.data, len);
+    return true;
+}
+
+bool spiQueueWrite(SpiExecutor &ex, SpiPriority priority, uint8_t reg, const uint8_t *data, uint8_t len) {
+    if (len == 0 || len > SPI_QUEUE_MAX_DATA) return false;
+    SpiCommand cmd;
+    spiCommandInit(cmd, SPI_CMD_WRITE, priority, reg, len);
+    memcpy(cmd.data, data, len);
+    spiSubmit(ex, cmd);
+    return spiWait(cmd);
+}
+
+bool spiQueueStrobe(SpiExecutor &ex, SpiPriority priority, uint8_t strobe, uint8_t *status) {
+    SpiCommand cmd;
+    spiCommandInit(cmd, SPI_CMD_STROBE, priority, strobe, 0);
+    spiSubmit(ex, cmd);
+    bool ok = spiWait(cmd);
+    if (status) *status = cmd.status;
+    return ok;
+}
+
+bool spiQueueExclusive(SpiExecutor &ex, SpiPriority priority, void (*run)(int fd, void *ctx), void *ctx) {
+    SpiCommand cmd;
+    spiCommandInit(cmd, SPI_CMD_EXCLUSIVE, priority, 0, 0);
+    cmd.run = run;
+    cmd.ctx = ctx;
+    spiSubmit(ex, cmd);
+    return spiWait(cmd);
+}
+
+void printSpiQueueStats(const SpiQueueStats &stats) {
+    static const char *names[SPI_NUM_PRIORITIES] = {"tx", "strobe", "config", "telemetry"};
+    uint64_t total = 0;
+    for (int p = 0; p < SPI_NUM_PRIORITIES; p++) {
+        const Histogram &h = stats.queueLatency[p];
+        total += stats.commands[p];
+        if (!stats.commands[p]) continue;
+        printf("    %-10s %9llu cmds  queued mean %7.1f us  p50 %6.0f us  p99 %6.0f us  max %7.0f us\n", names[p],
+               (unsigned long long)stats.commands[p], histogramMean(h) / 1e3, histogramPercentile(h, 50) / 1e3,
+               histogramPercentile(h, 99) / 1e3, h.max_ns / 1e3);
+    }
+    printf("    %llu ioctls, %.1f transfers + %.1f commands each, %llu merged into bursts, %llu failed\n",
+           (unsigned long long)stats.messages, stats.messages ? (double)stats.transfers / stats.messages : 0.0,
+           stats.messages ? (double)total / stats.messages : 0.0, (unsigned long long)stats.merged,
+           (unsigned long long)stats.failed);
+}
+
+static int simulatedTransfer(int, struct spi_ioc_transfer *xfers, int numXfers) {
+    uint64_t start = monotonicRawNs();
+    for (int x = 0; x < numXfers; x++) {
+        uint8_t *rx = (uint8_t *)xfers[x].rx_buf;
+        const uint8_t *tx = (const uint8_t *)xfers[x].tx_buf;
+        for (uint32_t i = 0; rx && i < xfers[x].len; i++) rx[i] = i ? (tx[0] & 0x3F) + i - 1 : 0x0F;    // register = its address
+    }
+    return simBusWait(start, xfers, numXfers);
+}
+
+// TX: 61 byte TX FIFO write + SFTX every 5 ms (no STX, nothing goes on air with a real radio)
+// strobe: SNOP every 1 ms, config: CHANNR write + FSCAL3..1 read every 2 ms
+// telemetry: 4 threads, back to back batches of 8 x (RSSI, MARCSTATE, PKTSTATUS, FREQ2, FREQ1, FREQ0)
+static void runLoad(SpiExecutor &ex, double seconds, bool &mismatch) {
+    bool stop = false;
+    std::vector<std::thread> threads;
+
+    threads.emplace_back([&]() {
+        uint8_t payload[61];
+        for (int i = 0; i < 61; i++) payload[i] = i;
+        while (!__atomic_load_n(&stop, __ATOMIC_RELAXED)) {
+            spiQueueWrite(ex, SPI_PRIO_TX, TXRXFIFO, payload, sizeof(payload));
+            spiQueueStrobe(ex, SPI_PRIO_TX, SFTX, NULL);
+            usleep(5000);
+        }
+    });
+    threads.emplace_back([&]() {
+        while (!__atomic_load_n(&stop, __ATOMIC_RELAXED)) {
+            spiQueueStrobe(ex, SPI_PRIO_STROBE, SNOP, NULL);
+            usleep(1000);
+        }
+    });
+    threads.emplace_back([&]() {
+        uint8_t channel = 0, fscal[3];
+        while (!__atomic_load_n(&stop, __ATOMIC_RELAXED)) {
+            spiQueueWrite(ex, SPI_PRIO_CONFIG, CHANNR, &channel, 1);
+            spiQueueRead(ex, SPI_PRIO_CONFIG, FSCAL3, fscal, 3);
+            usleep(2000);
+        }
+    });
+    for (int t = 0; t < 4; t++) {
+        threads.emplace_back([&]() {
+            static const uint8_t regs[] = {RSSI, MARCSTATE, PKTSTATUS, FREQ2, FREQ1, FREQ0};
+            constexpr int N = 8 * sizeof(regs);      // 48 in flight per thread
+            SpiCommand cmds[N];
+            while (!__atomic_load_n(&stop, __ATOMIC_RELAXED)) {
+                for (int i = 0; i < N; i++) {
+                    spiCommandInit(cmds[i], SPI_CMD_READ, SPI_PRIO_TELEMETRY, regs[i % sizeof(regs)], 1);
+                    spiSubmit(ex, cmds[i]);
+                }
+                for (int i = 0; i < N; i++) spiWait(cmds[i]);
+                // the simulated bus reads every register as its address, merged into a burst or not
+                for (int i = 0; i < N && ex.fd < 0; i++)
+                    if (cmds[i].data[0] != regs[i % sizeof(regs)]) __atomic_store_n(&mismatch, true, __ATOMIC_RELAXED);
+            }
+        });
+    }
+
+    usleep((useconds_t)(seconds * 1e6));
+    __atomic_store_n(&stop, true, __ATOMIC_RELAXED);
+    for (auto &t : threads) t.join();
+}
+
+void benchmarkSpiQueue(int fd, double seconds) {
+    printf("SPI queue: %s, %.1f s per run, 1 TX + 1 strobe + 1 config + 4 telemetry threads\n",
+           fd < 0 ? "simulated bus (20 us/ioctl, 5 MHz)" : "radio", seconds);
+
+    for (bool prioritize : {true, false}) {
+        SpiExecutor ex;
+        ex.prioritize = prioritize;
+        bool mismatch = false;
+        spiExecutorStart(ex, fd, fd < 0 ? simulatedTransfer : NULL);
+        runLoad(ex, seconds, mismatch);
+        spiExecutorStop(ex);
+        printf("  %s%s\n", prioritize ? "priorities" : "one FIFO for all", mismatch ? "  (DATA MISMATCH)" : "");
+        printSpiQueueStats(ex.stats);
+    }
+}
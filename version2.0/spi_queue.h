@@ -0,0 +1,115 @@
+#ifndef SPI_QUEUE_H
+#define SPI_QUEUE_H
+
+#include <stdint.h>
+#include <thread>
+
+#include <linux/spi/spidev.h>   // spi_ioc_transfer
+
+#include "capture_timing.h"     // Histogram
+#include "spi_util.h"           // SpiTransferFn
+
+// One executor thread per radio owns the fd, every other thread hands it commands.
+//
+// Submitting is lock free: each priority class has an intrusive stack (CAS push, any number
+// of producers), the executor takes a whole stack with one exchange and reverses it, so a
+// class is served FIFO. Before every ioctl the executor picks the highest class with work,
+// so TX and strobes wait for at most the message already on the bus, never for telemetry.
+//
+// A message is built from the front of that class: up to SPI_QUEUE_MAX_XFERS transfers (CSn
+// released between them) in one SPI_IOC_MESSAGE, and back to back config register reads
+// (same or following addresses) or writes (following addresses) merged into one burst.
+// Order is only kept within a class, use one class for accesses that depend on each other.
+//
+// Completion: a callback on the executor thread (keep it short, it may submit again), or
+// spiWait() on the command (futex) for future style use. The command memory belongs to the
+// caller and must stay valid until then.
+
+constexpr int SPI_QUEUE_MAX_XFERS = 32;     // transfers per ioctl
+constexpr int SPI_QUEUE_MAX_CMDS = 64;      // commands per ioctl (after merging)
+constexpr int SPI_QUEUE_MAX_DATA = 64;      // bytes per command (FIFO size)
+
+enum SpiPriority : uint8_t {
+    SPI_PRIO_TX = 0,            // TX FIFO writes, STX
+    SPI_PRIO_STROBE = 1,        // state changes
+    SPI_PRIO_CONFIG = 2,        // register writes / reads for reconfiguration
+    SPI_PRIO_TELEMETRY = 3,     // RSSI, MARCSTATE, counters
+    SPI_NUM_PRIORITIES = 4
+};
+
+enum SpiCommandKind : uint8_t {
+    SPI_CMD_READ = 0,           // len registers from reg (status registers: len 1, FIFO: 0x3F)
+    SPI_CMD_WRITE = 1,          // len bytes of data to reg (PATABLE 0x3E, TX FIFO 0x3F)
+    SPI_CMD_STROBE = 2,         // reg = strobe
+    SPI_CMD_EXCLUSIVE = 3       // run(fd, ctx) on the executor thread between messages
+};
+
+struct SpiCommand;
+typedef void (*SpiCallback)(SpiCommand &cmd, void *ctx);
+
+struct SpiCommand {
+    SpiCommandKind kind;
+    SpiPriority priority;
+    uint8_t reg;
+    uint8_t len;
+    uint16_t delayUs;                   // kernel timed gap after its transfer
+    uint8_t data[SPI_QUEUE_MAX_DATA];   // write: in, read: out
+    uint8_t status;                     // chip status byte seen with the header byte
+    bool ok;
+    void (*run)(int fd, void *ctx);     // SPI_CMD_EXCLUSIVE
+    SpiCallback callback;               // NULL = wait with spiWait()
+    void *ctx;
+
+    uint64_t submit_ns;                 // CLOCK_MONOTONIC_RAW
+    uint64_t start_ns;                  // its ioctl started
+    uint64_t done_ns;
+    uint32_t done;                      // futex word, 1 = completed
+    SpiCommand *next;                   // queue link
+};
+
+struct SpiQueueStats {
+    uint64_t commands[SPI_NUM_PRIORITIES];
+    Histogram queueLatency[SPI_NUM_PRIORITIES];     // submit -> ioctl start
+    uint64_t messages;                  // ioctls
+    uint64_t transfers;
+    uint64_t merged;                    // commands that rode in another command's burst
+    uint64_t failed;                    // commands of failed ioctls
+};
+
+struct SpiExecutor {
+    int fd = -1;
+    SpiTransferFn transfer = NULL;      // NULL = spiTransfer()
+    bool prioritize = true;             // false = every class in one FIFO (for comparison)
+
+    SpiCommand *inbox[SPI_NUM_PRIORITIES] = {};     // lock free stacks (atomic)
+    uint32_t wakeSeq = 0;               // futex word, bumped on every submit (atomic)
+    uint32_t sleeping = 0;              // executor waits on wakeSeq (atomic)
+    bool stopping = false;              // (atomic)
+    std::thread thread;
+
+    SpiQueueStats stats;                // written by the executor only, read after spiExecutorStop()
+};
+
+void spiExecutorStart(SpiExecutor &ex, int fd, SpiTransferFn transfer = NULL);
+// serves what was submitted before, then joins the thread
+void spiExecutorStop(SpiExecutor &ex);
+
+// command on the stack / in the caller's struct, then spiSubmit()
+void spiCommandInit(SpiCommand &cmd, SpiCommandKind kind, SpiPriority priority, uint8_t reg, uint8_t len);
+void spiSubmit(SpiExecutor &ex, SpiCommand &cmd);
+// waits for a command without callback, timeoutNs = 0 waits forever, returns cmd.ok (false on timeout)
+bool spiWait(SpiCommand &cmd, uint64_t timeoutNs = 0);
+
+// blocking wrappers
+bool spiQueueRead(SpiExecutor &ex, SpiPriority priority, uint8_t reg, uint8_t *out, uint8_t len);
+bool spiQueueWrite(SpiExecutor &ex, SpiPriority priority, uint8_t reg, const uint8_t *data, uint8_t len);
+bool spiQueueStrobe(SpiExecutor &ex, SpiPriority priority, uint8_t strobe, uint8_t *status);
+bool spiQueueExclusive(SpiExecutor &ex, SpiPriority priority, void (*run)(int fd, void *ctx), void *ctx);
+
+void printSpiQueueStats(const SpiQueueStats &stats);
+
+// TX / strobe / config / telemetry threads on one executor for seconds each with and without
+// priorities, queueing latency per class. fd < 0 = simulated bus (no radio needed)
+void benchmarkSpiQueue(int fd, double seconds);
+
+#endif
@@ -0,0 +1,433 @@
+#include <string.h>             // memcpy(), memcmp(), memset()
+#include <stdio.h>              // fopen(), fwrite(), printf()
+#include <unistd.h>             // write(), readlink(), access(), close()
+#include <fcntl.h>              // open()
+#include <sys/ioctl.h>          // ioctl()
+#include <errno.h>              // errno, EIO
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "spi_trace.h"
+#include "pacer.h"              // monotonicNs(), sleepUntil()
+
+enum SpiBackend { SPI_DIRECT, SPI_RECORD, SPI_REPLAY };
+
+constexpr size_t TRACE_RECORD_HEADER = 16;
+constexpr size_t TRACE_XFER_HEADER = 4;
+constexpr size_t TRACE_FLUSH_BYTES = 1 << 20;
+constexpr uint8_t XFER_HAS_RX = 0x01;
+constexpr uint8_t XFER_CS_CHANGE = 0x02;
+constexpr uint8_t KIND_FAILED = 0x80;          // or'd into the kind: the ioctl / write returned < 0
+constexpr int MAX_FDS = 1024;
+
+static std::atomic<int> backend{SPI_DIRECT};   // read by every shard on every transfer
+
+// record: messages go into traceBuff, a full one is swapped with traceSpare and the writer
+// thread writes that out, so the file I/O is never on the thread doing SPI
+static std::mutex traceLock;
+static FILE *traceFile;
+static std::vector<uint8_t> traceBuff;
+static std::vector<uint8_t> traceSpare;
+static bool traceWriting;               // traceSpare is the writer's until it's done
+static bool traceQuit;
+static std::condition_variable traceWake;
+static std::thread traceWriter;
+static uint64_t traceT0;
+static uint64_t traceBytes;
+static int traceDevice[MAX_FDS];        // fd -> device number + 1, 0 = not announced yet, cleared on open/close
+static std::vector<std::string> tracePaths;     // device number -> path, a reopened path keeps its number
+
+// replay
+struct ReplayDevice {
+    std::string path;
+    std::vector<size_t> records;        // offsets of its message / write records in replayData
+    size_t next;
+};
+static std::vector<uint8_t> replayData;
+static std::vector<ReplayDevice> replayDevices;
+static int replayFd[MAX_FDS];           // stand in fd -> device number + 1
+static bool replayPace;
+static uint64_t replayStart;
+static SpiReplayStats replayStats;
+
+template <typename T> static inline void putLE(uint8_t *p, T v) { memcpy(p, &v, sizeof(T)); }
+template <typename T> static inline T getLE(const uint8_t *p) { T v; memcpy(&v, p, sizeof(T)); return v; }
+
+// ===================== record =====================
+
+static void writeTrace(std::vector<uint8_t> &buff) {
+    if (buff.empty()) return;
+    fwrite(buff.data(), 1, buff.size(), traceFile);
+    traceBytes += buff.size();
+    buff.clear();
+}
+
+static void traceWriterLoop() {
+    std::unique_lock<std::mutex> lock(traceLock);
+    for (;;) {
+        traceWake.wait(lock, [] { return traceWriting || traceQuit; });
+        if (!traceWriting) return;
+        lock.unlock();
+        writeTrace(traceSpare);                     // traceBytes: only read once the writer is joined
+        lock.lock();
+        traceWriting = false;
+    }
+}
+
+static uint8_t *appendRecord(size_t bytes) {
+    size_t at = traceBuff.size();
+    traceBuff.resize(at + bytes);
+    return traceBuff.data() + at;
+}
+
+// the device an fd is on, announced with an open record the first time its path shows up
+// (fds opened before the trace started included, the path comes from /proc)
+static int traceDeviceOf(int fd, uint64_t t_ns) {
+    if (fd < 0 || fd >= MAX_FDS) return 0xFFFF;
+    if (traceDevice[fd]) return traceDevice[fd] - 1;
+
+    char link[32], path[256];
+    snprintf(link, sizeof(link), "/proc/self/fd/%d", fd);
+    ssize_t len = readlink(link, path, sizeof(path) - 1);
+    if (len < 0) len = 0;
+
+    for (size_t d = 0; d < tracePaths.size(); d++) {
+        if (tracePaths[d].compare(0, std::string::npos, path, len) == 0) {
+            traceDevice[fd] = d + 1;
+            return d;
+        }
+    }
+    int device = tracePaths.size();
+    tracePaths.emplace_back(path, len);
+    traceDevice[fd] = device + 1;
+    uint8_t *p = appendRecord(TRACE_RECORD_HEADER + 2 + len);
+    p[0] = SPI_TRACE_OPEN;
+    p[1] = 0;
+    putLE<uint16_t>(p + 2, device);
+    putLE<uint32_t>(p + 4, 0);
+    putLE<uint64_t>(p + 8, t_ns - traceT0);
+    putLE<uint16_t>(p + 16, len);
+    memcpy(p + 18, path, len);
+    return device;
+}
+
+static void traceMessage(SpiTraceKind kind, int fd, const struct spi_ioc_transfer *xfers, int numXfers,
+                         uint64_t start, uint64_t end, bool failed) {
+    std::lock_guard<std::mutex> lock(traceLock);
+    if (!traceFile) return;
+
+    uint16_t device = traceDeviceOf(fd, start);
+    size_t bytes = TRACE_RECORD_HEADER;
+    for (int i = 0; i < numXfers; i++) bytes += TRACE_XFER_HEADER + xfers[i].len * (xfers[i].rx_buf ? 2 : 1);
+
+    uint8_t *p = appendRecord(bytes);
+    p[0] = kind | (failed ? KIND_FAILED : 0);
+    p[1] = numXfers;
+    putLE<uint16_t>(p + 2, device);
+    putLE<uint32_t>(p + 4, (uint32_t)(end - start));
+    putLE<uint64_t>(p + 8, start - traceT0);
+    p += TRACE_RECORD_HEADER;
+
+    for (int i = 0; i < numXfers; i++) {
+        const struct spi_ioc_transfer &x = xfers[i];
+        putLE<uint16_t>(p, x.len);
+        p[2] = (x.rx_buf ? XFER_HAS_RX : 0) | (x.cs_change ? XFER_CS_CHANGE : 0);
+        p[3] = 0;
+        p += TRACE_XFER_HEADER;
+        if (x.tx_buf) memcpy(p, (const void *)(uintptr_t)x.tx_buf, x.len);
+        else memset(p, 0, x.len);
+        p += x.len;
+        if (x.rx_buf) {
+            memcpy(p, (const void *)(uintptr_t)x.rx_buf, x.len);
+            p += x.len;
+        }
+    }
+    // hand a full buffer to the writer (if it's still busy with the last one, this one grows)
+    if (traceBuff.size() >= TRACE_FLUSH_BYTES && !traceWriting) {
+        traceBuff.swap(traceSpare);
+        traceWriting = true;
+        traceWake.notify_one();
+    }
+}
+
+bool spiTraceStart(const char *filename) {
+    std::lock_guard<std::mutex> lock(traceLock);
+    traceFile = fopen(filename, "wb");
+    if (!traceFile) {
+        fprintf(stderr, "ERROR: Could not open %s for writing\n", filename);
+        return false;
+    }
+
+    traceBuff.clear();
+    traceBuff.reserve(TRACE_FLUSH_BYTES + 4096);
+    traceSpare.clear();
+    traceSpare.reserve(TRACE_FLUSH_BYTES + 4096);
+    traceWriting = traceQuit = false;
+    traceT0 = monotonicNs();
+    traceBytes = 0;
+    tracePaths.clear();
+    memset(traceDevice, 0, sizeof(traceDevice));
+
+    uint8_t *p = appendRecord(16);
+    memcpy(p, "SPIT", 4);
+    putLE<uint16_t>(p + 4, SPI_TRACE_VERSION);
+    putLE<uint16_t>(p + 6, 0);
+    putLE<uint64_t>(p + 8, traceT0);
+    traceWriter = std::thread(traceWriterLoop);
+    backend = SPI_RECORD;
+    return true;
+}
+
+uint64_t spiTraceStop() {
+    {
+        std::lock_guard<std::mutex> lock(traceLock);
+        if (!traceFile) return 0;
+        backend = SPI_DIRECT;
+        traceQuit = true;
+    }
+    traceWake.notify_one();
+    traceWriter.join();                                 // done with what it was handed
+
+    std::lock_guard<std::mutex> lock(traceLock);
+    writeTrace(traceBuff);
+    fclose(traceFile);
+    traceFile = NULL;
+    return traceBytes;
+}
+
+// ===================== replay =====================
+
+static bool loadTrace(const char *filename) {
+    FILE *f = fopen(filename, "rb");
+    if (!f) return false;
+    fseek(f, 0, SEEK_END);
+    long size = ftell(f);
+    fseek(f, 0, SEEK_SET);
+    replayData.resize(size > 0 ? size : 0);
+    bool ok = size >= 16 && fread(replayData.data(), 1, size, f) == (size_t)size;
+    fclose(f);
+    if (!ok || memcmp(replayData.data(), "SPIT", 4) != 0 || getLE<uint16_t>(&replayData[4]) != SPI_TRACE_VERSION) {
+        return false;
+    }
+
+    // split the records per device, each device replays in its own order
+    replayDevices.clear();
+    size_t pos = 16;
+    while (pos + TRACE_RECORD_HEADER <= replayData.size()) {
+        const uint8_t *p = &replayData[pos];
+        uint16_t device = getLE<uint16_t>(p + 2);
+        size_t end = pos + TRACE_RECORD_HEADER;
+
+        if (p[0] == SPI_TRACE_OPEN) {
+            if (end + 2 > replayData.size()) break;
+            uint16_t len = getLE<uint16_t>(&replayData[end]);
+            if (end + 2 + len > replayData.size()) break;
+            if (device >= replayDevices.size()) replayDevices.resize(device + 1);
+            replayDevices[device].path.assign((const char *)&replayData[end + 2], len);
+            pos = end + 2 + len;
+            continue;
+        }
+
+        for (int i = 0; i < p[1] && end + TRACE_XFER_HEADER <= replayData.size(); i++) {
+            uint16_t len = getLE<uint16_t>(&replayData[end]);
+            end += TRACE_XFER_HEADER + len * ((replayData[end + 2] & XFER_HAS_RX) ? 2 : 1);
+        }
+        if (end > replayData.size()) break;     // truncated trace (recorder killed): keep what's complete
+        if (device < replayDevices.size()) replayDevices[device].records.push_back(pos);
+        pos = end;
+    }
+    return true;
+}
+
+bool spiReplayStart(const char *filename, bool pace) {
+    if (!loadTrace(filename)) {
+        fprintf(stderr, "ERROR: %s is not a version %d SPI trace\n", filename, SPI_TRACE_VERSION);
+        return false;
+    }
+    memset(replayFd, 0, sizeof(replayFd));
+    replayStats = SpiReplayStats{};
+    replayPace = pace;
+    replayStart = monotonicNs();
+    backend = SPI_REPLAY;
+    return true;
+}
+
+SpiReplayStats spiReplayStop() {
+    backend = SPI_DIRECT;
+    replayData.clear();
+    replayDevices.clear();
+    memset(replayFd, 0, sizeof(replayFd));      // stand in fds point at devices that are gone
+    return replayStats;
+}
+
+static int replayMessage(int fd, struct spi_ioc_transfer *xfers, int numXfers) {
+    int device = (fd >= 0 && fd < MAX_FDS) ? replayFd[fd] - 1 : -1;
+    if (device < 0) return -1;
+
+    // the lock only covers the cursor and the stats, replayData doesn't change while replaying
+    ReplayDevice &dev = replayDevices[device];
+    std::unique_lock<std::mutex> lock(traceLock);
+    if (dev.next == dev.records.size()) {
+        replayStats.exhausted++;
+        return -1;
+    }
+    size_t record = dev.records[dev.next++];
+    lock.unlock();
+
+    const uint8_t *p = &replayData[record];
+    uint64_t done = replayStart + getLE<uint64_t>(p + 8) + getLE<uint32_t>(p + 4);
+    bool mismatch = p[1] != numXfers;
+    int total = 0;
+
+    const uint8_t *x = p + TRACE_RECORD_HEADER;
+    for (int i = 0; i < p[1] && i < numXfers; i++) {
+        uint16_t len = getLE<uint16_t>(x);
+        bool hasRx = x[2] & XFER_HAS_RX;
+        const uint8_t *tx = x + TRACE_XFER_HEADER;
+        const uint8_t *rx = tx + len;
+        x = rx + (hasRx ? len : 0);
+
+        if (len != xfers[i].len) {
+            mismatch = true;
+            continue;
+        }
+        if (xfers[i].tx_buf && memcmp(tx, (const void *)(uintptr_t)xfers[i].tx_buf, len) != 0) mismatch = true;
+        if (xfers[i].rx_buf) {
+            if (hasRx) memcpy((void *)(uintptr_t)xfers[i].rx_buf, rx, len);
+            else memset((void *)(uintptr_t)xfers[i].rx_buf, 0, len);
+        }
+        total += len;
+    }
+
+    lock.lock();
+    if (mismatch && !replayStats.mismatches++) replayStats.firstMismatch = replayStats.messages;
+    replayStats.messages++;
+    lock.unlock();
+
+    // pacing sleeps without the lock, other devices keep replaying meanwhile
+    if (replayPace && done > monotonicNs()) sleepUntil(done);
+    if (p[0] & KIND_FAILED) {
+        errno = EIO;
+        return -1;
+    }
+    return total;
+}
+
+// ===================== driver entry points =====================
+
+int spiOpen(const char *path) {
+    if (backend != SPI_REPLAY) {
+        int fd = open(path, O_RDWR);
+        if (fd >= 0 && fd < MAX_FDS) {
+            std::lock_guard<std::mutex> lock(traceLock);
+            traceDevice[fd] = 0;                // a reused fd number: look its path up again
+        }
+        return fd;
+    }
+
+    for (size_t d = 0; d < replayDevices.size(); d++) {
+        if (replayDevices[d].path != path) continue;
+        int fd = open("/dev/null", O_RDWR);     // real fd so close() etc. behave, ioctls on it just fail
+        if (fd >= 0 && fd < MAX_FDS) replayFd[fd] = d + 1;
+        return fd;
+    }
+    return -1;
+}
+
+int spiClose(int fd) {
+    if (fd >= 0 && fd < MAX_FDS) {
+        std::lock_guard<std::mutex> lock(traceLock);
+        traceDevice[fd] = 0;
+        replayFd[fd] = 0;
+    }
+    return close(fd);
+}
+
+bool spiExists(const char *path) {
+    if (backend != SPI_REPLAY) return access(path, F_OK) == 0;
+    for (const ReplayDevice &dev : replayDevices) {
+        if (dev.path == path) return true;
+    }
+    return false;
+}
+
+int spiTransfer(int fd, struct spi_ioc_transfer *xfers, int numXfers) {
+    int mode = backend.load(std::memory_order_acquire);
+    if (mode == SPI_REPLAY) return replayMessage(fd, xfers, numXfers);
+    if (mode == SPI_DIRECT) return ioctl(fd, SPI_IOC_MESSAGE(numXfers), xfers);
+
+    uint64_t start = monotonicNs();
+    int ret = ioctl(fd, SPI_IOC_MESSAGE(numXfers), xfers);
+    traceMessage(SPI_TRACE_MESSAGE, fd, xfers, numXfers, start, monotonicNs(), ret < 0);
+    return ret;
+}
+
+int spiWrite(int fd, const uint8_t *data, size_t len) {
+    struct spi_ioc_transfer xfer;
+    memset(&xfer, 0, sizeof(xfer));
+    xfer.tx_buf = (unsigned long)data;
+    xfer.len = len;
+
+    int mode = backend.load(std::memory_order_acquire);
+    if (mode == SPI_REPLAY) return replayMessage(fd, &xfer, 1);
+    if (mode == SPI_DIRECT) return write(fd, data, len);
+
+    uint64_t start = monotonicNs();
+    int ret = write(fd, data, len);
+    traceMessage(SPI_TRACE_WRITE, fd, &xfer, 1, start, monotonicNs(), ret < 0);
+    return ret;
+}
+
+// ===================== benchmark =====================
+
+void benchmarkSpiTrace(int numMessages) {
+    const char *filename = "/tmp/spi_trace_bench.spit";
+    int fd = open("/dev/null", O_RDWR);
+    if (fd < 0) return;
+
+    // RSSI reads as readRegister() does them: 2 byte transfer, rx = status + value
+    uint8_t tx[2] = {0xF4, 0x00}, rx[2] = {0x1F, 0xD0};
+    struct spi_ioc_transfer xfer;
+    memset(&xfer, 0, sizeof(xfer));
+    xfer.tx_buf = (unsigned long)tx;
+    xfer.rx_buf = (unsigned long)rx;
+    xfer.len = 2;
+
+    if (!spiTraceStart(filename)) return;
+    uint64_t start = monotonicNs();
+    for (int i = 0; i < numMessages; i++) {
+        rx[1] = (uint8_t)i;
+        traceMessage(SPI_TRACE_MESSAGE, fd, &xfer, 1, start, start + 1'000, false);
+    }
+    uint64_t recordNs = monotonicNs() - start;
+    uint64_t bytes = spiTraceStop();
+
+    // replay the same device path
+    char path[256];
+    char link[32];
+    snprintf(link, sizeof(link), "/proc/self/fd/%d", fd);
+    ssize_t len = readlink(link, path, sizeof(path) - 1);
+    path[len > 0 ? len : 0] = '\0';
+    spiClose(fd);
+
+    if (!spiReplayStart(filename, false)) return;
+    fd = spiOpen(path);
+    uint64_t wrong = 0;
+    start = monotonicNs();
+    for (int i = 0; i < numMessages; i++) {
+        spiTransfer(fd, &xfer, 1);
+        wrong += (rx[1] != (uint8_t)i);
+    }
+    uint64_t replayNs = monotonicNs() - start;
+    spiClose(fd);
+    SpiReplayStats stats = spiReplayStop();
+
+    printf("SPI trace, %d messages: record %.1f ns/message, %.1f bytes/message (%.1f MB)\n", numMessages,
+           (double)recordNs / numMessages, (double)bytes / numMessages, bytes / 1e6);
+    printf("    replay %.1f ns/message, %llu replayed, %llu mismatched, %llu wrong rx\n", (double)replayNs / numMessages,
+           (unsigned long long)stats.messages, (unsigned long long)stats.mismatches, (unsigned long long)wrong);
+}
@@ -0,0 +1,62 @@
+#ifndef SPI_TRACE_H
+#define SPI_TRACE_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include <linux/spi/spidev.h>   // spi_ioc_transfer
+
+// Every SPI access of the drivers goes through spiTransfer() / spiWrite(), which normally
+// are just ioctl(SPI_IOC_MESSAGE) / write() on spidev. Two optional backends sit under them:
+//
+//   record: spidev as usual + every open, message and write (tx bytes, rx bytes, fd,
+//           CLOCK_MONOTONIC start + duration) appended to a binary trace
+//   replay: no spidev, openSPI() hands out stand in fds and every message gets its rx bytes
+//           from the trace (matched per device in order, tx bytes checked against it),
+//           optionally at the recorded pace
+//
+// trace: "SPIT" | u16 version | u16 reserved | u64 t0_ns | records ...
+// record: u8 kind (| 0x80 = it failed) | u8 numXfers | u16 device | u32 duration_ns | u64 t_ns (since t0)
+//         open: u16 pathLen | path
+//         message / write: per transfer u16 len | u8 flags | u8 reserved | tx[len] | rx[len] (if flags & HAS_RX)
+
+constexpr uint16_t SPI_TRACE_VERSION = 1;
+
+enum SpiTraceKind : uint8_t {
+    SPI_TRACE_OPEN = 1,
+    SPI_TRACE_MESSAGE = 2,
+    SPI_TRACE_WRITE = 3
+};
+
+struct SpiReplayStats {
+    uint64_t messages;      // replayed
+    uint64_t mismatches;    // tx bytes differed from the trace (driver took another path)
+    uint64_t exhausted;     // messages after the trace of that device ran out
+    uint64_t firstMismatch; // message number of the first mismatch (valid if mismatches)
+};
+
+// drop in for ioctl(fd, SPI_IOC_MESSAGE(n), xfers) / write(fd, data, len)
+int spiTransfer(int fd, struct spi_ioc_transfer *xfers, int numXfers);
+int spiWrite(int fd, const uint8_t *data, size_t len);
+
+// open() a spidev, or a stand in fd while replaying
+int spiOpen(const char *path);
+// close() it and forget its fd -> device mapping, the fd number may come back for another device
+int spiClose(int fd);
+// access(path, F_OK), or whether the trace has the device while replaying
+bool spiExists(const char *path);
+
+// record to filename until spiTraceStop(), returns false if it can't be created. Messages are
+// buffered, a writer thread writes full 1 MB buffers so the SPI thread never waits on the file.
+bool spiTraceStart(const char *filename);
+// returns bytes written
+uint64_t spiTraceStop();
+
+// replay filename, pace = true sleeps so every message completes at its recorded offset
+bool spiReplayStart(const char *filename, bool pace);
+SpiReplayStats spiReplayStop();
+
+// ns per traced message of record + replay and trace bytes per message
+void benchmarkSpiTrace(int numMessages);
+
+#endif
@@ -0,0 +1,38 @@
+#include <stdio.h>              // perror(), fopen(), fscanf()
+
+#include "spi_util.h"
+#include "spi_trace.h"          // spiTransfer()
+#include "capture_timing.h"     // monotonicRawNs()
+
+int spiXfer(SpiTransferFn transfer, int fd, struct spi_ioc_transfer *xfers, int numXfers) {
+    int ret = transfer ? transfer(fd, xfers, numXfers) : spiTransfer(fd, xfers, numXfers);
+    if (ret < 0) perror("SPI transfer failed");
+    return ret;
+}
+
+int spidevBufsiz() {
+    static int bufsiz = 0;
+    if (bufsiz) return bufsiz;
+    bufsiz = SPIDEV_DEFAULT_BUFSIZ;
+    FILE *f = fopen("/sys/module/spidev/parameters/bufsiz", "r");
+    if (f) {
+        if (fscanf(f, "%d", &bufsiz) != 1 || bufsiz <= 0) bufsiz = SPIDEV_DEFAULT_BUFSIZ;
+        fclose(f);
+    }
+    return bufsiz;
+}
+
+uint64_t simBusNs(const struct spi_ioc_transfer *xfers, int numXfers) {
+    uint64_t busy = SIM_IOCTL_NS;
+    for (int x = 0; x < numXfers; x++)
+        busy += xfers[x].len * SIM_BYTE_NS + SIM_CS_GAP_NS + xfers[x].delay_usecs * 1000ull;
+    return busy;
+}
+
+int simBusWait(uint64_t startRawNs, const struct spi_ioc_transfer *xfers, int numXfers) {
+    uint64_t busy = simBusNs(xfers, numXfers);
+    int bytes = 0;
+    for (int x = 0; x < numXfers; x++) bytes += xfers[x].len;
+    while (monotonicRawNs() - startRawNs < busy) {}
+    return bytes;
+}
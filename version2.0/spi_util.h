@@ -0,0 +1,42 @@
+#ifndef SPI_UTIL_H
+#define SPI_UTIL_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include <linux/spi/spidev.h>   // spi_ioc_transfer
+
+// Transfer functions for modules that run on a simulator or the executor instead of calling
+// spiTransfer() directly. Register access and strobes take one as their last argument
+// (main_drivers.h).
+
+typedef int (*SpiTransferFn)(int fd, struct spi_ioc_transfer *xfers, int numXfers);
+
+// transfer (NULL = spiTransfer()), perror() on failure
+int spiXfer(SpiTransferFn transfer, int fd, struct spi_ioc_transfer *xfers, int numXfers);
+
+// spidev refuses a message whose tx or rx bytes pass bufsiz (module parameter, 4096 by default).
+// Each transfer counts ALIGN(len, ARCH_DMA_MINALIGN): 64 on armv7, 128 on arm64 (before 6.5), so
+// a 2 byte read costs as much as 128 bytes; budget with the larger one.
+constexpr int SPIDEV_DEFAULT_BUFSIZ = 4096;
+constexpr int SPIDEV_DMA_ALIGN = 128;
+
+inline int spidevAlignedLen(int len) {
+    return (len + SPIDEV_DMA_ALIGN - 1) / SPIDEV_DMA_ALIGN * SPIDEV_DMA_ALIGN;
+}
+
+// /sys/module/spidev/parameters/bufsiz, read once
+int spidevBufsiz();
+
+// simulated spidev on a Pi for the benchmarks' stand in radios: ~20 us per ioctl, 5 MHz SCLK,
+// ~1 us CSn gap between transfers
+constexpr uint64_t SIM_IOCTL_NS = 20'000;
+constexpr uint64_t SIM_BYTE_NS = 1'600;
+constexpr uint64_t SIM_CS_GAP_NS = 1'000;
+
+// bus time of one message
+uint64_t simBusNs(const struct spi_ioc_transfer *xfers, int numXfers);
+// busy wait until a message started at startRawNs (monotonicRawNs()) is off the bus, returns its bytes
+int simBusWait(uint64_t startRawNs, const struct spi_ioc_transfer *xfers, int numXfers);
+
+#endif